@@ -1,5 +1,6 @@
 #include <base/Log.h>
 #include <net/EventLoop.h>
+#include <tcp/SharedBuffer.h>
 #include <tcp/TcpConnection.h>
 #include <tcp/TcpServer.h>
 #include <cstdint>
@@ -64,14 +65,16 @@ private:
                 assertTrue(requestHdr.mReqLength == request.size(), "[ChatServer] Bad request!");
                 std::string_view requestData { request.data() + sizeof(requestHdr), request.size() - sizeof(requestHdr) };
                 switch (requestHdr.mReqType) {
-                    case RequestType::Message:
+                    case RequestType::Message: {
                         LOG_INFO("{}: Message request, message: {}", __FUNCTION__, requestData);
+                        // Format message only once, all clients share the same buffer.
+                        auto message = SharedBuffer::fromString(
+                                fmt::format("[{}] {}", mClients.at(conn), requestData));
                         for (const auto& client : mClients) {
-                            const auto& clientName = mClients.at(conn);
-                            auto message = fmt::format("[{}] {}", clientName, requestData);
-                            client.first->sendString(message);
+                            client.first->send(message);
                         }
                         return;
+                    }
                     case RequestType::Register:
                         LOG_INFO("{}: Register request, new client :{}", __FUNCTION__, requestData);
                         assertTrue(mClients.count(conn) != 0, "[ChatServer] bad Connection!");
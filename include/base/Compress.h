@@ -1,8 +1,12 @@
 #pragma once
 
+#include "base/Utils.h"
+#include <cstdint>
 #include <string_view>
 #include <string>
 
+struct z_stream_s;
+
 // Compress wrapper of deflate, gzip, br
 namespace simpletcp::utils {
 
@@ -14,4 +18,50 @@ std::string compress_gzip(std::string_view source);
 
 std::string uncompress_gzip(std::string_view source, size_t source_len);
 
+enum class CompressFormat : uint8_t {
+    Deflate,
+    Gzip,
+};
+
+/*
+ * StreamCompressor
+ * Incremental deflate or gzip compressor for the body which is produced chunk by chunk. Every chunk is
+ * flushed by Z_SYNC_FLUSH, so the peer can decode it before the stream is finished.
+ * The z_stream is taken from the pool of current thread and reset by deflateReset, so the streams of one
+ * loop reuse the states instead of initializing and ending them for every response.
+ */
+class StreamCompressor final {
+public:
+    DISABLE_COPY(StreamCompressor);
+    DISABLE_MOVE(StreamCompressor);
+
+    // @throw : std::runtime_error if z_stream can't be initialized.
+    explicit StreamCompressor(CompressFormat format);
+
+    // The z_stream is returned to the pool of current thread.
+    ~StreamCompressor();
+
+    /**
+     * @brief compress : Compress data and flush it, the output may be empty for empty data.
+     *
+     * @throw : std::runtime_error if stream is finished or broken.
+     */
+    std::string compress(std::string_view data);
+
+    /**
+     * @brief finish : Finish the stream, return the end of compressed data, e.g. the trailer of gzip.
+     *
+     * @throw : std::runtime_error if stream is finished or broken.
+     */
+    std::string finish();
+
+private:
+    z_stream_s*                 mpStream;
+    CompressFormat              mFormat;
+    bool                        mIsFinished;
+
+    // Deflate input with flush mode, and append all output to result.
+    void deflateAll(std::string_view data, int flush, std::string& result);
+};
+
 } // namespace simpletcp::utils
@@ -0,0 +1,94 @@
+#pragma once
+#include "base/Utils.h"
+#include <atomic>
+#include <type_traits>
+
+namespace simpletcp::utils {
+
+/**
+ * @brief : The hook of MpscQueue, element of queue must derive from it.
+ */
+struct MpscNode {
+    std::atomic<MpscNode *> mNext { nullptr };
+};
+
+/*
+ * MpscQueue
+ * Intrusive multi-producer single-consumer queue(Dmitry Vyukov's algorithm).
+ * push is wait-free and can be invoked in any thread, pop can only be invoked by one consumer thread.
+ * Queue doesn't own the nodes, the consumer takes the ownership of popped node.
+ *
+ *  mTail(consumer)                                   mHead(producers)
+ *      |                                                   |
+ *      v                                                   v
+ *    node -> node -> node -> ........................ -> node -> nullptr
+ *
+ * */
+template <typename T>
+class MpscQueue final {
+    static_assert(std::is_base_of_v<MpscNode, T>, "[MpscQueue] element must derive from MpscNode!");
+public:
+    DISABLE_COPY(MpscQueue);
+    DISABLE_MOVE(MpscQueue);
+
+    MpscQueue() noexcept : mHead(&mStub), mTail(&mStub) {}
+
+    ~MpscQueue() = default;
+
+    /**
+     * @brief push : Push node to the end of queue. Thread-safety.
+     *
+     * @param node:
+     */
+    void push(T* node) noexcept { pushNode(node); }
+
+    /**
+     * @brief pop : Pop node from the front of queue. Only invoked by consumer.
+     *
+     * @return : The popped node, or nullptr if queue is empty or the pushing of producer is in progress.
+     *      In the latter case the producer must notify consumer after push, so the node would not be lost.
+     */
+    [[nodiscard]]
+    T* pop() noexcept {
+        MpscNode* tail = mTail;
+        MpscNode* next = tail->mNext.load(std::memory_order_acquire);
+        // Skip the stub node.
+        if (tail == &mStub) {
+            if (next == nullptr) {
+                return nullptr;
+            }
+            mTail = next;
+            tail = next;
+            next = next->mNext.load(std::memory_order_acquire);
+        }
+        if (next != nullptr) {
+            mTail = next;
+            return static_cast<T *>(tail);
+        }
+        // tail is the last node, or a producer has exchanged mHead but not linked the node yet.
+        if (tail != mHead.load(std::memory_order_acquire)) {
+            return nullptr;
+        }
+        // Push stub node, so the last node can be popped.
+        pushNode(&mStub);
+        next = tail->mNext.load(std::memory_order_acquire);
+        if (next != nullptr) {
+            mTail = next;
+            return static_cast<T *>(tail);
+        }
+        return nullptr;
+    }
+
+private:
+    void pushNode(MpscNode* node) noexcept {
+        node->mNext.store(nullptr, std::memory_order_relaxed);
+        auto prev = mHead.exchange(node, std::memory_order_acq_rel);
+        prev->mNext.store(node, std::memory_order_release);
+    }
+
+    std::atomic<MpscNode *>     mHead;
+    MpscNode*                   mTail;
+    MpscNode                    mStub;
+};
+
+} // namespace simpletcp::utils
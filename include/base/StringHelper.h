@@ -40,4 +40,29 @@ inline std::string strip(std::string_view str) {
     return std::string{ str.begin() + start_pos, end_pos - start_pos };
 }
 
+// Same as strip, but return a view and strip tabs too.
+inline constexpr std::string_view stripView(std::string_view str) noexcept {
+    auto start_pos = str.find_first_not_of(" \t");
+    if (start_pos == std::string_view::npos) {
+        return {};
+    }
+    auto end_pos = str.find_last_not_of(" \t");
+    return str.substr(start_pos, end_pos + 1 - start_pos);
+}
+
+// Compare ASCII strings case-insensitively, e.g. the names of HTTP headers.
+inline constexpr bool equalsIgnoreCase(std::string_view lhs, std::string_view rhs) noexcept {
+    if (lhs.size() != rhs.size()) {
+        return false;
+    }
+    for (size_t i = 0; i != lhs.size(); ++i) {
+        auto l = lhs[i] >= 'A' && lhs[i] <= 'Z' ? static_cast<char>(lhs[i] + ('a' - 'A')) : lhs[i];
+        auto r = rhs[i] >= 'A' && rhs[i] <= 'Z' ? static_cast<char>(rhs[i] + ('a' - 'A')) : rhs[i];
+        if (l != r) {
+            return false;
+        }
+    }
+    return true;
+}
+
 } // namespace simpletcp::utils
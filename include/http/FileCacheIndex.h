@@ -0,0 +1,182 @@
+#pragma once
+
+#include "base/Utils.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <random>
+#include <shared_mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+extern "C" {
+#include <sys/stat.h>
+}
+
+// Helpers shared by StaticFileCache and OpenFileCache.
+namespace simpletcp::http {
+
+// Steady clock in nanoseconds, for access time and throttling stat.
+int64_t nowSteadyNs() noexcept;
+
+int64_t getStatMtimeNs(const struct stat& st) noexcept;
+
+/**
+ * @brief validateFileStat : Stat the path if the interval passed since checkedNs, and compare it with
+ *      the metadata of cached file. Only one thread stats the file in the interval, the others keep
+ *      using the cached one in the meantime, so the change in the interval is not noticed.
+ *
+ * @return : false if the file is changed or removed.
+ */
+bool validateFileStat(const std::string& path, uint64_t inode, size_t size, int64_t mtimeNs
+        , std::atomic<int64_t>& checkedNs, int64_t nowNs, std::chrono::milliseconds interval) noexcept;
+
+/*
+ * SampledLruIndex
+ * Index of cached files keyed by path, bounded by the total cost of files, e.g. bytes or count.
+ * Readers look up under shared lock, writers insert and evict under exclusive lock in constant time.
+ * When index is full, the least recently used of a few sampled files is evicted, which approximates
+ * LRU without ordering all files.
+ * The cost of a file may grow after it's inserted, e.g. by compressed variants, it's charged again
+ * when the file is found.
+ */
+template <typename T>
+class SampledLruIndex final {
+public:
+    DISABLE_COPY(SampledLruIndex);
+    DISABLE_MOVE(SampledLruIndex);
+
+    using Ptr = std::shared_ptr<const T>;
+    using CostFn = size_t (*)(const T&) noexcept;
+    using AccessFn = int64_t (*)(const T&) noexcept;
+
+    SampledLruIndex(size_t capacity, CostFn costFn, AccessFn accessFn) noexcept
+        : mCapacity(capacity), mGetCost(costFn), mGetAccessNs(accessFn), mCost(0) {}
+
+    // Look up the file, nullptr if it's missing.
+    Ptr find(const std::string& key) {
+        std::shared_lock lock { mMutex };
+        auto it = mIndex.find(key);
+        if (it == mIndex.end()) {
+            return nullptr;
+        }
+        auto& entry = it->second;
+        auto cost = mGetCost(*entry.mpValue);
+        if (auto charged = entry.mChargedCost.exchange(cost, std::memory_order_relaxed); charged != cost) {
+            mCost.fetch_add(cost - charged, std::memory_order_relaxed);
+        }
+        return entry.mpValue;
+    }
+
+    // Insert or replace file, and evict files until index fits capacity. Return the number of evicted.
+    size_t publish(const std::string& key, Ptr value) {
+        auto cost = mGetCost(*value);
+        std::unique_lock lock { mMutex };
+        auto [it, isInserted] = mIndex.try_emplace(key, value, cost, mEntries.size());
+        if (isInserted) {
+            mEntries.push_back(&*it);
+        } else {
+            // Replace the changed file, it's loaded by several loops at the same time too.
+            auto& entry = it->second;
+            mCost.fetch_sub(entry.mChargedCost.load(std::memory_order_relaxed), std::memory_order_relaxed);
+            entry.mpValue = std::move(value);
+            entry.mChargedCost.store(cost, std::memory_order_relaxed);
+        }
+        mCost.fetch_add(cost, std::memory_order_relaxed);
+        return evictLocked(&*it);
+    }
+
+    void erase(const std::string& key) {
+        std::unique_lock lock { mMutex };
+        if (auto it = mIndex.find(key); it != mIndex.end()) {
+            removeLocked(it);
+        }
+    }
+
+    void clear() {
+        std::unique_lock lock { mMutex };
+        mIndex.clear();
+        mEntries.clear();
+        mCost.store(0, std::memory_order_relaxed);
+    }
+
+    [[nodiscard]]
+    size_t size() const {
+        std::shared_lock lock { mMutex };
+        return mIndex.size();
+    }
+
+    [[nodiscard]]
+    size_t getCost() const noexcept { return mCost.load(std::memory_order_relaxed); }
+
+private:
+    // Files compared to select the evicted one, all files are compared if there are not more than it.
+    static constexpr size_t EVICTION_SAMPLES = 8;
+
+    struct Entry {
+        Entry(Ptr value, size_t cost, size_t pos) noexcept
+            : mpValue(std::move(value)), mChargedCost(cost), mPos(pos) {}
+
+        Ptr                         mpValue;
+        // Cost counted by index, the file may grow after that.
+        std::atomic<size_t>         mChargedCost;
+        // Position in mEntries.
+        size_t                      mPos;
+    };
+
+    using Index = std::unordered_map<std::string, Entry>;
+    using Node = typename Index::value_type;
+
+    size_t                      mCapacity;
+    CostFn                      mGetCost;
+    AccessFn                    mGetAccessNs;
+    mutable std::shared_mutex   mMutex;
+    Index                       mIndex;
+    // Nodes of index, so files are sampled in constant time. Guarded by mMutex as mEngine.
+    std::vector<Node*>          mEntries;
+    std::minstd_rand            mEngine;
+    std::atomic<size_t>         mCost;
+
+    // Invoked under exclusive lock, the file just published is kept.
+    size_t evictLocked(const Node* keep) {
+        size_t evicted = 0;
+        while (mCost.load(std::memory_order_relaxed) > mCapacity && mEntries.size() > 1) {
+            Node* victim = nullptr;
+            auto compare = [this, keep, &victim] (Node* node) {
+                if (node != keep && (victim == nullptr
+                            || mGetAccessNs(*node->second.mpValue) < mGetAccessNs(*victim->second.mpValue))) {
+                    victim = node;
+                }
+            };
+            if (mEntries.size() <= EVICTION_SAMPLES + 1) {
+                std::for_each(mEntries.begin(), mEntries.end(), compare);
+            } else {
+                std::uniform_int_distribution<size_t> distribution { 0, mEntries.size() - 1 };
+                for (size_t i = 0; i != EVICTION_SAMPLES; ++i) {
+                    compare(mEntries[distribution(mEngine)]);
+                }
+            }
+            if (victim != nullptr) {
+                removeLocked(mIndex.find(victim->first));
+                ++evicted;
+            }
+        }
+        return evicted;
+    }
+
+    void removeLocked(typename Index::iterator it) {
+        auto pos = it->second.mPos;
+        mEntries[pos] = mEntries.back();
+        mEntries[pos]->second.mPos = pos;
+        mEntries.pop_back();
+        mCost.fetch_sub(it->second.mChargedCost.load(std::memory_order_relaxed), std::memory_order_relaxed);
+        mIndex.erase(it);
+    }
+};
+
+} // namespace simpletcp::http
@@ -11,6 +11,8 @@ enum class RequestType {
     POST,
     PUT,
     DELETE,
+    // Same as GET, but the body of response is not sent.
+    HEAD,
 };
 
 inline constexpr auto to_cstr(RequestType type) {
@@ -19,6 +21,7 @@ inline constexpr auto to_cstr(RequestType type) {
         case RequestType::POST: return "POST";
         case RequestType::PUT: return "PUT";
         case RequestType::DELETE: return "DELETE";
+        case RequestType::HEAD: return "HEAD";
         default: return "UNKNOWN";
     }
 }
@@ -45,10 +48,13 @@ enum class StatusCode {
     OK = 200,
     PARTIAL_CONTENT = 206,
     MOVED_PERMANENTLY = 301,
+    NOT_MODIFIED = 304,
     BAD_REQUEST = 400,
     UNAUTHORIZED = 401,
     FORBIDDEN = 403,
     NOT_FOUND = 404,
+    PAYLOAD_TOO_LARGE = 413,
+    RANGE_NOT_SATISFIABLE = 416,
     INTERNAL_SERVER_ERROR = 500,
     METHOD_NOT_IMPLEMENTED = 501,
     HTTP_VERSION_NO_SUPPORT = 505,
@@ -63,9 +69,12 @@ inline constexpr auto to_cstr(StatusCode code) {
         case StatusCode::OK: return "200 OK";
         case StatusCode::PARTIAL_CONTENT: return "206 Partial Content";
         case StatusCode::MOVED_PERMANENTLY: return "301 Moved Permanently";
+        case StatusCode::NOT_MODIFIED: return "304 Not Modified";
         case StatusCode::BAD_REQUEST: return "400 Bad Request";
         case StatusCode::FORBIDDEN: return "403 Forbindden";
         case StatusCode::NOT_FOUND: return "404 Not Found";
+        case StatusCode::PAYLOAD_TOO_LARGE: return "413 Payload Too Large";
+        case StatusCode::RANGE_NOT_SATISFIABLE: return "416 Range Not Satisfiable";
         case StatusCode::INTERNAL_SERVER_ERROR: return "500 Internal Server Error";
         case StatusCode::METHOD_NOT_IMPLEMENTED: return "501 Method Not Implemented";
         default: return "UNKNOWN";
@@ -1,7 +1,6 @@
 #pragma once
 
 #include "http/HttpCommon.h"
-#include "http/HttpRequest.h"
 #include <stdexcept>
 
 namespace simpletcp::http {
@@ -10,6 +9,7 @@ enum class RequestErrorType {
     BadRequest,
     UnsupportMethod,
     PartialPacket,
+    PayloadTooLarge,
 };
 
 enum class ResponseErrorType {
@@ -26,6 +26,7 @@ inline constexpr std::string_view to_string_view(RequestErrorType type) {
         case RequestErrorType::BadRequest: return "BadRequest";
         case RequestErrorType::UnsupportMethod: return "UnsupportMethod";
         case RequestErrorType::PartialPacket: return "PartialPacket";
+        case RequestErrorType::PayloadTooLarge: return "PayloadTooLarge";
     }
 }
 
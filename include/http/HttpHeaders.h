@@ -0,0 +1,234 @@
+#pragma once
+
+#include "base/StringHelper.h"
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string_view>
+#include <vector>
+
+namespace simpletcp::http {
+
+// Well-known header names, they're identified by perfect hash when headers are added.
+enum class HeaderId : uint8_t {
+    Unknown,
+    Accept,
+    AcceptCharset,
+    AcceptEncoding,
+    AcceptLanguage,
+    AcceptRanges,
+    AccessControlAllowOrigin,
+    Age,
+    Allow,
+    Authorization,
+    CacheControl,
+    Connection,
+    ContentDisposition,
+    ContentEncoding,
+    ContentLanguage,
+    ContentLength,
+    ContentLocation,
+    ContentRange,
+    ContentType,
+    Cookie,
+    Date,
+    ETag,
+    Expect,
+    Expires,
+    Forwarded,
+    From,
+    Host,
+    IfMatch,
+    IfModifiedSince,
+    IfNoneMatch,
+    IfRange,
+    IfUnmodifiedSince,
+    KeepAlive,
+    LastModified,
+    Location,
+    Origin,
+    Pragma,
+    Range,
+    Referer,
+    RetryAfter,
+    Server,
+    SetCookie,
+    StrictTransportSecurity,
+    TE,
+    Trailer,
+    TransferEncoding,
+    Upgrade,
+    UserAgent,
+    Vary,
+    Via,
+    WWWAuthenticate,
+    XForwardedFor,
+    XRequestedWith,
+    Count,
+};
+
+// Canonical names of HeaderId, indexed by id.
+inline constexpr std::array<std::string_view, static_cast<size_t>(HeaderId::Count)> HEADER_NAMES {
+    "", "Accept", "Accept-Charset", "Accept-Encoding", "Accept-Language", "Accept-Ranges"
+    , "Access-Control-Allow-Origin", "Age", "Allow", "Authorization", "Cache-Control", "Connection"
+    , "Content-Disposition", "Content-Encoding", "Content-Language", "Content-Length", "Content-Location"
+    , "Content-Range", "Content-Type", "Cookie", "Date", "ETag", "Expect", "Expires", "Forwarded", "From"
+    , "Host", "If-Match", "If-Modified-Since", "If-None-Match", "If-Range", "If-Unmodified-Since"
+    , "Keep-Alive", "Last-Modified", "Location", "Origin", "Pragma", "Range", "Referer", "Retry-After"
+    , "Server", "Set-Cookie", "Strict-Transport-Security", "TE", "Trailer", "Transfer-Encoding", "Upgrade"
+    , "User-Agent", "Vary", "Via", "WWW-Authenticate", "X-Forwarded-For", "X-Requested-With",
+};
+
+inline constexpr auto to_cstr(HeaderId id) {
+    return HEADER_NAMES[static_cast<size_t>(id)].data();
+}
+
+namespace header_detail {
+
+inline constexpr size_t HEADER_HASH_SIZE = 128;
+
+inline constexpr uint8_t toLower(char c) noexcept {
+    return static_cast<uint8_t>(c >= 'A' && c <= 'Z' ? c + ('a' - 'A') : c);
+}
+
+// Case-insensitive hash of length and three chars of name, the factors are searched offline so that
+// all well-known names are mapped to different slots, it's checked below.
+inline constexpr size_t hashHeaderName(std::string_view name) noexcept {
+    return (name.size() * 32 + toLower(name.front()) * 43u + toLower(name.back()) * 21u
+        + toLower(name[name.size() / 2])) & (HEADER_HASH_SIZE - 1);
+}
+
+inline constexpr auto makeHeaderTable() noexcept {
+    std::array<HeaderId, HEADER_HASH_SIZE> table {};
+    for (size_t id = 1; id != HEADER_NAMES.size(); ++id) {
+        table[hashHeaderName(HEADER_NAMES[id])] = static_cast<HeaderId>(id);
+    }
+    return table;
+}
+
+inline constexpr auto HEADER_TABLE = makeHeaderTable();
+
+inline constexpr bool isPerfectHash() noexcept {
+    for (size_t id = 1; id != HEADER_NAMES.size(); ++id) {
+        if (HEADER_TABLE[hashHeaderName(HEADER_NAMES[id])] != static_cast<HeaderId>(id)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+static_assert(isPerfectHash(), "the hash of header names collides, search the factors again!");
+
+} // namespace header_detail
+
+/**
+ * @brief toHeaderId : Identify the name of header case-insensitively, it costs a hash and a comparison.
+ *
+ * @return : HeaderId::Unknown if it's not a well-known name.
+ */
+inline constexpr HeaderId toHeaderId(std::string_view name) noexcept {
+    if (name.empty()) {
+        return HeaderId::Unknown;
+    }
+    auto id = header_detail::HEADER_TABLE[header_detail::hashHeaderName(name)];
+    return utils::equalsIgnoreCase(name, HEADER_NAMES[static_cast<size_t>(id)]) ? id : HeaderId::Unknown;
+}
+
+struct HttpHeaderField {
+    HeaderId            mId;
+    std::string_view    mName;
+    std::string_view    mValue;
+};
+
+/*
+ * HttpHeaders
+ * Headers in the order of adding, they're stored in a flat vector and searched linearly, which is faster
+ * than hash map for the few headers of a message. The well-known names are compared by id.
+ * The fields are views, the request refers to receive buffer. The values of response are copied to
+ * arena by the *Copy methods, the views of arena are stable until the headers are cleared.
+ */
+class HttpHeaders final {
+public:
+    using const_iterator = std::vector<HttpHeaderField>::const_iterator;
+
+    HttpHeaders() noexcept : mBlockUsed(ARENA_BLOCK_SIZE) {}
+    HttpHeaders(HttpHeaders&&) noexcept = default;
+    HttpHeaders& operator=(HttpHeaders&&) noexcept = default;
+    // The copy owns the copies of the values in arena.
+    HttpHeaders(const HttpHeaders& other);
+    HttpHeaders& operator=(const HttpHeaders& other);
+
+    // Append a header, the views must be kept valid by caller.
+    void add(std::string_view name, std::string_view value) { add(toHeaderId(name), name, value); }
+
+    void add(HeaderId id, std::string_view value) { add(id, HEADER_NAMES[static_cast<size_t>(id)], value); }
+
+    void add(HeaderId id, std::string_view name, std::string_view value) { mFields.push_back({ id, name, value }); }
+
+    // Replace the value of first header with the name, or append it. The name and value are copied.
+    void setCopy(std::string_view name, std::string_view value);
+
+    void setCopy(HeaderId id, std::string_view value);
+
+    [[nodiscard]]
+    const HttpHeaderField* find(HeaderId id) const noexcept;
+
+    [[nodiscard]]
+    const HttpHeaderField* find(std::string_view name) const noexcept;
+
+    // Return the value of first header with the name, or empty view if it's missing.
+    [[nodiscard]]
+    std::string_view get(HeaderId id) const noexcept {
+        auto field = find(id);
+        return field != nullptr ? field->mValue : std::string_view {};
+    }
+
+    [[nodiscard]]
+    std::string_view get(std::string_view name) const noexcept {
+        auto field = find(name);
+        return field != nullptr ? field->mValue : std::string_view {};
+    }
+
+    [[nodiscard]]
+    bool contains(HeaderId id) const noexcept { return find(id) != nullptr; }
+
+    [[nodiscard]]
+    bool contains(std::string_view name) const noexcept { return find(name) != nullptr; }
+
+    // Remove all headers with the name.
+    void remove(HeaderId id) noexcept;
+
+    void remove(std::string_view name) noexcept;
+
+    // Remove all headers and release arena, the capacity of vector is kept for reuse.
+    void clear() noexcept;
+
+    [[nodiscard]]
+    size_t size() const noexcept { return mFields.size(); }
+
+    [[nodiscard]]
+    bool empty() const noexcept { return mFields.empty(); }
+
+    [[nodiscard]]
+    const_iterator begin() const noexcept { return mFields.begin(); }
+
+    [[nodiscard]]
+    const_iterator end() const noexcept { return mFields.end(); }
+
+private:
+    static constexpr size_t ARENA_BLOCK_SIZE = 1024;
+
+    std::vector<HttpHeaderField>    mFields;
+    // Blocks of arena, the long values are stored in their own blocks.
+    std::vector<std::unique_ptr<char[]>>
+                                    mBlocks;
+    size_t                          mBlockUsed;
+
+    void set(HeaderId id, std::string_view name, std::string_view value);
+
+    // Copy str to arena and return the stable view of it.
+    std::string_view store(std::string_view str);
+};
+
+} // namespace simpletcp::http
@@ -1,15 +1,31 @@
 #pragma once
 
 #include "http/HttpCommon.h"
+#include "http/HttpError.h"
+#include "http/HttpHeaders.h"
+#include <cstddef>
+#include <cstdint>
 #include <string>
 #include <string_view>
-#include <unordered_set>
+#include <utility>
 #include <vector>
-#include <unordered_map>
 
 namespace simpletcp::http {
 
+// Max size of request line and headers, the request is refused if its headers are longer.
+inline constexpr size_t HTTP_MAX_HEADER_SIZE = 64 * 1024;
+// Max size of request body, decoded size for chunked body. The request is refused if its body is larger.
+inline constexpr size_t HTTP_MAX_BODY_SIZE = 16 * 1024 * 1024;
+
+// Range of "bytes=first-last", last is inclusive and -1 if it's omitted. First is -1 for the suffix range
+// "bytes=-length", and last is the length then.
+struct ByteRange {
+    int64_t                     mFirst;
+    int64_t                     mLast;
+};
+
 // TODO: add cookie.
+// All views refer to the receive buffer of connection, they're only valid in the request handle.
 struct HttpRequest {
     HttpRequest()
         : mUrl()
@@ -23,35 +39,158 @@ struct HttpRequest {
         , mAcceptEncodings()
         , mHeaders()
         , mBody()
-        , mRawRequest()
         , mRequestSize(-1)
     {}
     // Parsed request.
-    std::string                 mUrl;
-    std::string                 mHost;
-    std::string                 mQueryParameters;
+    // Path without the leading '/', and the query string after '?'.
+    std::string_view            mUrl;
+    std::string_view            mHost;
+    std::string_view            mQueryParameters;
     RequestType                 mType;
     Version                     mVersion;
     ContentType                 mContentType;
     int64_t                     mContentLength;
 
-    std::vector<std::pair<int64_t, int64_t>>
-                                mRanges;
+    // Ranges of Range header, it's empty if the header is missing or invalid.
+    std::vector<ByteRange>      mRanges;
     bool                        mIsKeepAlive;
     std::vector<EncodingType>
                                 mAcceptEncodings;
 
-    std::unordered_map<std::string, std::string>
-                                mHeaders;
-    std::string                 mBody;
-    // Raw request data.
-    std::string                 mRawRequest;
+    // Headers in the order of request, the values are stripped.
+    HttpHeaders                 mHeaders;
+    std::string_view            mBody;
+    // Size of request line, headers and body in receive buffer.
     int64_t                     mRequestSize;
 };
 
+enum class ParseStatus {
+    Complete,
+    NeedMore,
+    Error,
+};
+
+/*
+ * HttpRequestParser
+ * Resumable parser of HTTP/1.x requests, one parser is kept for every connection.
+ * The receive buffer may be moved between reads, so the parser only keeps offsets while the request is
+ * partial, and never scans the parsed bytes again. The views of HttpRequest are built when the request
+ * is complete.
+ *
+ *  |--request line--|----headers----|--partial line--|
+ *  ^                                ^                ^
+ *  0                           mLineStart        mScanPos
+ *
+ *  |--request line--|------headers------|CRLF|-----body-----|--next request...
+ *  ^                                         ^              ^
+ *  0                                     mBodyStart   getRequestSize()
+ *
+ * The chunked body is decoded chunk by chunk into the storage of parser, the body of request refers to it.
+ *
+ *  |--headers--|CRLF|--size CRLF--|--data CRLF--|--size CRLF--|...|--0 CRLF--|--trailers--|CRLF|
+ *                   ^                           ^
+ *               mBodyStart                 mLineStart
+ */
+class HttpRequestParser final {
+public:
+    HttpRequestParser() noexcept { reset(); }
+
+    /**
+     * @brief parse : Continue to parse current request.
+     *
+     * @param data: All bytes of current request received so far, it starts with the first byte of request.
+     *              The bytes passed by last invocation must be kept at the front.
+     *
+     * @return : Complete if the request is complete, the request is in getRequest() and refers to data,
+     *           or to the storage of parser for chunked body.
+     *           NeedMore if more bytes are needed. Error if request is malformed, see getError().
+     */
+    ParseStatus parse(std::string_view data);
+
+    [[nodiscard]]
+    const HttpRequest& getRequest() const noexcept { return mRequest; }
+
+    // Size of current request, only valid if the request is complete.
+    [[nodiscard]]
+    size_t getRequestSize() const noexcept { return mBodyStart + mBodySize; }
+
+    [[nodiscard]]
+    RequestErrorType getError() const noexcept { return mError; }
+
+    // Prepare for next request, it should be invoked after the bytes of request are consumed.
+    // The storage of request is kept for reuse.
+    void reset() noexcept;
+
+private:
+    enum class State {
+        RequestLine,
+        Headers,
+        Body,
+        ChunkSize,
+        ChunkData,
+        Trailers,
+        Complete,
+        Error,
+    };
+
+    // A field of request, it's converted to view when request is complete.
+    struct Field {
+        size_t mOffset;
+        size_t mSize;
+    };
+
+    struct HeaderField {
+        HeaderId mId;
+        Field mName;
+        Field mValue;
+    };
+
+    State               mState;
+    // Start of current line, the lines before it have been parsed.
+    size_t              mLineStart;
+    // Position to resume searching LF, the bytes of current line before it have been scanned.
+    size_t              mScanPos;
+    size_t              mBodyStart;
+    // Size of body in data, it's the size of encoded body for chunked body.
+    size_t              mBodySize;
+    // Size of current chunk, the chunk data starts from mLineStart.
+    size_t              mChunkSize;
+    bool                mIsChunked;
+    std::string         mChunkedBody;
+    Field               mUrl;
+    Field               mQuery;
+    std::vector<HeaderField>
+                        mHeaderFields;
+    RequestErrorType    mError;
+    HttpRequest         mRequest;
+
+    // Find LF of current line from mScanPos, return npos if the line is partial or invalid.
+    size_t findLineEnd(std::string_view data) noexcept;
+
+    bool parseRequestLine(std::string_view data, size_t lineEnd) noexcept;
+
+    bool parseHeaderLine(std::string_view data, size_t lineEnd);
+
+    // Headers are complete, find the size of body.
+    bool finishHeaders(std::string_view data) noexcept;
+
+    // Decode the complete chunks and skip trailers, the request is complete after the last chunk.
+    bool parseChunks(std::string_view data);
+
+    // Build views and parse the well-known headers.
+    void buildRequest(std::string_view data);
+
+    ParseStatus fail(RequestErrorType error) noexcept;
+};
+
+/**
+ * @brief parseHttpRequest : Parse a whole request. The views refer to rawHttpPacket, except that the
+ *      chunked body refers to the storage of thread, it's valid until next invocation in the thread.
+ *
+ * @throw : RequestError, PartialPacket if the request is not complete.
+ */
 HttpRequest parseHttpRequest(std::string_view rawHttpPacket);
 
 void dumpHttpRequest(const HttpRequest& request);
 
 } // namespace simpletcp::http
-
@@ -1,8 +1,16 @@
 #pragma once
 #include "base/Utils.h"
 #include "http/HttpCommon.h"
+#include "http/HttpHeaders.h"
+#include "http/HttpRequest.h"
+#include "http/HttpStream.h"
+#include "http/OpenFileCache.h"
+#include "http/StaticFileCache.h"
+#include "tcp/SharedBuffer.h"
+#include "tcp/TcpConnection.h"
 #include <cstdint>
 #include <optional>
+#include <span>
 #include <string>
 #include <string_view>
 #include <tuple>
@@ -13,7 +21,7 @@
 
 namespace simpletcp::http {
 
-// Used for Content-Range property.
+// Used for Content-Range property, end is the position of last byte, it's inclusive.
 struct RangeType {
     int64_t start;
     int64_t end;
@@ -32,6 +40,11 @@ public:
         , mIsKeepAlive(false)
         , mCharSet(CharSet::UNKNOWN)
         , mAvailEncodings()
+        , mFileBody { .mpFile = nullptr, .mOffset = 0, .mSize = 0 }
+        , mpFileCache(nullptr)
+        , mpOpenFileCache(nullptr)
+        , mIsChunkedAllowed(false)
+        , mHasBody(true)
     {}
     // Enable move, disable copy.
     HttpResponse(HttpResponse&&) = default;
@@ -76,7 +89,11 @@ public:
 
     /**
      * @brief setContentByFilePath : Set body, type, length of HTTP response by file path, if the path is invalid,
-     *      this method would throw a std::runtime_error.
+     *      this method would throw a std::runtime_error. The file is served from the caches of server with
+     *      ETag, and the status is set to 304 if it matches If-None-Match of request. The files which are
+     *      not held in memory are sent by sendfile from the cached descriptor. The ranges of GET request
+     *      are sent by sendfile too, one range in 206 response, more in multipart/byteranges, and the status
+     *      is set to 416 if none of them is satisfiable.
      *
      * @param path: The path of file which would be write to HTTP response.
      *
@@ -90,8 +107,28 @@ public:
      *
      * @param body:
      */
-    void setBody(std::string&& body) noexcept { mBody = std::move(body); }
-    void setBody(std::string_view body) noexcept { mBody = std::string { body.data(), body.size() }; }
+    void setBody(std::string&& body) noexcept { clearBody(); mBody = std::move(body); }
+    void setBody(std::string_view body) noexcept { clearBody(); mBody = std::string { body.data(), body.size() }; }
+    // The shared body is sent without copy, e.g. the content of cached file.
+    void setBody(tcp::SharedBuffer body) noexcept { clearBody(); mSharedBody = std::move(body); }
+    // The range of file is sent by sendfile, the descriptor is kept open until it's sent.
+    void setBody(tcp::TcpFileRange file) noexcept { clearBody(); mFileBody = std::move(file); }
+
+    /**
+     * @brief beginStream : Stream the body of response, the length of body is not needed. Status line and
+     *      headers are sent when the request handle returns, then the body is written by the returned
+     *      stream in any thread until it's ended. The body is sent in chunked transfer coding for HTTP/1.1
+     *      clients, and the connection is closed at the end of body for HTTP/1.0 clients. The following
+     *      requests of connection are handled after the stream is ended.
+     *
+     * @param isCompressible: Compress the body by the first of gzip and deflate accepted by client, every
+     *      chunk is flushed so it can be decoded once it arrives.
+     *
+     * @return The stream of body.
+     *
+     * @throw : ResponseError if the response is not created by server.
+     */
+    HttpStreamPtr beginStream(bool isCompressible = false);
 
     /**
      * @brief setContentType : Original method of HTTP response, you'd better not use directly.
@@ -104,7 +141,7 @@ public:
     /**
      * @brief setContentLength : Original method of HTTP response, you'd better not use directly.
      *      Set content length of HTTP response. If the content range has been set, the invariant
-     *      (mContentLength == mContentRange.start - mContentRange.start) must be hold.
+     *      (mContentLength == mContentRange.end - mContentRange.start + 1) must be hold.
      * @param contentLength:
      */
     void setContentLength(int64_t contentLength) { mContentLength = contentLength; }
@@ -113,9 +150,9 @@ public:
      * @brief setContentRange : Set content range of HTTP response.
      *
      * @param contentRange: RangeType {start, end, total}, start means the start position of the byte stream
-     *      in content, end means the end position of byte stream int content, total means the total length
-     *      of byte stream that Server would send to Client. If the content range has been set, the invariant
-     *      (mContentLength == mContentRange.start - mContentRange.start) must be hold.
+     *      in content, end means the position of the last byte in content, total means the size of the whole
+     *      content. If the content range has been set, the invariant
+     *      (mContentLength == mContentRange.end - mContentRange.start + 1) must be hold.
      */
     void setContentRange(auto contentRange) { mContentRange = contentRange; }
 
@@ -139,9 +176,43 @@ private:
     // Internal method. Invoked by HttpServer.
     EncodingType selectEncodeType(const std::filesystem::path& filePath) const;
     void setAcceptEncodings(const auto& encodings) { mAvailEncodings = encodings; }
+    void setFileCache(StaticFileCache* cache, OpenFileCache* openFileCache) noexcept {
+        mpFileCache = cache;
+        mpOpenFileCache = openFileCache;
+    }
+    void setIfNoneMatch(std::string_view etags) noexcept { mIfNoneMatch = etags; }
+    void setStreamTarget(tcp::TcpConnectionPtr conn, bool isChunkedAllowed, bool hasBody) noexcept {
+        mpConn = std::move(conn);
+        mIsChunkedAllowed = isChunkedAllowed;
+        mHasBody = hasBody;
+    }
+    void setRangeRequest(std::span<const ByteRange> ranges, std::string_view ifRange) noexcept {
+        mRanges = ranges;
+        mIfRange = ifRange;
+    }
+    // Set ETag and return true if it matches If-None-Match, the response is 304 then.
+    bool checkNotModified(std::string_view etag);
+    void setContentByFile(const StaticFile& file);
+    void setContentByFile(const OpenFile& file);
+    // Return false if the ranges are ignored, then the whole file is sent.
+    bool setContentByRanges(const OpenFile& file);
+    void clearBody() noexcept;
     void dump() const;
     void validateResponse();
-    std::string generateResponse();
+    /**
+     * @brief serialize : Internal method. Format status line and headers into one segment of batch, and
+     *                    move body to the next segment, no full response is built.
+     *
+     * @param withBody: false for the response of HEAD.
+     *
+     * @throw : ResponseError if response is invalid.
+     */
+    void serialize(tcp::TcpConnection::Batch& batch, bool withBody);
+
+    // Reserved size for status line and generated headers.
+    static constexpr size_t HEADER_RESERVED_SIZE = 160;
+    // The Range header with more ranges is ignored, it's cheap to ask and costly to serve.
+    static constexpr size_t MAX_RANGES = 16;
 
     StatusCode                  mStatus;
     Version                     mVersion;
@@ -152,9 +223,26 @@ private:
     CharSet                     mCharSet;
     std::vector<EncodingType>
                                 mAvailEncodings;
-    std::unordered_map<std::string, std::string>
-                                mHeaders;
+    // Headers are sent in the order of setting, their names and values are copied to arena.
+    HttpHeaders                 mHeaders;
     std::string                 mBody;
+    tcp::SharedBuffer           mSharedBody;
+    tcp::TcpFileRange           mFileBody;
+    // Parts of multipart/byteranges, the part headers and the ranges of file.
+    std::vector<tcp::TcpSendSegment>
+                                mPartsBody;
+    // Owned by server, nullptr if the response is not created by server.
+    StaticFileCache*            mpFileCache;
+    OpenFileCache*              mpOpenFileCache;
+    // If-None-Match, Range and If-Range of request, they refer to the request.
+    std::string_view            mIfNoneMatch;
+    std::span<const ByteRange>  mRanges;
+    std::string_view            mIfRange;
+    // The connection of request, and the stream of body if it's streaming.
+    tcp::TcpConnectionPtr       mpConn;
+    bool                        mIsChunkedAllowed;
+    bool                        mHasBody;
+    HttpStreamPtr               mpStream;
 };
 
 inline constexpr std::string_view HTTP_NOT_FOUND_RESPONSE =
@@ -171,6 +259,11 @@ inline constexpr std::string_view HTTP_BAD_REQUEST_RESPONSE =
     "Content-Type: text/html\r\n" \
     "<P>Your browser sent a bad request, such as a POST without a Content-Length.\r\n";
 
+inline constexpr std::string_view HTTP_PAYLOAD_TOO_LARGE_RESPONSE =
+    "HTTP/1.1 413 Payload Too Large\r\n" \
+    "Connection: close\r\n" \
+    "Content-Length: 0\r\n\r\n";
+
 inline constexpr std::string_view HTTP_UNSUPPORT_METHOD_RESPONSE =
     "HTTP/1.1 501 Method Not Implemented\r\n" \
     "Content-Type: text/html\r\n" \
@@ -0,0 +1,99 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+
+namespace simpletcp::http {
+
+// Instruction set used by the scanning kernels of HTTP parser.
+enum class ScanKernel {
+    Scalar,
+    SSSE3,
+    AVX2,
+};
+
+inline constexpr auto to_cstr(ScanKernel kernel) {
+    switch (kernel) {
+        case ScanKernel::SSSE3: return "ssse3";
+        case ScanKernel::AVX2: return "avx2";
+        default: return "scalar";
+    }
+}
+
+// tchar of RFC 9110, the chars of method and header name.
+inline constexpr bool isTokenChar(uint8_t c) noexcept {
+    if (c <= ' ' || c >= 0x7f) {
+        return false;
+    }
+    return std::string_view { "\"(),/:;<=>?@[\\]{}" }.find(static_cast<char>(c)) == std::string_view::npos;
+}
+
+/*
+ * ByteClass
+ * A set of bytes which stops scanning. It's tested by the nibbles of byte in SIMD kernels:
+ *      byte is in set <=> (mLow[byte & 0xf] & mHigh[byte >> 4]) != 0
+ * Every bit of mLow stands for a high nibble in [0, 8). The bytes >= 0x80 are all in set or all out
+ * of set, they're tested by the sign of byte.
+ */
+struct ByteClass {
+    std::array<uint8_t, 16>     mLow;
+    std::array<uint8_t, 16>     mHigh;
+    bool                        mHasHighBytes;
+    std::array<bool, 256>       mTable;
+};
+
+template <typename Pred>
+inline constexpr ByteClass makeByteClass(Pred&& inSet) noexcept {
+    ByteClass result {};
+    for (size_t c = 0; c != 256; ++c) {
+        result.mTable[c] = inSet(static_cast<uint8_t>(c));
+    }
+    for (size_t high = 0; high != 8; ++high) {
+        result.mHigh[high] = static_cast<uint8_t>(1u << high);
+        for (size_t low = 0; low != 16; ++low) {
+            if (result.mTable[high << 4 | low]) {
+                result.mLow[low] = static_cast<uint8_t>(result.mLow[low] | result.mHigh[high]);
+            }
+        }
+    }
+    result.mHasHighBytes = result.mTable[0x80];
+    return result;
+}
+
+// Stop at the end of method or header name, e.g. the space or ':' after it.
+inline constexpr ByteClass NON_TOKEN_CHARS = makeByteClass([] (uint8_t c) {
+    return !isTokenChar(c);
+});
+
+// Stop at the end of request target, it's space or control char.
+inline constexpr ByteClass TARGET_END_CHARS = makeByteClass([] (uint8_t c) {
+    return c <= ' ' || c == 0x7f;
+});
+
+// Stop at CR, LF or other control chars which are invalid in header line, HTAB is allowed.
+inline constexpr ByteClass LINE_END_CHARS = makeByteClass([] (uint8_t c) {
+    return (c < ' ' && c != '\t') || c == 0x7f;
+});
+
+/**
+ * @brief findByteClass : Find the first byte of str which is in byteClass. The kernel is selected by
+ *                        the instruction sets supported by CPU at startup.
+ *
+ * @return : Offset of the byte, or the size of str if no byte is found.
+ */
+size_t findByteClass(std::string_view str, const ByteClass& byteClass) noexcept;
+
+[[nodiscard]]
+ScanKernel getScanKernel() noexcept;
+
+/**
+ * @brief setScanKernel : Replace the kernel selected at startup, it's used to compare kernels in benchmark.
+ *                        Not thread-safety, must be invoked before parsing.
+ *
+ * @return : false if the kernel isn't supported by CPU.
+ */
+bool setScanKernel(ScanKernel kernel) noexcept;
+
+} // namespace simpletcp::http
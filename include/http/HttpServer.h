@@ -4,7 +4,10 @@
 #include "tcp/TcpServer.h"
 #include "http/HttpRequest.h"
 #include "http/HttpResponse.h"
+#include "http/HttpStream.h"
 #include "http/HttpError.h"
+#include "http/OpenFileCache.h"
+#include "http/StaticFileCache.h"
 
 namespace simpletcp::http {
 
@@ -12,6 +15,19 @@ struct HttpServerArgs {
     net::SocketAddr serverAddr;
     int maxListenQueue;
     int maxThreadNum;
+    size_t maxConnectionNum = tcp::TCP_DEFAULT_MAX_CONNECTION_NUM;
+    // TCP_NODELAY is enabled if it's unset, responses are coalesced by send queue instead of Nagle.
+    net::SocketOptions socketOptions = {};
+    tcp::TcpBufferMode recvBufferMode = tcp::TcpBufferMode::Linear;
+    // Sending rate limits in bytes per second, 0 means no limit.
+    uint64_t maxServerSendRate = 0;
+    uint64_t maxConnectionSendRate = 0;
+    // Serve HTTPS if it's set.
+    tcp::TlsContextPtr tlsContext = nullptr;
+    // Cache of the files served by HttpResponse::setContentByFilePath, capacity 0 disables it.
+    StaticFileCacheOptions fileCacheOptions = {};
+    // Cache of the descriptors of served files, max files 0 disables it.
+    OpenFileCacheOptions openFileCacheOptions = {};
 };
 
 class HttpServer final {
@@ -45,13 +61,31 @@ public:
      * @brief start : Start loop and server.
      */
     void start();
+
+    /**
+     * @brief stop : Quit the loop of server, then start() returns. Thread-safety.
+     */
+    void stop();
 private:
     net::EventLoop              mLoop;
     tcp::TcpServer              mTcpServer;
     tcp::TcpConnectionCallback  mConnectionCb;
     RequestHandle               mRequestHandle;
+    // Shared by the loops of server.
+    StaticFileCache             mFileCache;
+    OpenFileCache               mOpenFileCache;
 
     void onMessage(const tcp::TcpConnectionPtr& conn);
+
+    void onConnection(const tcp::TcpConnectionPtr& conn);
+
+    // Handle one request and append the response to batch, return false if connection should be closed.
+    // The stream is returned if the body of response is streamed.
+    bool handleRequest(const tcp::TcpConnectionPtr& conn, const HttpRequest& request
+            , tcp::TcpConnection::Batch& batch, HttpStreamPtr& stream);
+
+    // The streaming response is ended, close connection or handle the requests waiting for it.
+    void onStreamEnd(const tcp::TcpConnectionPtr& conn, bool isKeepAlive);
 };
 
 } // namespace simpletcp::http
@@ -0,0 +1,127 @@
+#pragma once
+
+#include "base/Compress.h"
+#include "base/Utils.h"
+#include "tcp/SharedBuffer.h"
+#include "tcp/TcpConnection.h"
+#include <atomic>
+#include <cstddef>
+#include <functional>
+#include <memory>
+#include <span>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace simpletcp::http {
+
+class HttpStream;
+
+using HttpStreamPtr = std::shared_ptr<HttpStream>;
+using HttpStreamCallback = std::function<void (const HttpStreamPtr&)>;
+
+/*
+ * HttpStream
+ * Body of a streaming response, it's written chunk by chunk after the request handle returns, so the
+ * generated payload is never buffered entirely. Chunks are framed by chunked transfer coding for HTTP/1.1,
+ * the body for HTTP/1.0 is ended by closing connection.
+ *
+ * Chunks may be written in any thread, they're sent in the loop of connection in order. The writer is
+ * told to pause when the data queued in connection exceeds TCP_HIGH_WATER_MARK, and the writable callback
+ * is invoked when the queue is drained. If the stream is compressed, every chunk is compressed and flushed
+ * in loop thread, so the peer can decode it as soon as it arrives:
+ *
+ *      auto stream = response.beginStream();
+ *      stream->setWritableCallback([] (const HttpStreamPtr& stream) { produce(stream); });
+ *
+ *      void produce(const HttpStreamPtr& stream) {
+ *          while (hasMore()) {
+ *              if (!stream->writeChunk(next())) {
+ *                  return ; // Resumed by writable callback, or the stream is closed.
+ *              }
+ *          }
+ *          stream->end();
+ *      }
+ */
+class HttpStream final : public std::enable_shared_from_this<HttpStream> {
+public:
+    DISABLE_COPY(HttpStream);
+    DISABLE_MOVE(HttpStream);
+
+    // Created by HttpResponse::beginStream, the body is not compressed if compressor is null.
+    HttpStream(const tcp::TcpConnectionPtr& conn, bool isChunked, bool hasBody,
+            std::unique_ptr<utils::StreamCompressor> compressor = nullptr);
+
+    /**
+     * @brief writeChunk : Write a chunk of body, empty chunk is ignored. The data is copied if it's not
+     *      written in loop thread. Thread-safety.
+     *
+     * @return : false if the queued data exceeds the high water mark, the writer should wait for writable
+     *      callback, the chunks written in the meantime are still sent. false if the stream is closed too.
+     */
+    bool writeChunk(std::string_view data);
+    bool writeChunk(std::string&& data);
+    bool writeChunk(tcp::SharedBuffer data);
+
+    /**
+     * @brief end : Send the last chunk, the following requests of connection are handled then. Thread-safety.
+     */
+    void end();
+
+    /**
+     * @brief setWritableCallback : Set the callback which is invoked in loop thread when the writer can
+     *      continue after writeChunk returned false, or when the stream is closed by peer.
+     *      Must be invoked in request handle or loop thread.
+     */
+    void setWritableCallback(HttpStreamCallback&& cb) noexcept { mWritableCb = std::move(cb); }
+
+    // The stream is closed if it's ended or the connection is closed.
+    [[nodiscard]]
+    bool isClosed() const noexcept { return mIsClosed.load(std::memory_order_acquire); }
+
+private:
+    friend class HttpServer;
+    friend class HttpResponse;
+
+    std::weak_ptr<tcp::TcpConnection>
+                                mpConn;
+    bool                        mIsChunked;
+    // Body of HEAD response is never sent.
+    bool                        mHasBody;
+    // Accessed in loop thread.
+    bool                        mIsStarted;
+    bool                        mIsEndPending;
+    std::vector<tcp::TcpSendSegment>
+                                mPendingChunks;
+    // Accessed in loop thread, it's released when the stream is closed.
+    std::unique_ptr<utils::StreamCompressor>
+                                mpCompressor;
+    HttpStreamCallback          mWritableCb;
+    // Invoked by server when the last chunk is sent.
+    HttpStreamCallback          mEndCb;
+    // Bytes written by writer but not committed to connection, and bytes in the send queue of connection.
+    std::atomic<size_t>         mPostedBytes;
+    std::atomic<size_t>         mQueuedBytes;
+    std::atomic<bool>           mIsPaused;
+    std::atomic<bool>           mIsClosed;
+
+    bool write(tcp::TcpSendSegment&& chunk);
+    void writeInLoop(tcp::TcpSendSegment&& chunk);
+    void endInLoop();
+    // Compress and frame the chunks, then commit them to connection by one batch.
+    void sendChunks(const tcp::TcpConnectionPtr& conn, std::span<tcp::TcpSendSegment> chunks);
+    // Return true if the writer can continue, or mark it paused.
+    bool checkWritable() noexcept;
+    // Resume the paused writer if the queued data is below the high water mark.
+    void updateWritable(size_t queuedBytes);
+
+    // Internal methods. Invoked by server in loop thread.
+    // Headers of response have been committed, the chunks written before are sent.
+    void start();
+    // The send queue of connection is drained.
+    void onDrain() { updateWritable(0); }
+    // The connection is closed, the paused writer is resumed to see it.
+    void close();
+};
+
+} // namespace simpletcp::http
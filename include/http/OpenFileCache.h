@@ -0,0 +1,138 @@
+#pragma once
+
+#include "base/Utils.h"
+#include "http/FileCacheIndex.h"
+#include "http/HttpCommon.h"
+#include "net/FileDesc.h"
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <memory>
+#include <string>
+#include <string_view>
+
+namespace simpletcp::http {
+
+struct OpenFileCacheOptions {
+    // Max number of descriptors held by cache, 0 disables caching and every file is opened on request.
+    size_t mMaxFiles = 1024;
+    // A descriptor is reopened after it's held for ttl, so the space of removed files is released.
+    std::chrono::milliseconds mTtl { 60000 };
+    // A cached file is checked by stat at most once in the interval.
+    std::chrono::milliseconds mStatInterval { 1000 };
+};
+
+struct OpenFileCacheStats {
+    uint64_t mHits = 0;
+    uint64_t mMisses = 0;
+    uint64_t mReloads = 0;
+    uint64_t mEvictions = 0;
+    size_t   mFiles = 0;
+};
+
+class OpenFile;
+
+using OpenFilePtr = std::shared_ptr<const OpenFile>;
+
+/*
+ * OpenFile
+ * Read-only descriptor of a regular file and its metadata got by fstat when it's opened. The descriptor
+ * is shared by the sendfile segments of responses, it's closed when the last of them is sent, even if
+ * the file is evicted from cache before that.
+ */
+class OpenFile final {
+public:
+    DISABLE_COPY(OpenFile);
+    DISABLE_MOVE(OpenFile);
+
+    /**
+     * @brief open : Open the regular file and get its metadata, MIME type is got by extension.
+     *
+     * @throw : ResponseError if file is missing or its type is unsupported.
+     */
+    static OpenFilePtr open(const std::string& path);
+
+    OpenFile(std::shared_ptr<const net::FileDesc> file, size_t size, int64_t mtimeNs, uint64_t inode
+            , ContentType type, std::string etag) noexcept;
+
+    [[nodiscard]]
+    const std::shared_ptr<const net::FileDesc>& getFile() const noexcept { return mpFile; }
+
+    [[nodiscard]]
+    size_t getSize() const noexcept { return mSize; }
+
+    [[nodiscard]]
+    int64_t getMtimeNs() const noexcept { return mMtimeNs; }
+
+    [[nodiscard]]
+    uint64_t getInode() const noexcept { return mInode; }
+
+    [[nodiscard]]
+    ContentType getContentType() const noexcept { return mContentType; }
+
+    // Strong validator like "inode-size-mtime", with quotes.
+    [[nodiscard]]
+    std::string_view getETag() const noexcept { return mETag; }
+
+private:
+    friend class OpenFileCache;
+
+    std::shared_ptr<const net::FileDesc>
+                                mpFile;
+    size_t                      mSize;
+    int64_t                     mMtimeNs;
+    uint64_t                    mInode;
+    ContentType                 mContentType;
+    std::string                 mETag;
+    // Open, access and stat time in steady clock, for ttl, LRU and throttling stat.
+    int64_t                     mOpenNs;
+    mutable std::atomic<int64_t>
+                                mAccessNs;
+    mutable std::atomic<int64_t>
+                                mCheckedNs;
+};
+
+/*
+ * OpenFileCache
+ * Count-bounded cache of open descriptors keyed by path, shared by the loops of server, so a static
+ * request costs no open, fstat and close. Files are held by SampledLruIndex bounded by count, like
+ * StaticFileCache.
+ */
+class OpenFileCache final {
+public:
+    DISABLE_COPY(OpenFileCache);
+    DISABLE_MOVE(OpenFileCache);
+
+    explicit OpenFileCache(OpenFileCacheOptions options = {});
+
+    /**
+     * @brief getFile : Get the cached file, open it if it's missing, expired or changed. Thread-safety.
+     *
+     * @throw : ResponseError if file is missing or its type is unsupported.
+     */
+    OpenFilePtr getFile(const std::filesystem::path& path);
+
+    // Drop all files, the descriptors are closed when they're not used. Thread-safety.
+    void clear();
+
+    [[nodiscard]]
+    OpenFileCacheStats getStats() const noexcept;
+
+private:
+    OpenFileCacheOptions        mOptions;
+    SampledLruIndex<OpenFile>   mIndex;
+    std::atomic<uint64_t>       mHits;
+    std::atomic<uint64_t>       mMisses;
+    std::atomic<uint64_t>       mReloads;
+    std::atomic<uint64_t>       mEvictions;
+
+    static size_t getCost(const OpenFile&) noexcept { return 1; }
+    static int64_t getAccessNs(const OpenFile& file) noexcept { return file.mAccessNs.load(std::memory_order_relaxed); }
+
+    // Return false if the file is expired, or it's changed or removed when the interval passed.
+    bool validate(const std::string& path, const OpenFile& file, int64_t nowNs) const;
+};
+
+} // namespace simpletcp::http
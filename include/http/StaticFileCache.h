@@ -0,0 +1,169 @@
+#pragma once
+
+#include "base/Utils.h"
+#include "http/FileCacheIndex.h"
+#include "http/HttpCommon.h"
+#include "tcp/SharedBuffer.h"
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+
+namespace simpletcp::http {
+
+class OpenFile;
+
+struct StaticFileCacheOptions {
+    // Bytes of contents and compressed variants held by cache.
+    size_t mCapacity = 64 * 1024 * 1024;
+    // Larger files are not cached, they should be sent by sendfile.
+    size_t mMaxFileSize = 4 * 1024 * 1024;
+    // A cached file is checked by stat at most once in the interval, the change in the interval is
+    // not noticed.
+    std::chrono::milliseconds mStatInterval { 1000 };
+};
+
+struct StaticFileCacheStats {
+    uint64_t mHits = 0;
+    uint64_t mMisses = 0;
+    uint64_t mReloads = 0;
+    uint64_t mEvictions = 0;
+    size_t   mFiles = 0;
+    size_t   mBytes = 0;
+};
+
+/*
+ * StaticFile
+ * Immutable content and metadata of a cached file, shared by all loops. The compressed variants are
+ * built by the first request which accepts them, and never rebuilt.
+ */
+class StaticFile final {
+public:
+    DISABLE_COPY(StaticFile);
+    DISABLE_MOVE(StaticFile);
+
+    StaticFile(tcp::SharedBuffer content, ContentType type, std::string etag, int64_t mtimeNs
+            , uint64_t inode) noexcept;
+
+    /**
+     * @brief getContent : Get the content encoded by encoding, the variant is compressed at the first time.
+     *
+     * @return : Empty buffer if the file can't be compressed by encoding, the identity content should be
+     *           sent then.
+     */
+    [[nodiscard]]
+    tcp::SharedBuffer getContent(EncodingType encoding = EncodingType::NO_ENCODING) const;
+
+    [[nodiscard]]
+    ContentType getContentType() const noexcept { return mContentType; }
+
+    /**
+     * @brief getETag : Get the strong validator of content encoded by encoding, like "inode-size-mtime"
+     *      with quotes. Every encoded variant is a different representation, so it has its own validator
+     *      like "inode-size-mtime-gzip".
+     */
+    [[nodiscard]]
+    std::string_view getETag(EncodingType encoding = EncodingType::NO_ENCODING) const noexcept;
+
+    [[nodiscard]]
+    size_t getSize() const noexcept { return mContent.size(); }
+
+    // Whether the content type is worth to compress, e.g. text.
+    [[nodiscard]]
+    bool isCompressible() const noexcept;
+
+    // Bytes of content and the variants built.
+    [[nodiscard]]
+    size_t getCachedBytes() const noexcept { return mContent.size() + mVariantBytes.load(std::memory_order_relaxed); }
+
+private:
+    friend class StaticFileCache;
+
+    struct Variant {
+        std::string                 mETag;
+        mutable std::once_flag      mOnce;
+        mutable tcp::SharedBuffer   mContent;
+    };
+
+    tcp::SharedBuffer           mContent;
+    ContentType                 mContentType;
+    std::string                 mETag;
+    int64_t                     mMtimeNs;
+    uint64_t                    mInode;
+    Variant                     mGzip;
+    Variant                     mDeflate;
+    mutable std::atomic<size_t> mVariantBytes;
+    // Access time and stat time in steady clock, for LRU and throttling stat.
+    mutable std::atomic<int64_t>
+                                mAccessNs;
+    mutable std::atomic<int64_t>
+                                mCheckedNs;
+};
+
+using StaticFilePtr = std::shared_ptr<const StaticFile>;
+
+/*
+ * StaticFileCache
+ * Size-bounded cache of file contents keyed by path, shared by the loops of server.
+ * Files are held by SampledLruIndex bounded by bytes, the variants built after a file is loaded are
+ * counted when it's accessed again.
+ */
+class StaticFileCache final {
+public:
+    DISABLE_COPY(StaticFileCache);
+    DISABLE_MOVE(StaticFileCache);
+
+    explicit StaticFileCache(StaticFileCacheOptions options = {});
+
+    /**
+     * @brief getFile : Get the cached file, load it if it's missing or changed. Thread-safety.
+     *
+     * @return : nullptr if the file is larger than mMaxFileSize.
+     *
+     * @throw : ResponseError if file is missing or its type is unsupported.
+     */
+    StaticFilePtr getFile(const std::filesystem::path& path);
+
+    /**
+     * @brief getFile : Get the cached content of the opened file, it's loaded by the descriptor if it's
+     *      missing or the metadata is different. The file is validated by caller, e.g. OpenFileCache, so
+     *      it's not opened or stat again. Thread-safety.
+     *
+     * @return : nullptr if the file is not cacheable.
+     */
+    StaticFilePtr getFile(const std::filesystem::path& path, const OpenFile& file);
+
+    // Whether a file of size is held in memory, the larger ones should be sent by sendfile.
+    [[nodiscard]]
+    bool isCacheable(size_t size) const noexcept { return mOptions.mCapacity != 0 && size <= mOptions.mMaxFileSize; }
+
+    // Drop all files. Thread-safety.
+    void clear();
+
+    [[nodiscard]]
+    StaticFileCacheStats getStats() const noexcept;
+
+private:
+    StaticFileCacheOptions      mOptions;
+    SampledLruIndex<StaticFile> mIndex;
+    std::atomic<uint64_t>       mHits;
+    std::atomic<uint64_t>       mMisses;
+    std::atomic<uint64_t>       mReloads;
+    std::atomic<uint64_t>       mEvictions;
+
+    static size_t getCost(const StaticFile& file) noexcept { return file.getCachedBytes(); }
+    static int64_t getAccessNs(const StaticFile& file) noexcept { return file.mAccessNs.load(std::memory_order_relaxed); }
+
+    // Read the content by descriptor.
+    static StaticFilePtr load(const std::string& path, const OpenFile& file);
+
+    // Insert or replace file, and evict files until cache fits capacity.
+    void publish(const std::string& path, StaticFilePtr file);
+};
+
+} // namespace simpletcp::http
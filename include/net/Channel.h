@@ -4,11 +4,21 @@
 #include <algorithm>
 #include <functional>
 #include <memory>
-#include <string>
+#include <string_view>
 
 namespace simpletcp::net {
 
-using ChannelCbType = std::function<void ()>;
+// The event which would be dispatched to the owner of Channel.
+enum class ChannelEvent {
+    Read,
+    Write,
+    Error,
+    Close,
+};
+
+// A Channel only holds one callback, the owner dispatches the event itself. Thousands of connections
+// may be alive at the same time, so keep Channel as small as possible.
+using ChannelCbType = std::function<void (ChannelEvent)>;
 
 // The lifetime of EventLoop must be longer than Channel.
 // But EventLoop not handle the instance of Channel, it just has the weak reference of Channel.
@@ -36,15 +46,10 @@ public:
 
     void handleEvent();
 
-    void setChannelInfo(std::string s) { mChannelInfo = std::move(s); }
-
-    void setWriteCallback(ChannelCbType&& cb) noexcept { mWriteCb = std::move(cb); }
-
-    void setReadCallback(ChannelCbType&& cb) noexcept { mReadCb = std::move(cb); }
-
-    void setErrorCallback(ChannelCbType&& cb) noexcept { mErrorCb = std::move(cb); }
+    // Channel only records the view of info, so the info must outlive Channel(string literal is preferred).
+    void setChannelInfo(std::string_view info) noexcept { mChannelInfo = info; }
 
-    void setCloseCallback(ChannelCbType&& cb) noexcept { mCloseCb = std::move(cb); }
+    void setEventCallback(ChannelCbType&& cb) noexcept { mEventCb = std::move(cb); }
 
     // Not thread safe, but in loop thread.
     void enableRead();
@@ -74,10 +79,7 @@ public:
 private:
     Channel(int fd, EventLoop* loop, ChannelPriority priority);
 
-    ChannelCbType   mReadCb;
-    ChannelCbType   mWriteCb;
-    ChannelCbType   mErrorCb;
-    ChannelCbType   mCloseCb;
+    ChannelCbType   mEventCb;
 
     EventLoop*      mpEventLoop;
 
@@ -85,7 +87,8 @@ private:
     uint32_t        mRevent;
     int             mFd;
     ChannelPriority mPriority;
-    std::string     mChannelInfo;
+    std::string_view
+                    mChannelInfo;
 };
 
 using ChannelPtr = std::unique_ptr<Channel>;
@@ -4,7 +4,8 @@
 #include "net/EventLoop.h"
 #include <condition_variable>
 #include <thread>
-#include <unordered_map>
+#include <mutex>
+#include <vector>
 #include <functional>
 
 namespace simpletcp::net {
@@ -17,27 +18,31 @@ public:
     EventLoopPool(EventLoop* loop, int maxThreadNum);
     ~EventLoopPool();
 
+    /**
+     * @brief acquireLoop : Pick a loop by round-robin. Must be invoked in the thread of main loop.
+     *
+     * @return The main loop if there is no sub loop, otherwise a sub loop.
+     */
     [[nodiscard]]
-    EventLoop* acquireLoop();
+    EventLoop* acquireLoop() noexcept;
 
     [[nodiscard]]
     int getLoopNums() const noexcept { return mMaxThreadNum; }
-    // void releaseLoop(EventLoop* loop);
 
-private:
-    enum class State {
-        Initialized,
-        Running,
-        Exit,
-    };
+    /**
+     * @brief getLoops : Get all sub loops. All sub loops have been started when pool is constructed
+     *                   , and the result would not change until pool is destroyed.
+     */
+    [[nodiscard]]
+    const std::vector<EventLoop *>& getLoops() const noexcept { return mSubLoops; }
 
+private:
     EventLoop*                  mpMainLoop;
     int                         mMaxThreadNum;
 
     std::vector<std::thread>    mSubThreads;
+    // Written by sub threads only in constructor, read-only after that.
     std::vector<EventLoop *>    mSubLoops;
-    std::unordered_map<EventLoop *, State>
-                                mSubLoopStates;
 
     size_t                      mIndex;
     std::mutex                  mMutex;
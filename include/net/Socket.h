@@ -3,12 +3,16 @@
 #include "base/Utils.h"
 #include <algorithm>
 #include <memory>
+#include <optional>
 #include <string>
+#include <string_view>
 
 extern "C" {
 #include <netdb.h>
+#include <netinet/in.h>
 #include <netinet/tcp.h>
 #include <sys/socket.h>
+#include <sys/un.h>
 }
 
 namespace simpletcp::net {
@@ -16,14 +20,118 @@ namespace simpletcp::net {
 enum class IP_PROTOCOL {
     IPv4,
     IPv6,
+    // Unix domain stream socket. The address is the path of socket file, or the name in abstract
+    // namespace prefixed by '@'. Port is unused.
+    Unix,
 };
 
+// Text form of socket address, it's used to configure server and client.
+// Empty mIpAddr of server means any address.
 struct SocketAddr {
     std::string mIpAddr;
     IP_PROTOCOL mIpProtocol;
     uint16_t    mPort;
 };
 
+/**
+ * @brief : Binary form of socket address. Socket keeps addresses in this form, and the text of IP is
+ *          rendered by inet_ntop only when user asks for it. The rendered text is cached and shared by
+ *          the copies of address, so the sockets accepted by the same listen socket share one text of
+ *          local address.
+ */
+class RawSockAddr final {
+public:
+    RawSockAddr() noexcept : mStorage {}, mLength(0) {}
+
+    /**
+     * @brief fromSocketAddr : Parse the text form of address.
+     *
+     * @return : The binary address, or std::nullopt if IP is invalid. Empty IP means any address.
+     */
+    [[nodiscard]]
+    static std::optional<RawSockAddr> fromSocketAddr(const SocketAddr& addr) noexcept;
+
+    [[nodiscard]]
+    sockaddr* get() noexcept { return reinterpret_cast<sockaddr *>(&mStorage); }
+
+    [[nodiscard]]
+    const sockaddr* get() const noexcept { return reinterpret_cast<const sockaddr *>(&mStorage); }
+
+    // Length of valid bytes, 0 if address is unset.
+    [[nodiscard]]
+    socklen_t getLength() const noexcept { return mLength; }
+
+    // Capacity of storage, it's passed to accept/getsockname, and then setLength with the result.
+    [[nodiscard]]
+    static constexpr socklen_t getCapacity() noexcept { return sizeof(sockaddr_storage); }
+
+    void setLength(socklen_t length) noexcept;
+
+    [[nodiscard]]
+    sa_family_t getFamily() const noexcept { return mStorage.ss_family; }
+
+    [[nodiscard]]
+    bool isUnset() const noexcept { return mStorage.ss_family == AF_UNSPEC; }
+
+    // Any address(0.0.0.0 or ::), the real local address of connection is unknown until getsockname.
+    [[nodiscard]]
+    bool isAnyAddr() const noexcept;
+
+    [[nodiscard]]
+    IP_PROTOCOL getIpProtocol() const noexcept {
+        switch (getFamily()) {
+            case AF_INET6: return IP_PROTOCOL::IPv6;
+            case AF_UNIX: return IP_PROTOCOL::Unix;
+            default: return IP_PROTOCOL::IPv4;
+        }
+    }
+
+    // Port of IP address, 0 for Unix domain address.
+    [[nodiscard]]
+    uint16_t getPort() const noexcept;
+
+    // The path of Unix domain address which has a socket file, empty for others.
+    [[nodiscard]]
+    std::string_view getUnixPath() const noexcept;
+
+    // Render the IP by inet_ntop at the first time, empty if address is unset.
+    // For Unix domain address, it's the path, or '@' and the abstract name. The address of unbound peer
+    // is empty.
+    [[nodiscard]]
+    std::string_view getIp() const;
+
+    [[nodiscard]]
+    SocketAddr toSocketAddr() const;
+
+private:
+    sockaddr_storage    mStorage;
+    socklen_t           mLength;
+    mutable std::shared_ptr<const std::string>
+                        mpIpText;
+};
+
+// Declarative socket options, only the options which have value would be applied.
+// Options are applied in best effort: failure is logged but not thrown, because some of them
+// depend on the kernel version or capabilities(e.g. SO_BUSY_POLL needs CAP_NET_ADMIN for big values).
+struct SocketOptions {
+    std::optional<bool> mNoDelay;           // TCP_NODELAY
+    std::optional<int>  mSendBufSize;       // SO_SNDBUF, in bytes.
+    std::optional<int>  mRecvBufSize;       // SO_RCVBUF, in bytes.
+    std::optional<bool> mCork;              // TCP_CORK
+    std::optional<bool> mQuickAck;          // TCP_QUICKACK, it's not sticky in kernel.
+    std::optional<int>  mDeferAccept;       // TCP_DEFER_ACCEPT, in seconds. Only for listen socket.
+    std::optional<int>  mNotSentLowat;      // TCP_NOTSENT_LOWAT, in bytes.
+    std::optional<int>  mUserTimeout;       // TCP_USER_TIMEOUT, in milliseconds.
+    std::optional<int>  mBusyPoll;          // SO_BUSY_POLL, in microseconds.
+    std::optional<int>  mFastOpen;          // TCP_FASTOPEN, the queue length of pending TFO requests.
+                                            // Only for listen socket.
+    std::optional<bool> mFastOpenConnect;   // TCP_FASTOPEN_CONNECT, only for client socket before connect.
+                                            // The first write would be sent with SYN if TFO cookie is cached
+                                            // , otherwise kernel falls back to normal handshake.
+    std::optional<uint64_t> mMaxPacingRate; // SO_MAX_PACING_RATE, in bytes per second. Kernel paces the
+                                            // outgoing packets of socket.
+};
+
 
 /**
  * @brief : The wrapper of socket file descriptor.
@@ -35,10 +143,40 @@ public:
     DISABLE_MOVE(Socket);
     ~Socket();
 
-    static SocketPtr createTcpClientSocket(SocketAddr&& serverAddr);
-
+    /**
+     * @brief createTcpClientSocket : Create a non-blocking socket and start to connect server.
+     *                                The server may be a Unix domain address, see IP_PROTOCOL::Unix.
+     *
+     * @param serverAddr:
+     * @param options: socket options which are applied before connect.
+     *
+     * @return Socket, or nullptr if failed to connect.
+     */
+    static SocketPtr createTcpClientSocket(SocketAddr&& serverAddr, const SocketOptions& options = {});
+
+    // The socket file of Unix domain address is replaced when listen, and removed when the listen
+    // socket is closed.
     static SocketPtr createTcpListenSocket(SocketAddr&& serverAddr, int maxListenQueue);
 
+    /**
+     * @brief createUdpSocket : Create a non-blocking datagram socket bound to localAddr.
+     *
+     * @param localAddr: Port 0 means the port is chosen by kernel.
+     * @param reusePort: Bind with SO_REUSEPORT, so that several sockets share the port and kernel
+     *                   spreads datagrams over them by the hash of flow.
+     *
+     * @throw : NetworkException if the address is invalid or can't be bound.
+     */
+    static SocketPtr createUdpSocket(SocketAddr&& localAddr, bool reusePort = false);
+
+    /**
+     * @brief createUdpClientSocket : Create a non-blocking datagram socket connected to serverAddr, it's
+     *                                bound to an ephemeral port and only receives from serverAddr.
+     *
+     * @throw : NetworkException if the address is invalid or can't be connected.
+     */
+    static SocketPtr createUdpClientSocket(SocketAddr&& serverAddr);
+
     void listen();
 
     SocketPtr accept();
@@ -55,20 +193,43 @@ public:
 
     void setReusePort(bool enable);
 
+    /**
+     * @brief setMaxPacingRate : Limit the sending rate of socket by kernel(SO_MAX_PACING_RATE).
+     *
+     * @param bytesPerSecond:
+     *
+     * @throw : NetworkException if kernel doesn't support it.
+     */
+    void setMaxPacingRate(uint64_t bytesPerSecond);
+
+    /**
+     * @brief applyOptions : Apply all options which have value. TCP_DEFER_ACCEPT and TCP_FASTOPEN are
+     *                       ignored for non-listen socket, TCP_FASTOPEN_CONNECT is ignored except for
+     *                       client socket before connect.
+     *
+     * @param options:
+     */
+    void applyOptions(const SocketOptions& options) noexcept;
+
     [[nodiscard]]
     int getFd() const noexcept { return mFd; }
 
     [[nodiscard]]
-    auto getIpProtocol() const noexcept { return mLocalAddr.mIpProtocol; }
+    bool isUdpSocket() const noexcept { return mIsUDPSocket; }
+
+    [[nodiscard]]
+    IP_PROTOCOL getIpProtocol() const noexcept { return mLocalAddr.getIpProtocol(); }
 
     [[nodiscard]]
-    auto getPort() const noexcept { return mLocalAddr.mPort; }
+    uint16_t getPort() const noexcept { return mLocalAddr.getPort(); }
 
+    // The local address of accepted socket is inherited from listen socket. If listen socket is bound to
+    // any address, it's resolved by getsockname at the first invocation.
     [[nodiscard]]
-    auto getLocalAddr() const noexcept { return mLocalAddr; }
+    const RawSockAddr& getLocalAddr() const;
 
     [[nodiscard]]
-    auto getPeerAddr() const noexcept { return mPeerAddr; }
+    const RawSockAddr& getPeerAddr() const noexcept { return mPeerAddr; }
 
     [[nodiscard]]
     int getSocketError() const noexcept;
@@ -77,19 +238,24 @@ public:
 
 private:
     Socket(int fd)
-        : mFd(fd), mIsListenSocket(false), mMaxListenQueue(0) {}
+        : mFd(fd), mIsListenSocket(false), mIsTCPSocket(false), mIsUDPSocket(false), mIsUnixSocket(false)
+        , mMaxListenQueue(0), mLocalAddr {}, mPeerAddr {} {}
 
-    void setLocalAddr(IP_PROTOCOL ipType);
+    void setLocalAddr() const;
 
-    void setPeerAddr(SocketAddr&& peerAddr) noexcept { mPeerAddr = std::move(peerAddr); }
+    void setPeerAddr(const RawSockAddr& peerAddr) noexcept { mPeerAddr = peerAddr; }
 
     int         mFd;
     bool        mIsListenSocket;
     bool        mIsTCPSocket;
     bool        mIsUDPSocket;
+    // Stream socket of Unix domain, the options of TCP are not applied to it.
+    bool        mIsUnixSocket;
     int         mMaxListenQueue;
-    SocketAddr  mLocalAddr;
-    SocketAddr  mPeerAddr;
+    // Resolved lazily for the socket accepted by listen socket bound to any address.
+    mutable RawSockAddr
+                mLocalAddr;
+    RawSockAddr mPeerAddr;
 
 };
 
@@ -0,0 +1,79 @@
+#pragma once
+
+#include "base/Utils.h"
+#include "net/EventLoop.h"
+#include "net/EventLoopPool.h"
+#include "net/Socket.h"
+#include "net/UdpSocket.h"
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace simpletcp::net {
+
+struct UdpServerArgs {
+    EventLoop* loop;
+    SocketAddr serverAddr;
+    // If there are sub loops, every sub loop owns a socket bound to serverAddr by SO_REUSEPORT, and
+    // kernel shards the datagrams over them by the hash of flow.
+    int maxThreadNum = 0;
+    UdpSocketOptions socketOptions = {};
+};
+
+/*
+ * UdpServer
+ * Receive datagrams on one address in all loops of server. The message callback is invoked in the owner
+ * loop of socket, the reply is sent by the socket passed to callback.
+ */
+class UdpServer final {
+public:
+    DISABLE_COPY(UdpServer);
+    DISABLE_MOVE(UdpServer);
+
+    UdpServer(UdpServerArgs args);
+    ~UdpServer() noexcept;
+
+    /**
+     * @brief start: Start to receive datagrams. All callbacks must be set before start.
+     */
+    void start();
+
+    /**
+     * @brief setMessageCallback: User interface.
+     *
+     * @param cb: message callback which would be invoked for every batch of datagrams.
+     */
+    void setMessageCallback(UdpMessageCallback&& cb) noexcept { mMessageCb = std::move(cb); }
+
+    /**
+     * @brief getStats : Sum the statistics of all sockets. Must be invoked in the thread of owner loop.
+     */
+    [[nodiscard]]
+    UdpStats getStats() const;
+
+    // Count of sockets sharing the port, it's bounded by the count of CPUs as EventLoopPool.
+    [[nodiscard]]
+    size_t getSocketNums() const noexcept { return mSockets.size(); }
+
+    // The port chosen by kernel if serverAddr has port 0.
+    [[nodiscard]]
+    uint16_t getPort() const noexcept { return mPort; }
+
+    [[nodiscard]]
+    std::string_view getId() const noexcept { return mIdentification; }
+
+    [[nodiscard]]
+    EventLoop* getLoop() const noexcept { return mpEventLoop; }
+
+private:
+    EventLoop*                  mpEventLoop;
+    EventLoopPool               mEventLoopPool;
+    uint16_t                    mPort;
+    // Id is a string like: [timestamp_tid_port_ip]
+    std::string                 mIdentification;
+    UdpMessageCallback          mMessageCb;
+    // One socket for every loop, it's created and destroyed in its owner loop.
+    std::vector<UdpSocketPtr>   mSockets;
+};
+
+} // namespace simpletcp::net
@@ -0,0 +1,202 @@
+#pragma once
+
+#include "base/Utils.h"
+#include "net/Channel.h"
+#include "net/EventLoop.h"
+#include "net/Socket.h"
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <span>
+#include <vector>
+
+extern "C" {
+#include <sys/socket.h>
+#include <sys/uio.h>
+}
+
+namespace simpletcp::net {
+
+// Max payload of one UDP datagram, it's also the limit of a GSO super packet.
+inline constexpr size_t UDP_MAX_PAYLOAD_SIZE = 65507;
+
+struct UdpSocketOptions {
+    // Count of datagrams read by one recvmmsg, and written by one sendmmsg.
+    size_t          mBatchSize = 64;
+    // Size of one slot of receive ring. The received datagram which is longer would be truncated, and
+    // the longer datagram is refused by send.
+    size_t          mMaxPacketSize = 2048;
+    // Kernel coalesces the received datagrams of one flow into a super packet(UDP_GRO), which is split
+    // again before message callback. The slots of receive ring grow to 64KB.
+    bool            mEnableGro = false;
+    // Consecutive datagrams of the same size to the same peer are written as one super packet, and kernel
+    // segments it(UDP_SEGMENT). The last datagram of a super packet may be shorter.
+    bool            mEnableGso = false;
+    // Only SO_SNDBUF, SO_RCVBUF and SO_BUSY_POLL make sense for datagram socket.
+    SocketOptions   mSocketOptions = {};
+};
+
+// A received datagram, the data and the address are only valid until message callback returns.
+struct UdpPacket {
+    std::span<const uint8_t>    mData;
+    const RawSockAddr*          mpPeerAddr;
+};
+
+struct UdpStats {
+    uint64_t mRecvPackets = 0;
+    // Count of recvmmsg/sendmmsg which transfer at least one datagram.
+    uint64_t mRecvBatches = 0;
+    uint64_t mSentPackets = 0;
+    uint64_t mSendBatches = 0;
+    // Datagrams which are longer than the slot of receive ring.
+    uint64_t mTruncatedPackets = 0;
+    // Datagrams which are rejected by kernel on sending.
+    uint64_t mDroppedPackets = 0;
+};
+
+class UdpSocket;
+
+// All datagrams read by one recvmmsg are handed to callback together. The datagrams sent in callback
+// are flushed after callback returns.
+using UdpMessageCallback = std::function<void (UdpSocket& socket, std::span<const UdpPacket> packets)>;
+
+/*
+ * UdpSocket
+ * Datagram socket driven by EventLoop. Datagrams are read by recvmmsg into a preallocated ring of
+ * slots, and the datagrams to send are copied into a preallocated ring and written by sendmmsg, so
+ * no memory is allocated per datagram and one system call moves a batch of datagrams.
+ *
+ *  receive ring: |==slot==|==slot==|==slot==| ... mBatchSize slots of mMaxPacketSize bytes.
+ *  send ring:    |==msg==|====msg(GSO)====|==msg==|----free----|
+ *                ^                                ^
+ *                mSendHead                        mSendTail
+ *
+ * UdpSocket is owned by its loop, all functions must be invoked in loop thread.
+ */
+class UdpSocket final {
+public:
+    using UdpSocketPtr      = std::unique_ptr<UdpSocket>;
+    using char_type         = uint8_t;
+    using span_type         = std::span<const char_type>;
+    DISABLE_COPY(UdpSocket);
+    DISABLE_MOVE(UdpSocket);
+    ~UdpSocket();
+
+    /**
+     * @brief createUdpSocket : Wrap a datagram socket, see Socket::createUdpSocket and
+     *                          Socket::createUdpClientSocket. Must be invoked in loop thread.
+     *
+     * @param loop: The owner loop.
+     * @param socket:
+     * @param options: GSO/GRO fall back to plain datagrams if kernel doesn't support them.
+     */
+    static UdpSocketPtr createUdpSocket(EventLoop* loop, SocketPtr&& socket, const UdpSocketOptions& options = {});
+
+    // Must be set before start.
+    void setMessageCallback(UdpMessageCallback&& cb) noexcept { mMessageCb = std::move(cb); }
+
+    // Start to receive datagrams.
+    void start();
+
+    /**
+     * @brief send : Copy a datagram into send ring. The ring is flushed after message callback returns,
+     *               when it's full, or by flush.
+     *
+     * @param data:
+     * @param peerAddr: The destination, unset address means the peer of connected socket.
+     *
+     * @return : false if datagram is longer than mMaxPacketSize, or the ring is full and socket is not
+     *           writable now. The datagram is not queued in that case.
+     */
+    bool send(span_type data, const RawSockAddr& peerAddr);
+
+    // Send to the peer of connected socket.
+    bool send(span_type data) { return send(data, RawSockAddr {}); }
+
+    /**
+     * @brief flush : Write the datagrams of send ring by sendmmsg. If socket is not writable, the remained
+     *                datagrams are written when it's writable again.
+     */
+    void flush();
+
+    // Count of datagrams in send ring.
+    [[nodiscard]]
+    size_t getPendingPackets() const noexcept;
+
+    [[nodiscard]]
+    int getFd() const noexcept { return mpSocket->getFd(); }
+
+    [[nodiscard]]
+    const RawSockAddr& getLocalAddr() const { return mpSocket->getLocalAddr(); }
+
+    [[nodiscard]]
+    const UdpStats& getStats() const noexcept { return mStats; }
+
+    [[nodiscard]]
+    EventLoop* getLoop() const noexcept { return mpEventLoop; }
+
+    [[nodiscard]]
+    bool isGsoEnabled() const noexcept { return mIsGsoEnabled; }
+
+    [[nodiscard]]
+    bool isGroEnabled() const noexcept { return mIsGroEnabled; }
+
+private:
+    UdpSocket(EventLoop* loop, SocketPtr&& socket, const UdpSocketOptions& options);
+
+    // One message of send ring, it holds mSize / mSegmentSize datagrams if it's a GSO super packet.
+    struct SendMessage {
+        RawSockAddr mPeerAddr;
+        size_t      mOffset;
+        size_t      mSize;
+        size_t      mSegmentSize;
+        size_t      mSegments;
+    };
+
+    EventLoop*              mpEventLoop;
+    SocketPtr               mpSocket;
+    ChannelPtr              mpChannel;
+    UdpMessageCallback      mMessageCb;
+    size_t                  mBatchSize;
+    size_t                  mMaxPacketSize;
+    bool                    mIsGsoEnabled;
+    bool                    mIsGroEnabled;
+
+    // Receive ring, all of them are allocated in constructor.
+    size_t                  mRecvSlotSize;
+    std::vector<char_type>  mRecvStorage;
+    std::vector<char_type>  mRecvControl;
+    std::vector<iovec>      mRecvIovecs;
+    std::vector<mmsghdr>    mRecvMsgs;
+    std::vector<RawSockAddr>
+                            mRecvAddrs;
+    std::vector<UdpPacket>  mRecvPackets;
+
+    // Send ring, the messages in [mSendHead, mSendTail) are not written.
+    std::vector<char_type>  mSendStorage;
+    std::vector<char_type>  mSendControl;
+    std::vector<iovec>      mSendIovecs;
+    std::vector<mmsghdr>    mSendMsgs;
+    std::vector<SendMessage>
+                            mSendMessages;
+    size_t                  mSendHead;
+    size_t                  mSendTail;
+    size_t                  mSendUsed;
+
+    UdpStats                mStats;
+
+    void handleEvent(ChannelEvent event);
+
+    void handleRead();
+
+    // Append the datagram to the last GSO message if possible.
+    bool appendSegment(span_type data, const RawSockAddr& peerAddr) noexcept;
+
+    // Move the messages which are not sent to the front of ring, so the ring can be appended again.
+    void compactSendRing() noexcept;
+};
+
+using UdpSocketPtr = UdpSocket::UdpSocketPtr;
+
+} // namespace simpletcp::net
@@ -0,0 +1,50 @@
+#pragma once
+
+#include "base/Utils.h"
+#include <cstddef>
+#include <cstdint>
+
+namespace simpletcp::tcp {
+
+/*
+ * MirroredRing
+ * The storage of ring buffer. The same memfd pages are mapped twice back to back, so any readable or
+ * writable range of ring is contiguous in virtual memory, and no compaction is needed.
+ *
+ *  |=========pages=========|=========pages=========|
+ *  ^                       ^                       ^
+ *  |                       |                       |
+ * data()           data() + capacity()     data() + 2 * capacity()
+ *                          (mirror of data())
+ */
+class MirroredRing final {
+public:
+    DISABLE_COPY(MirroredRing);
+    DISABLE_MOVE(MirroredRing);
+
+    using char_type         = uint8_t;
+    using size_type         = size_t;
+
+    /**
+     * @brief MirroredRing : Map the ring.
+     *
+     * @param capacity: The capacity of ring, it's rounded up to the page size.
+     *
+     * @throw : SystemException if memfd or mmap fails.
+     */
+    explicit MirroredRing(size_type capacity);
+
+    ~MirroredRing() noexcept;
+
+    [[nodiscard]]
+    char_type* data() const noexcept { return mpData; }
+
+    [[nodiscard]]
+    size_type capacity() const noexcept { return mCapacity; }
+
+private:
+    char_type*  mpData;
+    size_type   mCapacity;
+};
+
+} // namespace simpletcp::tcp
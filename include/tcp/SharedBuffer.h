@@ -0,0 +1,115 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <span>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace simpletcp::tcp {
+
+/**
+ * @brief : Immutable refcounted byte block. Copying a SharedBuffer only increases the refcount, so the
+ *          same message can be enqueued into the send queues of many connections and written by writev
+ *          directly from the shared block.
+ *          A SharedBuffer may be a slice of a bigger block, the block is released when the last slice
+ *          referring to it is destroyed.
+ */
+class SharedBuffer final {
+public:
+    using char_type         = uint8_t;
+    using size_type         = size_t;
+    using span_type         = std::span<const char_type>;
+
+    static constexpr size_type npos = static_cast<size_type>(-1);
+
+    SharedBuffer() noexcept : mpData(nullptr), mSize(0) {}
+
+    /**
+     * @brief copyFrom : Create a SharedBuffer by copying data, the block is allocated only once.
+     */
+    [[nodiscard]]
+    static SharedBuffer copyFrom(span_type data) {
+        if (data.empty()) {
+            return {};
+        }
+        std::shared_ptr<char_type[]> block = std::make_shared_for_overwrite<char_type[]>(data.size());
+        ::memcpy(block.get(), data.data(), data.size());
+        auto blockData = block.get();
+        return { std::move(block), blockData, data.size() };
+    }
+
+    [[nodiscard]]
+    static SharedBuffer copyFrom(std::string_view data) {
+        return copyFrom(span_type { reinterpret_cast<const char_type *>(data.data()), data.size() });
+    }
+
+    /**
+     * @brief fromString : Create a SharedBuffer by adopting string, the data is not copied.
+     */
+    [[nodiscard]]
+    static SharedBuffer fromString(std::string&& data) {
+        auto holder = std::make_shared<const std::string>(std::move(data));
+        auto blockData = reinterpret_cast<const char_type *>(holder->data());
+        auto size = holder->size();
+        return { std::shared_ptr<const char_type[]> { std::move(holder), blockData }, blockData, size };
+    }
+
+    /**
+     * @brief fromVector : Create a SharedBuffer by adopting vector, the data is not copied.
+     */
+    [[nodiscard]]
+    static SharedBuffer fromVector(std::vector<char_type>&& data) {
+        auto holder = std::make_shared<const std::vector<char_type>>(std::move(data));
+        auto blockData = holder->data();
+        auto size = holder->size();
+        return { std::shared_ptr<const char_type[]> { std::move(holder), blockData }, blockData, size };
+    }
+
+    /**
+     * @brief slice : Create a view of [offset, offset + len) which shares the same block.
+     *                The range is clamped to the size of buffer.
+     */
+    [[nodiscard]]
+    SharedBuffer slice(size_type offset, size_type len = npos) const noexcept {
+        offset = std::min(offset, mSize);
+        len = std::min(len, mSize - offset);
+        return { mpBlock, mpData + offset, len };
+    }
+
+    [[nodiscard]]
+    const char_type* data() const noexcept { return mpData; }
+
+    [[nodiscard]]
+    size_type size() const noexcept { return mSize; }
+
+    [[nodiscard]]
+    bool empty() const noexcept { return mSize == 0; }
+
+    [[nodiscard]]
+    span_type view() const noexcept { return { mpData, mSize }; }
+
+    [[nodiscard]]
+    std::string_view stringView() const noexcept { return { reinterpret_cast<const char *>(mpData), mSize }; }
+
+    // The number of SharedBuffers refer to the same block.
+    [[nodiscard]]
+    long useCount() const noexcept { return mpBlock.use_count(); }
+
+private:
+    // TcpBuffer hands out slices of its receive block.
+    friend class TcpBuffer;
+
+    SharedBuffer(std::shared_ptr<const char_type[]> block, const char_type* data, size_type size) noexcept
+        : mpBlock(std::move(block)), mpData(data), mSize(size) {}
+
+    std::shared_ptr<const char_type[]>  mpBlock;
+    const char_type*                    mpData;
+    size_type                           mSize;
+};
+
+} // namespace simpletcp::tcp
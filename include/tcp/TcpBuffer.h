@@ -2,8 +2,11 @@
 
 #include "base/Utils.h"
 #include "net/Socket.h"
+#include "tcp/SharedBuffer.h"
+#include "tcp/Tls.h"
 #include <cstddef>
 #include <cstdint>
+#include <memory>
 #include <string>
 #include <string_view>
 #include <vector>
@@ -11,6 +14,15 @@
 
 namespace simpletcp::tcp {
 
+class MirroredRing;
+
+enum class TcpBufferMode : uint8_t {
+    // Contiguous block, readable bytes are moved to front when the read position passes half of data.
+    Linear,
+    // Ring mapped twice back to back, readable bytes are never moved unless the ring is full.
+    Mirrored,
+};
+
 /*
  *  |-------------------=================================|-------------------|
  *  |-------------------=========readablebytes===========|---writablebytes---|
@@ -19,13 +31,25 @@ namespace simpletcp::tcp {
  *  |                   |                                |                   |
  *  0               mReadPos                            mWritePos           last
  *
+ * The storage is a refcounted block, so the readable bytes can be handed out as SharedBuffer slices by
+ * extractShared. Bytes before mReadPos are never modified while the block is shared: the buffer only
+ * appends after mWritePos, and it moves to a new block instead of compacting the shared one. The old
+ * block is released when the last slice is destroyed.
+ *
+ * When the buffer is empty, data is read into the scratch buffer of current loop thread instead of the
+ * block, and the views returned by read refer to it. The unconsumed bytes are copied into the block by
+ * releaseScratch after message callback, so idle buffers hold no memory.
+ *
+ * In Mirrored mode, the storage is a MirroredRing, which is allocated at the first read and kept until the
+ * buffer is destroyed. The positions wrap around the capacity of ring instead of compaction. Slices returned
+ * by extractShared are copied from the ring.
  */
 class TcpBuffer final {
 public:
     DISABLE_COPY(TcpBuffer);
     DISABLE_MOVE(TcpBuffer);
-    TcpBuffer();
-    ~TcpBuffer() = default;
+    explicit TcpBuffer(TcpBufferMode mode = TcpBufferMode::Linear);
+    ~TcpBuffer();
 
     using char_type         = uint8_t;
     using buffer_type       = std::vector<char_type>;
@@ -38,11 +62,23 @@ public:
     // If read error or peer socket is shutdown, this function will throw a NetworkException.
     void readFromSocket(const net::SocketPtr& socket);
 
+    // Read decrypted data from TLS session to TcpBuffer, including the bytes buffered in session.
+    // Scratch buffer is not used, because the bytes are rarely consumed before the whole record arrives.
+    // Return the bytes read, 0 if no complete record is received yet.
+    // If read error or peer socket is shutdown, this function will throw a NetworkException.
+    size_type readFromTls(TlsSession& tls);
+
     // Write data from TcpBuffer to socket
     // This operation may block.
+    // If socket is not writable now(EAGAIN, or TCP Fast Open handshake in progress), data is kept in buffer.
     // If write error, this function will throw a NetworkException.
     void writeToSocket(const net::SocketPtr& socket);
 
+    // Copy the unconsumed bytes in scratch buffer into block, must be invoked before the scratch buffer
+    // is reused by other buffers of the same loop thread.
+    // This operation is non-block.
+    void releaseScratch();
+
     // Append data to the end of TcpBuffer.
     // This operation is non-block.
     void appendToBuffer(span_type data);
@@ -73,6 +109,19 @@ public:
 
     std::u8string extractU8String(size_type size) noexcept;
 
+    /**
+     * @brief extractShared : Extract data from current buffer without copy.
+     *
+     * @param size: The size would be extract.
+     *
+     * @return : return a refcounted slice of receive block, it is still valid after buffer advances,
+     *           and can be passed to other threads.
+     */
+    SharedBuffer extractShared(size_type size) noexcept;
+
+    // Drop size bytes from the front of buffer without copy.
+    void discard(size_type size) noexcept;
+
     // Return counts of bytes stored in buffer.
     [[nodiscard]]
     size_type size() const noexcept { return readablebytes(); }
@@ -84,18 +133,44 @@ public:
     bool isWriting() const noexcept;
 
 private:
-    buffer_type mBuffer;
+    std::shared_ptr<char_type[]> mpBlock;
+    std::unique_ptr<MirroredRing> mpRing;
+    // Point to the scratch buffer of loop thread if the data is borrowed from it.
+    char_type* mpScratch;
+    size_type mCapacity;
     size_type mReadPos;
     size_type mWritePos;
+    TcpBufferMode mMode;
+
+    [[nodiscard]]
+    char_type* getStorage() const noexcept;
 
     [[nodiscard]]
-    auto getWritePos() noexcept { return mBuffer.data() + mWritePos; }
+    auto getWritePos() noexcept { return getStorage() + mWritePos; }
 
     [[nodiscard]]
-    auto getReadPos() noexcept { return mBuffer.data() + mReadPos; }
+    auto getReadPos() noexcept { return (mpScratch != nullptr ? mpScratch : getStorage()) + mReadPos; }
 
+    // In ring, mWritePos may pass the capacity, the writable bytes are limited by the readable bytes.
     [[nodiscard]]
-    size_type writablebytes() const noexcept { return mBuffer.size() - mWritePos; }
+    size_type writablebytes() const noexcept {
+        return mpRing ? mCapacity - readablebytes() : mCapacity - mWritePos;
+    }
+
+    // Slices of block are still alive, the bytes before mWritePos must not be modified.
+    [[nodiscard]]
+    bool isShared() const noexcept { return mpBlock.use_count() > 1; }
+
+    // Make sure at least len bytes are writable. Compact block in place if it's not shared, otherwise
+    // move readable bytes to a new block.
+    void ensureWritable(size_type len);
+
+    // Read data from socket to ring.
+    void readToRing(const net::SocketPtr& socket);
+
+    // Move readable bytes to a new ring which holds required bytes at least. If ring can't be mapped,
+    // switch to Linear mode and return false.
+    bool growRing(size_type required);
 
     [[nodiscard]]
     size_type readablebytes() const noexcept { return mWritePos - mReadPos; }
@@ -122,6 +197,8 @@ private:
      *  ^                  ^                                          ^
      *  |                  |                                          |
      * mReadPos          mWritePos                                  last
+     *
+     * Shrink is skipped if block is shared, and the block is released if no bytes are left.
      */
     void updateReadPos(size_type len) noexcept;
 
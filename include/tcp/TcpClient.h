@@ -7,6 +7,7 @@
 #include "net/EventLoop.h"
 #include <chrono>
 #include <ratio>
+#include <string>
 
 namespace simpletcp::tcp {
 
@@ -56,7 +57,8 @@ public:
     DISABLE_MOVE(TcpClient);
 
     // Run in loop thread.
-    TcpClient(net::EventLoop* loop, net::SocketAddr serverAddr);
+    // The socket options are applied to socket before every connect.
+    TcpClient(net::EventLoop* loop, net::SocketAddr serverAddr, net::SocketOptions options = {});
 
     // Run in loop thread.
     ~TcpClient();
@@ -78,21 +80,21 @@ public:
      *
      * @param cb: connection callback which would be invoked when a connection is created or removed.
      */
-    void setConnectionCallback(TcpConnectionCallback&& cb) noexcept { mConnectionCb = std::move(cb); }
+    void setConnectionCallback(TcpConnectionCallback&& cb) noexcept { mCallbacks.mConnectionCb = std::move(cb); }
 
     /**
      * @brief setMessageCallback: User interface
      *
      * @param cb: messsage callback which would be invoked when a messsage is received from server.
      */
-    void setMessageCallback(TcpMessageCallback&& cb) noexcept { mMessageCb = std::move(cb); }
+    void setMessageCallback(TcpMessageCallback&& cb) noexcept { mCallbacks.mMessageCb = std::move(cb); }
 
     /**
      * @brief setWriteCompleteCallback: User interface
      *
      * @param cb: write complete callback which would be invoked after all write operation done.
      */
-    void setWriteCompleteCallback(TcpWriteCompleteCallback&& cb) noexcept { mWriteCompleteCb = std::move(cb); }
+    void setWriteCompleteCallback(TcpWriteCompleteCallback&& cb) noexcept { mCallbacks.mWriteCompleteCb = std::move(cb); }
 
     /**
      * @brief setHighWaterMarkCallback: User interface
@@ -100,7 +102,26 @@ public:
      * @param cb: The callback function would be invoked when
      *            the size of received buffer bigger then TCP_HIGH_WATER_MARK.
      */
-    void setHighWaterMarkCallback(TcpHighWaterMarkCallback&& cb) noexcept { mHighWaterMarkCb = std::move(cb); }
+    void setHighWaterMarkCallback(TcpHighWaterMarkCallback&& cb) noexcept { mCallbacks.mHighWaterMarkCb = std::move(cb); }
+
+    /**
+     * @brief setDrainCallback: User interface
+     *
+     * @param cb: The callback function would be invoked when the data queued by a blocked write is
+     *            written out, e.g. to resume the writer paused by high water mark.
+     */
+    void setDrainCallback(TcpDrainCallback&& cb) noexcept { mCallbacks.mDrainCb = std::move(cb); }
+
+    /**
+     * @brief setTlsContext: User interface
+     *
+     * @param context: The connection performs TLS handshake if it's set, see TlsContext::createClientContext.
+     * @param serverName: The name of server for SNI and verification.
+     */
+    void setTlsContext(TlsContextPtr context, std::string serverName = {}) noexcept {
+        mpTlsContext = std::move(context);
+        mServerName = std::move(serverName);
+    }
 
     /**
      * @brief getId : Get the idenfication of current server.
@@ -127,6 +148,7 @@ private:
 
     net::EventLoop*          mpEventLoop;
     net::SocketAddr          mServerAddr;
+    net::SocketOptions       mSocketOptions;
     ClientState         mState; // State can only change in loop thread.
 
     TcpConnectionPtr    mConnection;
@@ -143,10 +165,11 @@ private:
     // Id is a string like: [timestamp_tid_port_ip]
     std::string         mIdentification;
 
-    TcpConnectionCallback       mConnectionCb;
-    TcpMessageCallback          mMessageCb;
-    TcpWriteCompleteCallback    mWriteCompleteCb;
-    TcpHighWaterMarkCallback    mHighWaterMarkCb;
+    // User callbacks, they are frozen as a shared table when the connection is created.
+    TcpCallbacks                mCallbacks;
+
+    TlsContextPtr               mpTlsContext;
+    std::string                 mServerName;
 
 };
 
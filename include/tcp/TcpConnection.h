@@ -1,11 +1,14 @@
 #pragma once
 
 #include "base/Utils.h"
-#include "base/Mutex.h"
 #include "net/Channel.h"
 #include "net/EventLoop.h"
 #include "net/Socket.h"
 #include "tcp/TcpBuffer.h"
+#include "tcp/TcpRateLimiter.h"
+#include "tcp/TcpSendQueue.h"
+#include "tcp/Tls.h"
+#include <atomic>
 #include <cstddef>
 #include <cstdint>
 #include <fmt/core.h>
@@ -38,11 +41,33 @@ using TcpMessageCallback        = std::function<void (const TcpConnectionPtr&)>;
 using TcpCloseCallback          = std::function<void (const TcpConnectionPtr&)>;
 using TcpWriteCompleteCallback  = std::function<void (const TcpConnectionPtr&)>;
 using TcpHighWaterMarkCallback  = std::function<void (const TcpConnectionPtr&)>;
+using TcpDrainCallback          = std::function<void (const TcpConnectionPtr&)>;
+
+// The high water mark callback is invoked when the send queue holds more bytes.
+inline constexpr size_t TCP_HIGH_WATER_MARK = 65535;
+
+// Callback table of connections. TcpServer/TcpClient build it once and all connections created by them
+// share the same immutable table, so no connection need to copy the std::function objects.
+struct TcpCallbacks {
+    TcpConnectionCallback       mConnectionCb;
+    TcpMessageCallback          mMessageCb;
+    TcpWriteCompleteCallback    mWriteCompleteCb;
+    TcpHighWaterMarkCallback    mHighWaterMarkCb;
+    // Invoked when the data queued by a blocked write is written out, not for the writes that complete
+    // at once, so it costs nothing when socket is writable.
+    TcpDrainCallback            mDrainCb;
+    // Internal callback.
+    // Close callback is used by TcpServer/TcpClient to notify them erase TcpConnection from collection.
+    TcpCloseCallback            mCloseCb;
+};
+
+using TcpCallbacksPtr = std::shared_ptr<const TcpCallbacks>;
 
 
 class TcpConnection final : public std::enable_shared_from_this<TcpConnection> {
     // The state of Tcp connection.
     enum class ConnState {
+        Handshaking,
         Connected,
         HalfClosed,
         DisConnected
@@ -52,29 +77,17 @@ class TcpConnection final : public std::enable_shared_from_this<TcpConnection> {
     //      DisConnected -> Connected -> HalfClosed -> DisConnected
     // 2. If shutdown connection passively:
     //      DisConnected -> Connected -> DisConnected
+    // 3. If TLS is enabled, connection is Handshaking before Connected:
+    //      DisConnected -> Handshaking -> Connected -> ...
+    //      DisConnected -> Handshaking -> DisConnected (handshake failed)
 
 public:
 
     using span_type = TcpBuffer::span_type;         // equals to std::span<const uint8_t>
     using buffer_type = TcpBuffer::buffer_type;     // equals to std::vector<uint8_t>
 
-    static TcpConnectionPtr createTcpConnection(net::SocketPtr&& socket, net::EventLoop* loop);
-
-    // User interface.
-    void setMessageCallback(const TcpMessageCallback& cb) noexcept { mMessageCb = cb; }
-
-    // User interface.
-    void setConnectionCallback(const TcpConnectionCallback& cb) noexcept { mConnectionCb = cb; }
-
-    // User interface.
-    void setWriteCompleteCallback(const TcpWriteCompleteCallback& cb) noexcept { mWriteCompleteCb = cb; }
-
-    // User interface.
-    void setHighWaterMarkCallback(const TcpHighWaterMarkCallback& cb) noexcept { mHighWaterMarkCb = cb; }
-
-    // Internal interface.
-    // Close callback is used by TcpServer/TcpClient to notify them erase TcpConnection from collection.
-    void setCloseCallback(TcpCloseCallback&& cb) noexcept { mCloseCb = std::move(cb); }
+    static TcpConnectionPtr createTcpConnection(net::SocketPtr&& socket, net::EventLoop* loop
+            , TcpCallbacksPtr callbacks, TcpBufferMode recvBufferMode = TcpBufferMode::Linear);
 
     /**
      * @brief send : User interface. Send message to server.
@@ -90,62 +103,181 @@ public:
 
     void sendString(std::string&& message);
 
+    /**
+     * @brief send : User interface. Send a SharedBuffer by reference, the data is not copied and would be
+     *               written by writev from the shared block directly. Thread-safety.
+     *
+     * @param data:
+     */
+    void send(SharedBuffer data);
+
+    /**
+     * @brief sendFile : User interface. Send [offset, offset + size) of file by sendfile, the file is not
+     *                   read into user-space unless TLS records are encrypted in user-space.
+     *                   The file is kept open until it's sent. Thread-safety.
+     *
+     * @param file:
+     * @param offset:
+     * @param size:
+     */
+    void sendFile(std::shared_ptr<const net::FileDesc> file, off_t offset, size_t size);
+
+    /**
+     * @brief sendv : User interface. Send multiple parts as one message, parts are not concatenated.
+     *                Thread-safety.
+     *                In loop thread, parts are written by one writev if nothing is queued. Otherwise parts
+     *                are copied into one buffer and sent to loop thread by one task.
+     *
+     * @param parts:
+     */
+    void sendv(std::span<const span_type> parts);
+
+    class Batch;
+
+    /**
+     * @brief batch : User interface. Create a scoped builder, the parts appended to it are committed to send
+     *                path atomically when it's committed or destroyed. See TcpConnection::Batch.
+     *
+     * @return
+     */
+    [[nodiscard]]
+    Batch batch();
+
     /**
      * @brief read : Return a string which read from TcpBuffer, but not extract data from TcpBuffer.
      *               The size of result string may less then input size, please check it!
-     *               Thread-safety
+     *               Must be invoked in loop thread(in message callback generally).
      * @param size: the size of data user would read.
      *
      * @return result string.
      */
-    span_type read(size_t size) noexcept EXCLUDES(mRecvMutex);
+    span_type read(size_t size) noexcept;
 
     /**
      * @brief readAll : Return a string which read from TcpBuffer, but not extract data from TcpBuffer.
      *                  The size of result string may less then input size, please check it!
-     *                  Thread-safety
+     *                  Must be invoked in loop thread(in message callback generally).
      * @return result string.
      */
-    span_type readAll() noexcept EXCLUDES(mRecvMutex);
+    span_type readAll() noexcept;
 
     /**
      * @brief extract : Return a string which read from TcpBuffer, and extract data from TcpBuffer.
      *                  The size of result string may less then input size, please check it!
-     *                  Thread-safety
+     *                  Must be invoked in loop thread(in message callback generally).
      * @param size: the size of data user would extract.
      *
      * @return result string.
      */
-    buffer_type extract(size_t size) noexcept EXCLUDES(mRecvMutex);
+    buffer_type extract(size_t size) noexcept;
 
     /**
      * @brief extract : Return a string which read from TcpBuffer, and extract data from TcpBuffer.
      *                  The size of result string may less then input size, please check it!
-     *                  Thread-safety
+     *                  Must be invoked in loop thread(in message callback generally).
      * @param size: the size of data user would extract.
      *
      * @return result string.
      */
-    buffer_type extractAll() noexcept EXCLUDES(mRecvMutex);
+    buffer_type extractAll() noexcept;
+
+    /**
+     * @brief extractShared : Extract data from TcpBuffer without copy.
+     *                        The result is a refcounted slice of receive storage, it's still valid after
+     *                        TcpBuffer advances, so it can be passed to send of other connections or to
+     *                        other threads.
+     *                        Must be invoked in loop thread(in message callback generally).
+     * @param size: the size of data user would extract.
+     *
+     * @return result slice, the size may less then input size.
+     */
+    SharedBuffer extractShared(size_t size) noexcept;
+
+    SharedBuffer extractSharedAll() noexcept;
 
     // Read function return string.
-    std::string_view    readString(size_t size) noexcept EXCLUDES(mRecvMutex);
+    std::string_view    readString(size_t size) noexcept;
+
+    std::string_view    readStringAll() noexcept;
+
+    std::string         extractString(size_t size) noexcept;
+
+    std::string         extractStringAll() noexcept;
 
-    std::string_view    readStringAll() noexcept EXCLUDES(mRecvMutex);
+    /**
+     * @brief discard : Drop the bytes consumed by user from TcpBuffer without copy, it's used with
+     *                  readString() to parse messages in place.
+     *                  Must be invoked in loop thread(in message callback generally).
+     * @param size: the size of data user would drop.
+     */
+    void discard(size_t size) noexcept;
 
-    std::string         extractString(size_t size) noexcept EXCLUDES(mRecvMutex);
+    /**
+     * @brief setContext : Attach the state of upper protocol to connection, e.g. the parser of HTTP request.
+     *                     The context is destroyed with connection. Must be invoked in loop thread.
+     */
+    void setContext(std::shared_ptr<void> context) noexcept { mpContext = std::move(context); }
 
-    std::string         extractStringAll() noexcept EXCLUDES(mRecvMutex);
+    [[nodiscard]]
+    const std::shared_ptr<void>& getContext() const noexcept { return mpContext; }
 
     /**
      * @brief getBufferSize : Get the size of bytes store in mRecvBuffer.
      *
      * @return
      */
-    auto getBufferSize() noexcept EXCLUDES(mRecvMutex) {
-        std::lock_guard lock { mRecvMutex };
-        return mRecvBuffer.size();
-    }
+    auto getBufferSize() const noexcept { return mRecvBuffer.size(); }
+
+    /**
+     * @brief getSendQueueSize : Get the size of bytes which are not written to socket yet.
+     *                           Must be invoked in loop thread.
+     */
+    [[nodiscard]]
+    size_t getSendQueueSize() const noexcept { return mSendQueue.size(); }
+
+    /**
+     * @brief setSendRateLimit : User interface. Limit the sending rate of connection. Thread-safety.
+     *                           If useKernelPacing is true and kernel supports SO_MAX_PACING_RATE, packets are
+     *                           paced by kernel. Otherwise the send path is throttled by a token bucket, and
+     *                           writing is resumed by timer.
+     *
+     * @param bytesPerSecond: 0 means no limit.
+     * @param burstBytes: Max bytes written at once, 0 means 100ms of rate.
+     * @param useKernelPacing:
+     */
+    void setSendRateLimit(uint64_t bytesPerSecond, uint64_t burstBytes = 0, bool useKernelPacing = true);
+
+    /**
+     * @brief getThrottleStats : Get the times and the total time of sending is throttled by rate limit.
+     *                           Must be invoked in loop thread.
+     */
+    [[nodiscard]]
+    TcpThrottleStats getThrottleStats() const noexcept;
+
+    /**
+     * @brief attachServerRateLimiter : Internal interface.
+     *                                  Call by TcpServer to share the rate limit and statistics of server.
+     */
+    void attachServerRateLimiter(TcpServerRateLimiterPtr serverLimiter);
+
+    /**
+     * @brief enableTls : Internal interface.
+     *                    Call by TcpServer/TcpClient before establishConnect, then the connection performs
+     *                    TLS handshake before it's connected.
+     *
+     * @param context:
+     * @param serverName: The name of server for SNI and verification, only for client.
+     *
+     * @throw : NetworkException if session can't be created.
+     */
+    void enableTls(const TlsContextPtr& context, std::string_view serverName = {});
+
+    /**
+     * @brief getTlsSession : Get the TLS session, or nullptr if TLS is not enabled.
+     *                        Must be invoked in loop thread.
+     */
+    [[nodiscard]]
+    const TlsSession* getTlsSession() const noexcept { return mpTls.get(); }
 
     /**
      * @brief establishConnect :Internal interface.
@@ -177,9 +309,28 @@ public:
 
     inline void setState(ConnState state) noexcept { mState = state; }
 
-    inline net::SocketAddr getLocalAddr() const noexcept { return mLocalAddr; }
+    /**
+     * @brief getLocalAddr : Get the local address of connection. The text of IP is rendered when it's
+     *                       used at the first time, and cached in the address.
+     *
+     * @return The local address, or an unset address if the connection has been destroyed.
+     */
+    net::RawSockAddr getLocalAddr() const;
+
+    net::RawSockAddr getPeerAddr() const;
+
+    /**
+     * @brief getId : Get the numeric identification of connection, it's unique in the process.
+     */
+    [[nodiscard]]
+    uint64_t getId() const noexcept { return mConnId; }
 
-    inline net::SocketAddr getPeerAddr() const noexcept { return mPeerAddr; }
+    /**
+     * @brief getIdString : Format the identification of connection, like ConnId_[id]_[local]_[peer].
+     *                      The string is formatted for every invocation, don't call it in hot path.
+     */
+    [[nodiscard]]
+    std::string getIdString() const;
 
     void dumpSocketInfo() const noexcept { mpSocket->dumpSocketInfo(); }
 
@@ -192,36 +343,139 @@ public:
     net::EventLoop* getLoop() const noexcept { return mpEventLoop; }
 
 private:
+    // Keep the layout compact, there may be millions of connections in one process.
+    // The addresses are stored in Socket in binary form, and the text form of identification is
+    // formatted lazily by getIdString().
     net::EventLoop*             mpEventLoop;
     net::SocketPtr              mpSocket;
     net::ChannelPtr             mpChannel;
-    net::SocketAddr             mLocalAddr;
-    net::SocketAddr             mPeerAddr;
-    std::string                 mIdentification;
-
-    TcpCloseCallback            mCloseCb;
-    TcpConnectionCallback       mConnectionCb;
-    TcpMessageCallback          mMessageCb;
-    TcpWriteCompleteCallback    mWriteCompleteCb;
-    TcpHighWaterMarkCallback    mHighWaterMarkCb;
+    TcpCallbacksPtr             mpCallbacks;
+    uint64_t                    mConnId;
 
     ConnState                   mState;
 
-    std::mutex                  mRecvMutex;
-    TcpBuffer                   mRecvBuffer GUARDED_BY(mRecvMutex);
-    TcpBuffer                   mSendBuffer;
+    // Shutdown is requested, but it's delayed until send queue is drained.
+    bool                        mIsShutdownPending;
+
+    // Messages sent by other threads are pushed to outbox without lock, and drained by one flush task.
+    // The flag makes sure only one flush task is scheduled for a burst of messages.
+    std::atomic<bool>           mIsFlushScheduled;
+    utils::MpscQueue<TcpOutboxNode>
+                                mOutbox;
+
+    // Receive buffer and send queue are only accessed in loop thread. They hold memory only when data
+    // is left unconsumed by message callback or a write would block, and release it when drained.
+    TcpBuffer                   mRecvBuffer;
+    TcpSendQueue                mSendQueue;
+
+    // Created only if sending is rate limited.
+    std::unique_ptr<TcpRateLimiter>
+                                mpRateLimiter;
+
+    // Created only if TLS is enabled.
+    TlsSessionPtr               mpTls;
+
+    // State of upper protocol, set by user.
+    std::shared_ptr<void>       mpContext;
 
-    TcpConnection(net::SocketPtr&& socket, net::EventLoop* loop);
+    TcpConnection(net::SocketPtr&& socket, net::EventLoop* loop, TcpCallbacksPtr callbacks
+            , TcpBufferMode recvBufferMode);
 
-    void handleRead() EXCLUDES(mRecvMutex);
+    void handleEvent(net::ChannelEvent event);
 
-    void handleWrite() EXCLUDES(mRecvMutex);
+    void handleRead();
 
-    void handleError() EXCLUDES(mRecvMutex);
+    void handleWrite();
 
-    void handleClose() EXCLUDES(mRecvMutex);
+    void handleError();
 
-    void sendInLoop(span_type data);
+    void handleClose();
+
+    // The error of writing is not transient, e.g. connection is reset or the file is truncated, so the
+    // data can't be sent completely. The connection is closed in next loop, the caller may still use it.
+    void handleSendError(const std::exception& e);
+
+    // Drive TLS handshake when socket is readable or writable.
+    void handleHandshake();
+
+    // Write segments or send queue, the data is encrypted in user-space if TLS is enabled without kTLS send.
+    size_t writeSegments(std::span<const TcpSendSegment> segments, size_t limit);
+
+    size_t writeSendQueue(size_t limit = TcpSendQueue::npos);
+
+    // Send segments in the order, the first segment which can't be written directly and the remained
+    // segments are stored in send queue.
+    void sendSegmentsInLoop(std::span<TcpSendSegment> segments);
+
+    // Send segments in any thread, view segments are copied if not in loop thread.
+    void sendSegments(std::vector<TcpSendSegment>&& segments);
+
+    // Push message to outbox and schedule a flush task if needed. Invoked by other threads.
+    void postToOutbox(std::unique_ptr<TcpOutboxNode> node);
+
+    // Drain outbox and send all messages by one writev if possible. Run in loop thread.
+    void flushOutbox();
+
+    void shutdownInLoop();
+
+    // Return the bytes allowed to write now.
+    size_t getSendQuota();
+
+    // Wait for write event, or pause writing until quota is refilled.
+    void scheduleWrite();
+
+    // Called by timer when quota is refilled.
+    void resumeWrite();
+};
+
+/**
+ * @brief : Scoped builder of a multi-part message. All parts are committed to the send path of connection
+ *          atomically with at most one cross-thread hop, and flushed by one writev if possible.
+ *          The data appended by view must be kept valid until the batch is committed.
+ *
+ *          {
+ *              auto batch = conn->batch();
+ *              batch.append(header).append(std::move(body));
+ *          } // committed here.
+ */
+class TcpConnection::Batch final {
+public:
+    DISABLE_COPY(Batch);
+    Batch(Batch&&) noexcept = default;
+    Batch& operator=(Batch&&) = delete;
+
+    explicit Batch(TcpConnectionPtr conn) noexcept : mpConn(std::move(conn)) {}
+
+    ~Batch() { commit(); }
+
+    Batch& append(span_type data) { mSegments.emplace_back(data); return *this; }
+
+    Batch& append(std::string_view data) {
+        mSegments.emplace_back(span_type { reinterpret_cast<const uint8_t *>(data.data()), data.size() });
+        return *this;
+    }
+
+    Batch& append(const char* data) { return append(std::string_view { data }); }
+
+    Batch& append(buffer_type&& data) { mSegments.emplace_back(std::move(data)); return *this; }
+
+    Batch& append(std::string&& data) { mSegments.emplace_back(std::move(data)); return *this; }
+
+    Batch& append(SharedBuffer data) { mSegments.emplace_back(std::move(data)); return *this; }
+
+    // The range of file is sent by sendfile after the parts before it.
+    Batch& append(TcpFileRange file) { mSegments.emplace_back(std::move(file)); return *this; }
+
+    Batch& append(TcpSendSegment&& segment) { mSegments.push_back(std::move(segment)); return *this; }
+
+    /**
+     * @brief commit : Commit all parts to connection. The batch is empty after commit.
+     */
+    void commit();
+
+private:
+    TcpConnectionPtr                mpConn;
+    std::vector<TcpSendSegment>     mSegments;
 };
 
 
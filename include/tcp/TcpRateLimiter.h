@@ -0,0 +1,143 @@
+#pragma once
+
+#include "base/Utils.h"
+#include "base/Mutex.h"
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <optional>
+
+namespace simpletcp::tcp {
+
+using RateClock = std::chrono::steady_clock;
+
+/**
+ * @brief : The statistics of throttled sending.
+ */
+struct TcpThrottleStats {
+    uint64_t                    mThrottledCount = 0;    // Times of sending is paused by rate limit.
+    std::chrono::microseconds   mThrottledTime {};      // Total time of sending is paused.
+};
+
+/*
+ * TokenBucket
+ * Tokens are bytes, they are refilled at mRate bytes per second and at most mBurst bytes are kept.
+ * Not thread-safety.
+ */
+class TokenBucket final {
+public:
+    /**
+     * @brief TokenBucket :
+     *
+     * @param rate: Bytes per second, must be positive.
+     * @param burst: Max bytes sent at once, 0 means 100ms of rate.
+     */
+    TokenBucket(uint64_t rate, uint64_t burst) noexcept;
+
+    // Return the bytes can be sent now, 0 if it's less than one write unit.
+    [[nodiscard]]
+    size_t available(RateClock::time_point now) noexcept;
+
+    // Take bytes from bucket, bytes must not be larger than available.
+    void consume(size_t bytes) noexcept;
+
+    // Return the time to wait until bytes are available, bytes is limited to burst.
+    [[nodiscard]]
+    std::chrono::microseconds waitTime(size_t bytes) const noexcept;
+
+private:
+    double              mTokens;
+    double              mRate;
+    double              mBurst;
+    RateClock::time_point mLastRefill;
+};
+
+/*
+ * TcpServerRateLimiter
+ * The rate limit shared by all connections of server, and the throttle statistics of them.
+ * Thread-safety, connections of different loops refer to it.
+ */
+class TcpServerRateLimiter final {
+public:
+    DISABLE_COPY(TcpServerRateLimiter);
+    DISABLE_MOVE(TcpServerRateLimiter);
+
+    // rate is bytes per second, 0 means no limit of server.
+    TcpServerRateLimiter(uint64_t rate, uint64_t burst);
+
+    ~TcpServerRateLimiter() = default;
+
+    [[nodiscard]]
+    size_t available(RateClock::time_point now) EXCLUDES(mMutex);
+
+    void consume(size_t bytes) EXCLUDES(mMutex);
+
+    [[nodiscard]]
+    std::chrono::microseconds waitTime(size_t bytes) const EXCLUDES(mMutex);
+
+    void addThrottled(std::chrono::microseconds time) noexcept;
+
+    [[nodiscard]]
+    TcpThrottleStats getStats() const noexcept;
+
+private:
+    mutable std::mutex          mMutex;
+    std::optional<TokenBucket>  mBucket GUARDED_BY(mMutex);
+    std::atomic<uint64_t>       mThrottledCount;
+    std::atomic<int64_t>        mThrottledTime;
+};
+
+using TcpServerRateLimiterPtr = std::shared_ptr<TcpServerRateLimiter>;
+
+/*
+ * TcpRateLimiter
+ * The rate limit of one connection, it checks the bucket of connection and the bucket of server.
+ * Only accessed in loop thread of connection.
+ */
+class TcpRateLimiter final {
+public:
+    DISABLE_COPY(TcpRateLimiter);
+    DISABLE_MOVE(TcpRateLimiter);
+
+    TcpRateLimiter() noexcept : mIsThrottled(false) {}
+
+    ~TcpRateLimiter() = default;
+
+    // Set the rate of connection in bytes per second, 0 means no limit of connection.
+    void setRate(uint64_t rate, uint64_t burst) noexcept;
+
+    void setServerLimiter(TcpServerRateLimiterPtr serverLimiter) noexcept { mpServerLimiter = std::move(serverLimiter); }
+
+    // Return the bytes can be sent now.
+    [[nodiscard]]
+    size_t quota(RateClock::time_point now);
+
+    void consume(size_t bytes);
+
+    /**
+     * @brief beginThrottle : Pause sending because quota is exhausted.
+     *
+     * @return : The time to wait before sending is resumed.
+     */
+    std::chrono::microseconds beginThrottle(RateClock::time_point now);
+
+    void endThrottle(RateClock::time_point now) noexcept;
+
+    [[nodiscard]]
+    bool isThrottled() const noexcept { return mIsThrottled; }
+
+    [[nodiscard]]
+    const TcpThrottleStats& getStats() const noexcept { return mStats; }
+
+private:
+    std::optional<TokenBucket>  mBucket;
+    TcpServerRateLimiterPtr     mpServerLimiter;
+    TcpThrottleStats            mStats;
+    RateClock::time_point       mThrottleStart;
+    bool                        mIsThrottled;
+};
+
+} // namespace simpletcp::tcp
@@ -0,0 +1,178 @@
+#pragma once
+
+#include "base/Utils.h"
+#include "base/MpscQueue.h"
+#include "net/FileDesc.h"
+#include "net/Socket.h"
+#include "tcp/SharedBuffer.h"
+#include "tcp/Tls.h"
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <span>
+#include <string>
+#include <variant>
+#include <vector>
+
+namespace simpletcp::tcp {
+
+// A range of file, it's sent by sendfile without copying the file into user-space.
+struct TcpFileRange {
+    std::shared_ptr<const net::FileDesc>    mpFile;
+    off_t                                   mOffset;
+    size_t                                  mSize;
+};
+
+/**
+ * @brief : One part of outgoing data. It is either a view of user data, which must be kept valid
+ *          until it's committed to TcpConnection, a buffer owned by the segment, a reference of
+ *          SharedBuffer, or a range of file.
+ */
+class TcpSendSegment final {
+public:
+    using char_type         = uint8_t;
+    using buffer_type       = std::vector<char_type>;
+    using size_type         = buffer_type::size_type;
+    using span_type         = std::span<const char_type>;
+
+    TcpSendSegment(span_type data) noexcept : mData(data), mOffset(0) {}
+    TcpSendSegment(buffer_type&& data) noexcept : mData(std::move(data)), mOffset(0) {}
+    TcpSendSegment(std::string&& data) noexcept : mData(std::move(data)), mOffset(0) {}
+    TcpSendSegment(SharedBuffer data) noexcept : mData(std::move(data)), mOffset(0) {}
+    TcpSendSegment(TcpFileRange file) noexcept : mData(std::move(file)), mOffset(0) {}
+
+    // Return the data which has not been sent, it's empty for file segment.
+    [[nodiscard]]
+    span_type view() const noexcept;
+
+    [[nodiscard]]
+    size_type size() const noexcept;
+
+    // File segment holds no data in memory, it's written by sendfile.
+    [[nodiscard]]
+    bool isFile() const noexcept { return std::holds_alternative<TcpFileRange>(mData); }
+
+    // Return the range of file which has not been sent, only for file segment.
+    [[nodiscard]]
+    TcpFileRange fileRange() const noexcept;
+
+    // View segment doesn't own data, it must be copied before it's stored.
+    [[nodiscard]]
+    bool isView() const noexcept { return std::holds_alternative<span_type>(mData); }
+
+    void consume(size_type len) noexcept { mOffset += len; }
+
+private:
+    friend class TcpSendQueue;
+
+    std::variant<span_type, buffer_type, std::string, SharedBuffer, TcpFileRange>
+                mData;
+    size_type   mOffset;
+};
+
+/**
+ * @brief : Message node of the cross-thread outbox of TcpConnection. A node is one message, the parts of
+ *          a multi-part message are kept in one node so they're committed atomically.
+ */
+struct TcpOutboxNode final : utils::MpscNode {
+    explicit TcpOutboxNode(TcpSendSegment&& segment) noexcept : mSegment(std::move(segment)) {}
+
+    TcpSendSegment              mSegment;
+    std::vector<TcpSendSegment> mMoreSegments;
+};
+
+/*
+ * TcpSendQueue
+ * The send queue of TcpConnection. Data is stored as a list of segments and flushed by writev, so
+ * the parts of a message needn't be concatenated. Small segments are coalesced into the tail segment
+ * to keep the number of iovecs low, except SharedBuffer which is always stored by reference. File
+ * segments break the writev, they're sent by sendfile when they reach the head of queue.
+ * If the connection encrypts TLS records in user-space, segments are written by SSL_write one by one.
+ *
+ *  |---consumed---|====segment====|====segment====|====segment====|
+ *                 ^                                               ^
+ *                 |                                               |
+ *               mHead                                     mSegments.size()
+ */
+class TcpSendQueue final {
+public:
+    DISABLE_COPY(TcpSendQueue);
+    DISABLE_MOVE(TcpSendQueue);
+    TcpSendQueue() : mHead(0), mBytes(0) {}
+    ~TcpSendQueue() = default;
+
+    using char_type         = TcpSendSegment::char_type;
+    using buffer_type       = TcpSendSegment::buffer_type;
+    using size_type         = TcpSendSegment::size_type;
+    using span_type         = TcpSendSegment::span_type;
+
+    static constexpr size_type npos = static_cast<size_type>(-1);
+
+    // Append segment to the end of queue, the view segment would be copied, and the SharedBuffer
+    // segment is referred without copy.
+    // This operation is non-block.
+    void append(TcpSendSegment&& segment);
+
+    // Write at most limit bytes from queue to socket by writev, return the bytes written.
+    // If socket is not writable now, data is kept in queue.
+    // If write error, this function will throw a NetworkException.
+    size_type writeToSocket(const net::SocketPtr& socket, size_type limit = npos);
+
+    // Same as writeToSocket, but the data is encrypted by TLS session in user-space.
+    size_type writeToTls(TlsSession& tls, size_type limit = npos);
+
+    /**
+     * @brief writeSegments : Write segments to socket by one writev, the segments are not modified.
+     *                        If file segments are met, the segments are written by writev and sendfile in
+     *                        turn with socket corked, until all are written or socket would block.
+     *
+     * @param socket:
+     * @param segments:
+     * @param limit: Max bytes to write.
+     *
+     * @return : The bytes written to socket, 0 if socket is not writable now.
+     *
+     * @throw : NetworkException if write error.
+     */
+    static size_type writeSegments(const net::SocketPtr& socket, std::span<const TcpSendSegment> segments
+            , size_type limit = npos);
+
+    /**
+     * @brief writeSegments : Write segments by TLS session in user-space, until all segments are written or
+     *                        the session would block.
+     *
+     * @throw : NetworkException if write error.
+     */
+    static size_type writeSegments(TlsSession& tls, std::span<const TcpSendSegment> segments
+            , size_type limit = npos);
+
+    // Return counts of bytes stored in queue.
+    [[nodiscard]]
+    size_type size() const noexcept { return mBytes; }
+
+    [[nodiscard]]
+    bool empty() const noexcept { return mBytes == 0; }
+
+private:
+    std::vector<TcpSendSegment> mSegments;
+    size_type                   mHead;
+    size_type                   mBytes;
+
+    // Write segments by one writev or sendfile, skip the bytes of first segment which have been written.
+    static size_type writeOnce(const net::SocketPtr& socket, std::span<const TcpSendSegment> segments
+            , size_type skip, size_type limit);
+
+    // Send the head of file range by sendfile.
+    static size_type sendFile(const net::SocketPtr& socket, const TcpFileRange& file, size_type limit);
+
+    // Cork socket, return false if it's corked already, e.g. by SocketOptions::mCork, the socket should be
+    // kept corked after writing then.
+    static bool cork(const net::SocketPtr& socket) noexcept;
+
+    static void uncork(const net::SocketPtr& socket) noexcept;
+
+    // Drop the segments which have been sent, and move the remained segments to front if needed.
+    void consume(size_type len) noexcept;
+};
+
+} // namespace simpletcp::tcp
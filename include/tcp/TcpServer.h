@@ -8,16 +8,34 @@
 #include "net/EventLoopPool.h"
 #include "tcp/TcpConnection.h"
 
+#include <atomic>
 #include <functional>
+#include <string_view>
+#include <unordered_map>
 #include <unordered_set>
 
 namespace simpletcp::tcp {
 
+// Default limit of connections for one server, it's bounded by RLIMIT_NOFILE in practice.
+inline constexpr size_t TCP_DEFAULT_MAX_CONNECTION_NUM = 100'000;
+
 struct TcpServerArgs {
     net::EventLoop* loop;
     net::SocketAddr serverAddr;
     int maxListenQueue;
     int maxThreadNum = 0;
+    // New connections would be refused when the server holds maxConnectionNum connections.
+    size_t maxConnectionNum = TCP_DEFAULT_MAX_CONNECTION_NUM;
+    // Options are applied to listen socket, and to every accepted socket.
+    net::SocketOptions socketOptions = {};
+    // Storage of receive buffers, Mirrored suits the protocols which leave partial frames in buffer.
+    TcpBufferMode recvBufferMode = TcpBufferMode::Linear;
+    // Sending rate limits in bytes per second, 0 means no limit. The server limit is shared by all
+    // connections, and the connection limit is applied to every accepted connection.
+    uint64_t maxServerSendRate = 0;
+    uint64_t maxConnectionSendRate = 0;
+    // Accepted connections perform TLS handshake if it's set, see TlsContext::createServerContext.
+    TlsContextPtr tlsContext = nullptr;
 };
 
 class TcpServer final {
@@ -29,7 +47,7 @@ public:
     ~TcpServer() noexcept;
 
     /**
-     * @brief start: Start listen for client.
+     * @brief start: Start listen for client. All callbacks must be set before start.
      */
     void start();
 
@@ -62,6 +80,48 @@ public:
      */
     void setHighWaterMarkCallback(TcpHighWaterMarkCallback&& cb) noexcept;
 
+    /**
+     * @brief setDrainCallback: User interface
+     *
+     * @param cb: The callback function would be invoked when the data queued by a blocked write is
+     *            written out, e.g. to resume the writer paused by high water mark.
+     */
+    void setDrainCallback(TcpDrainCallback&& cb) noexcept;
+
+    /**
+     * @brief forEachConnection : User interface. Thread-safety.
+     *                            Invoke cb for every connection of server. cb is run asynchronously in
+     *                            the owner loop of each connection shard, so it's safe to send data or
+     *                            read buffer of connection in cb.
+     *
+     * @param cb: callback which would be invoked for every connection.
+     */
+    void forEachConnection(TcpConnectionCallback&& cb);
+
+    /**
+     * @brief broadcast : User interface. Thread-safety.
+     *                    Send message to all connections of server, message is copied only once into a
+     *                    SharedBuffer, and all connections refer to it.
+     *
+     * @param message:
+     */
+    void broadcast(std::string_view message);
+
+    void broadcast(SharedBuffer message);
+
+    /**
+     * @brief getConnectionNums : Get the number of connections now. The result is only a snapshot.
+     */
+    [[nodiscard]]
+    size_t getConnectionNums() const noexcept { return mConnectionNums.load(std::memory_order_relaxed); }
+
+    /**
+     * @brief getThrottleStats : Get the throttle statistics of all connections. Thread-safety.
+     *                           Only available if a rate limit of server is set.
+     */
+    [[nodiscard]]
+    TcpThrottleStats getThrottleStats() const noexcept;
+
     /**
      * @brief getId : Get the idenfication of current server.
      *
@@ -89,17 +149,34 @@ private:
     // Id is a string like: [timestamp_tid_port_ip]
     std::string         mIdentification;
 
-    std::mutex mConnMutex;
-    std::unordered_set<TcpConnectionPtr> mConnectionSet;
-    static constexpr auto MAX_CONNECTION_NUMS = 256;
-
-    TcpConnectionCallback       mConnectionCb;
-    TcpMessageCallback          mMessageCb;
-    TcpWriteCompleteCallback    mWriteCompleteCb;
-    TcpHighWaterMarkCallback    mHighWaterMarkCb;
+    // Connections are sharded by their owner loops. Every shard is only accessed in its owner loop
+    // , so no lock is needed. The map itself is built in constructor and read-only after that.
+    struct ConnectionShard {
+        std::unordered_set<TcpConnectionPtr> mConnections;
+    };
+    std::unordered_map<net::EventLoop*, ConnectionShard>
+                        mConnectionShards;
+    // Count of connections of all shards, it's used to enforce mMaxConnectionNum.
+    std::atomic<size_t> mConnectionNums;
+    size_t              mMaxConnectionNum;
+    net::SocketOptions  mSocketOptions;
+    TcpBufferMode       mRecvBufferMode;
+    uint64_t            mMaxConnectionSendRate;
+    // Created only if a rate limit is set.
+    TcpServerRateLimiterPtr
+                        mpRateLimiter;
+    TlsContextPtr       mpTlsContext;
+
+    // User callbacks are collected in mCallbacks, and then frozen as a shared table
+    // when server starts. All connections of this server share the same table.
+    TcpCallbacks                mCallbacks;
+    TcpCallbacksPtr             mpSharedCallbacks;
 
     void createNewConnection();
-    void createNewConnectionInSubLoop(net::EventLoop* loop);
+    void createNewConnectionInLoop(net::EventLoop* loop, net::SocketPtr&& clientSocket);
+
+    [[nodiscard]]
+    ConnectionShard& getShard(net::EventLoop* loop);
 };
 
 } // namespace net::tcp
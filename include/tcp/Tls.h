@@ -0,0 +1,155 @@
+#pragma once
+
+#include "base/Utils.h"
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <string_view>
+
+extern "C" {
+#include <sys/types.h>
+}
+
+// Forward declarations of OpenSSL, so users needn't include the headers of OpenSSL.
+struct ssl_ctx_st;
+struct ssl_st;
+
+namespace simpletcp::tcp {
+
+struct TlsContextArgs {
+    // PEM files of certificate chain and private key, required by server.
+    std::string certFile;
+    std::string keyFile;
+    // PEM file of trusted CA certificates. If it's empty, the default paths of system are used.
+    std::string caFile;
+    // Verify the certificate of peer. Client should always enable it in production.
+    bool verifyPeer = false;
+    // Hand the record encryption off to kernel(kTLS) after handshake if kernel supports it.
+    bool enableKtls = true;
+};
+
+/**
+ * @brief : The wrapper of SSL_CTX. It's shared by all connections of TcpServer/TcpClient and is
+ *          thread-safety after creation.
+ */
+class TlsContext final {
+public:
+    using TlsContextPtr = std::shared_ptr<TlsContext>;
+    DISABLE_COPY(TlsContext);
+    DISABLE_MOVE(TlsContext);
+    ~TlsContext();
+
+    /**
+     * @brief createServerContext : Create context for TcpServer.
+     *
+     * @throw : NetworkException if certificate or key can't be loaded.
+     */
+    static TlsContextPtr createServerContext(const TlsContextArgs& args);
+
+    /**
+     * @brief createClientContext : Create context for TcpClient.
+     *
+     * @throw : NetworkException if CA can't be loaded.
+     */
+    static TlsContextPtr createClientContext(const TlsContextArgs& args = {});
+
+    [[nodiscard]]
+    ssl_ctx_st* get() const noexcept { return mpContext; }
+
+    [[nodiscard]]
+    bool isServer() const noexcept { return mIsServer; }
+
+private:
+    TlsContext(ssl_ctx_st* context, bool isServer) noexcept : mpContext(context), mIsServer(isServer) {}
+
+    ssl_ctx_st* mpContext;
+    bool        mIsServer;
+};
+
+using TlsContextPtr = TlsContext::TlsContextPtr;
+
+enum class TlsHandshakeState {
+    Done,
+    WantRead,
+    WantWrite,
+    Failed,
+};
+
+/*
+ * TlsSession
+ * The TLS state of one connection. OpenSSL performs the handshake on the socket directly, and then
+ * enables kTLS if it's available:
+ *  1. kTLS send: records are encrypted by kernel, so the socket is written by writev/sendfile as a
+ *     plain socket, and file is sent without copy.
+ *  2. user-space: records are encrypted by SSL_write, and file is read to user-space before encryption.
+ * Data is always read by SSL_read, which reads from kernel directly if kTLS receive is enabled.
+ * Only accessed in loop thread of connection.
+ */
+class TlsSession final {
+public:
+    using TlsSessionPtr = std::unique_ptr<TlsSession>;
+    DISABLE_COPY(TlsSession);
+    DISABLE_MOVE(TlsSession);
+    ~TlsSession();
+
+    /**
+     * @brief createTlsSession : Create session on a connected socket.
+     *
+     * @param context:
+     * @param fd: The socket.
+     * @param serverName: SNI and the host name to verify, only for client.
+     *
+     * @throw : NetworkException if SSL can't be created.
+     */
+    static TlsSessionPtr createTlsSession(const TlsContextPtr& context, int fd, std::string_view serverName = {});
+
+    // Drive handshake, it should be invoked again when socket is readable or writable as the result says.
+    [[nodiscard]]
+    TlsHandshakeState handshake() noexcept;
+
+    // The following functions act as read/write. On failure, -1 is returned and errno is set, EAGAIN
+    // means the operation should be retried later.
+    ssize_t read(void* data, size_t len) noexcept;
+
+    // A write would block must be retried with the same data, and no less than getPendingWriteSize() bytes.
+    ssize_t write(const void* data, size_t len) noexcept;
+
+    // Encrypt a range of file in user-space. It's only needed if kTLS send is not enabled, otherwise file
+    // is sent by sendfile on socket directly.
+    ssize_t sendFile(int fd, off_t offset, size_t len) noexcept;
+
+    [[nodiscard]]
+    size_t getPendingWriteSize() const noexcept { return mPendingWrite; }
+
+    // Send close_notify to peer.
+    void shutdown() noexcept;
+
+    // Decrypted bytes are buffered in OpenSSL, they must be read before waiting for the socket.
+    [[nodiscard]]
+    bool hasPending() const noexcept;
+
+    [[nodiscard]]
+    bool isKtlsSend() const noexcept;
+
+    [[nodiscard]]
+    bool isKtlsRecv() const noexcept;
+
+    // The version and cipher of session, for log.
+    [[nodiscard]]
+    std::string_view getVersion() const noexcept;
+
+    [[nodiscard]]
+    std::string_view getCipher() const noexcept;
+
+private:
+    explicit TlsSession(ssl_st* ssl) noexcept : mpSsl(ssl), mPendingWrite(0) {}
+
+    ssl_st* mpSsl;
+    // The length of last write which would block, OpenSSL requires the retry to be no shorter.
+    size_t  mPendingWrite;
+};
+
+using TlsSessionPtr = TlsSession::TlsSessionPtr;
+
+} // namespace simpletcp::tcp
@@ -1,6 +1,10 @@
 #include "base/Compress.h"
 #include "base/Log.h"
+#include <algorithm>
+#include <climits>
+#include <memory>
 #include <stdexcept>
+#include <vector>
 #define ZLIB_CONST
 #include <zlib.h>
 
@@ -13,10 +17,14 @@ namespace simpletcp::utils {
 
 std::string compress_deflate(std::string_view src_buffer) {
     std::string dst_buffer;
-    dst_buffer.resize(src_buffer.size());
+    // Incompressible data grows, the output is sized by the bound of zlib.
+    dst_buffer.resize(compressBound(src_buffer.size()));
     size_t dst_buffer_len = dst_buffer.size();
-    compress(reinterpret_cast<unsigned char *>(dst_buffer.data()), &dst_buffer_len
+    auto res = compress(reinterpret_cast<unsigned char *>(dst_buffer.data()), &dst_buffer_len
             , reinterpret_cast<const unsigned char*>(src_buffer.data()), src_buffer.size());
+    if (res != Z_OK) {
+        throw std::runtime_error("[Compress] compress failed");
+    }
     LOG_INFO("{}: src len:{}, dst len:{}\n", __FUNCTION__, src_buffer.size(), dst_buffer_len);
     dst_buffer.resize(dst_buffer_len);
     return dst_buffer;
@@ -34,34 +42,30 @@ std::string uncompress_deflate(std::string_view src_buffer, size_t dst_buffer_le
 }
 
 std::string compress_gzip(std::string_view src_buffer) {
-    std::string dst_buffer;
-    dst_buffer.resize(src_buffer.size());
-    size_t dst_buffer_len = dst_buffer.size();
     z_stream stream {};
     stream.zalloc = nullptr;
     stream.zfree = nullptr;
-    stream.avail_in = static_cast<unsigned>(src_buffer.size());
-    stream.avail_out = static_cast<unsigned>(dst_buffer_len);
-    stream.next_in = reinterpret_cast<const unsigned char *>(src_buffer.data());
-    stream.next_out = reinterpret_cast<unsigned char *>(dst_buffer.data());
 
     if (deflateInit2(&stream, Z_BEST_COMPRESSION, Z_DEFLATED, 15 | 16 /* windowBits */, MAX_MEM_LEVEL /* memLevel */,
                Z_DEFAULT_STRATEGY) != Z_OK) {
         throw std::runtime_error("[Compress] deflateInit failed");
     }
+    // The state is released on every path.
+    ScopeGuard guard { [&stream] { deflateEnd(&stream); } };
 
-    if (deflate(&stream, Z_NO_FLUSH) != Z_OK) {
-        throw std::runtime_error("[Compress] deflate Z_NO_FLUSH failed");
-    }
+    // Incompressible data grows, the output is sized by the bound of zlib.
+    std::string dst_buffer;
+    dst_buffer.resize(deflateBound(&stream, static_cast<uLong>(src_buffer.size())));
+    size_t dst_buffer_len = dst_buffer.size();
+    stream.avail_in = static_cast<unsigned>(src_buffer.size());
+    stream.avail_out = static_cast<unsigned>(dst_buffer_len);
+    stream.next_in = reinterpret_cast<const unsigned char *>(src_buffer.data());
+    stream.next_out = reinterpret_cast<unsigned char *>(dst_buffer.data());
 
     if (deflate(&stream, Z_FINISH) != Z_STREAM_END) {
         throw std::runtime_error("[Compress] deflate Z_FINISH failed");
     }
 
-    if (deflateEnd(&stream) != Z_OK) {
-        throw std::runtime_error("[Compress] deflateEnd failed");
-    }
-
     dst_buffer_len = dst_buffer_len - stream.avail_out;
     dst_buffer.resize(dst_buffer_len);
     LOG_INFO("{}: input len {}, output len {}", __FUNCTION__, src_buffer.size(), dst_buffer_len);
@@ -82,25 +86,132 @@ std::string uncompress_gzip(std::string_view src_buffer, size_t dst_buffer_len)
     if (inflateInit2(&stream, 15 | 16) != Z_OK) {
         throw std::runtime_error("[Compress] inflateInit failed");
     }
-
-    if (inflate(&stream, Z_NO_FLUSH) != Z_STREAM_END) {
-        throw std::runtime_error("[Compress] inflate Z_NO_FLUSH failed");
-    }
+    ScopeGuard guard { [&stream] { inflateEnd(&stream); } };
 
     if (inflate(&stream, Z_FINISH) != Z_STREAM_END) {
         throw std::runtime_error("[Compress] inflate Z_FINISH failed");
     }
 
-    if (inflateEnd(&stream) != Z_OK) {
-        throw std::runtime_error("[Compress] inflateEnd failed");
-    }
-
     dst_buffer_len = dst_buffer_len - stream.avail_out;
     dst_buffer.resize(dst_buffer_len);
     LOG_INFO("{}: input len {}, output len {}", __FUNCTION__, src_buffer.size(), dst_buffer_len);
     return dst_buffer;
 }
 
+// Level of streaming compression, the chunks are compressed when they're produced, so speed matters more.
+static constexpr int STREAM_COMPRESS_LEVEL = 6;
+// Max idle states kept by one thread for each format, a deflate state takes about 256KB.
+static constexpr size_t STREAM_POOL_SIZE = 4;
+
+// Idle z_streams of current thread, they're ended when thread exits.
+class StreamPool final {
+public:
+    StreamPool() = default;
+    DISABLE_COPY(StreamPool);
+    DISABLE_MOVE(StreamPool);
+
+    ~StreamPool() {
+        for (auto& streams : mStreams) {
+            for (auto stream : streams) {
+                deflateEnd(stream);
+                delete stream;
+            }
+        }
+    }
+
+    z_stream* acquire(CompressFormat format) {
+        auto& streams = mStreams[static_cast<size_t>(format)];
+        if (!streams.empty()) {
+            auto stream = streams.back();
+            streams.pop_back();
+            return stream;
+        }
+        auto stream = std::make_unique<z_stream>();
+        // The gzip wrapper is selected by windowBits, it's kept by deflateReset.
+        auto windowBits = format == CompressFormat::Gzip ? 15 | 16 : 15;
+        if (deflateInit2(stream.get(), STREAM_COMPRESS_LEVEL, Z_DEFLATED, windowBits, 8, Z_DEFAULT_STRATEGY) != Z_OK) {
+            throw std::runtime_error("[Compress] deflateInit failed");
+        }
+        return stream.release();
+    }
+
+    void release(z_stream* stream, CompressFormat format) noexcept {
+        auto& streams = mStreams[static_cast<size_t>(format)];
+        if (streams.size() < STREAM_POOL_SIZE && deflateReset(stream) == Z_OK) {
+            streams.push_back(stream);
+            return ;
+        }
+        deflateEnd(stream);
+        delete stream;
+    }
+
+private:
+    std::vector<z_stream*>      mStreams[2];
+};
+
+static StreamPool& getStreamPool() {
+    thread_local StreamPool pool;
+    return pool;
+}
+
+StreamCompressor::StreamCompressor(CompressFormat format)
+    : mpStream(getStreamPool().acquire(format))
+    , mFormat(format)
+    , mIsFinished(false) {
+}
+
+StreamCompressor::~StreamCompressor() {
+    getStreamPool().release(mpStream, mFormat);
+}
+
+std::string StreamCompressor::compress(std::string_view data) {
+    std::string result;
+    if (!data.empty()) {
+        deflateAll(data, Z_SYNC_FLUSH, result);
+    }
+    return result;
+}
+
+std::string StreamCompressor::finish() {
+    std::string result;
+    deflateAll({}, Z_FINISH, result);
+    mIsFinished = true;
+    return result;
+}
+
+void StreamCompressor::deflateAll(std::string_view data, int flush, std::string& result) {
+    if (mIsFinished) {
+        throw std::runtime_error("[Compress] stream is finished");
+    }
+    // avail_in is 32 bits, the huge data is fed by parts.
+    constexpr size_t MAX_DEFLATE_INPUT = UINT_MAX / 2;
+    do {
+        auto input = data.substr(0, MAX_DEFLATE_INPUT);
+        data.remove_prefix(input.size());
+        auto mode = data.empty() ? flush : Z_NO_FLUSH;
+        mpStream->next_in = reinterpret_cast<const unsigned char *>(input.data());
+        mpStream->avail_in = static_cast<unsigned>(input.size());
+        // The bound is enough for most data, deflate is invoked again if the output is full.
+        auto reserved = deflateBound(mpStream, static_cast<uLong>(input.size())) + 16;
+        while (true) {
+            auto offset = result.size();
+            result.resize(offset + reserved);
+            mpStream->next_out = reinterpret_cast<unsigned char *>(result.data() + offset);
+            mpStream->avail_out = static_cast<unsigned>(reserved);
+            auto res = deflate(mpStream, mode);
+            result.resize(offset + reserved - mpStream->avail_out);
+            if (res == Z_STREAM_ERROR) {
+                throw std::runtime_error("[Compress] deflate failed");
+            }
+            // Output is complete if it's not full, or the last block is written.
+            if (res == Z_STREAM_END || (mpStream->avail_out != 0 && mpStream->avail_in == 0)) {
+                break;
+            }
+            reserved = std::max<size_t>(reserved, 4096);
+        }
+    } while (!data.empty());
+}
+
 // TODO:
 // Add br.
 
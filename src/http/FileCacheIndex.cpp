@@ -0,0 +1,32 @@
+#include "http/FileCacheIndex.h"
+
+using namespace std::chrono;
+
+namespace simpletcp::http {
+
+int64_t nowSteadyNs() noexcept {
+    return duration_cast<nanoseconds>(steady_clock::now().time_since_epoch()).count();
+}
+
+int64_t getStatMtimeNs(const struct stat& st) noexcept {
+    return static_cast<int64_t>(st.st_mtim.tv_sec) * 1'000'000'000 + st.st_mtim.tv_nsec;
+}
+
+bool validateFileStat(const std::string& path, uint64_t inode, size_t size, int64_t mtimeNs
+        , std::atomic<int64_t>& checkedNs, int64_t nowNs, milliseconds interval) noexcept {
+    auto lastNs = checkedNs.load(std::memory_order_relaxed);
+    if (nowNs - lastNs < duration_cast<nanoseconds>(interval).count()) {
+        return true;
+    }
+    if (!checkedNs.compare_exchange_strong(lastNs, nowNs, std::memory_order_relaxed)) {
+        return true;
+    }
+    // The path is checked instead of descriptor, the file may be replaced by rename.
+    struct stat st {};
+    if (::stat(path.c_str(), &st) != 0) {
+        return false;
+    }
+    return st.st_ino == inode && static_cast<size_t>(st.st_size) == size && getStatMtimeNs(st) == mtimeNs;
+}
+
+} // namespace simpletcp::http
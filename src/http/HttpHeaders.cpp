@@ -0,0 +1,117 @@
+#include "http/HttpHeaders.h"
+#include "base/StringHelper.h"
+#include <algorithm>
+#include <cstring>
+#include <string_view>
+#include <utility>
+
+using namespace simpletcp::utils;
+
+namespace simpletcp::http {
+
+// The names of unknown headers are compared case-insensitively, and the well-known ones by id.
+static bool isMatched(const HttpHeaderField& field, HeaderId id, std::string_view name) noexcept {
+    return id != HeaderId::Unknown ? field.mId == id : field.mId == HeaderId::Unknown && equalsIgnoreCase(field.mName, name);
+}
+
+HttpHeaders::HttpHeaders(const HttpHeaders& other) : mFields(other.mFields), mBlockUsed(ARENA_BLOCK_SIZE) {
+    if (other.mBlocks.empty()) {
+        return ;
+    }
+    for (auto& field : mFields) {
+        if (field.mId == HeaderId::Unknown) {
+            field.mName = store(field.mName);
+        }
+        field.mValue = store(field.mValue);
+    }
+}
+
+HttpHeaders& HttpHeaders::operator=(const HttpHeaders& other) {
+    if (this != &other) {
+        HttpHeaders copy { other };
+        *this = std::move(copy);
+    }
+    return *this;
+}
+
+const HttpHeaderField* HttpHeaders::find(HeaderId id) const noexcept {
+    for (auto& field : mFields) {
+        if (field.mId == id) {
+            return &field;
+        }
+    }
+    return nullptr;
+}
+
+const HttpHeaderField* HttpHeaders::find(std::string_view name) const noexcept {
+    auto id = toHeaderId(name);
+    for (auto& field : mFields) {
+        if (isMatched(field, id, name)) {
+            return &field;
+        }
+    }
+    return nullptr;
+}
+
+void HttpHeaders::setCopy(std::string_view name, std::string_view value) {
+    auto id = toHeaderId(name);
+    // The canonical name of well-known header is static.
+    set(id, id != HeaderId::Unknown ? HEADER_NAMES[static_cast<size_t>(id)] : name, value);
+}
+
+void HttpHeaders::setCopy(HeaderId id, std::string_view value) {
+    set(id, HEADER_NAMES[static_cast<size_t>(id)], value);
+}
+
+void HttpHeaders::set(HeaderId id, std::string_view name, std::string_view value) {
+    for (auto& field : mFields) {
+        if (isMatched(field, id, name)) {
+            field.mValue = store(value);
+            return ;
+        }
+    }
+    auto storedName = id != HeaderId::Unknown ? name : store(name);
+    mFields.push_back({ id, storedName, store(value) });
+}
+
+void HttpHeaders::remove(HeaderId id) noexcept {
+    std::erase_if(mFields, [id] (const HttpHeaderField& field) {
+        return field.mId == id;
+    });
+}
+
+void HttpHeaders::remove(std::string_view name) noexcept {
+    auto id = toHeaderId(name);
+    std::erase_if(mFields, [id, name] (const HttpHeaderField& field) {
+        return isMatched(field, id, name);
+    });
+}
+
+void HttpHeaders::clear() noexcept {
+    mFields.clear();
+    mBlocks.clear();
+    mBlockUsed = ARENA_BLOCK_SIZE;
+}
+
+std::string_view HttpHeaders::store(std::string_view str) {
+    if (str.empty()) {
+        return {};
+    }
+    char* dest = nullptr;
+    if (str.size() > ARENA_BLOCK_SIZE / 4) {
+        // Large value is stored in its own block, the current block is kept for the small ones.
+        mBlocks.insert(mBlocks.begin(), std::make_unique<char[]>(str.size()));
+        dest = mBlocks.front().get();
+    } else {
+        if (mBlockUsed + str.size() > ARENA_BLOCK_SIZE) {
+            mBlocks.push_back(std::make_unique<char[]>(ARENA_BLOCK_SIZE));
+            mBlockUsed = 0;
+        }
+        dest = mBlocks.back().get() + mBlockUsed;
+        mBlockUsed += str.size();
+    }
+    ::memcpy(dest, str.data(), str.size());
+    return { dest, str.size() };
+}
+
+} // namespace simpletcp::http
@@ -3,22 +3,20 @@
 #include "http/HttpCommon.h"
 #include "http/HttpError.h"
 #include "http/HttpRequest.h"
+#include "http/HttpScanner.h"
+#include <algorithm>
+#include <charconv>
 #include <cstddef>
 #include <cstdint>
-#include <exception>
-#include <string>
-#include <string_view>
 #include <iostream>
-#include <charconv>
+#include <string_view>
 #include <system_error>
-#include <regex>
-#include <tuple>
+#include <utility>
 
 static constexpr std::string_view TAG = "HttpRequest";
 
-static constexpr std::string_view CRLF = "\r\n";
-
-static constexpr std::string_view BLANK_LINE = "\r\n\r\n";
+// Max size of the line of chunk size with extensions, and of the trailer line.
+static constexpr size_t HTTP_MAX_CHUNK_LINE_SIZE = 4096;
 
 using namespace std;
 using namespace simpletcp;
@@ -26,220 +24,439 @@ using namespace simpletcp::utils;
 
 namespace simpletcp::http {
 
-// TODO : Parse request by regex
-static bool parseStartLine(std::string_view requestLine, HttpRequest& request) {
-    TRACE();
-    if (requestLine.empty()) {
-        LOG_ERR("{}: parse error, empty request!", __FUNCTION__);
-        return false;
+// Iterate the comma separated elements of header value, the elements are stripped.
+template <typename Func>
+static void forEachElement(std::string_view value, Func&& func) {
+    while (!value.empty()) {
+        auto pos = value.find(',');
+        func(stripView(value.substr(0, pos)));
+        if (pos == std::string_view::npos) {
+            break;
+        }
+        value.remove_prefix(pos + 1);
     }
-    const auto parser = [&] {
-        if (requestLine.find("HTTP/1.1") != std::string_view::npos) {
-            request.mVersion = Version::HTTP1_1;
-        } else if (requestLine.find("HTTP/1.0") != std::string_view::npos) {
-            request.mVersion = Version::HTTP1_0;
-        } else {
-            LOG_ERR("parseStartLine: parse error, unknown http version!");
-            return false;
+}
+
+static EncodingType toEncodingType(std::string_view type) {
+    // Skip the parameters, e.g. "gzip;q=1.0".
+    type = stripView(type.substr(0, type.find(';')));
+    for (auto encoding : { EncodingType::GZIP, EncodingType::BR, EncodingType::DEFLATE }) {
+        if (equalsIgnoreCase(type, to_cstr(encoding))) {
+            return encoding;
         }
-        auto url_start = requestLine.find('/');
-        auto url_end = requestLine.find('?');
-        if (url_start == std::string_view::npos) {
-            LOG_ERR("parseStartLine: parse error, bad request!");
-            return false;
+    }
+    return EncodingType::NO_ENCODING;
+}
+
+static ContentType toContentType(std::string_view type) {
+    // Skip the parameters, e.g. "text/plain; charset=UTF-8".
+    type = stripView(type.substr(0, type.find(';')));
+    for (auto content : { ContentType::HTML, ContentType::JSON, ContentType::JPEG, ContentType::PNG
+            , ContentType::GIF, ContentType::PLAIN, ContentType::XML, ContentType::BINARY }) {
+        if (equalsIgnoreCase(type, to_cstr(content))) {
+            return content;
+        }
+    }
+    return ContentType::UNKNOWN;
+}
+
+static RequestType toRequestType(std::string_view method) noexcept {
+    // Dispatch by length, so only one method is compared.
+    switch (method.size()) {
+        case 3:
+            return method == "GET" ? RequestType::GET : method == "PUT" ? RequestType::PUT : RequestType::UNKNOWN;
+        case 4:
+            return method == "POST" ? RequestType::POST : method == "HEAD" ? RequestType::HEAD : RequestType::UNKNOWN;
+        case 6:
+            return method == "DELETE" ? RequestType::DELETE : RequestType::UNKNOWN;
+        default:
+            return RequestType::UNKNOWN;
+    }
+}
+
+static bool parseInteger(std::string_view str, int64_t& value) noexcept {
+    auto res = std::from_chars(str.data(), str.data() + str.size(), value);
+    return res.ec == std::errc {} && res.ptr == str.data() + str.size();
+}
+
+// Parse "bytes=first-last, first-, -suffix". The header is ignored if any range is invalid, as RFC 9110
+// requires, then the whole content is sent.
+static void parseRanges(std::string_view value, HttpRequest& request) {
+    constexpr std::string_view unit = "bytes=";
+    if (!equalsIgnoreCase(value.substr(0, unit.size()), unit)) {
+        return ;
+    }
+    value.remove_prefix(unit.size());
+    bool isValid = true;
+    forEachElement(value, [&request, &isValid] (std::string_view range) {
+        auto pos = range.find('-');
+        if (range.empty() || pos == std::string_view::npos) {
+            // Empty elements are allowed in list.
+            isValid = isValid && range.empty();
+            return ;
         }
-        if (url_end == std::string_view::npos) {
-            // no query parameters
-            url_end = requestLine.find("HTTP");
+        auto first = range.substr(0, pos);
+        auto last = range.substr(pos + 1);
+        ByteRange r { .mFirst = -1, .mLast = -1 };
+        if (first.empty()) {
+            // Suffix range, the last bytes of content.
+            isValid = isValid && parseInteger(last, r.mLast) && r.mLast >= 0;
         } else {
-            auto query_begin = url_end;
-            auto query_end = requestLine.find("HTTP");
-            request.mQueryParameters = std::string { requestLine.data() + query_begin, query_end - query_begin };
+            isValid = isValid && parseInteger(first, r.mFirst) && r.mFirst >= 0
+                && (last.empty() || (parseInteger(last, r.mLast) && r.mLast >= r.mFirst));
         }
-        url_start += 1;
-        request.mUrl = strip({ requestLine.data() + url_start, url_end - url_start });
-        return true;
-    };
-    if (requestLine.find("GET") != std::string_view::npos) {
-        request.mType = RequestType::GET;
-        if (!parser())
-            return false;
-    } else if (requestLine.find("POST") != std::string_view::npos) {
-        request.mType = RequestType::POST;
-        if (!parser())
-            return false;
-    } else {
-        LOG_ERR("{}: parse error, unknown type request!", __FUNCTION__);
-        return false;
+        request.mRanges.push_back(r);
+    });
+    if (!isValid || request.mRanges.empty()) {
+        request.mRanges.clear();
     }
-    return true;
 }
 
-static bool parseHeaders(std::string_view headers, HttpRequest& request) {
-    // String translate helper functors
-    constexpr auto to_encoding_type = [] (std::string_view type) {
-        if (type == to_cstr(EncodingType::GZIP)) return EncodingType::GZIP;
-        if (type == to_cstr(EncodingType::BR)) return EncodingType::BR;
-        if (type == to_cstr(EncodingType::DEFLATE)) return EncodingType::DEFLATE;
-        return EncodingType::NO_ENCODING;
-    };
+void HttpRequestParser::reset() noexcept {
+    mState = State::RequestLine;
+    mLineStart = 0;
+    mScanPos = 0;
+    mBodyStart = 0;
+    mBodySize = 0;
+    mChunkSize = 0;
+    mIsChunked = false;
+    mChunkedBody.clear();
+    mUrl = {};
+    mQuery = {};
+    mHeaderFields.clear();
+    mError = RequestErrorType::BadRequest;
+    // Keep the capacity of containers for next request.
+    mRequest.mUrl = {};
+    mRequest.mHost = {};
+    mRequest.mQueryParameters = {};
+    mRequest.mType = RequestType::UNKNOWN;
+    mRequest.mVersion = Version::UNKNOWN;
+    mRequest.mContentType = ContentType::UNKNOWN;
+    mRequest.mContentLength = -1;
+    mRequest.mRanges.clear();
+    mRequest.mIsKeepAlive = false;
+    mRequest.mAcceptEncodings.clear();
+    mRequest.mHeaders.clear();
+    mRequest.mBody = {};
+    mRequest.mRequestSize = -1;
+}
 
-    constexpr auto to_content_type = [] (std::string_view type) {
-        if (type == to_cstr(ContentType::HTML)) return ContentType::HTML;
-        if (type == to_cstr(ContentType::JSON)) return ContentType::JSON;
-        if (type == to_cstr(ContentType::JPEG)) return ContentType::JPEG;
-        if (type == to_cstr(ContentType::PNG)) return ContentType::PNG;
-        if (type == to_cstr(ContentType::GIF)) return ContentType::GIF;
-        if (type == to_cstr(ContentType::PLAIN)) return ContentType::PLAIN;
-        return ContentType::UNKNOWN;
-    };
-    //
+ParseStatus HttpRequestParser::fail(RequestErrorType error) noexcept {
+    mState = State::Error;
+    mError = error;
+    return ParseStatus::Error;
+}
 
-    TRACE();
-    if (headers.empty()) {
-        LOG_INFO("{}: empty headers...", __FUNCTION__);
-        return true;
+ParseStatus HttpRequestParser::parse(std::string_view data) {
+    while (mState == State::RequestLine || mState == State::Headers) {
+        auto lineEnd = findLineEnd(data);
+        if (mState == State::Error) {
+            return ParseStatus::Error;
+        }
+        if (std::min(lineEnd, data.size()) > HTTP_MAX_HEADER_SIZE) {
+            LOG_ERR("{}: headers are longer than {}", __FUNCTION__, HTTP_MAX_HEADER_SIZE);
+            return fail(RequestErrorType::BadRequest);
+        }
+        if (lineEnd == std::string_view::npos) {
+            return ParseStatus::NeedMore;
+        }
+        auto ok = mState == State::RequestLine ? parseRequestLine(data, lineEnd) : parseHeaderLine(data, lineEnd);
+        if (!ok) {
+            return ParseStatus::Error;
+        }
+        mLineStart = lineEnd + 1;
+        mScanPos = mLineStart;
+    }
+    if ((mState == State::ChunkSize || mState == State::ChunkData || mState == State::Trailers)
+            && !parseChunks(data)) {
+        return ParseStatus::Error;
+    }
+    if (mState == State::Body && data.size() >= mBodyStart + mBodySize) {
+        mState = State::Complete;
+    }
+    switch (mState) {
+        case State::Complete:
+            // Views are built from the latest data, the buffer may have been moved since last invocation.
+            buildRequest(data);
+            return ParseStatus::Complete;
+        case State::Error:
+            return ParseStatus::Error;
+        default:
+            return ParseStatus::NeedMore;
     }
-    auto start_pos = 0ul;
-    auto end_pos = headers.find(CRLF, start_pos);
-    while (end_pos != std::string_view::npos) {
-        std::string_view current_header { headers.data() + start_pos, end_pos - start_pos };
+}
 
-        auto delim_pos = current_header.find(':');
-        if (delim_pos != std::string_view::npos) {
-            std::string key { current_header.begin(), current_header.begin() + delim_pos };
-            std::string value { current_header.begin() + delim_pos + 1, current_header.end() };
-            value = strip(value);
-            request.mHeaders.insert({ std::move(key), std::move(value) });
+size_t HttpRequestParser::findLineEnd(std::string_view data) noexcept {
+    // The control chars are invalid in request line and headers, so the line is validated by the
+    // scanning for CR and LF.
+    auto pos = mScanPos + findByteClass(data.substr(mScanPos), LINE_END_CHARS);
+    if (pos == data.size()) {
+        mScanPos = pos;
+        return std::string_view::npos;
+    }
+    if (data[pos] == '\n') {
+        return pos;
+    }
+    if (data[pos] == '\r') {
+        if (pos + 1 == data.size()) {
+            // Scan from CR again when more bytes are received.
+            mScanPos = pos;
+            return std::string_view::npos;
         }
-
-        start_pos = end_pos + CRLF.size();
-        end_pos = headers.find(CRLF, start_pos);
-    }
-    // Set host
-    if (auto iter = request.mHeaders.find("Host"); iter != request.mHeaders.end()) {
-        request.mHost = iter->second;
-    }
-    // Set connection state
-    if (auto iter = request.mHeaders.find("Connections");
-            iter != request.mHeaders.end() && iter->second == "keep-alive") {
-        request.mIsKeepAlive = true;
-    }
-    // Set availble encodings.
-    if (auto iter = request.mHeaders.find("Accept-Encoding"); iter != request.mHeaders.end()) {
-        auto split_result = split(iter->second, ",");
-        for (auto&& encoding_str : split_result) {
-            request.mAcceptEncodings.push_back(to_encoding_type(strip(encoding_str)));
+        if (data[pos + 1] == '\n') {
+            return pos + 1;
         }
     }
-    // Set content info.
-    if (request.mType != RequestType::GET) {
-        if (auto iter = request.mHeaders.find("Content-Type"); iter != request.mHeaders.end()) {
-            const auto& value = iter->second;
-            auto content_type = to_content_type(value);
-            if (content_type == ContentType::UNKNOWN) {
-                LOG_ERR("{}: Unknown content type!", __FUNCTION__);
+    LOG_ERR("{}: invalid char {:#x} in headers", __FUNCTION__, static_cast<uint8_t>(data[pos]));
+    fail(RequestErrorType::BadRequest);
+    return std::string_view::npos;
+}
+
+// Return the line without CRLF(or bare LF).
+static std::string_view getLine(std::string_view data, size_t lineStart, size_t lineEnd) noexcept {
+    auto line = data.substr(lineStart, lineEnd - lineStart);
+    if (!line.empty() && line.back() == '\r') {
+        line.remove_suffix(1);
+    }
+    return line;
+}
+
+bool HttpRequestParser::parseRequestLine(std::string_view data, size_t lineEnd) noexcept {
+    auto line = getLine(data, mLineStart, lineEnd);
+    if (line.empty()) {
+        // Ignore the empty lines before request line.
+        return true;
+    }
+    // METHOD SP request-target SP HTTP-version
+    auto methodEnd = findByteClass(line, NON_TOKEN_CHARS);
+    auto targetEnd = methodEnd + 1 >= line.size() ? line.size()
+        : methodEnd + 1 + findByteClass(line.substr(methodEnd + 1), TARGET_END_CHARS);
+    if (methodEnd == 0 || targetEnd >= line.size() || line[methodEnd] != ' ' || line[targetEnd] != ' ') {
+        LOG_ERR("{}: bad request line {}", __FUNCTION__, line);
+        fail(RequestErrorType::BadRequest);
+        return false;
+    }
+    mRequest.mType = toRequestType(line.substr(0, methodEnd));
+    if (mRequest.mType == RequestType::UNKNOWN) {
+        LOG_ERR("{}: unknown method {}", __FUNCTION__, line.substr(0, methodEnd));
+        fail(RequestErrorType::UnsupportMethod);
+        return false;
+    }
+    auto version = line.substr(targetEnd + 1);
+    if (version == to_cstr(Version::HTTP1_1)) {
+        mRequest.mVersion = Version::HTTP1_1;
+    } else if (version == to_cstr(Version::HTTP1_0)) {
+        mRequest.mVersion = Version::HTTP1_0;
+    } else {
+        LOG_ERR("{}: unknown http version {}", __FUNCTION__, version);
+        fail(RequestErrorType::BadRequest);
+        return false;
+    }
+    auto target = line.substr(methodEnd + 1, targetEnd - methodEnd - 1);
+    if (target.empty() || target.front() != '/') {
+        LOG_ERR("{}: bad request target {}", __FUNCTION__, target);
+        fail(RequestErrorType::BadRequest);
+        return false;
+    }
+    // The offsets are relative to data.
+    auto targetOffset = static_cast<size_t>(target.data() - data.data());
+    auto queryPos = target.find('?');
+    auto path = target.substr(1, queryPos == std::string_view::npos ? std::string_view::npos : queryPos - 1);
+    mUrl = { targetOffset + 1, path.size() };
+    if (queryPos != std::string_view::npos) {
+        mQuery = { targetOffset + queryPos + 1, target.size() - queryPos - 1 };
+    }
+    mState = State::Headers;
+    return true;
+}
+
+bool HttpRequestParser::parseHeaderLine(std::string_view data, size_t lineEnd) {
+    auto line = getLine(data, mLineStart, lineEnd);
+    if (line.empty()) {
+        // The blank line ends headers.
+        mBodyStart = lineEnd + 1;
+        return finishHeaders(data);
+    }
+    // The name must be a token followed by ':' immediately.
+    auto delimPos = findByteClass(line, NON_TOKEN_CHARS);
+    if (delimPos == 0 || delimPos == line.size() || line[delimPos] != ':') {
+        LOG_ERR("{}: bad header {}", __FUNCTION__, line);
+        fail(RequestErrorType::BadRequest);
+        return false;
+    }
+    auto name = line.substr(0, delimPos);
+    auto value = stripView(line.substr(delimPos + 1));
+    auto lineOffset = static_cast<size_t>(line.data() - data.data());
+    auto valueOffset = value.empty() ? lineOffset + line.size() : static_cast<size_t>(value.data() - data.data());
+    mHeaderFields.push_back({ toHeaderId(name), { lineOffset, name.size() }, { valueOffset, value.size() } });
+    return true;
+}
+
+bool HttpRequestParser::finishHeaders(std::string_view data) noexcept {
+    bool hasContentLength = false;
+    for (auto& field : mHeaderFields) {
+        auto value = data.substr(field.mValue.mOffset, field.mValue.mSize);
+        if (field.mId == HeaderId::ContentLength) {
+            int64_t length = 0;
+            // The duplicated lengths must be the same, or the end of body is ambiguous.
+            if (!parseInteger(value, length) || length < 0 || (hasContentLength && length != mRequest.mContentLength)) {
+                LOG_ERR("{}: bad content length {}", __FUNCTION__, value);
+                fail(RequestErrorType::BadRequest);
+                return false;
+            }
+            if (static_cast<uint64_t>(length) > HTTP_MAX_BODY_SIZE) {
+                LOG_ERR("{}: content length {} is larger than {}", __FUNCTION__, length, HTTP_MAX_BODY_SIZE);
+                fail(RequestErrorType::PayloadTooLarge);
                 return false;
             }
-            request.mContentType = content_type;
-            if (auto len = request.mHeaders.find("Content-Length"); len != request.mHeaders.end()) {
-                auto res = std::from_chars(len->second.c_str()
-                        , len->second.c_str() + len->second.size(), request.mContentLength);
-                if (res.ec == std::errc::invalid_argument) {
-                    LOG_ERR("{}: Unknown content length argument {}!", __FUNCTION__, len->second.c_str());
-                    return false;
-                }
+            mRequest.mContentLength = length;
+            mBodySize = static_cast<size_t>(length);
+            hasContentLength = true;
+        } else if (field.mId == HeaderId::TransferEncoding) {
+            // Only chunked is supported, the other codings are not applied by server.
+            if (!equalsIgnoreCase(value, "chunked") || mRequest.mVersion != Version::HTTP1_1) {
+                LOG_ERR("{}: transfer encoding {} is not supported", __FUNCTION__, value);
+                fail(RequestErrorType::BadRequest);
+                return false;
             }
+            mIsChunked = true;
         }
     }
-    // Set range info.
-    if (auto iter = request.mHeaders.find("Range"); iter != request.mHeaders.end()) {
-        const static std::regex range_header_partern {R"(bytes=(.*))"};
-        const auto& value = iter->second;
-        std::cmatch matched_header;
-        if (std::regex_match(value.c_str(), matched_header, range_header_partern)) {
-            std::string_view range_str {
-                value.c_str() + matched_header.position(1),
-                static_cast<size_t>(matched_header.length(1))
-            };
-            auto ranges = utils::split(range_str, ",");
-            const static std::regex range_partern { R"(\s*(\d*)-(\d*))" };
-            for (const auto& cur_range : ranges) {
-                std::cmatch matched;
-                if (std::regex_match(cur_range.c_str(), matched, range_partern)) {
-                    std::pair<int64_t, int64_t> r;
-                    r.first = matched.str(1).empty() ? 0 : std::stoll(matched.str(1));
-                    r.second = matched.str(2).empty() ? -1 : std::stoll(matched.str(2));
-                    request.mRanges.push_back(r);
-                }
+    // The length is ambiguous if both are set, it's refused to avoid request smuggling.
+    if (mIsChunked && hasContentLength) {
+        LOG_ERR("{}: both content length and transfer encoding are set", __FUNCTION__);
+        fail(RequestErrorType::BadRequest);
+        return false;
+    }
+    mState = mIsChunked ? State::ChunkSize : State::Body;
+    return true;
+}
+
+bool HttpRequestParser::parseChunks(std::string_view data) {
+    while (mState == State::ChunkSize || mState == State::ChunkData || mState == State::Trailers) {
+        if (mState == State::ChunkData) {
+            // The chunk is decoded when its data and CRLF are received.
+            if (data.size() < mLineStart + mChunkSize + 2) {
+                return true;
             }
+            if (data.substr(mLineStart + mChunkSize, 2) != "\r\n") {
+                LOG_ERR("{}: chunk data is not ended by CRLF", __FUNCTION__);
+                fail(RequestErrorType::BadRequest);
+                return false;
+            }
+            mChunkedBody.append(data.substr(mLineStart, mChunkSize));
+            mLineStart += mChunkSize + 2;
+            mScanPos = mLineStart;
+            mState = State::ChunkSize;
+            continue;
+        }
+        auto lineEnd = findLineEnd(data);
+        if (mState == State::Error) {
+            return false;
+        }
+        if (std::min(lineEnd, data.size()) - mLineStart > HTTP_MAX_CHUNK_LINE_SIZE) {
+            LOG_ERR("{}: chunk line is longer than {}", __FUNCTION__, HTTP_MAX_CHUNK_LINE_SIZE);
+            fail(RequestErrorType::BadRequest);
+            return false;
+        }
+        if (lineEnd == std::string_view::npos) {
+            return true;
         }
+        auto line = getLine(data, mLineStart, lineEnd);
+        mLineStart = lineEnd + 1;
+        mScanPos = mLineStart;
+        if (mState == State::Trailers) {
+            // Trailer fields are skipped, the blank line ends the body.
+            if (line.empty()) {
+                mBodySize = mLineStart - mBodyStart;
+                mState = State::Complete;
+            }
+            continue;
+        }
+        // chunk-size [ ";" chunk-ext ], the extensions are ignored. At most 15 hex digits, so the size
+        // can't overflow.
+        auto sizeText = stripView(line.substr(0, line.find(';')));
+        uint64_t size = 0;
+        auto res = std::from_chars(sizeText.data(), sizeText.data() + sizeText.size(), size, 16);
+        if (sizeText.empty() || sizeText.size() > 15 || res.ec != std::errc {}
+                || res.ptr != sizeText.data() + sizeText.size()) {
+            LOG_ERR("{}: bad chunk size {}", __FUNCTION__, line);
+            fail(RequestErrorType::BadRequest);
+            return false;
+        }
+        if (mChunkedBody.size() + size > HTTP_MAX_BODY_SIZE) {
+            LOG_ERR("{}: chunked body is larger than {}", __FUNCTION__, HTTP_MAX_BODY_SIZE);
+            fail(RequestErrorType::PayloadTooLarge);
+            return false;
+        }
+        mChunkSize = static_cast<size_t>(size);
+        mState = mChunkSize == 0 ? State::Trailers : State::ChunkData;
     }
     return true;
 }
 
-HttpRequest parseHttpRequest(std::string_view rawHttpPacket) {
-    // parse state machine
-    TRACE();
-    HttpRequest request {};
-    request.mIsKeepAlive = false;
-    std::string_view::size_type start_pos = 0, end_pos = 0;
-
-    // 1. parse request line
-    start_pos = 0;
-    end_pos = rawHttpPacket.find(CRLF);
-    if (end_pos == std::string_view::npos) {
-        LOG_ERR("{}: parse request error.", __FUNCTION__);
-        throw RequestError {"[parseHttpRequest] parse failed.", RequestErrorType::BadRequest};
-    }
-    auto requestLine = std::string(rawHttpPacket.data(), end_pos - start_pos);
-    if (!parseStartLine(requestLine, request)) {
-        LOG_ERR("{}: parse request error.", __FUNCTION__);
-        throw RequestError {"[parseHttpRequest] parse request failed.", RequestErrorType::BadRequest};
-    }
-    // We hope all input line like (key:value CRLF)
-    // Make sure start_pos not CRLF.
-    start_pos = end_pos + CRLF.size();
-    if (start_pos == std::string_view::npos) {
-        LOG_DEBUG("{}: parse headers complete", __FUNCTION__);
-        return request;
-    }
-    
-    // 2. parse headers
-    // end_pos is the ended CRLF of headers.
-    end_pos = rawHttpPacket.find(BLANK_LINE, start_pos);
-    if (end_pos == std::string_view::npos) {
-        LOG_ERR("{}: parse header error. BLANK_LINE not found.", __FUNCTION__);
-        throw RequestError {"[parseHttpRequest] parse header failed. BLANK_LINE not found"
-            , RequestErrorType::BadRequest};
-    }
-    end_pos += CRLF.size(); // use CRLF as end indicator.
-    std::string headers { rawHttpPacket.begin() + start_pos, end_pos - start_pos };
-    if (parseHeaders(headers, request) == false) {
-        LOG_ERR("{}: parse header error. ", __FUNCTION__);
-        throw RequestError {"[parseHttpRequest] parse header failed.", RequestErrorType::BadRequest};
-    }
-    LOG_DEBUG("{}: parse headers complete, then parse body", __FUNCTION__);
-    
-    // 3. parse body
-    // Skip blank line.
-    // Make sure start_pos not CRLF.
-    start_pos = end_pos + CRLF.size();
-    end_pos = rawHttpPacket.size();
-    if (request.mType == RequestType::GET) {
-        LOG_DEBUG("{}: Accept Get request, ignore size check.", __FUNCTION__);
+void HttpRequestParser::buildRequest(std::string_view data) {
+    auto toView = [data] (Field field) {
+        return data.substr(field.mOffset, field.mSize);
+    };
+    mRequest.mUrl = toView(mUrl);
+    mRequest.mQueryParameters = toView(mQuery);
+    if (mIsChunked) {
+        mRequest.mBody = mChunkedBody;
+        mRequest.mContentLength = static_cast<int64_t>(mChunkedBody.size());
     } else {
-        auto content_length = end_pos - start_pos;
-        if (content_length != static_cast<size_t>(request.mContentLength)) {
-            LOG_DEBUG("{}: Bad content length. Actually accepted size:{}, Expect size:{}"
-                    , __FUNCTION__, content_length, request.mContentLength);
-            throw RequestError {"[parseHttpRequest] parse body failed.", RequestErrorType::PartialPacket};
+        mRequest.mBody = data.substr(mBodyStart, mBodySize);
+    }
+    mRequest.mRequestSize = static_cast<int64_t>(getRequestSize());
+    // HTTP/1.1 keeps connection alive by default, HTTP/1.0 doesn't.
+    mRequest.mIsKeepAlive = mRequest.mVersion == Version::HTTP1_1;
+    mRequest.mHeaders.clear();
+    for (auto& field : mHeaderFields) {
+        auto value = toView(field.mValue);
+        mRequest.mHeaders.add(field.mId, toView(field.mName), value);
+        switch (field.mId) {
+            case HeaderId::Host:
+                mRequest.mHost = value;
+                break;
+            case HeaderId::Connection:
+                forEachElement(value, [this] (std::string_view option) {
+                    if (equalsIgnoreCase(option, "close")) {
+                        mRequest.mIsKeepAlive = false;
+                    } else if (equalsIgnoreCase(option, "keep-alive")) {
+                        mRequest.mIsKeepAlive = true;
+                    }
+                });
+                break;
+            case HeaderId::AcceptEncoding:
+                forEachElement(value, [this] (std::string_view encoding) {
+                    mRequest.mAcceptEncodings.push_back(toEncodingType(encoding));
+                });
+                break;
+            case HeaderId::ContentType:
+                mRequest.mContentType = toContentType(value);
+                break;
+            case HeaderId::Range:
+                parseRanges(value, mRequest);
+                break;
+            default:
+                break;
         }
     }
-    request.mBody = std::string { rawHttpPacket.begin() + start_pos, end_pos - start_pos };
-    request.mRequestSize = static_cast<int64_t>(rawHttpPacket.size());
-    LOG_DEBUG("{}: parse body complete", __FUNCTION__);
-    return request;
+}
+
+HttpRequest parseHttpRequest(std::string_view rawHttpPacket) {
+    TRACE();
+    // The decoded chunked body is kept by parser, so it's valid after return.
+    thread_local HttpRequestParser parser;
+    parser.reset();
+    switch (parser.parse(rawHttpPacket)) {
+        case ParseStatus::Complete:
+            return parser.getRequest();
+        case ParseStatus::NeedMore:
+            throw RequestError {"[parseHttpRequest] partial request.", RequestErrorType::PartialPacket};
+        default:
+            throw RequestError {"[parseHttpRequest] parse failed.", parser.getError()};
+    }
 }
 
 void dumpHttpRequest(const HttpRequest& request) {
@@ -256,7 +473,7 @@ void dumpHttpRequest(const HttpRequest& request) {
         LOG_DEBUG("{}: accept encoding {}", __FUNCTION__, to_cstr(encodeType));
     }
     for (auto&& header : request.mHeaders) {
-        LOG_DEBUG("{}: key:{}, value:{}", __FUNCTION__, header.first, header.second);
+        LOG_DEBUG("{}: key:{}, value:{}", __FUNCTION__, header.mName, header.mValue);
     }
 
     std::cout << "[REQUEST] method: " << to_cstr(request.mType) << std::endl;
@@ -269,14 +486,10 @@ void dumpHttpRequest(const HttpRequest& request) {
         std::cout << "[REQUEST] accept encoding:" << to_cstr(encodeType) << std::endl;
     }
     for (auto&& header : request.mHeaders) {
-        std::cout << "[HEADERS] key:" << header.first << ", value:" << header.second << std::endl;
+        std::cout << "[HEADERS] key:" << header.mName << ", value:" << header.mValue << std::endl;
     }
     std::cout << "[BODY] body:" << request.mBody << std::endl;
     std::cout << "[SIZE] total size:" << request.mRequestSize << std::endl;
 }
 
 } // namespace simpletcp::http
-
-
-
-
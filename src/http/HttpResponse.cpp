@@ -1,9 +1,13 @@
 #include <base/Log.h>
 #include <base/Compress.h>
+#include <base/StringHelper.h>
 #include <http/HttpResponse.h>
 #include <http/HttpCommon.h>
 #include <http/HttpError.h>
 #include <algorithm>
+#include <fmt/compile.h>
+#include <iterator>
+#include <memory>
 #include <chrono>
 #include <cstdint>
 #include <ctime>
@@ -11,6 +15,7 @@
 #include <filesystem>
 #include <fstream>
 #include <ios>
+#include <random>
 #include <stdexcept>
 #include <string>
 #include <string_view>
@@ -56,9 +61,183 @@ void HttpResponse::setDate() {
     setProperty("Date", date_str);
 }
 
+// Weak comparison of RFC 9110, the W/ prefix is ignored.
+static bool matchETag(std::string_view etags, std::string_view etag) noexcept {
+    while (!etags.empty()) {
+        auto pos = etags.find(',');
+        auto candidate = utils::stripView(etags.substr(0, pos));
+        if (candidate == "*") {
+            return true;
+        }
+        if (candidate.starts_with("W/")) {
+            candidate.remove_prefix(2);
+        }
+        if (candidate == etag) {
+            return true;
+        }
+        etags = pos == std::string_view::npos ? std::string_view {} : etags.substr(pos + 1);
+    }
+    return false;
+}
+
+// Resolve the range against the size of content, return false if it's unsatisfiable.
+static bool resolveRange(const ByteRange& range, int64_t size, RangeType& resolved) noexcept {
+    if (range.mFirst < 0) {
+        // Suffix range, the whole content is sent if it's longer than content.
+        if (range.mLast == 0 || size == 0) {
+            return false;
+        }
+        resolved = { .start = std::max<int64_t>(0, size - range.mLast), .end = size - 1, .total = size };
+        return true;
+    }
+    if (range.mFirst >= size) {
+        return false;
+    }
+    auto last = range.mLast < 0 ? size - 1 : std::min(range.mLast, size - 1);
+    resolved = { .start = range.mFirst, .end = last, .total = size };
+    return true;
+}
+
+static std::string makeBoundary() {
+    thread_local std::mt19937_64 engine { std::random_device {}() };
+    return fmt::format(FMT_COMPILE("{:016x}"), engine());
+}
+
+void HttpResponse::clearBody() noexcept {
+    mBody.clear();
+    mSharedBody = {};
+    mFileBody = { .mpFile = nullptr, .mOffset = 0, .mSize = 0 };
+    mPartsBody.clear();
+}
+
+bool HttpResponse::checkNotModified(std::string_view etag) {
+    setProperty("ETag", etag);
+    if (mIfNoneMatch.empty() || !matchETag(mIfNoneMatch, etag)) {
+        return false;
+    }
+    LOG_INFO("{}: etag {} is matched", __FUNCTION__, etag);
+    setStatus(StatusCode::NOT_MODIFIED);
+    clearBody();
+    setContentLength(0);
+    return true;
+}
+
+void HttpResponse::setContentByFile(const StaticFile& file) {
+    setContentType(file.getContentType());
+    auto content = file.getContent();
+    auto encoding = EncodingType::NO_ENCODING;
+    if (file.isCompressible()) {
+        setProperty("Vary", "Accept-Encoding");
+        // Select the first encoding accepted by client which has a smaller variant.
+        for (auto accepted : mAvailEncodings) {
+            if (accepted != EncodingType::GZIP && accepted != EncodingType::DEFLATE) {
+                continue;
+            }
+            if (auto variant = file.getContent(accepted); !variant.empty()) {
+                encoding = accepted;
+                content = std::move(variant);
+                break;
+            }
+        }
+    }
+    // The variant is selected first, its own validator is compared.
+    if (checkNotModified(file.getETag(encoding))) {
+        return ;
+    }
+    if (encoding != EncodingType::NO_ENCODING) {
+        setProperty("Content-Encoding", to_cstr(encoding));
+    }
+    LOG_INFO("{}: set content type :{}, size {}", __FUNCTION__, to_cstr(file.getContentType()), content.size());
+    setContentLength(static_cast<int64_t>(content.size()));
+    setBody(std::move(content));
+}
+
+void HttpResponse::setContentByFile(const OpenFile& file) {
+    setContentType(file.getContentType());
+    if (checkNotModified(file.getETag()) || setContentByRanges(file)) {
+        return ;
+    }
+    LOG_INFO("{}: set content type :{}, size {}", __FUNCTION__, to_cstr(file.getContentType()), file.getSize());
+    setContentLength(static_cast<int64_t>(file.getSize()));
+    setBody(tcp::TcpFileRange { .mpFile = file.getFile(), .mOffset = 0, .mSize = file.getSize() });
+}
+
+bool HttpResponse::setContentByRanges(const OpenFile& file) {
+    // The whole file is sent if If-Range doesn't match, it needs the strong comparison.
+    if (mRanges.empty() || mRanges.size() > MAX_RANGES || (!mIfRange.empty() && mIfRange != file.getETag())) {
+        return false;
+    }
+    // Ranges are only for the successful response.
+    if (mStatus != StatusCode::OK && mStatus != StatusCode::UNKNOWN) {
+        return false;
+    }
+    auto size = static_cast<int64_t>(file.getSize());
+    std::vector<RangeType> ranges;
+    ranges.reserve(mRanges.size());
+    for (auto& range : mRanges) {
+        if (RangeType resolved {}; resolveRange(range, size, resolved)) {
+            ranges.push_back(resolved);
+        }
+    }
+    clearBody();
+    if (ranges.empty()) {
+        LOG_INFO("{}: no range is satisfiable, size {}", __FUNCTION__, size);
+        setStatus(StatusCode::RANGE_NOT_SATISFIABLE);
+        setContentType(ContentType::UNKNOWN);
+        setProperty("Content-Range", fmt::format(FMT_COMPILE("bytes */{}"), size));
+        setContentLength(0);
+        return true;
+    }
+    setStatus(StatusCode::PARTIAL_CONTENT);
+    if (ranges.size() == 1) {
+        auto& range = ranges.front();
+        LOG_INFO("{}: send range {}-{}/{}", __FUNCTION__, range.start, range.end, size);
+        setContentRange(range);
+        setContentLength(range.end - range.start + 1);
+        setBody(tcp::TcpFileRange { .mpFile = file.getFile(), .mOffset = range.start
+                , .mSize = static_cast<size_t>(range.end - range.start + 1) });
+        return true;
+    }
+    // Every part is a header and a range of file, the ranges are sent by sendfile too.
+    auto boundary = makeBoundary();
+    int64_t length = 0;
+    mPartsBody.reserve(ranges.size() * 2 + 1);
+    for (auto& range : ranges) {
+        auto header = fmt::format(FMT_COMPILE("\r\n--{}\r\nContent-Type: {}\r\nContent-Range: bytes {}-{}/{}\r\n\r\n")
+            , boundary, to_cstr(file.getContentType()), range.start, range.end, size);
+        length += static_cast<int64_t>(header.size()) + range.end - range.start + 1;
+        mPartsBody.emplace_back(std::move(header));
+        mPartsBody.emplace_back(tcp::TcpFileRange { .mpFile = file.getFile(), .mOffset = range.start
+                , .mSize = static_cast<size_t>(range.end - range.start + 1) });
+    }
+    auto tail = fmt::format(FMT_COMPILE("\r\n--{}--\r\n"), boundary);
+    length += static_cast<int64_t>(tail.size());
+    mPartsBody.emplace_back(std::move(tail));
+    LOG_INFO("{}: send {} ranges, length {}", __FUNCTION__, ranges.size(), length);
+    setContentType(ContentType::UNKNOWN);
+    setProperty("Content-Type", fmt::format(FMT_COMPILE("multipart/byteranges; boundary={}"), boundary));
+    setContentLength(length);
+    return true;
+}
+
 void HttpResponse::setContentByFilePath(const std::filesystem::path& filePath) {
     TRACE();
     try {
+        if (mpOpenFileCache != nullptr) {
+            // The metadata of cached descriptor decides whether the content is held in memory.
+            auto file = mpOpenFileCache->getFile(filePath);
+            setProperty("Accept-Ranges", "bytes");
+            // Ranges are sent from descriptor, the content in memory may be compressed.
+            // The content is read by the opened descriptor, so it matches the metadata and needs no open.
+            if (mpFileCache != nullptr && mRanges.empty()) {
+                if (auto content = mpFileCache->getFile(filePath, *file); content != nullptr) {
+                    setContentByFile(*content);
+                    return ;
+                }
+            }
+            setContentByFile(*file);
+            return ;
+        }
         ContentType type;
         if (!filePath.has_extension()) {
             type = ContentType::BINARY;
@@ -94,20 +273,49 @@ void HttpResponse::setContentByFilePath(const std::filesystem::path& filePath) {
     }
 }
 
+HttpStreamPtr HttpResponse::beginStream(bool isCompressible) {
+    if (mpConn == nullptr) {
+        throw ResponseError { "[HttpResponse] stream is only supported by server.", ResponseErrorType::BadResponse };
+    }
+    clearBody();
+    setContentLength(-1);
+    // The end of body is the end of connection if chunked transfer coding is not supported by client.
+    if (!mIsChunkedAllowed) {
+        setKeepAlive(false);
+    }
+    std::unique_ptr<utils::StreamCompressor> compressor;
+    if (isCompressible) {
+        setProperty("Vary", "Accept-Encoding");
+        auto encoding = std::find_if(mAvailEncodings.begin(), mAvailEncodings.end(), [] (auto type) {
+            return type == EncodingType::GZIP || type == EncodingType::DEFLATE;
+        });
+        if (encoding != mAvailEncodings.end()) {
+            setProperty("Content-Encoding", to_cstr(*encoding));
+            // Body of HEAD response is never sent, so it's not compressed.
+            if (mHasBody) {
+                compressor = std::make_unique<utils::StreamCompressor>(*encoding == EncodingType::GZIP
+                        ? utils::CompressFormat::Gzip : utils::CompressFormat::Deflate);
+            }
+        }
+    }
+    mpStream = std::make_shared<HttpStream>(mpConn, mIsChunkedAllowed, mHasBody, std::move(compressor));
+    LOG_INFO("{}: chunked {}, compressed {}", __FUNCTION__, mIsChunkedAllowed, mpStream->mpCompressor != nullptr);
+    return mpStream;
+}
+
 void HttpResponse::setProperty(std::string_view key, std::string_view value) {
-    if (mHeaders.count(key.data()) != 0) {
-        LOG_INFO("{}: key:{}, old value({})->new value({})", __FUNCTION__, key, mHeaders.at(key.data()), value);
-        mHeaders.at(key.data()) = value.data();
+    if (auto field = mHeaders.find(key); field != nullptr) {
+        LOG_INFO("{}: key:{}, old value({})->new value({})", __FUNCTION__, key, field->mValue, value);
     } else {
         LOG_INFO("{}: key:{} value:{}", __FUNCTION__, key, value);
-        mHeaders.insert({ key.data(), value.data() });
     }
+    mHeaders.setCopy(key, value);
 }
 
 auto HttpResponse::getProperty(std::string_view key) -> std::optional<std::string_view> {
     std::optional<std::string_view> result {}; // enable NRVO
-    if (mHeaders.count(key.data()) > 0) {
-        result = mHeaders.at(key.data());
+    if (auto field = mHeaders.find(key); field != nullptr) {
+        result = field->mValue;
     }
     return result;
 }
@@ -124,67 +332,96 @@ void HttpResponse::validateResponse() {
         throw ResponseError {"[HttpResponse] please set status code correctly!", ResponseErrorType::BadStatus};
     }
     [[unlikely]]
-    if (to_unsigned(mStatus) < 300u && mContentLength < 0) {
+    if (to_unsigned(mStatus) < 300u && mContentLength < 0 && mpStream == nullptr) {
         throw ResponseError {"[HttpResponse] please set the length of response!", ResponseErrorType::BadContent};
     }
+    [[unlikely]]
+    if (mContentRange.total != 0 && mContentRange.end - mContentRange.start + 1 != mContentLength) {
+        auto errMsg =
+            fmt::format("[HttpResponse] range end({}) - start({}) + 1 not equals to conetent length({})"
+                    , mContentRange.end, mContentRange.start, mContentLength);
+        throw ResponseError{ errMsg, ResponseErrorType::BadContent };
+    }
 
 }
 
-std::string HttpResponse::generateResponse() {
+void HttpResponse::serialize(tcp::TcpConnection::Batch& batch, bool withBody) {
     TRACE();
     // Validate parameters of current response, throw exception if response is invalid.
     validateResponse();
+    LOG_DEBUG("{}: response status {}", __FUNCTION__, to_cstr(mStatus));
 
+    // The generated headers are formatted by compiled formats straight into the buffer of batch segment,
+    // they're not stored in mHeaders.
+    size_t size = HEADER_RESERVED_SIZE;
+    for (auto&& header : mHeaders) {
+        size += header.mName.size() + header.mValue.size() + 4;
+    }
     std::string buffer;
+    buffer.reserve(size);
+    auto out = std::back_inserter(buffer);
     // Generate status line
-    auto statusLine = fmt::format("{} {}", to_cstr(mVersion), to_cstr(mStatus));
-    buffer.append(statusLine);
-    buffer.append(CRLF);
-    LOG_INFO("{}: response status {}", __FUNCTION__, to_cstr(mStatus));
-
+    out = fmt::format_to(out, FMT_COMPILE("{} {}\r\n"), to_cstr(mVersion), to_cstr(mStatus));
     // Generate headers
     // Set content type and length
     if (mContentType != ContentType::UNKNOWN) {
         if (mCharSet != CharSet::UNKNOWN) {
-            setProperty("Content-Type", fmt::format("{}; {}"
-                    , to_cstr(mContentType), to_cstr(mCharSet)));
+            out = fmt::format_to(out, FMT_COMPILE("Content-Type: {}; {}\r\n"), to_cstr(mContentType), to_cstr(mCharSet));
         } else {
-            setProperty("Content-Type", to_cstr(mContentType));
+            out = fmt::format_to(out, FMT_COMPILE("Content-Type: {}\r\n"), to_cstr(mContentType));
         }
     }
-    setProperty("Content-Length", std::to_string(mContentLength));
-
+    // The length of error response may be unset, it's the size of body. 304 has no content.
+    if (mpStream != nullptr) {
+        if (mpStream->mIsChunked) {
+            buffer.append("Transfer-Encoding: chunked\r\n");
+        }
+    } else if (mStatus != StatusCode::NOT_MODIFIED) {
+        auto bodySize = mFileBody.mpFile != nullptr ? mFileBody.mSize
+            : mSharedBody.empty() ? mBody.size() : mSharedBody.size();
+        for (auto& part : mPartsBody) {
+            bodySize += part.size();
+        }
+        auto contentLength = mContentLength >= 0 ? mContentLength : static_cast<int64_t>(bodySize);
+        out = fmt::format_to(out, FMT_COMPILE("Content-Length: {}\r\n"), contentLength);
+    }
     // Set content range
     if (mContentRange.total != 0) {
-        if (mContentRange.end - mContentRange.start != mContentLength) {
-            auto errMsg =
-                fmt::format("[HttpResponse] range end({}) - start({}) not equals to conetent length({})"
-                        , mContentRange.end, mContentRange.start, mContentLength);
-            throw ResponseError{ errMsg, ResponseErrorType::BadContent };
-        }
-        setProperty("Content-Range", fmt::format("bytes {}-{}/{}"
-                    ,mContentRange.start, mContentRange.end, mContentRange.total));
+        out = fmt::format_to(out, FMT_COMPILE("Content-Range: bytes {}-{}/{}\r\n")
+            , mContentRange.start, mContentRange.end, mContentRange.total);
     }
     // set keep-alive property.
-    if (mIsKeepAlive) {
-        setProperty("Connection", "keep-alive");
-    } else {
-        setProperty("Connection", "close");
-    }
-    // add other headers
+    out = fmt::format_to(out, FMT_COMPILE("Connection: {}\r\n"), mIsKeepAlive ? "keep-alive" : "close");
+    // add other headers, the generated ones take precedence over the ones set by user.
     for (auto&& header : mHeaders) {
-        buffer.append(header.first).append(": ").append(header.second).append(CRLF);
+        auto isGenerated = header.mId == HeaderId::ContentLength || header.mId == HeaderId::Connection
+            || header.mId == HeaderId::TransferEncoding
+            || (header.mId == HeaderId::ContentType && mContentType != ContentType::UNKNOWN)
+            || (header.mId == HeaderId::ContentRange && mContentRange.total != 0);
+        if (!isGenerated) {
+            out = fmt::format_to(out, FMT_COMPILE("{}: {}\r\n"), header.mName, header.mValue);
+        }
     }
     buffer.append(CRLF);
-    if (mBody.empty()) {
-        LOG_DEBUG("{}: response", __FUNCTION__);
-        return buffer;
+    batch.append(std::move(buffer));
+    // Body is moved to its own segment, it's not copied.
+    if (!withBody || mStatus == StatusCode::NOT_MODIFIED || mpStream != nullptr) {
+        return ;
+    }
+    if (mFileBody.mpFile != nullptr) {
+        if (mFileBody.mSize != 0) {
+            batch.append(std::move(mFileBody));
+        }
+    } else if (!mPartsBody.empty()) {
+        for (auto& part : mPartsBody) {
+            batch.append(std::move(part));
+        }
+        mPartsBody.clear();
+    } else if (!mSharedBody.empty()) {
+        batch.append(std::move(mSharedBody));
+    } else if (!mBody.empty()) {
+        batch.append(std::move(mBody));
     }
-
-    // Generate content.
-    buffer.append(mBody);
-    LOG_DEBUG("{}: response", __FUNCTION__);
-    return buffer;
 }
 
 EncodingType HttpResponse::selectEncodeType(const std::filesystem::path& filePath) const {
@@ -205,7 +442,7 @@ void HttpResponse::dump() const {
     LOG_DEBUG("{}: contentType: {}", __FUNCTION__, to_cstr(mContentType));
     LOG_DEBUG("{}: charset: {}", __FUNCTION__, to_cstr(mCharSet));
     for (auto&& header : mHeaders) {
-        LOG_DEBUG("{}: key:{}, value:{}", __FUNCTION__, header.first, header.second);
+        LOG_DEBUG("{}: key:{}, value:{}", __FUNCTION__, header.mName, header.mValue);
     }
 
     if (mContentType == ContentType::HTML || mContentType == ContentType::PLAIN
@@ -219,7 +456,7 @@ void HttpResponse::dump() const {
     std::cout << "[Response] contentType: " << to_cstr(mContentType) << std::endl;
     std::cout << "[Response] charset: " << to_cstr(mCharSet) << std::endl;
     for (auto&& header : mHeaders) {
-        std::cout << "[Response] key:" << header.first << ", value: " << header.second << std::endl;
+        std::cout << "[Response] key:" << header.mName << ", value: " << header.mValue << std::endl;
     }
 
     if (mContentType == ContentType::HTML || mContentType == ContentType::PLAIN
@@ -0,0 +1,164 @@
+#include "http/HttpScanner.h"
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+
+#if defined(__x86_64__) || defined(__i386__)
+#define SIMPLETCP_X86_SIMD 1
+extern "C" {
+#include <immintrin.h>
+}
+#else
+#define SIMPLETCP_X86_SIMD 0
+#endif
+
+namespace simpletcp::http {
+
+using FindKernel = size_t (*)(const char* data, size_t size, const ByteClass& byteClass) noexcept;
+
+static size_t findScalar(const char* data, size_t size, const ByteClass& byteClass) noexcept {
+    for (size_t pos = 0; pos != size; ++pos) {
+        if (byteClass.mTable[static_cast<uint8_t>(data[pos])]) {
+            return pos;
+        }
+    }
+    return size;
+}
+
+#if SIMPLETCP_X86_SIMD
+
+// The kernels are compiled for their instruction sets by target attribute, so the library runs on all
+// x86 CPUs, and they're selected at startup.
+
+// Return the mask of bytes in byteClass for 16 bytes, the nibble lookup by pshufb needs SSSE3.
+__attribute__((target("ssse3")))
+static inline uint32_t matchBlock16(const char* data, __m128i low, __m128i high, bool hasHighBytes) noexcept {
+    const auto nibble = _mm_set1_epi8(0x0f);
+    auto block = _mm_loadu_si128(reinterpret_cast<const __m128i *>(data));
+    auto lowBits = _mm_shuffle_epi8(low, _mm_and_si128(block, nibble));
+    auto highBits = _mm_shuffle_epi8(high, _mm_and_si128(_mm_srli_epi16(block, 4), nibble));
+    auto miss = _mm_cmpeq_epi8(_mm_and_si128(lowBits, highBits), _mm_setzero_si128());
+    auto mask = ~static_cast<uint32_t>(_mm_movemask_epi8(miss)) & 0xffff;
+    // mHigh is 0 for the bytes >= 0x80, they're matched by sign.
+    return hasHighBytes ? mask | static_cast<uint32_t>(_mm_movemask_epi8(block)) : mask;
+}
+
+__attribute__((target("ssse3")))
+static size_t findSsse3(const char* data, size_t size, const ByteClass& byteClass) noexcept {
+    if (size < 16) {
+        return findScalar(data, size, byteClass);
+    }
+    const auto low = _mm_loadu_si128(reinterpret_cast<const __m128i *>(byteClass.mLow.data()));
+    const auto high = _mm_loadu_si128(reinterpret_cast<const __m128i *>(byteClass.mHigh.data()));
+    size_t pos = 0;
+    for (; pos + 16 <= size; pos += 16) {
+        if (auto mask = matchBlock16(data + pos, low, high, byteClass.mHasHighBytes); mask != 0) {
+            return pos + static_cast<size_t>(std::countr_zero(mask));
+        }
+    }
+    if (pos != size) {
+        // The last block overlaps the scanned bytes, they're not matched.
+        pos = size - 16;
+        if (auto mask = matchBlock16(data + pos, low, high, byteClass.mHasHighBytes); mask != 0) {
+            return pos + static_cast<size_t>(std::countr_zero(mask));
+        }
+    }
+    return size;
+}
+
+__attribute__((target("avx2")))
+static inline uint32_t matchBlock32(const char* data, __m256i low, __m256i high, bool hasHighBytes) noexcept {
+    const auto nibble = _mm256_set1_epi8(0x0f);
+    auto block = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(data));
+    auto lowBits = _mm256_shuffle_epi8(low, _mm256_and_si256(block, nibble));
+    auto highBits = _mm256_shuffle_epi8(high, _mm256_and_si256(_mm256_srli_epi16(block, 4), nibble));
+    auto miss = _mm256_cmpeq_epi8(_mm256_and_si256(lowBits, highBits), _mm256_setzero_si256());
+    auto mask = ~static_cast<uint32_t>(_mm256_movemask_epi8(miss));
+    return hasHighBytes ? mask | static_cast<uint32_t>(_mm256_movemask_epi8(block)) : mask;
+}
+
+__attribute__((target("avx2")))
+static size_t findAvx2(const char* data, size_t size, const ByteClass& byteClass) noexcept {
+    if (size < 32) {
+        // Most of header names are shorter than 32 bytes.
+        return findSsse3(data, size, byteClass);
+    }
+    const auto low = _mm256_broadcastsi128_si256(_mm_loadu_si128(reinterpret_cast<const __m128i *>(byteClass.mLow.data())));
+    const auto high = _mm256_broadcastsi128_si256(_mm_loadu_si128(reinterpret_cast<const __m128i *>(byteClass.mHigh.data())));
+    size_t pos = 0;
+    for (; pos + 32 <= size; pos += 32) {
+        if (auto mask = matchBlock32(data + pos, low, high, byteClass.mHasHighBytes); mask != 0) {
+            return pos + static_cast<size_t>(std::countr_zero(mask));
+        }
+    }
+    if (pos != size) {
+        pos = size - 32;
+        if (auto mask = matchBlock32(data + pos, low, high, byteClass.mHasHighBytes); mask != 0) {
+            return pos + static_cast<size_t>(std::countr_zero(mask));
+        }
+    }
+    return size;
+}
+
+static bool isSupported(ScanKernel kernel) noexcept {
+    __builtin_cpu_init();
+    switch (kernel) {
+        case ScanKernel::AVX2: return __builtin_cpu_supports("avx2");
+        case ScanKernel::SSSE3: return __builtin_cpu_supports("ssse3");
+        default: return true;
+    }
+}
+
+#else
+
+static bool isSupported(ScanKernel kernel) noexcept {
+    return kernel == ScanKernel::Scalar;
+}
+
+#endif
+
+static FindKernel getKernel(ScanKernel kernel) noexcept {
+    switch (kernel) {
+#if SIMPLETCP_X86_SIMD
+        case ScanKernel::AVX2: return findAvx2;
+        case ScanKernel::SSSE3: return findSsse3;
+#endif
+        default: return findScalar;
+    }
+}
+
+static ScanKernel selectKernel() noexcept {
+    for (auto kernel : { ScanKernel::AVX2, ScanKernel::SSSE3 }) {
+        if (isSupported(kernel)) {
+            return kernel;
+        }
+    }
+    return ScanKernel::Scalar;
+}
+
+// Scalar kernel is constant initialized, it's used if a request is parsed in static initialization.
+static ScanKernel gScanKernel = ScanKernel::Scalar;
+static FindKernel gFindKernel = findScalar;
+
+size_t findByteClass(std::string_view str, const ByteClass& byteClass) noexcept {
+    return gFindKernel(str.data(), str.size(), byteClass);
+}
+
+ScanKernel getScanKernel() noexcept {
+    return gScanKernel;
+}
+
+bool setScanKernel(ScanKernel kernel) noexcept {
+    if (!isSupported(kernel)) {
+        return false;
+    }
+    gScanKernel = kernel;
+    gFindKernel = getKernel(kernel);
+    return true;
+}
+
+[[maybe_unused]]
+static const bool gIsKernelSelected = setScanKernel(selectKernel());
+
+} // namespace simpletcp::http
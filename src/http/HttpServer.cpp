@@ -8,71 +8,191 @@
 #include <tcp/TcpConnection.h>
 #include <tcp/TcpServer.h>
 #include <iostream>
+#include <memory>
 #include <stdexcept>
 #include <type_traits>
 
 inline static constexpr std::string_view TAG = "HttpServer";
 
-// TODO: add SSL
 namespace simpletcp::http {
 
 [[maybe_unused]]
 static constexpr std::string_view CRLF = "\r\n";
 
+// State of HTTP connection, it's kept in the context of connection.
+struct HttpConnectionContext {
+    HttpRequestParser           mParser;
+    // The streaming response, the following requests wait until it's ended.
+    HttpStreamPtr               mpStream;
+};
+
+// The tail of corked response which is written by several calls is held by Nagle until peer acks,
+// so nodelay is the default of HTTP connections.
+static net::SocketOptions withNoDelay(net::SocketOptions options) {
+    if (!options.mNoDelay) {
+        options.mNoDelay = true;
+    }
+    return options;
+}
+
 HttpServer::HttpServer(HttpServerArgs args): mLoop(), mTcpServer({
         .loop = &mLoop,
         .serverAddr = std::move(args.serverAddr),
         .maxListenQueue = args.maxListenQueue,
-        .maxThreadNum = args.maxThreadNum
-        }) {
+        .maxThreadNum = args.maxThreadNum,
+        .maxConnectionNum = args.maxConnectionNum,
+        .socketOptions = withNoDelay(std::move(args.socketOptions)),
+        .recvBufferMode = args.recvBufferMode,
+        .maxServerSendRate = args.maxServerSendRate,
+        .maxConnectionSendRate = args.maxConnectionSendRate,
+        .tlsContext = std::move(args.tlsContext)
+        })
+        , mFileCache(args.fileCacheOptions)
+        , mOpenFileCache(args.openFileCacheOptions) {
     LOG_INFO("{}", __FUNCTION__);
 }
 
 void HttpServer::start() {
     LOG_INFO("{}", __FUNCTION__);
-    mTcpServer.setConnectionCallback(std::move(mConnectionCb));
+    mTcpServer.setConnectionCallback([this] (const tcp::TcpConnectionPtr& conn) {
+        this->onConnection(conn);
+    });
     mTcpServer.setMessageCallback([this] (const tcp::TcpConnectionPtr& conn) mutable {
         this->onMessage(conn);
     });
+    // Resume the streaming response paused by high water mark.
+    mTcpServer.setDrainCallback([] (const tcp::TcpConnectionPtr& conn) {
+        auto context = std::static_pointer_cast<HttpConnectionContext>(conn->getContext());
+        if (context != nullptr && context->mpStream != nullptr) {
+            context->mpStream->onDrain();
+        }
+    });
     mTcpServer.start();
     mLoop.startLoop();
 }
 
+void HttpServer::stop() {
+    LOG_INFO("{}", __FUNCTION__);
+    mLoop.queueInLoop([this] {
+        mLoop.quitLoop();
+    });
+}
+
+void HttpServer::onConnection(const tcp::TcpConnectionPtr& conn) {
+    if (!conn->isConnected()) {
+        // The writer of stream sees the closed stream.
+        if (auto context = std::static_pointer_cast<HttpConnectionContext>(conn->getContext());
+                context != nullptr && context->mpStream != nullptr) {
+            auto stream = std::move(context->mpStream);
+            stream->close();
+        }
+    }
+    if (mConnectionCb) {
+        mConnectionCb(conn);
+    }
+}
+
 void HttpServer::onMessage(const tcp::TcpConnectionPtr& conn [[maybe_unused]]) {
     TRACE();
-    auto rawHttpPacket = conn->readStringAll();
-    HttpRequest request {};
-    HttpResponse response {};
+    // The parser is kept in connection, so the partial request is not parsed again for every read.
+    auto context = std::static_pointer_cast<HttpConnectionContext>(conn->getContext());
+    if (context == nullptr) {
+        context = std::make_shared<HttpConnectionContext>();
+        conn->setContext(context);
+    }
+    if (context->mpStream != nullptr) {
+        LOG_INFO("{}: response is streaming, the requests are handled after it", __FUNCTION__);
+        return ;
+    }
+    auto parser = &context->mParser;
+    // Pipelined requests are handled in order, and all responses are flushed by one writev.
+    // The views of requests refer to receive buffer, so the requests are discarded after the loop.
+    auto data = conn->readStringAll();
+    size_t consumed = 0;
+    bool isKeepAlive = true;
+    auto batch = conn->batch();
+    while (isKeepAlive && consumed != data.size()) {
+        auto status = parser->parse(data.substr(consumed));
+        if (status == ParseStatus::NeedMore) {
+            LOG_INFO("{}: PartialPacket is received, expect for more data...", __FUNCTION__);
+            break;
+        }
+        if (status == ParseStatus::Error) {
+            LOG_ERR("{}: parse failed, error {}", __FUNCTION__, static_cast<int>(parser->getError()));
+            batch.append(parser->getError() == RequestErrorType::PayloadTooLarge
+                    ? HTTP_PAYLOAD_TOO_LARGE_RESPONSE : HTTP_BAD_REQUEST_RESPONSE);
+            isKeepAlive = false;
+            break;
+        }
+        HttpStreamPtr stream;
+        isKeepAlive = handleRequest(conn, parser->getRequest(), batch, stream);
+        consumed += parser->getRequestSize();
+        parser->reset();
+        if (stream != nullptr) {
+            // The headers are sent with the responses before, the body follows them.
+            batch.commit();
+            conn->discard(consumed);
+            context->mpStream = stream;
+            stream->mEndCb = [this, isKeepAlive] (const HttpStreamPtr& endedStream) {
+                if (auto streamConn = endedStream->mpConn.lock(); streamConn != nullptr) {
+                    this->onStreamEnd(streamConn, isKeepAlive);
+                }
+            };
+            stream->start();
+            return ;
+        }
+    }
+    batch.commit();
+    conn->discard(consumed);
+    if (!isKeepAlive) {
+        conn->shutdownConnection();
+    }
+}
+
+void HttpServer::onStreamEnd(const tcp::TcpConnectionPtr& conn, bool isKeepAlive) {
+    auto context = std::static_pointer_cast<HttpConnectionContext>(conn->getContext());
+    if (context != nullptr) {
+        context->mpStream = nullptr;
+    }
+    if (!isKeepAlive) {
+        conn->shutdownConnection();
+        return ;
+    }
+    // The pipelined requests are handled in next loop, the writer of stream may be in this call stack.
+    if (conn->getBufferSize() != 0) {
+        conn->getLoop()->queueInLoop([this, conn] {
+            if (conn->isConnected()) {
+                this->onMessage(conn);
+            }
+        });
+    }
+}
 
+bool HttpServer::handleRequest(const tcp::TcpConnectionPtr& conn, const HttpRequest& request
+        , tcp::TcpConnection::Batch& batch, HttpStreamPtr& stream) {
+    HttpResponse response {};
     // TODO:
     // Need not found page?
     try {
-        // Parse HTTP request.
-        request = parseHttpRequest(rawHttpPacket);
-        request.mRawRequest = conn->extractString(request.mRequestSize);
         // Handle the received request.
         if (mRequestHandle) {
             LOG_INFO("{}: send response.", __FUNCTION__);
             response.setAcceptEncodings(request.mAcceptEncodings);
+            response.setFileCache(&mFileCache, &mOpenFileCache);
+            response.setStreamTarget(conn, request.mVersion == Version::HTTP1_1, request.mType != RequestType::HEAD);
+            response.setIfNoneMatch(request.mHeaders.get(HeaderId::IfNoneMatch));
+            // Range is only defined for GET.
+            if (request.mType == RequestType::GET) {
+                response.setRangeRequest(request.mRanges, request.mHeaders.get(HeaderId::IfRange));
+            }
             mRequestHandle(request, response);
         } else {
             LOG_INFO("{}: response not found", __FUNCTION__);
             response.setStatus(StatusCode::BAD_REQUEST);
             response.setKeepAlive(false);
         }
-        conn->sendString(response.generateResponse());
-        if (!response.mIsKeepAlive) {
-            conn->shutdownConnection();
-        }
-    } catch (const RequestError& e) {
-        if (e.getErrorType() == RequestErrorType::PartialPacket) {
-            LOG_INFO("{}: PartialPacket is received, expect for more data...", __FUNCTION__);
-        } else {
-            dumpHttpRequest(request);
-            LOG_ERR("{}: {}", __FUNCTION__, e.what());
-            printBacktrace();
-            conn->sendString(HTTP_BAD_REQUEST_RESPONSE);
-        }
+        // Body of HEAD is never sent.
+        response.serialize(batch, request.mType != RequestType::HEAD);
     } catch (const ResponseError& e) {
         // The Server impl of HTTP must catch the exception of HTTP response.
         LOG_ERR("{}: {}", __FUNCTION__, e.what());
@@ -81,7 +201,8 @@ void HttpServer::onMessage(const tcp::TcpConnectionPtr& conn [[maybe_unused]]) {
         printBacktrace();
         throw;
     }
-
+    stream = std::move(response.mpStream);
+    return response.mIsKeepAlive;
 }
 
 } // namespace simpletcp::http
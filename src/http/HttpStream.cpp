@@ -0,0 +1,220 @@
+#include "http/HttpStream.h"
+#include "base/Log.h"
+#include <fmt/compile.h>
+#include <fmt/format.h>
+#include <stdexcept>
+#include <utility>
+
+static constexpr std::string_view TAG = "HttpStream";
+
+namespace simpletcp::http {
+
+static constexpr std::string_view CRLF = "\r\n";
+static constexpr std::string_view LAST_CHUNK = "0\r\n\r\n";
+
+HttpStream::HttpStream(const tcp::TcpConnectionPtr& conn, bool isChunked, bool hasBody,
+        std::unique_ptr<utils::StreamCompressor> compressor)
+    : mpConn(conn)
+    , mIsChunked(isChunked)
+    , mHasBody(hasBody)
+    , mIsStarted(false)
+    , mIsEndPending(false)
+    , mpCompressor(std::move(compressor))
+    , mPostedBytes(0)
+    , mQueuedBytes(0)
+    , mIsPaused(false)
+    , mIsClosed(false) {
+}
+
+bool HttpStream::writeChunk(std::string_view data) {
+    return write(tcp::TcpSendSegment { tcp::TcpSendSegment::span_type {
+            reinterpret_cast<const uint8_t *>(data.data()), data.size() } });
+}
+
+bool HttpStream::writeChunk(std::string&& data) {
+    return write(tcp::TcpSendSegment { std::move(data) });
+}
+
+bool HttpStream::writeChunk(tcp::SharedBuffer data) {
+    return write(tcp::TcpSendSegment { std::move(data) });
+}
+
+bool HttpStream::write(tcp::TcpSendSegment&& chunk) {
+    auto size = chunk.size();
+    if (isClosed()) {
+        return false;
+    }
+    if (size == 0) {
+        return checkWritable();
+    }
+    auto conn = mpConn.lock();
+    if (conn == nullptr) {
+        return false;
+    }
+    mPostedBytes.fetch_add(size);
+    auto loop = conn->getLoop();
+    if (loop->isInLoopThread()) {
+        writeInLoop(std::move(chunk));
+    } else {
+        // The view is invalid after return.
+        if (chunk.isView()) {
+            auto view = chunk.view();
+            chunk = tcp::TcpSendSegment { std::string { reinterpret_cast<const char *>(view.data()), view.size() } };
+        }
+        loop->queueInLoop([self = shared_from_this(), chunk = std::move(chunk)] () mutable {
+            self->writeInLoop(std::move(chunk));
+        });
+    }
+    return checkWritable();
+}
+
+void HttpStream::writeInLoop(tcp::TcpSendSegment&& chunk) {
+    auto size = chunk.size();
+    auto conn = mpConn.lock();
+    if (conn == nullptr || isClosed() || !mHasBody) {
+        mPostedBytes.fetch_sub(size);
+        return ;
+    }
+    if (!mIsStarted) {
+        // Headers are not committed yet, the chunk is kept until the request handle returns.
+        if (chunk.isView()) {
+            auto view = chunk.view();
+            chunk = tcp::TcpSendSegment { std::string { reinterpret_cast<const char *>(view.data()), view.size() } };
+        }
+        mPendingChunks.push_back(std::move(chunk));
+        return ;
+    }
+    sendChunks(conn, std::span { &chunk, 1 });
+    mPostedBytes.fetch_sub(size);
+    updateWritable(conn->getSendQueueSize());
+}
+
+void HttpStream::sendChunks(const tcp::TcpConnectionPtr& conn, std::span<tcp::TcpSendSegment> chunks) {
+    if (mpCompressor != nullptr) {
+        try {
+            for (auto& chunk : chunks) {
+                auto view = chunk.view();
+                chunk = tcp::TcpSendSegment { mpCompressor->compress({
+                        reinterpret_cast<const char *>(view.data()), view.size() }) };
+            }
+        } catch (const std::runtime_error& e) {
+            // The body can't be continued, the peer sees the truncated body.
+            LOG_ERR("{}: {}", __FUNCTION__, e.what());
+            conn->shutdownConnection();
+            close();
+            return ;
+        }
+    }
+    auto batch = conn->batch();
+    for (auto& chunk : chunks) {
+        // The compressor may hold the input until more data is written.
+        if (chunk.size() == 0) {
+            continue;
+        }
+        if (mIsChunked) {
+            batch.append(fmt::format(FMT_COMPILE("{:x}\r\n"), chunk.size()));
+            batch.append(std::move(chunk));
+            batch.append(CRLF);
+        } else {
+            batch.append(std::move(chunk));
+        }
+    }
+}
+
+void HttpStream::end() {
+    auto conn = mpConn.lock();
+    if (conn == nullptr) {
+        return ;
+    }
+    if (conn->getLoop()->isInLoopThread()) {
+        endInLoop();
+    } else {
+        conn->getLoop()->queueInLoop([self = shared_from_this()] {
+            self->endInLoop();
+        });
+    }
+}
+
+void HttpStream::endInLoop() {
+    if (isClosed()) {
+        return ;
+    }
+    if (!mIsStarted) {
+        mIsEndPending = true;
+        return ;
+    }
+    LOG_DEBUG("{}: stream is ended", __FUNCTION__);
+    auto conn = mpConn.lock();
+    if (auto compressor = std::move(mpCompressor); conn != nullptr && compressor != nullptr) {
+        // The end of compressed data, e.g. the trailer of gzip, is sent as the last data chunk.
+        try {
+            tcp::TcpSendSegment tail { compressor->finish() };
+            sendChunks(conn, std::span { &tail, 1 });
+        } catch (const std::runtime_error& e) {
+            LOG_ERR("{}: {}", __FUNCTION__, e.what());
+            conn->shutdownConnection();
+            close();
+            return ;
+        }
+    }
+    mIsClosed.store(true, std::memory_order_release);
+    if (conn != nullptr && mIsChunked && mHasBody) {
+        conn->batch().append(LAST_CHUNK);
+    }
+    if (mEndCb) {
+        mEndCb(shared_from_this());
+    }
+}
+
+void HttpStream::start() {
+    mIsStarted = true;
+    if (auto conn = mpConn.lock(); conn != nullptr && !mPendingChunks.empty()) {
+        size_t size = 0;
+        for (auto& chunk : mPendingChunks) {
+            size += chunk.size();
+        }
+        sendChunks(conn, mPendingChunks);
+        mPendingChunks.clear();
+        mPostedBytes.fetch_sub(size);
+        updateWritable(conn->getSendQueueSize());
+    }
+    if (mIsEndPending) {
+        endInLoop();
+    }
+}
+
+bool HttpStream::checkWritable() noexcept {
+    if (mPostedBytes.load() + mQueuedBytes.load() <= tcp::TCP_HIGH_WATER_MARK) {
+        return !isClosed();
+    }
+    mIsPaused.store(true);
+    // The loop may drain the queue before the flag is set, it doesn't resume writer then.
+    if (mPostedBytes.load() + mQueuedBytes.load() <= tcp::TCP_HIGH_WATER_MARK && mIsPaused.exchange(false)) {
+        return !isClosed();
+    }
+    return false;
+}
+
+void HttpStream::updateWritable(size_t queuedBytes) {
+    mQueuedBytes.store(queuedBytes);
+    if (mPostedBytes.load() + queuedBytes <= tcp::TCP_HIGH_WATER_MARK && mIsPaused.exchange(false)
+            && mWritableCb) {
+        mWritableCb(shared_from_this());
+    }
+}
+
+void HttpStream::close() {
+    if (isClosed()) {
+        return ;
+    }
+    LOG_INFO("{}: connection is closed before stream is ended", __FUNCTION__);
+    mIsClosed.store(true, std::memory_order_release);
+    mPendingChunks.clear();
+    mpCompressor.reset();
+    if (mWritableCb) {
+        mIsPaused.store(false);
+        mWritableCb(shared_from_this());
+    }
+}
+
+} // namespace simpletcp::http
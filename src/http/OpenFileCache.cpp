@@ -0,0 +1,124 @@
+#include "http/OpenFileCache.h"
+#include "base/Error.h"
+#include "base/Log.h"
+#include "http/HttpError.h"
+#include <fmt/format.h>
+#include <utility>
+
+extern "C" {
+#include <fcntl.h>
+#include <sys/stat.h>
+}
+
+static constexpr std::string_view TAG = "OpenFileCache";
+
+using namespace std::chrono;
+
+namespace simpletcp::http {
+
+OpenFilePtr OpenFile::open(const std::string& path) {
+    TRACE();
+    auto type = ContentType::BINARY;
+    if (auto extension = std::filesystem::path { path }.extension(); !extension.empty()) {
+        auto it = Str2ContentType.find(extension.native());
+        if (it == Str2ContentType.end()) {
+            std::string errMsg = "[OpenFile] unsupport file type! Path:";
+            errMsg.append(path);
+            throw ResponseError(errMsg, ResponseErrorType::BadContentType);
+        }
+        type = it->second;
+    }
+    std::shared_ptr<const net::FileDesc> file;
+    try {
+        file = net::FileDesc::createFileDesc(path, O_RDONLY | O_CLOEXEC, 0);
+    } catch (const SystemException& e) {
+        throw ResponseError(fmt::format("[OpenFile] {}", e.what()), ResponseErrorType::FileNotFound);
+    }
+    // fstat the opened file, so the metadata matches the content read by descriptor.
+    struct stat st {};
+    if (::fstat(file->getFd(), &st) != 0 || !S_ISREG(st.st_mode)) {
+        auto errMsg = fmt::format("[OpenFile] {} is not a regular file, error {}", path, errno);
+        throw ResponseError(errMsg, ResponseErrorType::FileNotFound);
+    }
+    auto size = static_cast<size_t>(st.st_size);
+    auto etag = fmt::format("\"{:x}-{:x}-{:x}\"", st.st_ino, size, getStatMtimeNs(st));
+    LOG_DEBUG("{}: open {}, size {}, etag {}", __FUNCTION__, path, size, etag);
+    return std::make_shared<const OpenFile>(std::move(file), size, getStatMtimeNs(st), st.st_ino, type, std::move(etag));
+}
+
+OpenFile::OpenFile(std::shared_ptr<const net::FileDesc> file, size_t size, int64_t mtimeNs, uint64_t inode
+        , ContentType type, std::string etag) noexcept
+    : mpFile(std::move(file))
+    , mSize(size)
+    , mMtimeNs(mtimeNs)
+    , mInode(inode)
+    , mContentType(type)
+    , mETag(std::move(etag))
+    , mOpenNs(nowSteadyNs())
+    , mAccessNs(mOpenNs)
+    , mCheckedNs(mOpenNs) {
+}
+
+OpenFileCache::OpenFileCache(OpenFileCacheOptions options)
+    : mOptions(options)
+    , mIndex(options.mMaxFiles, getCost, getAccessNs)
+    , mHits(0)
+    , mMisses(0)
+    , mReloads(0)
+    , mEvictions(0) {
+}
+
+OpenFilePtr OpenFileCache::getFile(const std::filesystem::path& path) {
+    const auto& key = path.native();
+    if (mOptions.mMaxFiles == 0) {
+        mMisses.fetch_add(1, std::memory_order_relaxed);
+        return OpenFile::open(key);
+    }
+    auto now = nowSteadyNs();
+    if (auto file = mIndex.find(key); file != nullptr) {
+        if (validate(key, *file, now)) {
+            file->mAccessNs.store(now, std::memory_order_relaxed);
+            mHits.fetch_add(1, std::memory_order_relaxed);
+            return file;
+        }
+        mReloads.fetch_add(1, std::memory_order_relaxed);
+    } else {
+        mMisses.fetch_add(1, std::memory_order_relaxed);
+    }
+    OpenFilePtr file;
+    try {
+        file = OpenFile::open(key);
+    } catch (const ResponseError&) {
+        mIndex.erase(key);
+        throw;
+    }
+    if (auto evicted = mIndex.publish(key, file); evicted != 0) {
+        LOG_DEBUG("{}: evict {} files for {}", __FUNCTION__, evicted, key);
+        mEvictions.fetch_add(evicted, std::memory_order_relaxed);
+    }
+    return file;
+}
+
+void OpenFileCache::clear() {
+    mIndex.clear();
+}
+
+OpenFileCacheStats OpenFileCache::getStats() const noexcept {
+    OpenFileCacheStats stats;
+    stats.mHits = mHits.load(std::memory_order_relaxed);
+    stats.mMisses = mMisses.load(std::memory_order_relaxed);
+    stats.mReloads = mReloads.load(std::memory_order_relaxed);
+    stats.mEvictions = mEvictions.load(std::memory_order_relaxed);
+    stats.mFiles = mIndex.size();
+    return stats;
+}
+
+bool OpenFileCache::validate(const std::string& path, const OpenFile& file, int64_t nowNs) const {
+    if (nowNs - file.mOpenNs >= duration_cast<nanoseconds>(mOptions.mTtl).count()) {
+        return false;
+    }
+    return validateFileStat(path, file.mInode, file.mSize, file.mMtimeNs, file.mCheckedNs, nowNs
+            , mOptions.mStatInterval);
+}
+
+} // namespace simpletcp::http
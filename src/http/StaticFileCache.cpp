@@ -0,0 +1,196 @@
+#include "http/StaticFileCache.h"
+#include "base/Compress.h"
+#include "base/Log.h"
+#include "http/HttpError.h"
+#include "http/OpenFileCache.h"
+#include <stdexcept>
+#include <utility>
+
+extern "C" {
+#include <unistd.h>
+}
+
+static constexpr std::string_view TAG = "StaticFileCache";
+
+using namespace std::chrono;
+
+namespace simpletcp::http {
+
+// Append the suffix of encoding to etag, inside the quotes.
+static std::string makeVariantETag(std::string_view etag, EncodingType encoding) {
+    auto isQuoted = etag.ends_with('"');
+    std::string result;
+    result.append(etag.substr(0, etag.size() - (isQuoted ? 1 : 0))).append("-").append(to_cstr(encoding));
+    if (isQuoted) {
+        result.push_back('"');
+    }
+    return result;
+}
+
+StaticFile::StaticFile(tcp::SharedBuffer content, ContentType type, std::string etag, int64_t mtimeNs
+        , uint64_t inode) noexcept
+    : mContent(std::move(content))
+    , mContentType(type)
+    , mETag(std::move(etag))
+    , mMtimeNs(mtimeNs)
+    , mInode(inode)
+    , mGzip { .mETag = makeVariantETag(mETag, EncodingType::GZIP), .mOnce = {}, .mContent = {} }
+    , mDeflate { .mETag = makeVariantETag(mETag, EncodingType::DEFLATE), .mOnce = {}, .mContent = {} }
+    , mVariantBytes(0)
+    , mAccessNs(nowSteadyNs())
+    , mCheckedNs(mAccessNs.load()) {
+}
+
+bool StaticFile::isCompressible() const noexcept {
+    switch (mContentType) {
+        case ContentType::PLAIN:
+        case ContentType::HTML:
+        case ContentType::CSS:
+        case ContentType::JAVASCRIPT:
+        case ContentType::XML:
+        case ContentType::JSON:
+            return true;
+        default:
+            return false;
+    }
+}
+
+std::string_view StaticFile::getETag(EncodingType encoding) const noexcept {
+    switch (encoding) {
+        case EncodingType::GZIP: return mGzip.mETag;
+        case EncodingType::DEFLATE: return mDeflate.mETag;
+        default: return mETag;
+    }
+}
+
+tcp::SharedBuffer StaticFile::getContent(EncodingType encoding) const {
+    if (encoding != EncodingType::GZIP && encoding != EncodingType::DEFLATE) {
+        return mContent;
+    }
+    auto& variant = encoding == EncodingType::GZIP ? mGzip : mDeflate;
+    // The first request compresses the content, the concurrent ones in other loops wait for it.
+    std::call_once(variant.mOnce, [this, encoding, &variant] {
+        try {
+            auto compressed = encoding == EncodingType::GZIP
+                ? utils::compress_gzip(mContent.stringView()) : utils::compress_deflate(mContent.stringView());
+            // Tiny files may grow after compression, send the identity content for them.
+            if (!compressed.empty() && compressed.size() < mContent.size()) {
+                mVariantBytes.fetch_add(compressed.size(), std::memory_order_relaxed);
+                variant.mContent = tcp::SharedBuffer::fromString(std::move(compressed));
+            }
+        } catch (const std::runtime_error& e) {
+            LOG_WARN("{}: compress {} failed, {}", __FUNCTION__, to_cstr(encoding), e.what());
+        }
+    });
+    return variant.mContent;
+}
+
+StaticFileCache::StaticFileCache(StaticFileCacheOptions options)
+    : mOptions(options)
+    , mIndex(options.mCapacity, getCost, getAccessNs)
+    , mHits(0)
+    , mMisses(0)
+    , mReloads(0)
+    , mEvictions(0) {
+}
+
+StaticFilePtr StaticFileCache::getFile(const std::filesystem::path& path) {
+    const auto& key = path.native();
+    auto now = nowSteadyNs();
+    if (auto file = mIndex.find(key); file != nullptr) {
+        if (validateFileStat(key, file->mInode, file->getSize(), file->mMtimeNs, file->mCheckedNs, now
+                    , mOptions.mStatInterval)) {
+            file->mAccessNs.store(now, std::memory_order_relaxed);
+            mHits.fetch_add(1, std::memory_order_relaxed);
+            return file;
+        }
+        LOG_INFO("{}: {} is changed, reload it", __FUNCTION__, key);
+        mReloads.fetch_add(1, std::memory_order_relaxed);
+    } else {
+        mMisses.fetch_add(1, std::memory_order_relaxed);
+    }
+    OpenFilePtr opened;
+    try {
+        opened = OpenFile::open(key);
+    } catch (const ResponseError&) {
+        mIndex.erase(key);
+        throw;
+    }
+    if (!isCacheable(opened->getSize())) {
+        LOG_INFO("{}: {} is too large({}) to cache", __FUNCTION__, key, opened->getSize());
+        mIndex.erase(key);
+        return nullptr;
+    }
+    auto file = load(key, *opened);
+    publish(key, file);
+    return file;
+}
+
+StaticFilePtr StaticFileCache::getFile(const std::filesystem::path& path, const OpenFile& file) {
+    if (!isCacheable(file.getSize())) {
+        return nullptr;
+    }
+    const auto& key = path.native();
+    if (auto cached = mIndex.find(key); cached != nullptr) {
+        if (cached->mInode == file.getInode() && cached->getSize() == file.getSize()
+                && cached->mMtimeNs == file.getMtimeNs()) {
+            cached->mAccessNs.store(nowSteadyNs(), std::memory_order_relaxed);
+            mHits.fetch_add(1, std::memory_order_relaxed);
+            return cached;
+        }
+        LOG_INFO("{}: {} is changed, reload it", __FUNCTION__, key);
+        mReloads.fetch_add(1, std::memory_order_relaxed);
+    } else {
+        mMisses.fetch_add(1, std::memory_order_relaxed);
+    }
+    auto loaded = load(key, file);
+    publish(key, loaded);
+    return loaded;
+}
+
+void StaticFileCache::clear() {
+    mIndex.clear();
+}
+
+StaticFileCacheStats StaticFileCache::getStats() const noexcept {
+    StaticFileCacheStats stats;
+    stats.mHits = mHits.load(std::memory_order_relaxed);
+    stats.mMisses = mMisses.load(std::memory_order_relaxed);
+    stats.mReloads = mReloads.load(std::memory_order_relaxed);
+    stats.mEvictions = mEvictions.load(std::memory_order_relaxed);
+    stats.mFiles = mIndex.size();
+    stats.mBytes = mIndex.getCost();
+    return stats;
+}
+
+StaticFilePtr StaticFileCache::load(const std::string& path, const OpenFile& file) {
+    TRACE();
+    std::string content;
+    content.resize(file.getSize());
+    size_t offset = 0;
+    while (offset != content.size()) {
+        auto res = ::pread(file.getFile()->getFd(), content.data() + offset, content.size() - offset
+                , static_cast<off_t>(offset));
+        if (res < 0 && errno == EINTR) {
+            continue;
+        }
+        if (res <= 0) {
+            // The file is truncated after fstat, it's reloaded when stat is changed.
+            content.resize(offset);
+            break;
+        }
+        offset += static_cast<size_t>(res);
+    }
+    LOG_INFO("{}: load {}, size {}, etag {}", __FUNCTION__, path, content.size(), file.getETag());
+    return std::make_shared<const StaticFile>(tcp::SharedBuffer::fromString(std::move(content))
+            , file.getContentType(), std::string { file.getETag() }, file.getMtimeNs(), file.getInode());
+}
+
+void StaticFileCache::publish(const std::string& path, StaticFilePtr file) {
+    if (auto evicted = mIndex.publish(path, std::move(file)); evicted != 0) {
+        LOG_INFO("{}: evict {} files for {}", __FUNCTION__, evicted, path);
+        mEvictions.fetch_add(evicted, std::memory_order_relaxed);
+    }
+}
+
+} // namespace simpletcp::http
@@ -54,10 +54,13 @@ Channel::Channel(int fd, EventLoop* loop, ChannelPriority priority)
     mEvent = EPOLLERR;
 
     // set default callback
-    mReadCb = [] {};
-    mWriteCb = [] {};
-    mCloseCb = [] { LOG_INFO("close callback."); };
-    mErrorCb = [] { LOG_INFO("error callback"); };
+    mEventCb = [] (ChannelEvent event) {
+        if (event == ChannelEvent::Close) {
+            LOG_INFO("close callback.");
+        } else if (event == ChannelEvent::Error) {
+            LOG_INFO("error callback");
+        }
+    };
 
     mpEventLoop->addChannel(this);
 }
@@ -74,18 +77,18 @@ Channel::~Channel() {
 void Channel::handleEvent() {
     LOG_INFO("{} +", __FUNCTION__);
     if ((mRevent & EPOLLHUP) && !(mRevent & EPOLLIN)) {
-        mCloseCb();
+        mEventCb(ChannelEvent::Close);
         return ;
     }
     if (mRevent & EPOLLERR) {
-        mErrorCb();
+        mEventCb(ChannelEvent::Error);
         return ;
     }
     if (mRevent & (EPOLLIN | EPOLLPRI | EPOLLRDHUP)) {
-        mReadCb();
+        mEventCb(ChannelEvent::Read);
     }
     if (mRevent & EPOLLOUT) {
-        mWriteCb();
+        mEventCb(ChannelEvent::Write);
     }
     LOG_INFO("{} -", __FUNCTION__);
 }
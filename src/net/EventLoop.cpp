@@ -53,8 +53,10 @@ EventLoop::EventLoop() {
         mpWakeupFd = EventFd::createEventFd();
         mpWakeupChannel = Channel::createChannel(mpWakeupFd->getFd(), this);
         mpWakeupChannel->setChannelInfo("Wakeup channel");
-        mpWakeupChannel->setReadCallback([&] {
-            mpWakeupFd->handleRead();
+        mpWakeupChannel->setEventCallback([&] (ChannelEvent event) {
+            if (event == ChannelEvent::Read) {
+                mpWakeupFd->handleRead();
+            }
         });
         mpWakeupChannel->enableRead();
     } catch (SystemException& e) {
@@ -197,7 +199,7 @@ void EventLoop::removeTimer(TimerId timerId) {
 }
 
 bool EventLoop::isInLoopThread() const noexcept {
-    return (tCurrentLoop != nullptr);
+    return (tCurrentLoop == this);
 }
 
 int EventLoop::getLoopTid() const noexcept {
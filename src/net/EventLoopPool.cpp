@@ -29,25 +29,24 @@ EventLoopPool::EventLoopPool(EventLoop* mainLoop, int maxThreadNum): mpMainLoop(
 
     for (int i = 0; i < mMaxThreadNum; ++i) {
         mSubThreads.emplace_back([this] {
-
             EventLoop loop {};
             LOG_INFO("EventLoopPool: create new loop {} in thread {}"
                     , static_cast<void *>(&loop), loop.getLoopTid());
             {
-                std::unique_lock lock { mMutex };
+                std::lock_guard lock { mMutex };
                 mSubLoops.push_back(&loop);
-                mSubLoopStates.insert({ &loop, State::Initialized });
-                while (mSubLoopStates[&loop] != State::Running) {
-                    mCond.wait(lock);
-                }
             }
+            mCond.notify_all();
             LOG_INFO("EventLoopPool: start loop {}", static_cast<void *>(&loop));
             loop.startLoop();
-            std::lock_guard lock { mMutex };
-            if (mSubLoopStates[&loop] == State::Exit) {
-                LOG_INFO("EventLoopPool: quit loop {}", static_cast<void *>(&loop));
-                return ;
-            }
+            LOG_INFO("EventLoopPool: quit loop {}", static_cast<void *>(&loop));
+        });
+    }
+    // Wait for all sub loops are registered, so acquireLoop and getLoops need no lock later.
+    {
+        std::unique_lock lock { mMutex };
+        mCond.wait(lock, [this] {
+            return mSubLoops.size() == static_cast<size_t>(mMaxThreadNum);
         });
     }
     mIndex = 0;
@@ -56,12 +55,12 @@ EventLoopPool::EventLoopPool(EventLoop* mainLoop, int maxThreadNum): mpMainLoop(
 
 EventLoopPool::~EventLoopPool() {
     LOG_INFO("{}: E", __FUNCTION__);
-    std::lock_guard lock { mMutex };
     for (auto loop : mSubLoops) {
-        mSubLoopStates[loop] = State::Exit;
-        loop->quitLoop();
+        // Quit in loop thread, so the request would not be lost even if the loop is not polling yet.
+        loop->queueInLoop([loop] {
+            loop->quitLoop();
+        });
     }
-    mCond.notify_all();
     for (auto&& thread : mSubThreads) {
         if (thread.joinable())
             thread.join();
@@ -69,22 +68,14 @@ EventLoopPool::~EventLoopPool() {
     LOG_INFO("{}: X", __FUNCTION__);
 }
 
-EventLoop* EventLoopPool::acquireLoop() {
-    if (mMaxThreadNum == 0) {
+EventLoop* EventLoopPool::acquireLoop() noexcept {
+    if (mSubLoops.empty()) {
         LOG_INFO("{}: return main loop", __FUNCTION__);
         return mpMainLoop;
     }
-
-    std::lock_guard lock { mMutex };
-    auto loop = mSubLoops[ mIndex % mSubLoops.size() ];
-    LOG_INFO("{}: return sub loop {} in index {}", __FUNCTION__, static_cast<void *>(loop), mIndex % mSubLoops.size());
-    ++mIndex;
-    // First time enter loop.
-    if (mSubLoopStates[loop] == State::Initialized) {
-        mSubLoopStates[loop] = State::Running;
-        mCond.notify_all();
-    }
-    return loop;
+    auto index = mIndex++ % mSubLoops.size();
+    LOG_INFO("{}: return sub loop {} in index {}", __FUNCTION__, static_cast<void *>(mSubLoops[index]), index);
+    return mSubLoops[index];
 }
 
 } // namespace simpletcp::net
@@ -19,8 +19,8 @@ namespace simpletcp::net {
 constexpr auto DEFAULT_FILE_MODE = S_IRWXU | S_IRWXG | S_IRWXO;
 
 FileDesc::FileDesc(std::string_view path, int flag, uint32_t mode = DEFAULT_FILE_MODE) {
-    flag |= O_CREAT;
-    if (flag | O_CREAT) {
+    // The mode is only used when the file is created.
+    if ((flag & O_CREAT) != 0) {
         mFd = ::open(path.data(), flag, mode);
         if (mFd < 0) {
             std::string msg = "Can't open file: ";
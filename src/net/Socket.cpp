@@ -4,15 +4,19 @@
 #include "net/Socket.h"
 #include <algorithm>
 #include <cerrno>
+#include <cstddef>
 #include <cstdint>
+#include <cstring>
 #include <memory>
+#include <optional>
 #include <string>
 #include <string_view>
-#include <variant>
 
 extern "C" {
 #include <sys/socket.h>
+#include <sys/stat.h>
 #include <sys/types.h>
+#include <sys/un.h>
 #include <arpa/inet.h>
 #include <fcntl.h>
 #include <netdb.h>
@@ -27,16 +31,48 @@ static constexpr std::string_view TAG = "Socket";
 
 namespace simpletcp::net {
 
+// Remove the socket file if no server listens on it. Other files and the file of a live server, e.g.
+// another process, are never removed.
+static void removeStaleSocketFile(const std::string& path) {
+    struct stat st {};
+    if (::lstat(path.c_str(), &st) != 0 || !S_ISSOCK(st.st_mode)) {
+        return ;
+    }
+    auto addr = RawSockAddr::fromSocketAddr({ path, IP_PROTOCOL::Unix, 0 });
+    if (!addr) {
+        return ;
+    }
+    int fd = ::socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC | SOCK_NONBLOCK, 0);
+    if (fd < 0) {
+        return ;
+    }
+    // Only a file without listener refuses connect, a full backlog of live server fails with EAGAIN.
+    auto isStale = ::connect(fd, addr->get(), addr->getLength()) != 0 && errno == ECONNREFUSED;
+    ::close(fd);
+    if (isStale) {
+        LOG_INFO("{}: remove {}", __FUNCTION__, path);
+        ::unlink(path.c_str());
+    }
+}
+
 Socket::~Socket() {
     LOG_INFO("{} ", __FUNCTION__);
     ::close(getFd());
+    if (mIsListenSocket && mIsUnixSocket && !mLocalAddr.getUnixPath().empty()) {
+        // The socket is closed, so the file is kept only if another server listens on it.
+        removeStaleSocketFile(std::string { mLocalAddr.getUnixPath() });
+    }
 }
 
 inline static int createTcpNonblockingSocket(IP_PROTOCOL protocol) {
-    int socketFd = ::socket(
-            protocol == IP_PROTOCOL::IPv4 ? AF_INET : AF_INET6
-            , SOCK_STREAM | SOCK_CLOEXEC | SOCK_NONBLOCK
-            , IPPROTO_TCP);
+    int family = AF_INET;
+    if (protocol == IP_PROTOCOL::IPv6) {
+        family = AF_INET6;
+    } else if (protocol == IP_PROTOCOL::Unix) {
+        family = AF_UNIX;
+    }
+    int socketFd = ::socket(family, SOCK_STREAM | SOCK_CLOEXEC | SOCK_NONBLOCK
+            , protocol == IP_PROTOCOL::Unix ? 0 : IPPROTO_TCP);
     if (socketFd < 0) {
         throw SystemException("failed to create socket.");
     }
@@ -44,34 +80,110 @@ inline static int createTcpNonblockingSocket(IP_PROTOCOL protocol) {
     return socketFd;
 }
 
-inline static std::string transAddrToString(const sockaddr_in& addr) {
-    std::string result;
-    // addr.sin_addr is a 32 bytes struct.
-    auto start = reinterpret_cast<const uint8_t *>(&addr.sin_addr.s_addr);
-    constexpr auto maxLen = sizeof(addr.sin_addr);
-    for (int i = 0; i != maxLen; ++i) {
-        result.append(std::to_string(start[i]));
-        if (i != maxLen - 1) {
-            result.push_back('.');
+std::optional<RawSockAddr> RawSockAddr::fromSocketAddr(const SocketAddr& addr) noexcept {
+    RawSockAddr result;
+    // Empty IP means any address, which is all zero.
+    if (addr.mIpProtocol == IP_PROTOCOL::IPv4) {
+        auto& addr4 = *reinterpret_cast<sockaddr_in *>(result.get());
+        addr4.sin_family = AF_INET;
+        addr4.sin_port = ::htons(addr.mPort);
+        // inet_pton return 1 indicate success.
+        if (!addr.mIpAddr.empty() && ::inet_pton(AF_INET, addr.mIpAddr.c_str(), &addr4.sin_addr) != 1) {
+            return std::nullopt;
+        }
+        result.setLength(sizeof(sockaddr_in));
+    } else if (addr.mIpProtocol == IP_PROTOCOL::Unix) {
+        auto& addrUnix = *reinterpret_cast<sockaddr_un *>(result.get());
+        addrUnix.sun_family = AF_UNIX;
+        // The path is null-terminated, the abstract name is not.
+        if (addr.mIpAddr.empty() || addr.mIpAddr.size() >= sizeof(addrUnix.sun_path)) {
+            return std::nullopt;
         }
+        auto isAbstract = addr.mIpAddr.front() == '@';
+        auto name = std::string_view { addr.mIpAddr }.substr(isAbstract ? 1 : 0);
+        std::copy(name.begin(), name.end(), addrUnix.sun_path + (isAbstract ? 1 : 0));
+        result.setLength(static_cast<socklen_t>(offsetof(sockaddr_un, sun_path) + 1 + name.size()));
+    } else {
+        auto& addr6 = *reinterpret_cast<sockaddr_in6 *>(result.get());
+        addr6.sin6_family = AF_INET6;
+        addr6.sin6_port = ::htons(addr.mPort);
+        if (!addr.mIpAddr.empty() && ::inet_pton(AF_INET6, addr.mIpAddr.c_str(), &addr6.sin6_addr) != 1) {
+            return std::nullopt;
+        }
+        result.setLength(sizeof(sockaddr_in6));
     }
     return result;
 }
 
-inline static std::string transAddrToString(const sockaddr_in6& addr) {
-    std::string result;
-    auto start = addr.sin6_addr.s6_addr;
-    constexpr auto maxLen = sizeof(addr.sin6_addr);
-    for (int i = 0; i != maxLen; ++i) {
-        result.push_back(static_cast<char>(start[i]));
-        if (((i + 1) % 4) == 0) {
-            result.append("::");
+void RawSockAddr::setLength(socklen_t length) noexcept {
+    mLength = length;
+    // The storage may be rewritten, drop the text of old address.
+    mpIpText.reset();
+}
+
+bool RawSockAddr::isAnyAddr() const noexcept {
+    if (getFamily() == AF_UNIX) {
+        return false;
+    }
+    if (getFamily() == AF_INET6) {
+        return IN6_IS_ADDR_UNSPECIFIED(&reinterpret_cast<const sockaddr_in6 *>(get())->sin6_addr);
+    }
+    return reinterpret_cast<const sockaddr_in *>(get())->sin_addr.s_addr == INADDR_ANY;
+}
+
+uint16_t RawSockAddr::getPort() const noexcept {
+    if (getFamily() == AF_UNIX) {
+        return 0;
+    }
+    if (getFamily() == AF_INET6) {
+        return ::ntohs(reinterpret_cast<const sockaddr_in6 *>(get())->sin6_port);
+    }
+    return ::ntohs(reinterpret_cast<const sockaddr_in *>(get())->sin_port);
+}
+
+std::string_view RawSockAddr::getUnixPath() const noexcept {
+    if (getFamily() != AF_UNIX || mLength <= offsetof(sockaddr_un, sun_path)) {
+        return {};
+    }
+    auto path = reinterpret_cast<const sockaddr_un *>(get())->sun_path;
+    // Abstract name starts with '\0'.
+    return { path, ::strnlen(path, mLength - offsetof(sockaddr_un, sun_path)) };
+}
+
+std::string_view RawSockAddr::getIp() const {
+    if (isUnset()) {
+        return {};
+    }
+    if (!mpIpText && getFamily() == AF_UNIX) {
+        auto path = reinterpret_cast<const sockaddr_un *>(get())->sun_path;
+        auto pathLen = mLength > offsetof(sockaddr_un, sun_path) ? mLength - offsetof(sockaddr_un, sun_path) : 0;
+        if (pathLen != 0 && path[0] == '\0') {
+            std::string name(1, '@');
+            name.append(path + 1, pathLen - 1);
+            mpIpText = std::make_shared<const std::string>(std::move(name));
+        } else {
+            mpIpText = std::make_shared<const std::string>(getUnixPath());
         }
     }
-    return result;
+    if (!mpIpText) {
+        char buf[INET6_ADDRSTRLEN] {};
+        auto res = getFamily() == AF_INET6
+            ? ::inet_ntop(AF_INET6, &reinterpret_cast<const sockaddr_in6 *>(get())->sin6_addr, buf, sizeof(buf))
+            : ::inet_ntop(AF_INET, &reinterpret_cast<const sockaddr_in *>(get())->sin_addr, buf, sizeof(buf));
+        mpIpText = std::make_shared<const std::string>(res != nullptr ? buf : "");
+    }
+    return *mpIpText;
+}
+
+SocketAddr RawSockAddr::toSocketAddr() const {
+    return SocketAddr {
+        .mIpAddr = std::string { getIp() },
+        .mIpProtocol = getIpProtocol(),
+        .mPort = getPort()
+    };
 }
 
-SocketPtr Socket::createTcpClientSocket(SocketAddr&& serverSocketAddr) {
+SocketPtr Socket::createTcpClientSocket(SocketAddr&& serverSocketAddr, const SocketOptions& options) {
     std::unique_ptr<Socket> result;
 
     constexpr auto failedResult = [] (int err) {
@@ -79,68 +191,97 @@ SocketPtr Socket::createTcpClientSocket(SocketAddr&& serverSocketAddr) {
             err != EINPROGRESS && err != EINTR && err != EISCONN;
     };
 
-    if (serverSocketAddr.mIpProtocol == IP_PROTOCOL::IPv4) {
-        LOG_DEBUG("{}: IPv4", __FUNCTION__);
-        sockaddr_in serverAddr = {};
-        serverAddr.sin_family = AF_INET;
-        serverAddr.sin_port = htons(serverSocketAddr.mPort);
-        // inet_pton return 1 indicate success.
-        if (auto res = ::inet_pton(AF_INET, serverSocketAddr.mIpAddr.data(), &serverAddr.sin_addr); res != 1) {
-            LOG_ERR("{}: error IP addr {}, error {}", __FUNCTION__, serverSocketAddr.mIpAddr.data(), errno);
-            return result;
-        }
-        auto socketFd = createTcpNonblockingSocket(IP_PROTOCOL::IPv4);
-        if (auto res = ::connect(socketFd, reinterpret_cast<sockaddr *>(&serverAddr), sizeof(serverAddr))
-                ; res < 0 && failedResult(errno)) {
-            LOG_ERR("{}: connect failed, addr:{} port:{}", __FUNCTION__
-                    , serverSocketAddr.mIpAddr.data(), serverSocketAddr.mPort);
-            return result;
-        } else if (res != 0) {
-            LOG_INFO("{}: socket state ({}), ({})", __FUNCTION__, errno, strerror(errno));
-        }
-        result.reset(new Socket(socketFd));
-    } else {
-        LOG_DEBUG("{}: IPv6", __FUNCTION__);
-        sockaddr_in6 serverAddr = {};
-        serverAddr.sin6_family = AF_INET6;
-        serverAddr.sin6_port = htons(serverSocketAddr.mPort);
-        if (auto res = ::inet_pton(AF_INET6, serverSocketAddr.mIpAddr.data(), &serverAddr.sin6_addr); res != 1) {
-            LOG_ERR("{}: connect failed, addr:{} port:{}", __FUNCTION__
-                    , serverSocketAddr.mIpAddr.data(), serverSocketAddr.mPort);
-            return result;
-        }
-        auto socketFd = createTcpNonblockingSocket(IP_PROTOCOL::IPv6);
-        if (auto res = ::connect(socketFd, reinterpret_cast<sockaddr *>(&serverAddr), sizeof(serverAddr))
-                ; res < 0 && failedResult(errno)) {
-            LOG_ERR("{}: failed to connect {}", __FUNCTION__, serverSocketAddr.mIpAddr.data());
-            return result;
-        }
-        result.reset(new Socket(socketFd));
+    auto serverAddr = RawSockAddr::fromSocketAddr(serverSocketAddr);
+    if (!serverAddr || serverSocketAddr.mIpAddr.empty()) {
+        LOG_ERR("{}: error IP addr {}", __FUNCTION__, serverSocketAddr.mIpAddr);
+        return result;
+    }
+    auto socketFd = createTcpNonblockingSocket(serverSocketAddr.mIpProtocol);
+    result.reset(new Socket(socketFd));
+    result->mIsUnixSocket = serverSocketAddr.mIpProtocol == IP_PROTOCOL::Unix;
+    // Buffer size must be set before connect, so that the window scale is negotiated with it.
+    result->applyOptions(options);
+    if (auto res = ::connect(socketFd, serverAddr->get(), serverAddr->getLength()); res < 0 && failedResult(errno)) {
+        LOG_ERR("{}: connect failed, addr:{} port:{}", __FUNCTION__
+                , serverSocketAddr.mIpAddr.data(), serverSocketAddr.mPort);
+        // Socket would be closed by dtor.
+        result.reset();
+        return result;
+    } else if (res != 0) {
+        LOG_INFO("{}: socket state ({}), ({})", __FUNCTION__, errno, strerror(errno));
     }
-    result->setLocalAddr(serverSocketAddr.mIpProtocol);
-    result->setPeerAddr(std::move(serverSocketAddr));
+    // Local address is resolved when it's used.
+    result->setPeerAddr(*serverAddr);
     result->mIsTCPSocket = true;
     result->mIsUDPSocket = false;
     return result;
 }
 
 SocketPtr Socket::createTcpListenSocket(SocketAddr&& serverSocketAddr, int maxListenQueue) {
-    std::unique_ptr<Socket> result;
-    if (serverSocketAddr.mIpProtocol == IP_PROTOCOL::IPv4) {
-        LOG_DEBUG("{}: IPv4", __FUNCTION__);
-        auto socketFd = createTcpNonblockingSocket(IP_PROTOCOL::IPv4);
-        result.reset(new Socket(socketFd));
-    } else {
-        LOG_DEBUG("{}: IPv6", __FUNCTION__);
-        auto socketFd = createTcpNonblockingSocket(IP_PROTOCOL::IPv6);
-        result.reset(new Socket(socketFd));
+    auto bindAddr = RawSockAddr::fromSocketAddr(serverSocketAddr);
+    if (!bindAddr) {
+        throw NetworkException("[Socket] invalid listen address " + serverSocketAddr.mIpAddr, EINVAL);
     }
+    auto socketFd = createTcpNonblockingSocket(serverSocketAddr.mIpProtocol);
+    std::unique_ptr<Socket> result { new Socket(socketFd) };
+    // Socket is bound to this address in listen.
+    result->mLocalAddr = *bindAddr;
+    result->mIsUnixSocket = serverSocketAddr.mIpProtocol == IP_PROTOCOL::Unix;
     result->mIsListenSocket = true;
     result->mMaxListenQueue = maxListenQueue;
     result->mIsTCPSocket = true;
     result->mIsUDPSocket = false;
-    result->mLocalAddr.mPort = serverSocketAddr.mPort;
-    result->mLocalAddr.mIpProtocol = serverSocketAddr.mIpProtocol;
+    return result;
+}
+
+inline static int createUdpNonblockingSocket(IP_PROTOCOL protocol) {
+    if (protocol == IP_PROTOCOL::Unix) {
+        throw NetworkException("[Socket] unix domain datagram socket is not supported.", EAFNOSUPPORT);
+    }
+    int socketFd = ::socket(protocol == IP_PROTOCOL::IPv6 ? AF_INET6 : AF_INET
+            , SOCK_DGRAM | SOCK_CLOEXEC | SOCK_NONBLOCK, IPPROTO_UDP);
+    if (socketFd < 0) {
+        throw SystemException("failed to create socket.");
+    }
+    LOG_INFO("{}: success create new fd {}", __FUNCTION__, socketFd);
+    return socketFd;
+}
+
+SocketPtr Socket::createUdpSocket(SocketAddr&& localSocketAddr, bool reusePort) {
+    auto bindAddr = RawSockAddr::fromSocketAddr(localSocketAddr);
+    if (!bindAddr) {
+        throw NetworkException("[Socket] invalid udp address " + localSocketAddr.mIpAddr, EINVAL);
+    }
+    auto socketFd = createUdpNonblockingSocket(localSocketAddr.mIpProtocol);
+    std::unique_ptr<Socket> result { new Socket(socketFd) };
+    result->mIsTCPSocket = false;
+    result->mIsUDPSocket = true;
+    if (reusePort) {
+        result->setReuseAddr(true);
+        result->setReusePort(true);
+    }
+    if (auto res = ::bind(socketFd, bindAddr->get(), bindAddr->getLength()); res != 0) {
+        throw NetworkException("[Socket] failed to bind udp address " + localSocketAddr.mIpAddr, errno);
+    }
+    // Resolve the port if it's chosen by kernel.
+    result->setLocalAddr();
+    return result;
+}
+
+SocketPtr Socket::createUdpClientSocket(SocketAddr&& serverSocketAddr) {
+    auto serverAddr = RawSockAddr::fromSocketAddr(serverSocketAddr);
+    if (!serverAddr || serverSocketAddr.mIpAddr.empty()) {
+        throw NetworkException("[Socket] invalid udp address " + serverSocketAddr.mIpAddr, EINVAL);
+    }
+    auto socketFd = createUdpNonblockingSocket(serverSocketAddr.mIpProtocol);
+    std::unique_ptr<Socket> result { new Socket(socketFd) };
+    result->mIsTCPSocket = false;
+    result->mIsUDPSocket = true;
+    // Connect of datagram socket only records the peer, it never blocks.
+    if (auto res = ::connect(socketFd, serverAddr->get(), serverAddr->getLength()); res != 0) {
+        throw NetworkException("[Socket] failed to connect udp address " + serverSocketAddr.mIpAddr, errno);
+    }
+    result->setPeerAddr(*serverAddr);
     return result;
 }
 
@@ -148,33 +289,20 @@ void Socket::listen() {
     LOG_INFO("{}: start", __FUNCTION__);
     assertTrue(mIsListenSocket, "[Socket] listen just can be invoked by listen socket!");
     assertTrue(mIsTCPSocket, "[Socket] listen just can be invoked in tcp socket!");
-    if (mLocalAddr.mIpProtocol == IP_PROTOCOL::IPv4) {
-        LOG_DEBUG("{}: IPv4", __FUNCTION__);
-        sockaddr_in serverAddr = {};
-        serverAddr.sin_family = AF_INET;
-        serverAddr.sin_addr.s_addr = INADDR_ANY;
-        serverAddr.sin_port = ::htons(mLocalAddr.mPort);
-        if (auto res = ::bind(getFd(), reinterpret_cast<sockaddr *>(&serverAddr), sizeof(serverAddr)); res != 0) {
-            LOG_FATAL("{}: bind error because {}.", __FUNCTION__, strerror(errno));
-        }
-        if (auto res = ::listen(getFd(), mMaxListenQueue); res != 0) {
-            LOG_FATAL("{}: listen error because {}.", __FUNCTION__, strerror(errno));
-        }
-    } else {
-        LOG_DEBUG("{}: IPv6", __FUNCTION__);
-        sockaddr_in6 serverAddr = {};
-        serverAddr.sin6_family = AF_INET6;
-        serverAddr.sin6_port = ::htons(mLocalAddr.mPort);
-        serverAddr.sin6_addr = IN6ADDR_ANY_INIT;
-        if (auto res = ::bind(getFd(), reinterpret_cast<sockaddr *>(&serverAddr), sizeof(serverAddr)); res != 0) {
-            LOG_FATAL("{}: bind error because {}.", __FUNCTION__, strerror(errno));
-        }
-        if (auto res = ::listen(getFd(), mMaxListenQueue); res != 0) {
-            LOG_FATAL("{}: listen error because {}.", __FUNCTION__, strerror(errno));
-        }
+    if (std::string path { mLocalAddr.getUnixPath() }; !path.empty()) {
+        // Remove the socket file left by last run, otherwise bind fails with EADDRINUSE.
+        removeStaleSocketFile(path);
+    }
+    if (auto res = ::bind(getFd(), mLocalAddr.get(), mLocalAddr.getLength()); res != 0) {
+        LOG_FATAL("{}: bind error because {}.", __FUNCTION__, strerror(errno));
+    }
+    if (auto res = ::listen(getFd(), mMaxListenQueue); res != 0) {
+        LOG_FATAL("{}: listen error because {}.", __FUNCTION__, strerror(errno));
     }
     LOG_INFO("{}: end", __FUNCTION__);
-    setLocalAddr(mLocalAddr.mIpProtocol);
+    // Resolve the port if it's chosen by kernel, and render the text once for all accepted sockets.
+    setLocalAddr();
+    static_cast<void>(mLocalAddr.getIp());
 }
 
 SocketPtr Socket::accept() {
@@ -182,31 +310,25 @@ SocketPtr Socket::accept() {
     // Accept connection.
     assertTrue(mIsListenSocket, "[Socket] accept just can be invoked by listen socket!");
     assertTrue(mIsTCPSocket, "[Socket] accept just can be invoked in tcp socket!");
-    std::variant<sockaddr_in, sockaddr_in6> clientAddr;
-    socklen_t addrLen = (getIpProtocol() == IP_PROTOCOL::IPv4)
-            ? sizeof(sockaddr_in) : sizeof(sockaddr_in6);
-    auto connectedFd = ::accept4(getFd()
-            , reinterpret_cast<sockaddr *>(&clientAddr), &addrLen
-            , SOCK_CLOEXEC | SOCK_NONBLOCK);
+    RawSockAddr clientAddr {};
+    socklen_t addrLen = RawSockAddr::getCapacity();
+    auto connectedFd = ::accept4(getFd(), clientAddr.get(), &addrLen, SOCK_CLOEXEC | SOCK_NONBLOCK);
     if (connectedFd < 0) {
         LOG_ERR("{}: failed to accept, {}", __FUNCTION__, gai_strerror(errno));
         throw NetworkException("[Socket] accept failed.", errno);
     }
 
-    // Translate IP address.
+    // Only keep the binary address, the text form is rendered on demand.
+    clientAddr.setLength(addrLen);
     auto result = std::unique_ptr<Socket>(new Socket(connectedFd));
-    SocketAddr peerAddr {};
-    if (getIpProtocol() == IP_PROTOCOL::IPv4) {
-        peerAddr.mIpAddr = transAddrToString(std::get<sockaddr_in>(clientAddr));
-        peerAddr.mIpProtocol = IP_PROTOCOL::IPv4;
-        peerAddr.mPort = ::ntohs(std::get<sockaddr_in>(clientAddr).sin_port);
-    } else {
-        peerAddr.mIpAddr = transAddrToString(std::get<sockaddr_in6>(clientAddr));
-        peerAddr.mIpProtocol = IP_PROTOCOL::IPv6;
-        peerAddr.mPort = ::ntohs(std::get<sockaddr_in6>(clientAddr).sin6_port);
+    result->setPeerAddr(clientAddr);
+    // The local address equals to the bound address of listen socket, unless it's any address.
+    if (!mLocalAddr.isAnyAddr()) {
+        result->mLocalAddr = mLocalAddr;
     }
-    result->setPeerAddr(std::move(peerAddr));
-    result->setLocalAddr(getIpProtocol());
+    result->mIsTCPSocket = true;
+    result->mIsUDPSocket = false;
+    result->mIsUnixSocket = mIsUnixSocket;
     // Return new connected socket..
     LOG_INFO("{}: end", __FUNCTION__);
     return result;
@@ -222,7 +344,7 @@ void Socket::shutdown() {
 
 void Socket::setNonBlock(bool enable) {
     int flags = 0;
-    if (flags = ::fcntl(getFd(), F_GETFL, 0); flags != 0) {
+    if (flags = ::fcntl(getFd(), F_GETFL, 0); flags < 0) {
         throw SystemException("failed to setNonBlock");
     }
     if (enable) {
@@ -237,7 +359,7 @@ void Socket::setNonBlock(bool enable) {
 
 void Socket::setNonDelay(bool enable) {
     int flag = enable ? 1 : 0;
-    if (auto res = ::setsockopt(getFd(), SOL_SOCKET, TCP_NODELAY, &flag, sizeof(flag)); res != 0) {
+    if (auto res = ::setsockopt(getFd(), IPPROTO_TCP, TCP_NODELAY, &flag, sizeof(flag)); res != 0) {
         throw NetworkException("failed to setNonDelay.", getSocketError());
     }
 }
@@ -249,6 +371,17 @@ void Socket::setKeepAlive(bool enable) {
     }
 }
 
+void Socket::setMaxPacingRate(uint64_t bytesPerSecond) {
+    // Kernel accepts 64-bit rate since 4.20, try 32-bit rate for the older kernel.
+    if (::setsockopt(getFd(), SOL_SOCKET, SO_MAX_PACING_RATE, &bytesPerSecond, sizeof(bytesPerSecond)) == 0) {
+        return ;
+    }
+    auto rate = static_cast<uint32_t>(std::min<uint64_t>(bytesPerSecond, UINT32_MAX));
+    if (auto res = ::setsockopt(getFd(), SOL_SOCKET, SO_MAX_PACING_RATE, &rate, sizeof(rate)); res != 0) {
+        throw NetworkException("failed to setMaxPacingRate", errno);
+    }
+}
+
 void Socket::setReuseAddr(bool enable) {
     int flag = enable ? 1 : 0;
     if (auto res = ::setsockopt(getFd(), SOL_SOCKET, SO_REUSEADDR, &flag, sizeof(flag)); res != 0) {
@@ -263,39 +396,76 @@ void Socket::setReusePort(bool enable) {
     }
 }
 
-
-void Socket::setLocalAddr(IP_PROTOCOL protocol) {
-    if (protocol == IP_PROTOCOL::IPv4) {
-        sockaddr_in addr;
-        socklen_t addrLen = sizeof(addr);
-        auto res = ::getsockname(getFd(), reinterpret_cast<sockaddr *>(&addr), &addrLen);
-        if (res == 0) {
-            SocketAddr localAddr {
-                .mIpAddr = transAddrToString(addr),
-                .mIpProtocol = IP_PROTOCOL::IPv4,
-                .mPort = ::ntohs(addr.sin_port)
-            };
-            mLocalAddr = std::move(localAddr);
-        } else {
-            LOG_ERR("{}: failed to get local addr.", __FUNCTION__);
+void Socket::applyOptions(const SocketOptions& options) noexcept {
+    auto applyOption = [this] (std::string_view name, int level, int optName, int value) {
+        if (level == IPPROTO_TCP && (mIsUnixSocket || mIsUDPSocket)) {
+            // Unix domain socket and datagram socket have no TCP layer.
+            return ;
         }
-    } else {
-        sockaddr_in6 addr;
-        socklen_t addrLen = sizeof(addr);
-        auto res = ::getsockname(getFd(), reinterpret_cast<sockaddr *>(&addr), &addrLen);
-        if (res == 0) {
-            SocketAddr localAddr {
-                .mIpAddr = transAddrToString(addr),
-                .mIpProtocol = IP_PROTOCOL::IPv6,
-                .mPort = ::ntohs(addr.sin6_port)
-            };
-            mLocalAddr = std::move(localAddr);
-        } else {
-            LOG_ERR("{}: failed to get local addr.", __FUNCTION__);
+        if (auto res = ::setsockopt(getFd(), level, optName, &value, sizeof(value)); res != 0) {
+            LOG_WARN("{}: failed to set {} to {}, {}", __FUNCTION__, name, value, strerror(errno));
+        }
+    };
+    if (options.mNoDelay) {
+        applyOption("TCP_NODELAY", IPPROTO_TCP, TCP_NODELAY, *options.mNoDelay ? 1 : 0);
+    }
+    if (options.mSendBufSize) {
+        applyOption("SO_SNDBUF", SOL_SOCKET, SO_SNDBUF, *options.mSendBufSize);
+    }
+    if (options.mRecvBufSize) {
+        applyOption("SO_RCVBUF", SOL_SOCKET, SO_RCVBUF, *options.mRecvBufSize);
+    }
+    if (options.mCork) {
+        applyOption("TCP_CORK", IPPROTO_TCP, TCP_CORK, *options.mCork ? 1 : 0);
+    }
+    if (options.mQuickAck) {
+        applyOption("TCP_QUICKACK", IPPROTO_TCP, TCP_QUICKACK, *options.mQuickAck ? 1 : 0);
+    }
+    if (options.mDeferAccept && mIsListenSocket) {
+        applyOption("TCP_DEFER_ACCEPT", IPPROTO_TCP, TCP_DEFER_ACCEPT, *options.mDeferAccept);
+    }
+    if (options.mNotSentLowat) {
+        applyOption("TCP_NOTSENT_LOWAT", IPPROTO_TCP, TCP_NOTSENT_LOWAT, *options.mNotSentLowat);
+    }
+    if (options.mUserTimeout) {
+        applyOption("TCP_USER_TIMEOUT", IPPROTO_TCP, TCP_USER_TIMEOUT, *options.mUserTimeout);
+    }
+    if (options.mBusyPoll) {
+        applyOption("SO_BUSY_POLL", SOL_SOCKET, SO_BUSY_POLL, *options.mBusyPoll);
+    }
+    if (options.mFastOpen && mIsListenSocket) {
+        applyOption("TCP_FASTOPEN", IPPROTO_TCP, TCP_FASTOPEN, *options.mFastOpen);
+    }
+    // Peer address is unset only for client socket which is not connected.
+    if (options.mFastOpenConnect && !mIsListenSocket && mPeerAddr.isUnset()) {
+        applyOption("TCP_FASTOPEN_CONNECT", IPPROTO_TCP, TCP_FASTOPEN_CONNECT, *options.mFastOpenConnect ? 1 : 0);
+    }
+    if (options.mMaxPacingRate) {
+        try {
+            setMaxPacingRate(*options.mMaxPacingRate);
+        } catch (const NetworkException& e) {
+            LOG_WARN("{}: failed to set SO_MAX_PACING_RATE to {}, {}", __FUNCTION__, *options.mMaxPacingRate
+                    , strerror(e.getNetErr()));
         }
     }
 }
 
+void Socket::setLocalAddr() const {
+    socklen_t addrLen = RawSockAddr::getCapacity();
+    if (auto res = ::getsockname(getFd(), mLocalAddr.get(), &addrLen); res != 0) {
+        LOG_ERR("{}: failed to get local addr.", __FUNCTION__);
+        return ;
+    }
+    mLocalAddr.setLength(addrLen);
+}
+
+const RawSockAddr& Socket::getLocalAddr() const {
+    if (mLocalAddr.isUnset()) {
+        setLocalAddr();
+    }
+    return mLocalAddr;
+}
+
 int Socket::getSocketError() const noexcept {
     int optval;
     socklen_t optlen = sizeof(optval);
@@ -307,11 +477,15 @@ int Socket::getSocketError() const noexcept {
 }
 
 void Socket::dumpSocketInfo() const noexcept {
+    if (mIsUnixSocket) {
+        LOG_DEBUG("{}: unix local addr {}, peer addr {}", __FUNCTION__, getLocalAddr().getIp(), getPeerAddr().getIp());
+        return ;
+    }
     tcp_info tcpInfo {};
     socklen_t len = sizeof(tcpInfo);
-    if (::getsockopt(getFd(), SOL_SOCKET, TCP_INFO, &tcpInfo, &len) == 0) {
-        LOG_DEBUG("{}: local addr {}, port {}", __FUNCTION__, mLocalAddr.mIpAddr, mLocalAddr.mPort);
-        LOG_DEBUG("{}: peer  addr {}, port {}", __FUNCTION__, mPeerAddr.mIpAddr, mPeerAddr.mPort);
+    if (::getsockopt(getFd(), IPPROTO_TCP, TCP_INFO, &tcpInfo, &len) == 0) {
+        LOG_DEBUG("{}: local addr {}, port {}", __FUNCTION__, getLocalAddr().getIp(), getLocalAddr().getPort());
+        LOG_DEBUG("{}: peer  addr {}, port {}", __FUNCTION__, getPeerAddr().getIp(), getPeerAddr().getPort());
         LOG_DEBUG("{}: pmtu={}, state={}", __FUNCTION__, tcpInfo.tcpi_pmtu, tcpInfo.tcpi_state);
         LOG_DEBUG("{}: rtt={}, trrval={}, rto={}", __FUNCTION__
                 , tcpInfo.tcpi_rtt, tcpInfo.tcpi_rttvar, tcpInfo.tcpi_rto);
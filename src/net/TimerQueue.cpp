@@ -41,14 +41,15 @@ TimerId TimerQueue::addOneshotTimer(TimerCallback&& cb, TimerType type, std::chr
             // Create new channel must run in loop thread.
             auto newChannel = net::Channel::createChannel(newTimer->getFd(), mpEventloop, ChannelPriority::High);
             newChannel->setChannelInfo("Oneshot timer");
-            newChannel->setReadCallback([this, newTimer, newId, cb = std::move(cb)] () {
-                cb();
-                newTimer->handleRead();
-                // Task have done, and then remove the timer.
-                removeTimer(newId);
-            });
-            newChannel->setErrorCallback([newTimer] () {
-                newTimer->handleError();
+            newChannel->setEventCallback([this, newTimer, newId, cb = std::move(cb)] (ChannelEvent event) {
+                if (event == ChannelEvent::Read) {
+                    cb();
+                    newTimer->handleRead();
+                    // Task have done, and then remove the timer.
+                    removeTimer(newId);
+                } else if (event == ChannelEvent::Error) {
+                    newTimer->handleError();
+                }
             });
             newChannel->enableRead();
             TimerStruct newTimerStruct {
@@ -77,13 +78,14 @@ TimerId TimerQueue::addRepeatingTimer(TimerCallback&& cb, TimerType type, std::c
             // Create new channel must run in loop thread.
             auto newChannel = net::Channel::createChannel(newTimer->getFd(), mpEventloop, ChannelPriority::High);
             newChannel->setChannelInfo("Repeating timer");
-            newChannel->setReadCallback([newTimer, cb = std::move(cb)] () {
-                newTimer->handleRead();
-                cb();
-                // repeating task, don't remove the timer.
-            });
-            newChannel->setErrorCallback([newTimer] () {
-                newTimer->handleError();
+            newChannel->setEventCallback([newTimer, cb = std::move(cb)] (ChannelEvent event) {
+                if (event == ChannelEvent::Read) {
+                    newTimer->handleRead();
+                    cb();
+                    // repeating task, don't remove the timer.
+                } else if (event == ChannelEvent::Error) {
+                    newTimer->handleError();
+                }
             });
             newChannel->enableRead();
             TimerStruct newTimerStruct {
@@ -0,0 +1,89 @@
+#include "net/UdpServer.h"
+#include "base/Error.h"
+#include "base/Log.h"
+#include <chrono>
+#include <fmt/format.h>
+#include <string_view>
+
+extern "C" {
+#include <unistd.h>
+}
+
+using namespace simpletcp;
+
+static constexpr std::string_view TAG = "UdpServer";
+
+namespace simpletcp::net {
+
+UdpServer::UdpServer(UdpServerArgs args)
+    : mpEventLoop(args.loop), mEventLoopPool(args.loop, args.maxThreadNum), mPort(0) {
+    assertTrue(mpEventLoop != nullptr, "[UdpServer] loop must not be none!");
+    mpEventLoop->assertInLoopThread();
+    LOG_INFO("{}: E", __FUNCTION__);
+    std::vector<EventLoop *> loops = mEventLoopPool.getLoops();
+    if (loops.empty()) {
+        loops.push_back(mpEventLoop);
+    }
+    // Sockets are bound in current thread, so the error of bind is thrown to user. Channels must be created
+    // in their owner loops.
+    auto reusePort = loops.size() > 1;
+    for (auto loop : loops) {
+        auto socket = Socket::createUdpSocket(SocketAddr { args.serverAddr }, reusePort);
+        // The sockets after the first one join the port chosen by kernel.
+        mPort = socket->getLocalAddr().getPort();
+        args.serverAddr.mPort = mPort;
+        loop->runInLoop([&] {
+            mSockets.push_back(UdpSocket::createUdpSocket(loop, std::move(socket), args.socketOptions));
+        });
+    }
+    mIdentification = fmt::format("{:016d}_{:05d}_{}_{}"
+        , std::chrono::steady_clock::now().time_since_epoch().count()
+        , gettid()
+        , mPort
+        , mSockets.front()->getLocalAddr().getIp()
+    );
+    LOG_INFO("{}: New Sever {}, {} sockets", __FUNCTION__, mIdentification, mSockets.size());
+    LOG_INFO("{}: X", __FUNCTION__);
+}
+
+UdpServer::~UdpServer() noexcept {
+    LOG_INFO("{}", __FUNCTION__);
+    mpEventLoop->assertInLoopThread();
+    // Sockets must be destroyed in their owner loops.
+    for (auto& socket : mSockets) {
+        socket->getLoop()->runInLoop([&socket] {
+            socket = nullptr;
+        });
+    }
+}
+
+void UdpServer::start() {
+    LOG_INFO("{}", __FUNCTION__);
+    mpEventLoop->assertInLoopThread();
+    for (auto& socket : mSockets) {
+        socket->getLoop()->runInLoop([this, &socket] {
+            auto cb = mMessageCb;
+            socket->setMessageCallback(std::move(cb));
+            socket->start();
+        });
+    }
+}
+
+UdpStats UdpServer::getStats() const {
+    mpEventLoop->assertInLoopThread();
+    UdpStats result;
+    for (auto& socket : mSockets) {
+        socket->getLoop()->runInLoop([&result, &socket] {
+            auto& stats = socket->getStats();
+            result.mRecvPackets += stats.mRecvPackets;
+            result.mRecvBatches += stats.mRecvBatches;
+            result.mSentPackets += stats.mSentPackets;
+            result.mSendBatches += stats.mSendBatches;
+            result.mTruncatedPackets += stats.mTruncatedPackets;
+            result.mDroppedPackets += stats.mDroppedPackets;
+        });
+    }
+    return result;
+}
+
+} // namespace simpletcp::net
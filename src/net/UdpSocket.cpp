@@ -0,0 +1,310 @@
+#include "net/UdpSocket.h"
+#include "base/Error.h"
+#include "base/Log.h"
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <string_view>
+
+extern "C" {
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <netinet/udp.h>
+}
+
+using namespace simpletcp;
+
+static constexpr std::string_view TAG = "UdpSocket";
+
+namespace simpletcp::net {
+
+// Slot size of receive ring if GRO is enabled, a super packet is no longer than 64KB.
+static constexpr size_t UDP_GRO_SLOT_SIZE = 65536;
+// Max count of datagrams in one GSO super packet, it's UDP_MAX_SEGMENTS of kernel.
+static constexpr size_t UDP_MAX_GSO_SEGMENTS = 64;
+// Max rounds of recvmmsg in one read event, so that a busy socket would not starve other channels.
+static constexpr int UDP_MAX_READ_ROUNDS = 16;
+
+static constexpr size_t UDP_RECV_CONTROL_SIZE = CMSG_SPACE(sizeof(int));
+static constexpr size_t UDP_SEND_CONTROL_SIZE = CMSG_SPACE(sizeof(uint16_t));
+
+static bool isSameAddr(const RawSockAddr& lhs, const RawSockAddr& rhs) noexcept {
+    return lhs.getLength() == rhs.getLength() && std::memcmp(lhs.get(), rhs.get(), lhs.getLength()) == 0;
+}
+
+UdpSocketPtr UdpSocket::createUdpSocket(EventLoop* loop, SocketPtr&& socket, const UdpSocketOptions& options) {
+    return UdpSocketPtr { new UdpSocket(loop, std::move(socket), options) };
+}
+
+UdpSocket::UdpSocket(EventLoop* loop, SocketPtr&& socket, const UdpSocketOptions& options)
+        : mpEventLoop(loop), mpSocket(std::move(socket)), mBatchSize(options.mBatchSize)
+        , mMaxPacketSize(options.mMaxPacketSize), mIsGsoEnabled(false), mIsGroEnabled(false)
+        , mSendHead(0), mSendTail(0), mSendUsed(0) {
+    LOG_INFO("{}: E", __FUNCTION__);
+    assertTrue(mpEventLoop != nullptr, "[UdpSocket] loop must not be none!");
+    assertTrue(mpSocket != nullptr && mpSocket->isUdpSocket(), "[UdpSocket] socket must be datagram socket!");
+    assertTrue(mBatchSize > 0, "[UdpSocket] batch size must bigger than 0");
+    assertTrue(mMaxPacketSize > 0 && mMaxPacketSize <= UDP_MAX_PAYLOAD_SIZE, "[UdpSocket] bad max packet size");
+    mpEventLoop->assertInLoopThread();
+    mpSocket->applyOptions(options.mSocketOptions);
+
+    // Probe the offloads, they're missing in old kernels.
+    if (options.mEnableGso) {
+        int segmentSize = 0;
+        mIsGsoEnabled = ::setsockopt(getFd(), SOL_UDP, UDP_SEGMENT, &segmentSize, sizeof(segmentSize)) == 0;
+        if (!mIsGsoEnabled) {
+            LOG_WARN("{}: UDP_SEGMENT is not supported, {}", __FUNCTION__, strerror(errno));
+        }
+    }
+    if (options.mEnableGro) {
+        int enable = 1;
+        mIsGroEnabled = ::setsockopt(getFd(), SOL_UDP, UDP_GRO, &enable, sizeof(enable)) == 0;
+        if (!mIsGroEnabled) {
+            LOG_WARN("{}: UDP_GRO is not supported, {}", __FUNCTION__, strerror(errno));
+        }
+    }
+
+    // Build receive ring, the iovecs and headers point to the slots and never change.
+    mRecvSlotSize = mIsGroEnabled ? UDP_GRO_SLOT_SIZE : mMaxPacketSize;
+    mRecvStorage.resize(mBatchSize * mRecvSlotSize);
+    mRecvControl.resize(mBatchSize * UDP_RECV_CONTROL_SIZE);
+    mRecvIovecs.resize(mBatchSize);
+    mRecvMsgs.resize(mBatchSize);
+    mRecvAddrs.resize(mBatchSize);
+    // A GRO super packet holds at most UDP_MAX_GSO_SEGMENTS datagrams.
+    mRecvPackets.reserve(mIsGroEnabled ? mBatchSize * UDP_MAX_GSO_SEGMENTS : mBatchSize);
+    for (size_t i = 0; i != mBatchSize; ++i) {
+        mRecvIovecs[i] = { mRecvStorage.data() + i * mRecvSlotSize, mRecvSlotSize };
+        mRecvMsgs[i].msg_hdr.msg_iov = &mRecvIovecs[i];
+        mRecvMsgs[i].msg_hdr.msg_iovlen = 1;
+        mRecvMsgs[i].msg_hdr.msg_name = mRecvAddrs[i].get();
+    }
+
+    // Build send ring, the headers are filled on flush.
+    mSendStorage.resize(mBatchSize * mMaxPacketSize);
+    mSendControl.resize(mBatchSize * UDP_SEND_CONTROL_SIZE);
+    mSendIovecs.resize(mBatchSize);
+    mSendMsgs.resize(mBatchSize);
+    mSendMessages.resize(mBatchSize);
+
+    mpChannel = Channel::createChannel(getFd(), loop);
+    mpChannel->setChannelInfo(TAG);
+    mpChannel->setEventCallback([this] (ChannelEvent event) {
+        handleEvent(event);
+    });
+    LOG_INFO("{}: fd {}, batch {}, packet size {}, GSO {}, GRO {}", __FUNCTION__, getFd(), mBatchSize
+            , mMaxPacketSize, mIsGsoEnabled, mIsGroEnabled);
+    LOG_INFO("{}: X", __FUNCTION__);
+}
+
+UdpSocket::~UdpSocket() {
+    LOG_INFO("{}", __FUNCTION__);
+    mpEventLoop->assertInLoopThread();
+    if (getPendingPackets() != 0) {
+        LOG_WARN("{}: {} datagrams are not sent", __FUNCTION__, getPendingPackets());
+    }
+    mpChannel = nullptr;
+}
+
+void UdpSocket::start() {
+    LOG_INFO("{}", __FUNCTION__);
+    mpEventLoop->assertInLoopThread();
+    mpChannel->enableRead();
+}
+
+void UdpSocket::handleEvent(ChannelEvent event) {
+    switch (event) {
+        case ChannelEvent::Read: handleRead(); break;
+        case ChannelEvent::Write: flush(); break;
+        case ChannelEvent::Error:
+        case ChannelEvent::Close:
+            // ICMP errors are reported on connected socket(e.g. ECONNREFUSED), reading SO_ERROR clears it.
+            LOG_WARN("{}: fd {}, {}", __FUNCTION__, getFd(), strerror(mpSocket->getSocketError()));
+            break;
+    }
+}
+
+void UdpSocket::handleRead() {
+    for (int round = 0; round != UDP_MAX_READ_ROUNDS; ++round) {
+        for (size_t i = 0; i != mBatchSize; ++i) {
+            auto& header = mRecvMsgs[i].msg_hdr;
+            header.msg_namelen = RawSockAddr::getCapacity();
+            header.msg_control = mIsGroEnabled ? mRecvControl.data() + i * UDP_RECV_CONTROL_SIZE : nullptr;
+            header.msg_controllen = mIsGroEnabled ? UDP_RECV_CONTROL_SIZE : 0;
+            header.msg_flags = 0;
+        }
+        auto res = ::recvmmsg(getFd(), mRecvMsgs.data(), static_cast<unsigned int>(mBatchSize), 0, nullptr);
+        if (res < 0) {
+            if (errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR) {
+                LOG_ERR("{}: recvmmsg failed, {}", __FUNCTION__, strerror(errno));
+            }
+            return ;
+        }
+        auto count = static_cast<size_t>(res);
+        mRecvPackets.clear();
+        for (size_t i = 0; i != count; ++i) {
+            auto& header = mRecvMsgs[i].msg_hdr;
+            mRecvAddrs[i].setLength(header.msg_namelen);
+            if (header.msg_flags & MSG_TRUNC) {
+                ++mStats.mTruncatedPackets;
+            }
+            size_t segmentSize = 0;
+            for (auto cmsg = CMSG_FIRSTHDR(&header); cmsg != nullptr; cmsg = CMSG_NXTHDR(&header, cmsg)) {
+                if (cmsg->cmsg_level == SOL_UDP && cmsg->cmsg_type == UDP_GRO) {
+                    int value = 0;
+                    std::memcpy(&value, CMSG_DATA(cmsg), sizeof(value));
+                    segmentSize = static_cast<size_t>(value);
+                }
+            }
+            auto data = span_type { mRecvStorage.data() + i * mRecvSlotSize, mRecvMsgs[i].msg_len };
+            // Split the super packet of GRO into the original datagrams.
+            if (segmentSize == 0 || segmentSize >= data.size()) {
+                mRecvPackets.push_back({ data, &mRecvAddrs[i] });
+                continue;
+            }
+            for (size_t offset = 0; offset < data.size(); offset += segmentSize) {
+                mRecvPackets.push_back({ data.subspan(offset, std::min(segmentSize, data.size() - offset))
+                        , &mRecvAddrs[i] });
+            }
+        }
+        if (count != 0) {
+            ++mStats.mRecvBatches;
+            mStats.mRecvPackets += mRecvPackets.size();
+            if (mMessageCb) {
+                mMessageCb(*this, mRecvPackets);
+            }
+            if (getPendingPackets() != 0) {
+                flush();
+            }
+        }
+        if (count < mBatchSize) {
+            // Socket is drained.
+            return ;
+        }
+    }
+}
+
+size_t UdpSocket::getPendingPackets() const noexcept {
+    size_t result = 0;
+    for (auto i = mSendHead; i != mSendTail; ++i) {
+        result += mSendMessages[i].mSegments;
+    }
+    return result;
+}
+
+bool UdpSocket::appendSegment(span_type data, const RawSockAddr& peerAddr) noexcept {
+    if (!mIsGsoEnabled || mSendTail == mSendHead) {
+        return false;
+    }
+    auto& last = mSendMessages[mSendTail - 1];
+    // All segments but the last one have the same size, and the last one closes the super packet if
+    // it's shorter.
+    if (data.size() > last.mSegmentSize || last.mSize != last.mSegmentSize * last.mSegments
+            || last.mSegments == UDP_MAX_GSO_SEGMENTS || last.mSize + data.size() > UDP_MAX_PAYLOAD_SIZE
+            || mSendUsed + data.size() > mSendStorage.size() || !isSameAddr(last.mPeerAddr, peerAddr)) {
+        return false;
+    }
+    std::copy(data.begin(), data.end(), mSendStorage.begin() + static_cast<ptrdiff_t>(mSendUsed));
+    mSendUsed += data.size();
+    last.mSize += data.size();
+    ++last.mSegments;
+    return true;
+}
+
+bool UdpSocket::send(span_type data, const RawSockAddr& peerAddr) {
+    mpEventLoop->assertInLoopThread();
+    if (data.size() > mMaxPacketSize) {
+        LOG_WARN("{}: datagram of {} bytes is longer than {}", __FUNCTION__, data.size(), mMaxPacketSize);
+        return false;
+    }
+    if (appendSegment(data, peerAddr)) {
+        return true;
+    }
+    if (mSendTail == mBatchSize || mSendUsed + data.size() > mSendStorage.size()) {
+        flush();
+        if (mSendTail == mBatchSize || mSendUsed + data.size() > mSendStorage.size()) {
+            return false;
+        }
+    }
+    std::copy(data.begin(), data.end(), mSendStorage.begin() + static_cast<ptrdiff_t>(mSendUsed));
+    mSendMessages[mSendTail++] = { peerAddr, mSendUsed, data.size(), std::max<size_t>(data.size(), 1), 1 };
+    mSendUsed += data.size();
+    return true;
+}
+
+void UdpSocket::compactSendRing() noexcept {
+    if (mSendHead == 0) {
+        return ;
+    }
+    auto offset = mSendMessages[mSendHead].mOffset;
+    std::copy(mSendStorage.begin() + static_cast<ptrdiff_t>(offset)
+            , mSendStorage.begin() + static_cast<ptrdiff_t>(mSendUsed), mSendStorage.begin());
+    std::move(mSendMessages.begin() + static_cast<ptrdiff_t>(mSendHead)
+            , mSendMessages.begin() + static_cast<ptrdiff_t>(mSendTail), mSendMessages.begin());
+    mSendTail -= mSendHead;
+    mSendUsed -= offset;
+    mSendHead = 0;
+    for (size_t i = 0; i != mSendTail; ++i) {
+        mSendMessages[i].mOffset -= offset;
+    }
+}
+
+void UdpSocket::flush() {
+    mpEventLoop->assertInLoopThread();
+    while (mSendHead != mSendTail) {
+        auto count = mSendTail - mSendHead;
+        for (size_t i = 0; i != count; ++i) {
+            auto& message = mSendMessages[mSendHead + i];
+            auto& header = mSendMsgs[i].msg_hdr;
+            mSendIovecs[i] = { mSendStorage.data() + message.mOffset, message.mSize };
+            header = {};
+            header.msg_iov = &mSendIovecs[i];
+            header.msg_iovlen = 1;
+            // Connected socket sends to its peer.
+            if (!message.mPeerAddr.isUnset()) {
+                header.msg_name = message.mPeerAddr.get();
+                header.msg_namelen = message.mPeerAddr.getLength();
+            }
+            if (message.mSegments > 1) {
+                auto control = mSendControl.data() + i * UDP_SEND_CONTROL_SIZE;
+                header.msg_control = control;
+                header.msg_controllen = UDP_SEND_CONTROL_SIZE;
+                auto cmsg = CMSG_FIRSTHDR(&header);
+                cmsg->cmsg_level = SOL_UDP;
+                cmsg->cmsg_type = UDP_SEGMENT;
+                cmsg->cmsg_len = CMSG_LEN(sizeof(uint16_t));
+                auto segmentSize = static_cast<uint16_t>(message.mSegmentSize);
+                std::memcpy(CMSG_DATA(cmsg), &segmentSize, sizeof(segmentSize));
+            }
+        }
+        auto res = ::sendmmsg(getFd(), mSendMsgs.data(), static_cast<unsigned int>(count), 0);
+        if (res < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            if (errno == EAGAIN || errno == EWOULDBLOCK) {
+                // Send buffer is full, continue when socket is writable.
+                compactSendRing();
+                mpChannel->enableWrite();
+                return ;
+            }
+            // The head message is rejected(e.g. EMSGSIZE, ECONNREFUSED), drop it and send the others.
+            LOG_WARN("{}: drop {} datagrams, {}", __FUNCTION__, mSendMessages[mSendHead].mSegments
+                    , strerror(errno));
+            mStats.mDroppedPackets += mSendMessages[mSendHead].mSegments;
+            ++mSendHead;
+            continue;
+        }
+        ++mStats.mSendBatches;
+        for (int i = 0; i != res; ++i) {
+            mStats.mSentPackets += mSendMessages[mSendHead++].mSegments;
+        }
+    }
+    // All messages are sent, rewind the ring.
+    mSendHead = mSendTail = mSendUsed = 0;
+    if (mpChannel->isWriting()) {
+        mpChannel->disableWrite();
+    }
+}
+
+} // namespace simpletcp::net
@@ -0,0 +1,64 @@
+#include "tcp/MirroredRing.h"
+#include "base/Log.h"
+#include "base/Error.h"
+#include <algorithm>
+#include <cerrno>
+#include <string_view>
+
+extern "C" {
+#include <unistd.h>
+#include <sys/mman.h>
+}
+
+static constexpr std::string_view TAG = "MirroredRing";
+
+using namespace simpletcp;
+
+namespace simpletcp::tcp {
+
+MirroredRing::MirroredRing(size_type capacity) : mpData(nullptr), mCapacity(0) {
+    auto pageSize = static_cast<size_type>(::sysconf(_SC_PAGESIZE));
+    capacity = (std::max(capacity, size_type { 1 }) + pageSize - 1) / pageSize * pageSize;
+
+    int fd = ::memfd_create("SimpleTcp_ring", MFD_CLOEXEC);
+    if (fd < 0) {
+        throw SystemException("[MirroredRing] memfd_create failed.");
+    }
+    if (::ftruncate(fd, static_cast<off_t>(capacity)) < 0) {
+        auto err = errno;
+        ::close(fd);
+        errno = err;
+        throw SystemException("[MirroredRing] ftruncate failed.");
+    }
+    // Reserve the address space of both halves, then map the pages into each half.
+    auto addr = ::mmap(nullptr, capacity * 2, PROT_NONE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (addr == MAP_FAILED) {
+        auto err = errno;
+        ::close(fd);
+        errno = err;
+        throw SystemException("[MirroredRing] reserve address failed.");
+    }
+    auto base = static_cast<char_type *>(addr);
+    for (auto half : { base, base + capacity }) {
+        if (::mmap(half, capacity, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_FIXED, fd, 0) == MAP_FAILED) {
+            auto err = errno;
+            ::munmap(addr, capacity * 2);
+            ::close(fd);
+            errno = err;
+            throw SystemException("[MirroredRing] map pages failed.");
+        }
+    }
+    // The mappings keep the pages alive.
+    ::close(fd);
+    mpData = base;
+    mCapacity = capacity;
+    LOG_DEBUG("{}: map ring, capacity {}", __FUNCTION__, mCapacity);
+}
+
+MirroredRing::~MirroredRing() noexcept {
+    if (mpData != nullptr) {
+        ::munmap(mpData, mCapacity * 2);
+    }
+}
+
+} // namespace simpletcp::tcp
@@ -1,8 +1,10 @@
 #include "tcp/TcpBuffer.h"
+#include "tcp/MirroredRing.h"
 #include "base/Utils.h"
 #include "base/Log.h"
 #include "base/Error.h"
 #include <algorithm>
+#include <cerrno>
 #include <cstddef>
 #include <cstdint>
 #include <cstring>
@@ -22,8 +24,34 @@ using namespace simpletcp::net;
 
 namespace simpletcp::tcp {
 
-TcpBuffer::TcpBuffer() :mReadPos(0), mWritePos(0) {
-    mBuffer.resize(1024);
+// Initial size of buffer, buffer is allocated when it is used at the first time.
+static constexpr TcpBuffer::size_type TCP_BUFFER_INIT_SIZE = 1024;
+
+// Initial size of ring, it's rounded up to the page size.
+static constexpr TcpBuffer::size_type TCP_RING_INIT_SIZE = 65536;
+
+// Max plaintext size of TLS record, buffer keeps room for one record before SSL_read.
+static constexpr TcpBuffer::size_type TCP_TLS_RECORD_SIZE = 16384;
+
+// Size of the scratch buffer of each loop thread.
+static constexpr TcpBuffer::size_type TCP_SCRATCH_SIZE = 65536;
+
+// Reads of empty buffers land in the scratch buffer first, one for each loop thread.
+static TcpBuffer::char_type* getScratch() {
+    thread_local std::unique_ptr<TcpBuffer::char_type[]> tScratch;
+    if (!tScratch) {
+        tScratch = std::make_unique_for_overwrite<TcpBuffer::char_type[]>(TCP_SCRATCH_SIZE);
+    }
+    return tScratch.get();
+}
+
+TcpBuffer::TcpBuffer(TcpBufferMode mode)
+    : mpScratch(nullptr), mCapacity(0), mReadPos(0), mWritePos(0), mMode(mode) {}
+
+TcpBuffer::~TcpBuffer() = default;
+
+TcpBuffer::char_type* TcpBuffer::getStorage() const noexcept {
+    return mpRing ? mpRing->data() : mpBlock.get();
 }
 
 /*
@@ -42,11 +70,32 @@ TcpBuffer::TcpBuffer() :mReadPos(0), mWritePos(0) {
 // TODO:
 // Use readv to speed up this invocation.
 void TcpBuffer::readFromSocket(const SocketPtr &socket) {
+    releaseScratch();
+    if (mMode == TcpBufferMode::Mirrored) {
+        readToRing(socket);
+        return ;
+    }
+    if (readablebytes() == 0) {
+        // Nothing left, read into scratch buffer. Data is copied only if it's not consumed.
+        auto scratch = getScratch();
+        auto res = ::read(socket->getFd(), scratch, TCP_SCRATCH_SIZE);
+        if (res <= 0) {
+            throw NetworkException("[TcpBuffer] write error.", socket->getSocketError());
+        }
+        mpScratch = scratch;
+        mReadPos = 0;
+        mWritePos = static_cast<size_type>(res);
+        LOG_DEBUG("{}: read bytes to scratch: {}", __FUNCTION__, res);
+        return ;
+    }
+    if (writablebytes() == 0) {
+        ensureWritable(TCP_BUFFER_INIT_SIZE);
+    }
     auto res = ::read(socket->getFd(), getWritePos(), writablebytes());
     if (res > 0 && static_cast<size_type>(res) == writablebytes()) {
         // Don't write again. Make write availble in next loop.
         mWritePos += static_cast<size_type>(res);
-        mBuffer.resize(mBuffer.size() * 2);
+        ensureWritable(mCapacity);
     } else if (res > 0) {
         mWritePos += static_cast<size_type>(res);
     } else {
@@ -56,6 +105,33 @@ void TcpBuffer::readFromSocket(const SocketPtr &socket) {
             , res, readablebytes(), writablebytes());
 }
 
+TcpBuffer::size_type TcpBuffer::readFromTls(TlsSession& tls) {
+    releaseScratch();
+    size_type total = 0;
+    do {
+        if (writablebytes() < TCP_TLS_RECORD_SIZE) {
+            ensureWritable(TCP_TLS_RECORD_SIZE);
+        }
+        auto res = tls.read(getWritePos(), writablebytes());
+        if (res < 0 && errno == EAGAIN) {
+            // The record is incomplete, or a handshake message is received.
+            break;
+        }
+        if (res <= 0) {
+            throw NetworkException("[TcpBuffer] tls read error.", res == 0 ? 0 : errno);
+        }
+        mWritePos += static_cast<size_type>(res);
+        total += static_cast<size_type>(res);
+    } while (tls.hasPending());
+    if (readablebytes() == 0) {
+        // Nothing is received, don't keep the block for idle connection.
+        updateReadPos(0);
+    }
+    LOG_DEBUG("{}: read bytes: {}, readablebytes {}, writablebytes {}", __FUNCTION__
+            , total, readablebytes(), writablebytes());
+    return total;
+}
+
 /*
  *  |-------------------|-------------------------------||-------------------|
  *  |-------------------|--------readablebytes----------||---writablebytes---|
@@ -81,19 +157,62 @@ void TcpBuffer::writeToSocket(const SocketPtr &socket) {
         LOG_DEBUG("{}: write done, write bytes: {}", __FUNCTION__, res);
         // Don't write again. Make write availble in next loop.
         updateReadPos(static_cast<size_type>(res));
+    } else if (res < 0 && (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR || errno == EINPROGRESS)) {
+        // Socket is not writable now, or the handshake of TCP Fast Open is in progress because no data could
+        // be sent with SYN. Keep data in buffer and retry when socket is writable.
+        LOG_DEBUG("{}: write later, {}", __FUNCTION__, strerror(errno));
     } else {
         throw NetworkException("[TcpBuffer] write error.", socket->getSocketError());
     }
 }
 
+/*
+ * The readable bytes may wrap around the end of ring, but they're always contiguous in the mirror.
+ *
+ *  |======|-----writablebytes-----|=====readable=====||======|-----------------|==================|
+ *  ^                              ^                   ^      ^
+ *  |                              |                   |      |
+ * data()                       mReadPos          capacity  mWritePos
+ */
+void TcpBuffer::readToRing(const SocketPtr &socket) {
+    if (writablebytes() == 0) {
+        ensureWritable(1);
+    }
+    auto res = ::read(socket->getFd(), getWritePos(), writablebytes());
+    if (res <= 0) {
+        throw NetworkException("[TcpBuffer] write error.", socket->getSocketError());
+    }
+    mWritePos += static_cast<size_type>(res);
+    LOG_DEBUG("{}: read bytes: {}, readablebytes {}, writablebytes {}", __FUNCTION__
+            , res, readablebytes(), writablebytes());
+}
+
+void TcpBuffer::releaseScratch() {
+    if (mpScratch == nullptr) {
+        return ;
+    }
+    auto data = span_type { getReadPos(), readablebytes() };
+    mpScratch = nullptr;
+    mReadPos = 0;
+    mWritePos = 0;
+    if (!data.empty()) {
+        LOG_DEBUG("{}: keep unconsumed bytes: {}", __FUNCTION__, data.size());
+        ensureWritable(data.size());
+        ::memcpy(getWritePos(), data.data(), data.size());
+        mWritePos += data.size();
+    }
+}
+
 void TcpBuffer::appendToBuffer(span_type data) {
-    LOG_DEBUG("{}: start, message size:{}, current buffer size:{}", __FUNCTION__, data.size(), mBuffer.size());
-    while (writablebytes() < data.size()) {
-        mBuffer.resize(data.size() * 2);
+    LOG_DEBUG("{}: start, message size:{}, current buffer size:{}", __FUNCTION__, data.size(), mCapacity);
+    if (data.empty()) {
+        return ;
     }
+    releaseScratch();
+    ensureWritable(data.size());
     ::memcpy(getWritePos(), data.data(), data.size());
     mWritePos += data.size();
-    LOG_DEBUG("{}: end, message size:{}, current buffer size:{}", __FUNCTION__, data.size(), mBuffer.size());
+    LOG_DEBUG("{}: end, message size:{}, current buffer size:{}", __FUNCTION__, data.size(), mCapacity);
 }
 
 
@@ -136,6 +255,10 @@ std::vector<TcpBuffer::char_type> TcpBuffer::extract(size_type size) noexcept {
     return result;
 }
 
+void TcpBuffer::discard(size_type size) noexcept {
+    updateReadPos(std::min(size, readablebytes()));
+}
+
 std::string TcpBuffer::extractString(size_type size) noexcept {
     std::string result;
     if (size < readablebytes()) {
@@ -162,11 +285,99 @@ std::u8string TcpBuffer::extractU8String(size_type size) noexcept {
     return result;
 }
 
+SharedBuffer TcpBuffer::extractShared(size_type size) noexcept {
+    size = std::min(size, readablebytes());
+    if (size == 0) {
+        return {};
+    }
+    // Scratch buffer and ring are reused, so the bytes in them must be copied.
+    auto result = mpScratch != nullptr || mpRing ? SharedBuffer::copyFrom(span_type { getReadPos(), size })
+                                                 : SharedBuffer { mpBlock, getReadPos(), size };
+    updateReadPos(size);
+    return result;
+}
+
+void TcpBuffer::ensureWritable(size_type len) {
+    if (writablebytes() >= len) {
+        return ;
+    }
+    auto readable = readablebytes();
+    if (mMode == TcpBufferMode::Mirrored && growRing(readable + len)) {
+        return ;
+    }
+    if (!isShared() && mCapacity >= readable + len) {
+        // Enough space in current block, just compact it.
+        ::memmove(mpBlock.get(), getReadPos(), readable);
+    } else {
+        // Keep the size of block if the data fits, otherwise grow it.
+        auto capacity = readable + len <= mCapacity ? mCapacity : std::max(mCapacity * 2, readable + len);
+        capacity = std::max(capacity, TCP_BUFFER_INIT_SIZE);
+        std::shared_ptr<char_type[]> block = std::make_shared_for_overwrite<char_type[]>(capacity);
+        if (readable != 0) {
+            ::memcpy(block.get(), getReadPos(), readable);
+        }
+        // The old block is released here, or by the last slice refers to it.
+        mpBlock = std::move(block);
+        mCapacity = capacity;
+    }
+    mReadPos = 0;
+    mWritePos = readable;
+}
+
+bool TcpBuffer::growRing(size_type required) {
+    auto readable = readablebytes();
+    auto capacity = std::max({ TCP_RING_INIT_SIZE, mCapacity * 2, required });
+    std::unique_ptr<MirroredRing> ring;
+    try {
+        ring = std::make_unique<MirroredRing>(capacity);
+    } catch (const SystemException& e) {
+        // The old storage is kept, fall back to linear buffer.
+        LOG_WARN("{}: {}, fall back to linear buffer.", __FUNCTION__, e.what());
+        mMode = TcpBufferMode::Linear;
+        if (mpRing) {
+            auto block = std::make_shared_for_overwrite<char_type[]>(std::max(readable, TCP_BUFFER_INIT_SIZE));
+            ::memcpy(block.get(), getReadPos(), readable);
+            mpRing.reset();
+            mpBlock = std::move(block);
+            mCapacity = std::max(readable, TCP_BUFFER_INIT_SIZE);
+            mReadPos = 0;
+            mWritePos = readable;
+        }
+        return false;
+    }
+    if (readable != 0) {
+        ::memcpy(ring->data(), getReadPos(), readable);
+    }
+    mpRing = std::move(ring);
+    mCapacity = mpRing->capacity();
+    mReadPos = 0;
+    mWritePos = readable;
+    return true;
+}
+
 void TcpBuffer::updateReadPos(size_type len) noexcept {
     assertTrue((mReadPos + len) <= mWritePos, "[TcpBuffer] the fomula (mReadPos + len <= mWritePos) dosn't hold!");
     mReadPos += len;
-    if (mReadPos > readablebytes()) {
-        ::memcpy(mBuffer.data(), getReadPos(), readablebytes());
+    if (mpScratch != nullptr) {
+        // Scratch buffer is not owned, it's left to releaseScratch.
+        return ;
+    }
+    if (mpRing) {
+        // Wrap around, the ring is kept for the following data.
+        if (mReadPos >= mCapacity) {
+            mReadPos -= mCapacity;
+            mWritePos -= mCapacity;
+        }
+        return ;
+    }
+    if (readablebytes() == 0) {
+        // Release the block, so idle buffer holds no memory.
+        mpBlock.reset();
+        mCapacity = 0;
+        mReadPos = 0;
+        mWritePos = 0;
+    } else if (mReadPos > readablebytes() && !isShared()) {
+        ::memcpy(mpBlock.get(), getReadPos(), readablebytes());
         mWritePos = readablebytes();
         mReadPos = 0;
     }
@@ -36,8 +36,8 @@ static constexpr std::string_view TAG = "TcpClient";
 
 namespace simpletcp::tcp {
 
-TcpClient::TcpClient(EventLoop* loop, SocketAddr serverAddr)
-    : mpEventLoop(loop), mServerAddr(std::move(serverAddr))
+TcpClient::TcpClient(EventLoop* loop, SocketAddr serverAddr, SocketOptions options)
+    : mpEventLoop(loop), mServerAddr(std::move(serverAddr)), mSocketOptions(std::move(options))
       , mState(ClientState::Disconnect), mConnRetryDelay(TCP_INIT_RETRY_TIMEOUT), mIdentification(UNKNOWN_CLIENT_ID)
 {
     assertTrue(mpEventLoop != nullptr, "[TcpClient] loop must not be none!");
@@ -133,7 +133,7 @@ void TcpClient::doConnecting() {
     mConnSocket = nullptr;
     auto serverAddr = mServerAddr;
     // Get non-block socket.
-    mConnSocket = Socket::createTcpClientSocket(std::move(serverAddr));
+    mConnSocket = Socket::createTcpClientSocket(std::move(serverAddr), mSocketOptions);
     if (mConnSocket == nullptr) {
         retry();
         LOG_INFO("{}: X", __FUNCTION__);
@@ -149,19 +149,23 @@ void TcpClient::doConnecting() {
         LOG_INFO("{} : connect in progress.", __FUNCTION__);
         mConnChannel = Channel::createChannel(mConnSocket->getFd(), mpEventLoop);
         mConnChannel->setChannelInfo("Client temp channel");
-        mConnChannel->setErrorCallback([this] {
-            auto err = mConnSocket->getSocketError();
-            LOG_ERR("{} : connect error({}) message({})", __FUNCTION__, err, strerror(err));
-            // If connect failed, retry.
-            retry();
-        });
-        mConnChannel->setWriteCallback([this] {
-            // TODO:
-            // Need check the state of socket.
-            LOG_INFO("{} : connect has done.", __FUNCTION__);
-            mpEventLoop->queueInLoop([this] {
-                transStateInLoop(ClientState::Connected);
-            });
+        mConnChannel->setEventCallback([this] (ChannelEvent event) {
+            // A refused connect reports EPOLLHUP, which is dispatched as Close instead of Error.
+            if (event == ChannelEvent::Error || event == ChannelEvent::Close) {
+                auto err = mConnSocket->getSocketError();
+                LOG_ERR("{} : connect error({}) message({})", __FUNCTION__, err, strerror(err));
+                // The events are level triggered, stop monitoring the failed socket until retry.
+                mConnChannel->disableAll();
+                // If connect failed, retry.
+                retry();
+            } else if (event == ChannelEvent::Write) {
+                // TODO:
+                // Need check the state of socket.
+                LOG_INFO("{} : connect has done.", __FUNCTION__);
+                mpEventLoop->queueInLoop([this] {
+                    transStateInLoop(ClientState::Connected);
+                });
+            }
         });
         mConnChannel->enableWrite();
     } else if (errCode == 0) {
@@ -189,25 +193,26 @@ void TcpClient::doConnected() {
     mConnRetryDelay = TCP_INIT_RETRY_TIMEOUT;
 
     // Create new connection.
-    mConnection = TcpConnection::createTcpConnection(std::move(mConnSocket), mpEventLoop);
-    mConnection->setMessageCallback(mMessageCb);
-    mConnection->setWriteCompleteCallback(mWriteCompleteCb);
-    mConnection->setConnectionCallback(mConnectionCb);
-    mConnection->setHighWaterMarkCallback(mHighWaterMarkCb);
-    mConnection->setCloseCallback([this] (const TcpConnectionPtr&) {
+    mCallbacks.mCloseCb = [this] (const TcpConnectionPtr&) {
         mpEventLoop->queueInLoop([this] {
             transStateInLoop(ClientState::Disconnect);
         });
-    });
+    };
+    mConnection = TcpConnection::createTcpConnection(std::move(mConnSocket), mpEventLoop
+            , std::make_shared<const TcpCallbacks>(mCallbacks));
     // Create new idenfication for TcpClient.
+    auto localAddr = mConnection->getLocalAddr();
     mIdentification = fmt::format("{:016d}_{:05d}_{}_{}"
         , steady_clock::now().time_since_epoch().count()
         , gettid()
-        , mConnection->getLocalAddr().mPort
-        , mConnection->getLocalAddr().mIpAddr
+        , localAddr.getPort()
+        , localAddr.getIp()
     );
     LOG_INFO("{}: New Identification {}", __FUNCTION__, mIdentification);
 
+    if (mpTlsContext) {
+        mConnection->enableTls(mpTlsContext, mServerName);
+    }
     mConnection->establishConnect();
 
     LOG_INFO("{}: X", __FUNCTION__);
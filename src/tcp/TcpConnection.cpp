@@ -7,20 +7,19 @@
 #include <net/Socket.h>
 #include <tcp/TcpBuffer.h>
 #include <tcp/TcpConnection.h>
-#include <bits/types/struct_tm.h>
+#include <algorithm>
+#include <atomic>
 #include <exception>
 #include <memory>
-#include <mutex>
 #include <span>
 #include <string>
 #include <string_view>
 #include <system_error>
 
-// define TAG as a expression to print idenfication of connection
-const static std::string DEF_TAG = "TcpConnection";
-#define TAG (mIdentification.empty() ? DEF_TAG : mIdentification)
+static constexpr std::string_view TAG = "TcpConnection";
 
-constexpr auto TCP_HIGH_WATER_MARK = 65535;
+// The numeric identification of connections, starts from 1.
+static std::atomic<uint64_t> gNextConnId { 1 };
 
 using namespace std;
 using namespace simpletcp;
@@ -28,52 +27,78 @@ using namespace simpletcp::net;
 
 namespace simpletcp::tcp {
 
-TcpConnectionPtr TcpConnection::createTcpConnection(net::SocketPtr&& socket, net::EventLoop* loop) {
-    return std::shared_ptr<TcpConnection>(new TcpConnection(std::move(socket), loop));
+TcpConnectionPtr TcpConnection::createTcpConnection(net::SocketPtr&& socket, net::EventLoop* loop
+        , TcpCallbacksPtr callbacks, TcpBufferMode recvBufferMode) {
+    return std::shared_ptr<TcpConnection>(
+            new TcpConnection(std::move(socket), loop, std::move(callbacks), recvBufferMode));
 }
 
-TcpConnection::TcpConnection(SocketPtr&& socket, net::EventLoop* loop)
-        : mpEventLoop(loop), mpSocket(std::move(socket)), mState(ConnState::DisConnected) {
+TcpConnection::TcpConnection(SocketPtr&& socket, net::EventLoop* loop, TcpCallbacksPtr callbacks
+        , TcpBufferMode recvBufferMode)
+        : mpEventLoop(loop), mpSocket(std::move(socket)), mpCallbacks(std::move(callbacks))
+        , mConnId(gNextConnId.fetch_add(1, std::memory_order_relaxed)), mState(ConnState::DisConnected)
+        , mIsShutdownPending(false), mIsFlushScheduled(false), mRecvBuffer(recvBufferMode) {
     LOG_INFO("{}: E", __FUNCTION__);
-    LOG_INFO("{}: owner loop :{}", __FUNCTION__, static_cast<void *>(mpEventLoop));
-
-    mLocalAddr = mpSocket->getLocalAddr();
-    mPeerAddr = mpSocket->getPeerAddr();
-    mIdentification = fmt::format("ConnId_{}_{}_{}_{}"
-        , mpSocket->getLocalAddr().mIpAddr, mpSocket->getLocalAddr().mPort
-        , mpSocket->getPeerAddr().mIpAddr, mpSocket->getPeerAddr().mPort
-    );
+    LOG_INFO("{}: conn {}, owner loop :{}", __FUNCTION__, mConnId, static_cast<void *>(mpEventLoop));
+    assertTrue(mpCallbacks != nullptr, "[TcpConnection] callback table must not be none!");
 
     mpChannel = net::Channel::createChannel(mpSocket->getFd(), loop);
-    mpChannel->setChannelInfo(mIdentification);
-    mpChannel->setWriteCallback([this] () {
-        handleWrite();
-    });
-    mpChannel->setReadCallback([this] () {
-        handleRead();
-    });
-    mpChannel->setErrorCallback([this] () {
-        handleError();
-    });
-    mpChannel->setCloseCallback([this] () {
-        handleClose();
+    mpChannel->setChannelInfo(TAG);
+    mpChannel->setEventCallback([this] (ChannelEvent event) {
+        handleEvent(event);
     });
     LOG_INFO("{}: X", __FUNCTION__);
 }
 
 TcpConnection::~TcpConnection() noexcept {
     LOG_INFO("{}: E", __FUNCTION__);
-    if (mState == ConnState::Connected || mState == ConnState::HalfClosed) {
+    if (mState == ConnState::Handshaking || mState == ConnState::Connected || mState == ConnState::HalfClosed) {
         mState = ConnState::DisConnected;
         destroyConnection();
         LOG_ERR("{}: The connection is not shutdown, but dtor has invoked...", __FUNCTION__);
         LOG_ERR("{}: current exceptions {}", __FUNCTION__, std::uncaught_exceptions());
     }
+    // Release the messages which are not flushed.
+    while (auto node = mOutbox.pop()) {
+        delete node;
+    }
     LOG_INFO("{}: X", __FUNCTION__);
 }
 
+net::RawSockAddr TcpConnection::getLocalAddr() const {
+    return mpSocket ? mpSocket->getLocalAddr() : net::RawSockAddr {};
+}
+
+net::RawSockAddr TcpConnection::getPeerAddr() const {
+    return mpSocket ? mpSocket->getPeerAddr() : net::RawSockAddr {};
+}
+
+std::string TcpConnection::getIdString() const {
+    if (!mpSocket) {
+        return fmt::format("ConnId_{}", mConnId);
+    }
+    // Refer to the addresses of socket, so the cached text is reused.
+    const auto& localAddr = mpSocket->getLocalAddr();
+    const auto& peerAddr = mpSocket->getPeerAddr();
+    return fmt::format("ConnId_{}_{}_{}_{}_{}", mConnId
+        , localAddr.getIp(), localAddr.getPort(), peerAddr.getIp(), peerAddr.getPort());
+}
+
+void TcpConnection::handleEvent(ChannelEvent event) {
+    if (mState == ConnState::Handshaking && (event == ChannelEvent::Read || event == ChannelEvent::Write)) {
+        handleHandshake();
+        return ;
+    }
+    switch (event) {
+        case ChannelEvent::Read: handleRead(); break;
+        case ChannelEvent::Write: handleWrite(); break;
+        case ChannelEvent::Error: handleError(); break;
+        case ChannelEvent::Close: handleClose(); break;
+    }
+}
+
 // Read data from socket to receive buffer
-// Read operation may invoked asynchronously, so need a lock to protect receive buffer.
+// Receive buffer is only accessed in loop thread, so no need to lock.
 void TcpConnection::handleRead() {
     TRACE();
     mpEventLoop->assertInLoopThread();
@@ -81,19 +106,25 @@ void TcpConnection::handleRead() {
             , "[TcpConnection] invoke handleRead in a bad connection!");
     auto scopeGuard = shared_from_this();
     try {
-        {
-        // Avoid dead lock.
-            std::lock_guard lock { mRecvMutex };
+        if (mpTls) {
+            if (mRecvBuffer.readFromTls(*mpTls) == 0) {
+                // Only TLS control messages or a partial record are received.
+                return ;
+            }
+        } else {
             mRecvBuffer.readFromSocket(mpSocket);
         }
         // What message callback may doing:
         // 1. send: safe, it always run in loop thread.
-        // 2. read: safe, use a mutex to protect receive buffer.
+        // 2. read: safe, message callback is run in loop thread.
         // 3. shutdownConnection: safe, it always run in loop thread.
-        if (mMessageCb) {
-            mMessageCb(scopeGuard);
+        if (mpCallbacks->mMessageCb) {
+            mpCallbacks->mMessageCb(scopeGuard);
         }
+        // Keep the unconsumed bytes before the scratch buffer of loop is reused by other connections.
+        mRecvBuffer.releaseScratch();
     } catch (const NetworkException& e) {
+        mRecvBuffer.releaseScratch();
         if (e.getNetErr() == 0) {
             LOG_INFO("{} remote socket is shutdown.", __FUNCTION__);
             handleClose();
@@ -110,16 +141,40 @@ void TcpConnection::handleWrite() {
     mpEventLoop->assertInLoopThread();
     assertTrue(mState == ConnState::Connected, "[TcpConnection] invoke handleWrite in a bad connection!");
     auto scopeGuard = shared_from_this();
-    if (mSendBuffer.size() != 0) {
-        mSendBuffer.writeToSocket(mpSocket);
+    auto isQueued = !mSendQueue.empty();
+    try {
+        if (isQueued) {
+            auto quota = getSendQuota();
+            if (quota == 0) {
+                scheduleWrite();
+                return ;
+            }
+            auto written = writeSendQueue(quota);
+            if (mpRateLimiter) {
+                mpRateLimiter->consume(written);
+                if (written == quota && !mSendQueue.empty()) {
+                    scheduleWrite();
+                }
+            }
+        }
+    } catch (const NetworkException& e) {
+        LOG_ERR("{}: {}, code({}) message({})", __FUNCTION__, e.what(), e.getNetErr(), strerror(e.getNetErr()));
+        handleSendError(e);
+        return ;
     }
-    if (mSendBuffer.size() == 0) {
+    if (mSendQueue.empty()) {
         // TODO
         // Delay callback function in loop thread.
-        if (mWriteCompleteCb) {
-            mWriteCompleteCb(scopeGuard);
+        if (mpCallbacks->mWriteCompleteCb) {
+            mpCallbacks->mWriteCompleteCb(scopeGuard);
+        }
+        if (isQueued && mpCallbacks->mDrainCb) {
+            mpCallbacks->mDrainCb(scopeGuard);
         }
         mpChannel->disableWrite();
+        if (mIsShutdownPending) {
+            shutdownInLoop();
+        }
     }
 }
 
@@ -130,17 +185,58 @@ void TcpConnection::handleClose() {
     auto errCode = mpSocket->getSocketError();
     LOG_ERR("{}: code({}) message({})", __FUNCTION__, errCode, strerror(errCode));
     mpEventLoop->assertInLoopThread();
-    assertTrue(mState == ConnState::Connected || mState == ConnState::HalfClosed
+    assertTrue(mState == ConnState::Handshaking || mState == ConnState::Connected || mState == ConnState::HalfClosed
             , "[TcpConnection] handleClose: destroy a bad connection!");
 
     mState = ConnState::DisConnected;
     auto scopeGuard = shared_from_this();
-    if (mCloseCb) {
+    if (mpCallbacks->mCloseCb) {
         // mCloseCb is a lambda wraper destroyConnection()
-        mCloseCb(scopeGuard);
+        mpCallbacks->mCloseCb(scopeGuard);
+    }
+    if (mpCallbacks->mConnectionCb) {
+        mpCallbacks->mConnectionCb(scopeGuard);
+    }
+}
+
+void TcpConnection::handleHandshake() {
+    TRACE();
+    mpEventLoop->assertInLoopThread();
+    switch (mpTls->handshake()) {
+        case TlsHandshakeState::WantRead:
+            if (mpChannel->isWriting()) {
+                mpChannel->disableWrite();
+            }
+            return ;
+        case TlsHandshakeState::WantWrite:
+            if (!mpChannel->isWriting()) {
+                mpChannel->enableWrite();
+            }
+            return ;
+        case TlsHandshakeState::Failed:
+            LOG_ERR("{}: conn {} handshake failed.", __FUNCTION__, mConnId);
+            handleClose();
+            return ;
+        case TlsHandshakeState::Done:
+            break;
+    }
+    LOG_INFO("{}: conn {} {} {}, kTLS send {}, kTLS recv {}", __FUNCTION__, mConnId, mpTls->getVersion()
+            , mpTls->getCipher(), mpTls->isKtlsSend(), mpTls->isKtlsRecv());
+    mState = ConnState::Connected;
+    if (mpChannel->isWriting()) {
+        mpChannel->disableWrite();
+    }
+    auto scopeGuard = shared_from_this();
+    if (mpCallbacks->mConnectionCb) {
+        mpCallbacks->mConnectionCb(scopeGuard);
+    }
+    // Flush the data sent during handshake.
+    if (isConnected() && !mSendQueue.empty()) {
+        scheduleWrite();
     }
-    if (mConnectionCb) {
-        mConnectionCb(scopeGuard);
+    // The records following handshake may be buffered in session already, socket won't be readable for them.
+    if (isConnected() && mpTls->hasPending()) {
+        handleRead();
     }
 }
 
@@ -153,136 +249,380 @@ void TcpConnection::handleError() {
     mpEventLoop->assertInLoopThread();
 }
 
-// We use std::string but not const std::string& or string_view, because we should
-// hold the string in different thread. So make problem simpler, we need a copy.
+void TcpConnection::handleSendError(const std::exception& e) {
+    mpEventLoop->assertInLoopThread();
+    LOG_ERR("{}: close conn {}, {}", __FUNCTION__, mConnId, e.what());
+    // The queued data would never be sent, don't wait for it.
+    mIsShutdownPending = false;
+    if (mpChannel->isWriting()) {
+        mpChannel->disableWrite();
+    }
+    mpEventLoop->queueInLoop([guard = shared_from_this()] {
+        if (guard->mState == ConnState::Connected || guard->mState == ConnState::HalfClosed) {
+            guard->handleClose();
+        }
+    });
+}
+
+// In loop thread, data is written directly or stored in send queue. Otherwise we should hold the data
+// in different thread, so make problem simpler, we need a copy.
 void TcpConnection::send(span_type data) {
-    // In loop thread, write to buffer directly.
     if (mpEventLoop->isInLoopThread()) {
-        sendInLoop(data);
+        TcpSendSegment segment { data };
+        sendSegmentsInLoop({ &segment, 1 });
     } else {
-    // Not in loop thread, copy the input buffer and send it to loop thread.
-        std::vector<TcpBuffer::char_type> tmp { data.begin(), data.end() };
-        mpEventLoop->queueInLoop([tmp = std::move(tmp), this] () mutable {
-            sendInLoop({ tmp.data(), tmp.size() });
-        });
+        postToOutbox(std::make_unique<TcpOutboxNode>(buffer_type { data.begin(), data.end() }));
     }
 }
 
 void TcpConnection::send(buffer_type&& data) {
-    // In loop thread, write to buffer directly.
     if (mpEventLoop->isInLoopThread()) {
-        sendInLoop(data);
+        TcpSendSegment segment { std::move(data) };
+        sendSegmentsInLoop({ &segment, 1 });
     } else {
-    // Not in loop thread, move the input buffer and send it to loop thread.
-        mpEventLoop->queueInLoop([data = std::move(data), this] () mutable {
-            sendInLoop(data);
-        });
+        postToOutbox(std::make_unique<TcpOutboxNode>(std::move(data)));
     }
 }
 
 void TcpConnection::sendString(std::string_view message) {
-    // In loop thread, write to buffer directly.
+    send({ reinterpret_cast<const TcpBuffer::char_type *>(message.data()), message.size() });
+}
+
+void TcpConnection::sendString(std::string&& message) {
     if (mpEventLoop->isInLoopThread()) {
-        sendInLoop({ reinterpret_cast<const TcpBuffer::char_type *>(message.data()), message.size() });
+        TcpSendSegment segment { std::move(message) };
+        sendSegmentsInLoop({ &segment, 1 });
     } else {
-    // Not in loop thread, copy the input buffer and send it to loop thread.
-        std::string s { message.data(), message.size() };
-        mpEventLoop->queueInLoop([s = std::move(s), this] () mutable {
-            sendInLoop({ reinterpret_cast<const TcpBuffer::char_type *>(s.data()), s.size() });
-        });
+        postToOutbox(std::make_unique<TcpOutboxNode>(std::move(message)));
     }
 }
 
-void TcpConnection::sendString(std::string&& message) {
-    // In loop thread, write to buffer directly.
+void TcpConnection::send(SharedBuffer data) {
+    if (mpEventLoop->isInLoopThread()) {
+        TcpSendSegment segment { std::move(data) };
+        sendSegmentsInLoop({ &segment, 1 });
+    } else {
+        postToOutbox(std::make_unique<TcpOutboxNode>(std::move(data)));
+    }
+}
+
+void TcpConnection::sendFile(std::shared_ptr<const net::FileDesc> file, off_t offset, size_t size) {
+    TcpFileRange range { std::move(file), offset, size };
     if (mpEventLoop->isInLoopThread()) {
-        sendInLoop({ reinterpret_cast<const TcpBuffer::char_type *>(message.data()), message.size() });
+        TcpSendSegment segment { std::move(range) };
+        sendSegmentsInLoop({ &segment, 1 });
     } else {
-    // Not in loop thread, move the input buffer and send it to loop thread.
-        mpEventLoop->queueInLoop([message = std::move(message), this] () mutable {
-            sendInLoop({ reinterpret_cast<const TcpBuffer::char_type *>(message.data()), message.size() });
+        postToOutbox(std::make_unique<TcpOutboxNode>(std::move(range)));
+    }
+}
+
+void TcpConnection::sendv(std::span<const span_type> parts) {
+    if (mpEventLoop->isInLoopThread()) {
+        std::vector<TcpSendSegment> segments { parts.begin(), parts.end() };
+        sendSegmentsInLoop(segments);
+    } else {
+        // Concatenate parts into one buffer, so only one copy and one task are needed.
+        buffer_type buffer;
+        for (auto part : parts) {
+            buffer.insert(buffer.end(), part.begin(), part.end());
+        }
+        std::vector<TcpSendSegment> segments;
+        segments.emplace_back(std::move(buffer));
+        sendSegments(std::move(segments));
+    }
+}
+
+TcpConnection::Batch TcpConnection::batch() {
+    return Batch { shared_from_this() };
+}
+
+void TcpConnection::Batch::commit() {
+    if (mSegments.empty() || !mpConn) {
+        return ;
+    }
+    mpConn->sendSegments(std::move(mSegments));
+    mSegments.clear();
+}
+
+void TcpConnection::sendSegments(std::vector<TcpSendSegment>&& segments) {
+    if (mpEventLoop->isInLoopThread()) {
+        sendSegmentsInLoop(segments);
+        return ;
+    }
+    if (segments.empty()) {
+        return ;
+    }
+    // Not in loop thread, the views may be invalid when the message is flushed, copy them.
+    for (auto& segment : segments) {
+        if (segment.isView()) {
+            auto data = segment.view();
+            segment = TcpSendSegment { buffer_type { data.begin(), data.end() } };
+        }
+    }
+    auto node = std::make_unique<TcpOutboxNode>(std::move(segments.front()));
+    node->mMoreSegments.assign(std::make_move_iterator(segments.begin() + 1), std::make_move_iterator(segments.end()));
+    postToOutbox(std::move(node));
+}
+
+void TcpConnection::postToOutbox(std::unique_ptr<TcpOutboxNode> node) {
+    mOutbox.push(node.release());
+    // Only the first producer after last flush schedules the flush task.
+    if (!mIsFlushScheduled.exchange(true, std::memory_order_acq_rel)) {
+        mpEventLoop->queueInLoop([guard = shared_from_this()] {
+            guard->flushOutbox();
         });
     }
 }
 
-void TcpConnection::sendInLoop(span_type data) {
+void TcpConnection::flushOutbox() {
     TRACE();
     mpEventLoop->assertInLoopThread();
+    // Clear the flag before draining, so the message pushed during draining is either drained now
+    // , or its producer schedules a new flush task.
+    mIsFlushScheduled.exchange(false, std::memory_order_acq_rel);
+    std::vector<TcpSendSegment> segments;
+    while (auto rawNode = mOutbox.pop()) {
+        std::unique_ptr<TcpOutboxNode> node { rawNode };
+        segments.push_back(std::move(node->mSegment));
+        for (auto& segment : node->mMoreSegments) {
+            segments.push_back(std::move(segment));
+        }
+    }
+    if (!segments.empty()) {
+        sendSegmentsInLoop(segments);
+    }
+}
+
+void TcpConnection::sendSegmentsInLoop(std::span<TcpSendSegment> segments) {
+    TRACE();
+    mpEventLoop->assertInLoopThread();
+    if (mState == ConnState::Handshaking) {
+        // Keep the data until handshake is done.
+        for (auto& segment : segments) {
+            mSendQueue.append(std::move(segment));
+        }
+        return ;
+    }
     if (!isConnected()) {
         LOG_ERR("{}: remote connection is shutdown!", __FUNCTION__);
         return ;
     }
-    mSendBuffer.appendToBuffer(data);
-    // TODO: slow down throught of socket.
-    if (mSendBuffer.size() > TCP_HIGH_WATER_MARK && mHighWaterMarkCb) {
-        mHighWaterMarkCb(shared_from_this());
+    // Nothing is queued, try to write all segments by one writev and store the remained data.
+    auto quota = mSendQueue.empty() ? getSendQuota() : 0;
+    if (quota != 0) {
+        try {
+            auto written = writeSegments(segments, quota);
+            if (mpRateLimiter) {
+                mpRateLimiter->consume(written);
+            }
+            for (auto& segment : segments) {
+                auto len = std::min(written, segment.size());
+                segment.consume(len);
+                written -= len;
+            }
+        } catch (const NetworkException& e) {
+            LOG_ERR("{}: {}, code({}) message({})", __FUNCTION__, e.what(), e.getNetErr(), strerror(e.getNetErr()));
+            handleSendError(e);
+            return ;
+        }
+    }
+    for (auto& segment : segments) {
+        mSendQueue.append(std::move(segment));
+    }
+    if (mSendQueue.empty()) {
+        // All data is written, notify user in next loop as handleWrite does.
+        if (mpCallbacks->mWriteCompleteCb) {
+            mpEventLoop->queueInLoop([guard = shared_from_this()] {
+                guard->mpCallbacks->mWriteCompleteCb(guard);
+            });
+        }
+        return ;
+    }
+    if (mSendQueue.size() > TCP_HIGH_WATER_MARK && mpCallbacks->mHighWaterMarkCb) {
+        mpCallbacks->mHighWaterMarkCb(shared_from_this());
+    }
+    scheduleWrite();
+}
+
+size_t TcpConnection::writeSegments(std::span<const TcpSendSegment> segments, size_t limit) {
+    if (mpTls && !mpTls->isKtlsSend()) {
+        return TcpSendQueue::writeSegments(*mpTls, segments, limit);
+    }
+    // Plain socket, or records are encrypted by kernel.
+    return TcpSendQueue::writeSegments(mpSocket, segments, limit);
+}
+
+size_t TcpConnection::writeSendQueue(size_t limit) {
+    if (mpTls && !mpTls->isKtlsSend()) {
+        return mSendQueue.writeToTls(*mpTls, limit);
+    }
+    return mSendQueue.writeToSocket(mpSocket, limit);
+}
+
+size_t TcpConnection::getSendQuota() {
+    if (!mpRateLimiter) {
+        return TcpSendQueue::npos;
+    }
+    if (mpRateLimiter->isThrottled()) {
+        return 0;
+    }
+    return mpRateLimiter->quota(RateClock::now());
+}
+
+void TcpConnection::scheduleWrite() {
+    if (mpRateLimiter && mpRateLimiter->isThrottled()) {
+        // Timer would resume writing.
+        return ;
+    }
+    if (mpRateLimiter && mpRateLimiter->quota(RateClock::now()) == 0) {
+        if (mpChannel->isWriting()) {
+            mpChannel->disableWrite();
+        }
+        auto delay = mpRateLimiter->beginThrottle(RateClock::now());
+        LOG_DEBUG("{}: conn {} throttled for {}us", __FUNCTION__, mConnId, delay.count());
+        mpEventLoop->runAfter([weakConn = weak_from_this()] {
+            if (auto conn = weakConn.lock()) {
+                conn->resumeWrite();
+            }
+        }, delay);
+        return ;
     }
     if (!mpChannel->isWriting()) {
         mpChannel->enableWrite();
     }
 }
 
+void TcpConnection::resumeWrite() {
+    mpEventLoop->assertInLoopThread();
+    mpRateLimiter->endThrottle(RateClock::now());
+    if (!isConnected() || mSendQueue.empty()) {
+        return ;
+    }
+    scheduleWrite();
+}
+
+void TcpConnection::setSendRateLimit(uint64_t bytesPerSecond, uint64_t burstBytes, bool useKernelPacing) {
+    auto task = [this, guard = shared_from_this(), bytesPerSecond, burstBytes, useKernelPacing] {
+        if (!mpRateLimiter) {
+            mpRateLimiter = std::make_unique<TcpRateLimiter>();
+        }
+        auto kernelPacing = useKernelPacing && bytesPerSecond != 0;
+        try {
+            // Maximum rate means no limit of kernel.
+            mpSocket->setMaxPacingRate(kernelPacing ? bytesPerSecond : UINT64_MAX);
+        } catch (const NetworkException& e) {
+            if (kernelPacing) {
+                LOG_WARN("{}: SO_MAX_PACING_RATE is not available, {}", __FUNCTION__, strerror(e.getNetErr()));
+                kernelPacing = false;
+            }
+        }
+        if (kernelPacing) {
+            LOG_INFO("{}: conn {} is paced by kernel, rate {}", __FUNCTION__, mConnId, bytesPerSecond);
+            mpRateLimiter->setRate(0, 0);
+        } else {
+            mpRateLimiter->setRate(bytesPerSecond, burstBytes);
+        }
+    };
+    if (mpEventLoop->isInLoopThread()) {
+        task();
+    } else {
+        mpEventLoop->queueInLoop(std::move(task));
+    }
+}
+
+TcpThrottleStats TcpConnection::getThrottleStats() const noexcept {
+    return mpRateLimiter ? mpRateLimiter->getStats() : TcpThrottleStats {};
+}
+
+void TcpConnection::attachServerRateLimiter(TcpServerRateLimiterPtr serverLimiter) {
+    mpEventLoop->assertInLoopThread();
+    if (!mpRateLimiter) {
+        mpRateLimiter = std::make_unique<TcpRateLimiter>();
+    }
+    mpRateLimiter->setServerLimiter(std::move(serverLimiter));
+}
+
 TcpBuffer::span_type TcpConnection::read(size_t size) noexcept {
     TRACE();
-    std::lock_guard lock { mRecvMutex };
     return mRecvBuffer.read(size);
 }
 
 TcpBuffer::span_type TcpConnection::readAll() noexcept {
     TRACE();
-    std::lock_guard lock { mRecvMutex };
     auto size = mRecvBuffer.size();
     return mRecvBuffer.read(size);
 }
 
 std::vector<uint8_t> TcpConnection::extract(size_t size) noexcept {
     TRACE();
-    std::lock_guard lock { mRecvMutex };
     return mRecvBuffer.extract(size);
 }
 
 std::vector<uint8_t> TcpConnection::extractAll() noexcept {
     TRACE();
-    std::lock_guard lock { mRecvMutex };
     auto size = mRecvBuffer.size();
     return mRecvBuffer.extract(size);
 }
 
+SharedBuffer TcpConnection::extractShared(size_t size) noexcept {
+    TRACE();
+    return mRecvBuffer.extractShared(size);
+}
+
+SharedBuffer TcpConnection::extractSharedAll() noexcept {
+    TRACE();
+    auto size = mRecvBuffer.size();
+    return mRecvBuffer.extractShared(size);
+}
+
 std::string_view TcpConnection::readString(size_t size) noexcept {
     TRACE();
-    std::lock_guard lock { mRecvMutex };
     return mRecvBuffer.readString(size);
 }
 
 std::string_view TcpConnection::readStringAll() noexcept {
     TRACE();
-    std::lock_guard lock { mRecvMutex };
     auto size = mRecvBuffer.size();
     return mRecvBuffer.readString(size);
 }
 
 std::string TcpConnection::extractString(size_t size) noexcept {
     TRACE();
-    std::lock_guard lock { mRecvMutex };
     return mRecvBuffer.extractString(size);
 }
 
 std::string TcpConnection::extractStringAll() noexcept {
     TRACE();
-    std::lock_guard lock { mRecvMutex };
     auto size = mRecvBuffer.size();
     return mRecvBuffer.extractString(size);
 }
 
+void TcpConnection::discard(size_t size) noexcept {
+    TRACE();
+    mRecvBuffer.discard(size);
+}
+
+void TcpConnection::enableTls(const TlsContextPtr& context, std::string_view serverName) {
+    mpEventLoop->assertInLoopThread();
+    assertTrue(mState == ConnState::DisConnected, "[TcpConnection] enableTls: must be invoked before establishConnect!");
+    mpTls = TlsSession::createTlsSession(context, mpSocket->getFd(), serverName);
+}
+
 // in loop thread.
 // just invoked by TcpClient/TcpServer
 void TcpConnection::establishConnect() {
     LOG_INFO("{}", __FUNCTION__);
     mpEventLoop->assertInLoopThread();
     mpChannel->enableRead();
+    if (mpTls) {
+        // Connection callback is invoked when handshake is done.
+        mState = ConnState::Handshaking;
+        handleHandshake();
+        return ;
+    }
     mState = ConnState::Connected;
-    if (mConnectionCb) {
-        mConnectionCb(shared_from_this());
+    if (mpCallbacks->mConnectionCb) {
+        mpCallbacks->mConnectionCb(shared_from_this());
     }
 }
 
@@ -307,6 +647,17 @@ void TcpConnection::destroyConnection() noexcept {
     }
 }
 
+void TcpConnection::shutdownInLoop() {
+    mpEventLoop->assertInLoopThread();
+    mIsShutdownPending = false;
+    mState = ConnState::HalfClosed;
+    mpChannel->disableWrite();
+    if (mpTls) {
+        mpTls->shutdown();
+    }
+    mpSocket->shutdown();
+}
+
 // Internal interface call by TcpClient, must run in loop.
 void TcpConnection::shutdownConnection() noexcept {
     LOG_INFO("{}", __FUNCTION__);
@@ -317,13 +668,30 @@ void TcpConnection::shutdownConnection() noexcept {
                 LOG_WARN("shutdownConnection: connection is already closed.");
                 return ;
             }
-            if (mSendBuffer.size() != 0) {
+            if (mState == ConnState::Handshaking) {
+                // Nothing can be sent before handshake is done, drop the queued data.
+                LOG_WARN("shutdownConnection: shutdown during tls handshake.");
+                shutdownInLoop();
+                return ;
+            }
+            if (auto quota = mSendQueue.empty() ? 0 : getSendQuota(); quota != 0) {
+                // The data is limited by rate as handleWrite does, the rest is sent by pending shutdown.
                 LOG_INFO("shutdownConnection: write buffer before shutdown");
-                mSendBuffer.writeToSocket(mpSocket);
+                auto written = writeSendQueue(quota);
+                if (mpRateLimiter) {
+                    mpRateLimiter->consume(written);
+                }
             }
-            mState = ConnState::HalfClosed;
-            mpChannel->disableWrite();
-            mpSocket->shutdown();
+            if (!mSendQueue.empty()) {
+                // Don't lose the queued data, shutdown when send queue is drained.
+                LOG_INFO("shutdownConnection: shutdown after send queue is drained");
+                mIsShutdownPending = true;
+                return ;
+            }
+            shutdownInLoop();
+        } catch (const NetworkException& e) {
+            LOG_ERR("shutdownConnection: {}", e.what());
+            handleSendError(e);
         } catch (const std::exception& e) {
             LOG_ERR("shutdownConnection: {}", e.what());
         }
@@ -0,0 +1,130 @@
+#include "tcp/TcpRateLimiter.h"
+#include <algorithm>
+#include <limits>
+
+using namespace std::chrono;
+
+namespace simpletcp::tcp {
+
+// Don't wake up for tiny writes, wait until so many bytes are available.
+static constexpr size_t TCP_RATE_MIN_WRITE = 4096;
+// Don't arm timers which are shorter than this.
+static constexpr microseconds TCP_RATE_MIN_WAIT { 1000 };
+
+TokenBucket::TokenBucket(uint64_t rate, uint64_t burst) noexcept
+    : mRate(static_cast<double>(rate))
+    , mBurst(static_cast<double>(burst != 0 ? burst : std::max<uint64_t>(rate / 10, TCP_RATE_MIN_WRITE)))
+    , mLastRefill(RateClock::now()) {
+    mTokens = mBurst;
+}
+
+size_t TokenBucket::available(RateClock::time_point now) noexcept {
+    auto elapsed = duration<double>(now - mLastRefill).count();
+    if (elapsed > 0) {
+        mTokens = std::min(mBurst, mTokens + elapsed * mRate);
+        mLastRefill = now;
+    }
+    // Avoid tiny writes, wait until a write unit is refilled.
+    if (mTokens < std::min(mBurst, static_cast<double>(TCP_RATE_MIN_WRITE))) {
+        return 0;
+    }
+    return static_cast<size_t>(mTokens);
+}
+
+void TokenBucket::consume(size_t bytes) noexcept {
+    mTokens = std::max(0.0, mTokens - static_cast<double>(bytes));
+}
+
+microseconds TokenBucket::waitTime(size_t bytes) const noexcept {
+    auto deficit = std::min(static_cast<double>(bytes), mBurst) - mTokens;
+    if (deficit <= 0) {
+        return microseconds { 0 };
+    }
+    return microseconds { static_cast<microseconds::rep>(deficit / mRate * 1'000'000) + 1 };
+}
+
+TcpServerRateLimiter::TcpServerRateLimiter(uint64_t rate, uint64_t burst)
+    : mThrottledCount(0), mThrottledTime(0) {
+    if (rate != 0) {
+        mBucket.emplace(rate, burst);
+    }
+}
+
+size_t TcpServerRateLimiter::available(RateClock::time_point now) {
+    std::lock_guard lock { mMutex };
+    return mBucket ? mBucket->available(now) : std::numeric_limits<size_t>::max();
+}
+
+void TcpServerRateLimiter::consume(size_t bytes) {
+    std::lock_guard lock { mMutex };
+    if (mBucket) {
+        mBucket->consume(bytes);
+    }
+}
+
+microseconds TcpServerRateLimiter::waitTime(size_t bytes) const {
+    std::lock_guard lock { mMutex };
+    return mBucket ? mBucket->waitTime(bytes) : microseconds { 0 };
+}
+
+void TcpServerRateLimiter::addThrottled(microseconds time) noexcept {
+    mThrottledCount.fetch_add(1, std::memory_order_relaxed);
+    mThrottledTime.fetch_add(time.count(), std::memory_order_relaxed);
+}
+
+TcpThrottleStats TcpServerRateLimiter::getStats() const noexcept {
+    return {
+        .mThrottledCount = mThrottledCount.load(std::memory_order_relaxed),
+        .mThrottledTime = microseconds { mThrottledTime.load(std::memory_order_relaxed) },
+    };
+}
+
+void TcpRateLimiter::setRate(uint64_t rate, uint64_t burst) noexcept {
+    if (rate == 0) {
+        mBucket.reset();
+    } else {
+        mBucket.emplace(rate, burst);
+    }
+}
+
+size_t TcpRateLimiter::quota(RateClock::time_point now) {
+    auto result = mBucket ? mBucket->available(now) : std::numeric_limits<size_t>::max();
+    if (mpServerLimiter && result != 0) {
+        result = std::min(result, mpServerLimiter->available(now));
+    }
+    return result;
+}
+
+void TcpRateLimiter::consume(size_t bytes) {
+    if (mBucket) {
+        mBucket->consume(bytes);
+    }
+    if (mpServerLimiter) {
+        mpServerLimiter->consume(bytes);
+    }
+}
+
+microseconds TcpRateLimiter::beginThrottle(RateClock::time_point now) {
+    mIsThrottled = true;
+    mThrottleStart = now;
+    auto wait = mBucket ? mBucket->waitTime(TCP_RATE_MIN_WRITE) : microseconds { 0 };
+    if (mpServerLimiter) {
+        wait = std::max(wait, mpServerLimiter->waitTime(TCP_RATE_MIN_WRITE));
+    }
+    return std::max(wait, TCP_RATE_MIN_WAIT);
+}
+
+void TcpRateLimiter::endThrottle(RateClock::time_point now) noexcept {
+    if (!mIsThrottled) {
+        return ;
+    }
+    mIsThrottled = false;
+    auto throttled = duration_cast<microseconds>(now - mThrottleStart);
+    ++mStats.mThrottledCount;
+    mStats.mThrottledTime += throttled;
+    if (mpServerLimiter) {
+        mpServerLimiter->addThrottled(throttled);
+    }
+}
+
+} // namespace simpletcp::tcp
@@ -0,0 +1,285 @@
+#include "tcp/TcpSendQueue.h"
+#include "base/Utils.h"
+#include "base/Log.h"
+#include "base/Error.h"
+#include <algorithm>
+#include <array>
+#include <cerrno>
+#include <cstring>
+#include <string_view>
+
+extern "C" {
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/sendfile.h>
+#include <sys/socket.h>
+#include <sys/uio.h>
+#include <unistd.h>
+}
+
+static constexpr std::string_view TAG = "TcpSendQueue";
+
+using namespace simpletcp;
+using namespace simpletcp::net;
+
+namespace simpletcp::tcp {
+
+// Segments smaller than this are copied into the tail segment instead of a new segment.
+static constexpr TcpSendQueue::size_type TCP_COALESCE_SIZE = 4096;
+// The tail segment stops growing when it's bigger than this.
+static constexpr TcpSendQueue::size_type TCP_COALESCE_LIMIT = 65536;
+// Max iovec counts of one writev.
+static constexpr size_t TCP_MAX_IOVEC_NUMS = 64;
+// Compact the segment list when so many segments have been consumed.
+static constexpr TcpSendQueue::size_type TCP_COMPACT_THRESHOLD = 16;
+
+// Max bytes of one sendfile.
+static constexpr size_t TCP_MAX_SENDFILE_SIZE = 1 << 30;
+
+TcpSendSegment::span_type TcpSendSegment::view() const noexcept {
+    return std::visit([this] <typename T> (const T& data) {
+        if constexpr (std::is_same_v<T, TcpFileRange>) {
+            return span_type {};
+        } else {
+            auto bytes = span_type { reinterpret_cast<const char_type *>(data.data()), data.size() };
+            return bytes.subspan(mOffset);
+        }
+    }, mData);
+}
+
+TcpSendSegment::size_type TcpSendSegment::size() const noexcept {
+    if (auto file = std::get_if<TcpFileRange>(&mData)) {
+        return file->mSize - mOffset;
+    }
+    return view().size();
+}
+
+TcpFileRange TcpSendSegment::fileRange() const noexcept {
+    auto& file = std::get<TcpFileRange>(mData);
+    return { file.mpFile, file.mOffset + static_cast<off_t>(mOffset), file.mSize - mOffset };
+}
+
+// Return true if the error means the socket is not writable now, or the handshake of TCP Fast Open is
+// in progress.
+static bool isWriteLater(int err) noexcept {
+    return err == EAGAIN || err == EWOULDBLOCK || err == EINTR || err == EINPROGRESS;
+}
+
+void TcpSendQueue::append(TcpSendSegment&& segment) {
+    auto size = segment.size();
+    if (size == 0) {
+        return ;
+    }
+    mBytes += size;
+    // Coalesce small segment into the tail buffer, SharedBuffer and file are kept by reference.
+    bool isShared = std::holds_alternative<SharedBuffer>(segment.mData) || segment.isFile();
+    if (!isShared && size <= TCP_COALESCE_SIZE && mHead != mSegments.size()) {
+        auto data = segment.view();
+        auto tail = std::get_if<buffer_type>(&mSegments.back().mData);
+        if (tail != nullptr && tail->size() + data.size() <= TCP_COALESCE_LIMIT) {
+            tail->insert(tail->end(), data.begin(), data.end());
+            return ;
+        }
+    }
+    if (segment.isView()) {
+        auto data = segment.view();
+        mSegments.emplace_back(buffer_type { data.begin(), data.end() });
+    } else {
+        mSegments.emplace_back(std::move(segment));
+    }
+}
+
+TcpSendQueue::size_type TcpSendQueue::writeSegments(const SocketPtr& socket, std::span<const TcpSendSegment> segments
+        , size_type limit) {
+    auto isFile = [] (const TcpSendSegment& segment) { return segment.isFile(); };
+    if (segments.size() < 2 || std::none_of(segments.begin(), segments.end(), isFile)) {
+        // All segments are written by one writev, or one sendfile.
+        return writeOnce(socket, segments, 0, limit);
+    }
+    // File segments break writev, so the segments are written by several calls. The socket is corked
+    // meanwhile, headers and files are coalesced into full packets, and the tail is pushed by uncorking
+    // instead of being held by Nagle until peer acks the previous packet.
+    auto isCorked = cork(socket);
+    size_type written = 0;
+    size_type skip = 0;
+    try {
+        while (!segments.empty() && written != limit) {
+            auto res = writeOnce(socket, segments, skip, limit - written);
+            if (res == 0) {
+                break;
+            }
+            written += res;
+            skip += res;
+            while (!segments.empty() && skip >= segments.front().size()) {
+                skip -= segments.front().size();
+                segments = segments.subspan(1);
+            }
+        }
+    } catch (const NetworkException&) {
+        if (isCorked) {
+            uncork(socket);
+        }
+        throw;
+    }
+    if (isCorked) {
+        uncork(socket);
+    }
+    return written;
+}
+
+bool TcpSendQueue::cork(const SocketPtr& socket) noexcept {
+    // It fails on Unix domain socket, which is not delayed by Nagle.
+    int flag = 0;
+    socklen_t len = sizeof(flag);
+    if (::getsockopt(socket->getFd(), IPPROTO_TCP, TCP_CORK, &flag, &len) != 0 || flag != 0) {
+        return false;
+    }
+    flag = 1;
+    return ::setsockopt(socket->getFd(), IPPROTO_TCP, TCP_CORK, &flag, sizeof(flag)) == 0;
+}
+
+void TcpSendQueue::uncork(const SocketPtr& socket) noexcept {
+    int flag = 0;
+    ::setsockopt(socket->getFd(), IPPROTO_TCP, TCP_CORK, &flag, sizeof(flag));
+}
+
+TcpSendQueue::size_type TcpSendQueue::writeOnce(const SocketPtr& socket, std::span<const TcpSendSegment> segments
+        , size_type skip, size_type limit) {
+    std::array<iovec, TCP_MAX_IOVEC_NUMS> iovecs;
+    size_t iovecNums = 0;
+    for (const auto& segment : segments) {
+        if (iovecNums == iovecs.size() || limit == 0) {
+            break;
+        }
+        // Only the first segment is partially written.
+        auto offset = &segment == &segments.front() ? skip : 0;
+        if (segment.isFile()) {
+            if (iovecNums != 0) {
+                // Write the segments before file, the file is sent in next write.
+                break;
+            }
+            if (segment.size() == offset) {
+                continue;
+            }
+            auto file = segment.fileRange();
+            file.mOffset += static_cast<off_t>(offset);
+            file.mSize -= offset;
+            return sendFile(socket, file, limit);
+        }
+        auto data = segment.view().subspan(offset);
+        if (data.empty()) {
+            continue;
+        }
+        iovecs[iovecNums].iov_base = const_cast<char_type *>(data.data());
+        iovecs[iovecNums].iov_len = std::min(data.size(), limit);
+        limit -= iovecs[iovecNums].iov_len;
+        ++iovecNums;
+    }
+    if (iovecNums == 0) {
+        return 0;
+    }
+    auto res = ::writev(socket->getFd(), iovecs.data(), static_cast<int>(iovecNums));
+    if (res >= 0) {
+        LOG_DEBUG("{}: write done, iovec nums: {}, write bytes: {}", __FUNCTION__, iovecNums, res);
+        return static_cast<size_type>(res);
+    }
+    if (isWriteLater(errno)) {
+        LOG_DEBUG("{}: write later, {}", __FUNCTION__, strerror(errno));
+        return 0;
+    }
+    throw NetworkException("[TcpSendQueue] write error.", errno);
+}
+
+TcpSendQueue::size_type TcpSendQueue::sendFile(const SocketPtr& socket, const TcpFileRange& file, size_type limit) {
+    auto offset = file.mOffset;
+    auto len = std::min({ file.mSize, limit, TCP_MAX_SENDFILE_SIZE });
+    auto res = ::sendfile(socket->getFd(), file.mpFile->getFd(), &offset, len);
+    if (res > 0) {
+        LOG_DEBUG("{}: sendfile done, write bytes: {}", __FUNCTION__, res);
+        return static_cast<size_type>(res);
+    }
+    if (res == 0) {
+        // The file is shorter than the range, the remained bytes can never be sent.
+        throw NetworkException("[TcpSendQueue] file is truncated.", EIO);
+    }
+    if (isWriteLater(errno)) {
+        LOG_DEBUG("{}: sendfile later, {}", __FUNCTION__, strerror(errno));
+        return 0;
+    }
+    throw NetworkException("[TcpSendQueue] sendfile error.", errno);
+}
+
+TcpSendQueue::size_type TcpSendQueue::writeSegments(TlsSession& tls, std::span<const TcpSendSegment> segments
+        , size_type limit) {
+    size_type written = 0;
+    for (const auto& segment : segments) {
+        auto size = segment.size();
+        auto data = segment.view();
+        size_type offset = 0;
+        while (offset != size && limit != 0) {
+            // The write which would block must be retried with no less bytes, even if limit is exceeded.
+            auto len = std::min(size - offset, std::max(limit, tls.getPendingWriteSize()));
+            ssize_t res = 0;
+            if (segment.isFile()) {
+                auto file = segment.fileRange();
+                res = tls.sendFile(file.mpFile->getFd(), file.mOffset + static_cast<off_t>(offset), len);
+            } else {
+                res = tls.write(data.data() + offset, len);
+            }
+            if (res < 0 && errno == EAGAIN) {
+                LOG_DEBUG("{}: write later, write bytes: {}", __FUNCTION__, written);
+                return written;
+            }
+            if (res <= 0) {
+                throw NetworkException("[TcpSendQueue] tls write error.", res == 0 ? EPIPE : errno);
+            }
+            offset += static_cast<size_type>(res);
+            written += static_cast<size_type>(res);
+            limit -= std::min(limit, static_cast<size_type>(res));
+        }
+        if (limit == 0) {
+            break;
+        }
+    }
+    LOG_DEBUG("{}: write done, write bytes: {}", __FUNCTION__, written);
+    return written;
+}
+
+TcpSendQueue::size_type TcpSendQueue::writeToSocket(const SocketPtr& socket, size_type limit) {
+    auto segments = std::span { mSegments }.subspan(mHead);
+    auto written = writeSegments(socket, segments, limit);
+    consume(written);
+    return written;
+}
+
+TcpSendQueue::size_type TcpSendQueue::writeToTls(TlsSession& tls, size_type limit) {
+    auto segments = std::span { mSegments }.subspan(mHead);
+    auto written = writeSegments(tls, segments, limit);
+    consume(written);
+    return written;
+}
+
+void TcpSendQueue::consume(size_type len) noexcept {
+    assertTrue(len <= mBytes, "[TcpSendQueue] consume more bytes than queue size!");
+    mBytes -= len;
+    while (len != 0) {
+        auto& segment = mSegments[mHead];
+        auto segmentSize = segment.size();
+        if (len < segmentSize) {
+            segment.consume(len);
+            break;
+        }
+        len -= segmentSize;
+        ++mHead;
+    }
+    if (mHead == mSegments.size()) {
+        // Release the segment list, so idle connection holds no send memory.
+        mSegments = {};
+        mHead = 0;
+    } else if (mHead >= TCP_COMPACT_THRESHOLD && mHead * 2 >= mSegments.size()) {
+        mSegments.erase(mSegments.begin(), mSegments.begin() + static_cast<std::ptrdiff_t>(mHead));
+        mHead = 0;
+    }
+}
+
+} // namespace simpletcp::tcp
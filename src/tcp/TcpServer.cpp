@@ -25,38 +25,52 @@ using namespace simpletcp::net;
 namespace simpletcp::tcp {
 
 TcpServer::TcpServer(TcpServerArgs args)
-    : mpEventLoop(args.loop), mEventLoopPool(args.loop, args.maxThreadNum) {
+    : mpEventLoop(args.loop), mEventLoopPool(args.loop, args.maxThreadNum)
+    , mConnectionNums(0), mMaxConnectionNum(args.maxConnectionNum), mSocketOptions(args.socketOptions)
+    , mRecvBufferMode(args.recvBufferMode), mMaxConnectionSendRate(args.maxConnectionSendRate)
+    , mpTlsContext(std::move(args.tlsContext)) {
     assertTrue(mpEventLoop != nullptr, "[TcpServer] loop must not be none!");
     assertTrue(args.maxListenQueue > 0, "[TcpServer] maxListenQueue must bigger than 0");
+    assertTrue(args.maxConnectionNum > 0, "[TcpServer] maxConnectionNum must bigger than 0");
     mpEventLoop->assertInLoopThread();
     LOG_INFO("{}: E", __FUNCTION__);
     LOG_INFO("{}: owner loop :{}", __FUNCTION__, static_cast<void *>(mpEventLoop));
+    // Create a connection shard for every loop which may own connections.
+    if (mEventLoopPool.getLoops().empty()) {
+        mConnectionShards[mpEventLoop];
+    }
+    for (auto loop : mEventLoopPool.getLoops()) {
+        mConnectionShards[loop];
+    }
+    if (args.maxServerSendRate != 0 || args.maxConnectionSendRate != 0) {
+        mpRateLimiter = std::make_shared<TcpServerRateLimiter>(args.maxServerSendRate, 0);
+    }
+
     // create listen socket.
+    auto isUnixSocket = args.serverAddr.mIpProtocol == IP_PROTOCOL::Unix;
     mpListenSocket = Socket::createTcpListenSocket(std::move(args.serverAddr), args.maxListenQueue);
-    mpListenSocket->setReuseAddr(true);
-    mpListenSocket->setReusePort(true);
+    // The path of unix domain socket is exclusive, kernel rejects SO_REUSEPORT on it.
+    if (!isUnixSocket) {
+        mpListenSocket->setReuseAddr(true);
+        mpListenSocket->setReusePort(true);
+    }
+    // Buffer sizes must be set before listen, so accepted sockets inherit them and negotiate window scale.
+    mpListenSocket->applyOptions(mSocketOptions);
 
     // create listen channel.
     mpListenChannel = Channel::createChannel(mpListenSocket->getFd(), args.loop);
 
-    auto channelInfo = fmt::format("Server listen in port {}", mpListenSocket->getPort());
-    mpListenChannel->setChannelInfo(channelInfo);
-    mpListenChannel->setReadCallback([&] {
-        LOG_INFO("[ReadCallback] new client is arrived.");
-        createNewConnection();
-    });
-
-    // When error happen in listen socket, exit tcp server.
-    mpListenChannel->setCloseCallback([&] {
-        auto errCode = mpListenSocket->getSocketError();
-        LOG_FATAL("{}: Error happen for server! Error code:{}, {}", __FUNCTION__
-                , errCode, gai_strerror(errCode));
-    });
-
-    mpListenChannel->setErrorCallback([&] {
-        auto errCode = mpListenSocket->getSocketError();
-        LOG_FATAL("{}: Error happen for server! Error code:{}, {}", __FUNCTION__
-                , errCode, gai_strerror(errCode));
+    mpListenChannel->setChannelInfo("Server listen channel");
+    mpListenChannel->setEventCallback([&] (ChannelEvent event) {
+        if (event == ChannelEvent::Read) {
+            LOG_INFO("[ReadCallback] new client is arrived.");
+            createNewConnection();
+        } else if (event == ChannelEvent::Close || event == ChannelEvent::Error) {
+            // When error happen in listen socket, exit tcp server.
+            auto errCode = mpListenSocket->getSocketError();
+            LOG_FATAL("{}: Error happen for server! Error code:{}, {}", __FUNCTION__
+                    , errCode, gai_strerror(errCode));
+        }
     });
 
     // When new connection is established, create new idenfication for TcpClient.
@@ -64,8 +78,8 @@ TcpServer::TcpServer(TcpServerArgs args)
     mIdentification = fmt::format("{:016d}_{:05d}_{}_{}"
         , std::chrono::steady_clock::now().time_since_epoch().count()
         , gettid()
-        , mpListenSocket->getLocalAddr().mPort
-        , mpListenSocket->getLocalAddr().mIpAddr
+        , mpListenSocket->getPort()
+        , mpListenSocket->getLocalAddr().getIp()
     );
     LOG_INFO("{}: New Sever {}", __FUNCTION__, mIdentification);
     LOG_INFO("{}: X", __FUNCTION__);
@@ -74,7 +88,12 @@ TcpServer::TcpServer(TcpServerArgs args)
 TcpServer::~TcpServer() noexcept {
     LOG_INFO("{}", __FUNCTION__);
     mpEventLoop->assertInLoopThread();
-    mConnectionSet.clear();
+    // Connections must be destroyed in their owner loops.
+    for (auto& [loop, shard] : mConnectionShards) {
+        loop->runInLoop([&shard] {
+            shard.mConnections.clear();
+        });
+    }
     mpListenChannel = nullptr;
     mpListenSocket = nullptr;
 }
@@ -83,103 +102,147 @@ TcpServer::~TcpServer() noexcept {
 void TcpServer::start() {
     LOG_INFO("{}", __FUNCTION__);
     mpEventLoop->assertInLoopThread();
+
+    // Must remove connection in loop thread of TcpServer.
+    // EventLoop::poll()
+    //
+    //      => handleEvent()
+    //          => Channel::mEventCb()
+    //              => TcpConnection::handleClose()
+    //                  => TcpConnection::mCloseCb()
+    //                      => EventLoop::queueInLoop()
+    //      => destroyConnection()
+    //          => ~Channel()
+    //              => EventLoop::removeChannel()
+    //                  => ~Socket()
+    //                      => ~TcpConnection()
+    mCallbacks.mCloseCb = [this] (const TcpConnectionPtr& conn) {
+        // destroy connection in sub loop.
+        auto guard = conn;
+        conn->getLoop()->queueInLoop([guard, this] {
+            guard->destroyConnection();
+            // remove connection, the shard is owned by current loop.
+            if (getShard(guard->getLoop()).mConnections.erase(guard) != 0) {
+                mConnectionNums.fetch_sub(1, std::memory_order_relaxed);
+            }
+        });
+    };
+    // Freeze user callbacks, all connections share this table.
+    mpSharedCallbacks = std::make_shared<const TcpCallbacks>(mCallbacks);
+
     mpListenSocket->listen();
     mpListenChannel->enableRead();
 }
 
 void TcpServer::setConnectionCallback(TcpConnectionCallback &&cb) noexcept {
-    mConnectionCb = std::move(cb);
+    mCallbacks.mConnectionCb = std::move(cb);
 }
 
 void TcpServer::setMessageCallback(TcpMessageCallback &&cb) noexcept {
-    mMessageCb = std::move(cb);
+    mCallbacks.mMessageCb = std::move(cb);
 }
 
 void TcpServer::setWriteCompleteCallback(TcpWriteCompleteCallback &&cb) noexcept {
-    mWriteCompleteCb = std::move(cb);
+    mCallbacks.mWriteCompleteCb = std::move(cb);
 }
 
 void TcpServer::setHighWaterMarkCallback(TcpHighWaterMarkCallback &&cb) noexcept {
-    mHighWaterMarkCb = std::move(cb);
+    mCallbacks.mHighWaterMarkCb = std::move(cb);
 }
 
-// Callback for Channel::handleEvent(), so it is run in loop thread.
-void TcpServer::createNewConnection() {
-    LOG_INFO("{}", __FUNCTION__);
-    getLoop()->assertInLoopThread();
-    if (mEventLoopPool.getLoopNums() == 0) {
-        createNewConnectionInSubLoop(mpEventLoop);
-    } else {
-        // Get a loop from loop pool and create new connection in new loop.
-        auto newLoop = mEventLoopPool.acquireLoop();
-        // Execute task asynchronously and wait for it to complete.
-        // Because listen fd is available now, no need to use queueInLoop to delay the task.
-        newLoop->runInLoop([this, newLoop] {
-            createNewConnectionInSubLoop(newLoop);
+void TcpServer::setDrainCallback(TcpDrainCallback &&cb) noexcept {
+    mCallbacks.mDrainCb = std::move(cb);
+}
+
+void TcpServer::forEachConnection(TcpConnectionCallback&& cb) {
+    auto sharedCb = std::make_shared<const TcpConnectionCallback>(std::move(cb));
+    for (auto& [loop, shard] : mConnectionShards) {
+        loop->queueInLoop([sharedCb, &shard] {
+            // Closed connections are erased by pending tasks, so the shard is stable in this loop.
+            for (const auto& conn : shard.mConnections) {
+                (*sharedCb)(conn);
+            }
         });
     }
 }
 
-void TcpServer::createNewConnectionInSubLoop(EventLoop* newLoop) {
-    LOG_INFO("{}: E", __FUNCTION__);
-    newLoop->assertInLoopThread();
-    mpEventLoop->assertInLoopThread();
+void TcpServer::broadcast(std::string_view message) {
+    broadcast(SharedBuffer::copyFrom(message));
+}
+
+TcpThrottleStats TcpServer::getThrottleStats() const noexcept {
+    return mpRateLimiter ? mpRateLimiter->getStats() : TcpThrottleStats {};
+}
+
+void TcpServer::broadcast(SharedBuffer message) {
+    forEachConnection([message = std::move(message)] (const TcpConnectionPtr& conn) {
+        if (conn->isConnected()) {
+            conn->send(message);
+        }
+    });
+}
+
+TcpServer::ConnectionShard& TcpServer::getShard(EventLoop* loop) {
+    auto iter = mConnectionShards.find(loop);
+    assertTrue(iter != mConnectionShards.end(), "[TcpServer] loop has no connection shard!");
+    return iter->second;
+}
+
+// Callback for Channel::handleEvent(), so it is run in loop thread.
+void TcpServer::createNewConnection() {
+    LOG_INFO("{}", __FUNCTION__);
+    getLoop()->assertInLoopThread();
     SocketPtr clientSocket;
     try {
         clientSocket = mpListenSocket->accept();
     } catch (const NetworkException& e) {
         LOG_ERR("{}: Ignore exception: {}", __FUNCTION__, e.what());
-        throw;
-    } catch (const std::exception& e) {
-        LOG_ERR("{}: {}", __FUNCTION__, e.what());
-        throw;
+        return ;
     }
-    if (mConnectionSet.size() == MAX_CONNECTION_NUMS) {
-        LOG_ERR("{}: refuse connect because connection set is full.", __FUNCTION__);
+    // Connection counter is only increased in main loop, so the limit would not be exceeded.
+    if (mConnectionNums.fetch_add(1, std::memory_order_relaxed) >= mMaxConnectionNum) {
+        mConnectionNums.fetch_sub(1, std::memory_order_relaxed);
+        LOG_ERR("{}: refuse connect because connection nums reach limit {}.", __FUNCTION__, mMaxConnectionNum);
         // Socket would be close when leave this scope.
         return ;
     }
-    clientSocket->dumpSocketInfo();
-    // Assign a loop for new connection.
-    auto newConn = TcpConnection::createTcpConnection(std::move(clientSocket), newLoop);
-
-    // Copy user callback function to new connection.
-    newConn->setConnectionCallback(mConnectionCb);
-    newConn->setMessageCallback(mMessageCb);
-    newConn->setWriteCompleteCallback(mWriteCompleteCb);
-    newConn->setHighWaterMarkCallback(mHighWaterMarkCb);
-
-    // Must remove connection in loop thread of TcpServer.
-    // EventLoop::poll()
-    //
-    //      => handleEvent()
-    //          => Channel::mCloseCb()
-    //              => TcpConnection::handleClose()
-    //                  => TcpConnection::mCloseCb()
-    //                      => EventLoop::queueInLoop()
-    //      => destroyConnection()
-    //          => ~Channel()
-    //              => EventLoop::removeChannel()
-    //                  => ~Socket()
-    //                      => ~TcpConnection()
-    newConn->setCloseCallback([this] (const TcpConnectionPtr& conn) {
-            // destroy connection in sub loop.
-            auto guard = conn;
-            conn->getLoop()->queueInLoop([guard, this] {
-                guard->destroyConnection();
-                // remove connection.
-                {
-                    std::lock_guard lock { mConnMutex };
-                    mConnectionSet.erase(guard);
-                }
-            });
-    });
-    newConn->establishConnect();
+    auto newLoop = mEventLoopPool.acquireLoop();
+    if (newLoop == mpEventLoop) {
+        createNewConnectionInLoop(newLoop, std::move(clientSocket));
+    } else {
+        // Hand over the socket to sub loop asynchronously, so main loop can accept next client at once.
+        auto socketHolder = std::make_shared<SocketPtr>(std::move(clientSocket));
+        newLoop->queueInLoop([this, newLoop, socketHolder] {
+            createNewConnectionInLoop(newLoop, std::move(*socketHolder));
+        });
+    }
+}
 
-    {
-        std::lock_guard lock { mConnMutex };
-        mConnectionSet.insert(std::move(newConn));
+void TcpServer::createNewConnectionInLoop(EventLoop* newLoop, SocketPtr&& clientSocket) {
+    LOG_INFO("{}: E", __FUNCTION__);
+    newLoop->assertInLoopThread();
+    clientSocket->applyOptions(mSocketOptions);
+    clientSocket->dumpSocketInfo();
+    // Assign a loop for new connection, all connections share the callback table of server.
+    auto newConn = TcpConnection::createTcpConnection(std::move(clientSocket), newLoop, mpSharedCallbacks
+            , mRecvBufferMode);
+    if (mpRateLimiter) {
+        newConn->attachServerRateLimiter(mpRateLimiter);
+    }
+    if (mMaxConnectionSendRate != 0) {
+        newConn->setSendRateLimit(mMaxConnectionSendRate);
     }
+    if (mpTlsContext) {
+        try {
+            newConn->enableTls(mpTlsContext);
+        } catch (const NetworkException& e) {
+            LOG_ERR("{}: Drop connection: {}", __FUNCTION__, e.what());
+            mConnectionNums.fetch_sub(1, std::memory_order_relaxed);
+            return ;
+        }
+    }
+    getShard(newLoop).mConnections.insert(newConn);
+    newConn->establishConnect();
     LOG_INFO("{}: X", __FUNCTION__);
 }
 
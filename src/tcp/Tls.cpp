@@ -0,0 +1,234 @@
+#include "tcp/Tls.h"
+#include "base/Log.h"
+#include "base/Error.h"
+#include <algorithm>
+#include <array>
+#include <cerrno>
+#include <string>
+#include <string_view>
+
+extern "C" {
+#include <unistd.h>
+#include <openssl/err.h>
+#include <openssl/ssl.h>
+}
+
+static constexpr std::string_view TAG = "Tls";
+
+using namespace simpletcp;
+
+namespace simpletcp::tcp {
+
+// Size of the buffer which file is read into, if file is encrypted in user-space.
+static constexpr size_t TLS_FILE_CHUNK_SIZE = 16384;
+
+// Pop the errors of OpenSSL in current thread.
+static std::string popSslErrors() {
+    std::string result;
+    while (auto err = ::ERR_get_error()) {
+        std::array<char, 256> buf {};
+        ::ERR_error_string_n(err, buf.data(), buf.size());
+        if (!result.empty()) {
+            result.append("; ");
+        }
+        result.append(buf.data());
+    }
+    return result.empty() ? "unknown error" : result;
+}
+
+[[noreturn]]
+static void throwSslError(std::string_view message) {
+    throw NetworkException(fmt::format("[Tls] {}: {}", message, popSslErrors()), EPROTO);
+}
+
+static ssl_ctx_st* createContext(const SSL_METHOD* method, const TlsContextArgs& args) {
+    auto context = ::SSL_CTX_new(method);
+    if (context == nullptr) {
+        throwSslError("failed to create SSL_CTX");
+    }
+    ::SSL_CTX_set_min_proto_version(context, TLS1_2_VERSION);
+    // Partial write and moving buffer are required by send queue, the data of a retried write may be
+    // moved or appended.
+    ::SSL_CTX_set_mode(context, SSL_MODE_ENABLE_PARTIAL_WRITE | SSL_MODE_ACCEPT_MOVING_WRITE_BUFFER);
+    if (args.enableKtls) {
+        ::SSL_CTX_set_options(context, SSL_OP_ENABLE_KTLS);
+    }
+    return context;
+}
+
+TlsContextPtr TlsContext::createServerContext(const TlsContextArgs& args) {
+    auto context = createContext(::TLS_server_method(), args);
+    TlsContextPtr result { new TlsContext(context, true) };
+    if (::SSL_CTX_use_certificate_chain_file(context, args.certFile.c_str()) != 1) {
+        throwSslError("failed to load certificate");
+    }
+    if (::SSL_CTX_use_PrivateKey_file(context, args.keyFile.c_str(), SSL_FILETYPE_PEM) != 1) {
+        throwSslError("failed to load private key");
+    }
+    if (::SSL_CTX_check_private_key(context) != 1) {
+        throwSslError("private key doesn't match certificate");
+    }
+    if (args.verifyPeer) {
+        if (!args.caFile.empty() && ::SSL_CTX_load_verify_locations(context, args.caFile.c_str(), nullptr) != 1) {
+            throwSslError("failed to load CA");
+        }
+        ::SSL_CTX_set_verify(context, SSL_VERIFY_PEER | SSL_VERIFY_FAIL_IF_NO_PEER_CERT, nullptr);
+    }
+    LOG_INFO("{}: certificate {}, kTLS {}", __FUNCTION__, args.certFile, args.enableKtls);
+    return result;
+}
+
+TlsContextPtr TlsContext::createClientContext(const TlsContextArgs& args) {
+    auto context = createContext(::TLS_client_method(), args);
+    TlsContextPtr result { new TlsContext(context, false) };
+    if (args.verifyPeer) {
+        auto res = args.caFile.empty() ? ::SSL_CTX_set_default_verify_paths(context)
+                                       : ::SSL_CTX_load_verify_locations(context, args.caFile.c_str(), nullptr);
+        if (res != 1) {
+            throwSslError("failed to load CA");
+        }
+        ::SSL_CTX_set_verify(context, SSL_VERIFY_PEER, nullptr);
+    }
+    if (!args.certFile.empty()) {
+        if (::SSL_CTX_use_certificate_chain_file(context, args.certFile.c_str()) != 1
+                || ::SSL_CTX_use_PrivateKey_file(context, args.keyFile.c_str(), SSL_FILETYPE_PEM) != 1) {
+            throwSslError("failed to load client certificate");
+        }
+    }
+    LOG_INFO("{}: verify peer {}, kTLS {}", __FUNCTION__, args.verifyPeer, args.enableKtls);
+    return result;
+}
+
+TlsContext::~TlsContext() {
+    ::SSL_CTX_free(mpContext);
+}
+
+TlsSessionPtr TlsSession::createTlsSession(const TlsContextPtr& context, int fd, std::string_view serverName) {
+    auto ssl = ::SSL_new(context->get());
+    if (ssl == nullptr) {
+        throwSslError("failed to create SSL");
+    }
+    TlsSessionPtr result { new TlsSession(ssl) };
+    // Socket BIO is required by kTLS, OpenSSL reads and writes the socket directly.
+    if (::SSL_set_fd(ssl, fd) != 1) {
+        throwSslError("failed to set fd");
+    }
+    if (context->isServer()) {
+        ::SSL_set_accept_state(ssl);
+    } else {
+        if (!serverName.empty()) {
+            std::string name { serverName };
+            ::SSL_ctrl(ssl, SSL_CTRL_SET_TLSEXT_HOSTNAME, TLSEXT_NAMETYPE_host_name, name.data());
+            ::SSL_set1_host(ssl, name.c_str());
+        }
+        ::SSL_set_connect_state(ssl);
+    }
+    return result;
+}
+
+TlsSession::~TlsSession() {
+    ::SSL_free(mpSsl);
+}
+
+TlsHandshakeState TlsSession::handshake() noexcept {
+    ::ERR_clear_error();
+    auto res = ::SSL_do_handshake(mpSsl);
+    if (res == 1) {
+        LOG_INFO("{}: done, {} {}, kTLS send {}, kTLS recv {}", __FUNCTION__, getVersion(), getCipher()
+                , isKtlsSend(), isKtlsRecv());
+        return TlsHandshakeState::Done;
+    }
+    switch (::SSL_get_error(mpSsl, res)) {
+        case SSL_ERROR_WANT_READ: return TlsHandshakeState::WantRead;
+        case SSL_ERROR_WANT_WRITE: return TlsHandshakeState::WantWrite;
+        default:
+            LOG_ERR("{}: failed, {}", __FUNCTION__, popSslErrors());
+            return TlsHandshakeState::Failed;
+    }
+}
+
+// Translate the result of SSL_* to the convention of read/write.
+static ssize_t translateResult(ssl_st* ssl, int res, size_t bytes, std::string_view operation) {
+    if (res == 1) {
+        return static_cast<ssize_t>(bytes);
+    }
+    switch (::SSL_get_error(ssl, res)) {
+        case SSL_ERROR_WANT_READ:
+        case SSL_ERROR_WANT_WRITE:
+            errno = EAGAIN;
+            return -1;
+        case SSL_ERROR_ZERO_RETURN:
+            // close_notify is received.
+            return 0;
+        case SSL_ERROR_SYSCALL:
+            // errno is set by the failed system call, or the peer closes socket without close_notify.
+            if (errno == 0) {
+                return 0;
+            }
+            return -1;
+        default:
+            LOG_ERR("{}: {} failed, {}", __FUNCTION__, operation, popSslErrors());
+            errno = EPROTO;
+            return -1;
+    }
+}
+
+ssize_t TlsSession::read(void* data, size_t len) noexcept {
+    ::ERR_clear_error();
+    errno = 0;
+    size_t bytes = 0;
+    auto res = ::SSL_read_ex(mpSsl, data, len, &bytes);
+    return translateResult(mpSsl, res, bytes, "SSL_read");
+}
+
+ssize_t TlsSession::write(const void* data, size_t len) noexcept {
+    ::ERR_clear_error();
+    errno = 0;
+    size_t bytes = 0;
+    auto res = ::SSL_write_ex(mpSsl, data, len, &bytes);
+    auto result = translateResult(mpSsl, res, bytes, "SSL_write");
+    mPendingWrite = result < 0 && errno == EAGAIN ? std::max(mPendingWrite, len) : 0;
+    return result;
+}
+
+ssize_t TlsSession::sendFile(int fd, off_t offset, size_t len) noexcept {
+    // The chunk is encrypted before SSL_write returns, so it can be shared by all sessions of thread.
+    thread_local std::array<uint8_t, TLS_FILE_CHUNK_SIZE> tChunk;
+    auto res = ::pread(fd, tChunk.data(), std::min(len, tChunk.size()), offset);
+    if (res <= 0) {
+        // The file is shorter than expected.
+        errno = res == 0 ? EIO : errno;
+        return -1;
+    }
+    return write(tChunk.data(), static_cast<size_t>(res));
+}
+
+void TlsSession::shutdown() noexcept {
+    ::ERR_clear_error();
+    // Don't wait for the close_notify of peer.
+    if (::SSL_shutdown(mpSsl) < 0) {
+        LOG_WARN("{}: {}", __FUNCTION__, popSslErrors());
+    }
+}
+
+bool TlsSession::hasPending() const noexcept {
+    return ::SSL_pending(mpSsl) > 0;
+}
+
+bool TlsSession::isKtlsSend() const noexcept {
+    return ::BIO_ctrl(::SSL_get_wbio(mpSsl), BIO_CTRL_GET_KTLS_SEND, 0, nullptr) > 0;
+}
+
+bool TlsSession::isKtlsRecv() const noexcept {
+    return ::BIO_ctrl(::SSL_get_rbio(mpSsl), BIO_CTRL_GET_KTLS_RECV, 0, nullptr) > 0;
+}
+
+std::string_view TlsSession::getVersion() const noexcept {
+    return ::SSL_get_version(mpSsl);
+}
+
+std::string_view TlsSession::getCipher() const noexcept {
+    return ::SSL_CIPHER_get_name(::SSL_get_current_cipher(mpSsl));
+}
+
+} // namespace simpletcp::tcp
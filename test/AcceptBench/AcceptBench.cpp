@@ -0,0 +1,96 @@
+#include "base/Log.h"
+#include "net/EventLoop.h"
+#include "tcp/TcpServer.h"
+#include "TestUtils.h"
+#include <chrono>
+#include <future>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <thread>
+
+extern "C" {
+#include <unistd.h>
+#include <arpa/inet.h>
+#include <sys/resource.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+}
+
+static constexpr std::string_view TAG = "AcceptBench";
+
+using namespace simpletcp;
+using namespace simpletcp::net;
+using namespace simpletcp::tcp;
+using namespace simpletcp::test;
+using namespace std::chrono;
+
+// Client connects and closes repeatedly, server accepts every connection and formats its identification
+// as a server usually does for logging. Measure the CPU time of server loop per connection.
+
+static constexpr uint16_t SERVER_PORT = 8888;
+static constexpr size_t CONNECTION_NUMS = 20'000;
+
+static microseconds getThreadCpuTime() {
+    rusage usage {};
+    ::getrusage(RUSAGE_THREAD, &usage);
+    return seconds(usage.ru_utime.tv_sec + usage.ru_stime.tv_sec)
+        + microseconds(usage.ru_utime.tv_usec + usage.ru_stime.tv_usec);
+}
+
+static bool connectAndClose() {
+    int fd = connectServer({ "127.0.0.1", IP_PROTOCOL::IPv4, SERVER_PORT });
+    if (fd < 0) {
+        return false;
+    }
+    ::close(fd);
+    return true;
+}
+
+int main() {
+    std::promise<microseconds> cpuPromise;
+    std::promise<EventLoop*> loopPromise;
+    size_t idBytes = 0;
+    std::thread serverThread([&] {
+        EventLoop loop;
+        TcpServer server({ &loop, { "127.0.0.1", IP_PROTOCOL::IPv4, SERVER_PORT }, 1024 });
+        size_t accepted = 0;
+        microseconds start {};
+        server.setConnectionCallback([&] (const TcpConnectionPtr& conn) {
+            if (!conn->isConnected()) {
+                return;
+            }
+            if (accepted == 0) {
+                start = getThreadCpuTime();
+            }
+            idBytes += conn->getIdString().size();
+            if (++accepted == CONNECTION_NUMS) {
+                cpuPromise.set_value(getThreadCpuTime() - start);
+            }
+        });
+        server.start();
+        loopPromise.set_value(&loop);
+        loop.startLoop();
+    });
+    auto loop = loopPromise.get_future().get();
+
+    auto start = steady_clock::now();
+    bool ok = true;
+    for (size_t i = 0; i != CONNECTION_NUMS && ok; ++i) {
+        ok = connectAndClose();
+    }
+    auto cpuFuture = cpuPromise.get_future();
+    ok = ok && cpuFuture.wait_for(seconds(30)) == std::future_status::ready;
+    auto cost = duration_cast<milliseconds>(steady_clock::now() - start);
+    auto cpu = ok ? cpuFuture.get() : microseconds {};
+    loop->queueInLoop([loop] {
+        loop->quitLoop();
+    });
+    serverThread.join();
+
+    std::cout << std::fixed << std::setprecision(2) << "[AcceptBench] connections: " << CONNECTION_NUMS
+        << " wall: " << cost.count() << "ms server cpu: " << cpu.count() / 1000 << "ms"
+        << " per connection: " << static_cast<double>(cpu.count()) / CONNECTION_NUMS << "us"
+        << " id bytes: " << idBytes << (ok ? " success" : " FAIL") << std::endl;
+    return ok ? 0 : 1;
+}
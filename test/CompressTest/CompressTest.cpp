@@ -1,10 +1,95 @@
 #include "base/Log.h"
 #include "base/Compress.h"
 #include <iostream>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <zlib.h>
 
 using namespace simpletcp;
 using namespace simpletcp::utils;
 
+// Inflate the sync-flushed prefix of stream, it must be decodable before the stream is finished.
+static std::string inflatePrefix(std::string_view source, bool isGzip) {
+    z_stream stream {};
+    if (inflateInit2(&stream, isGzip ? 15 | 16 : 15) != Z_OK) {
+        throw std::runtime_error("inflateInit failed");
+    }
+    std::string output;
+    char buffer[4096];
+    stream.next_in = reinterpret_cast<Bytef *>(const_cast<char *>(source.data()));
+    stream.avail_in = static_cast<uInt>(source.size());
+    int res = Z_OK;
+    do {
+        stream.next_out = reinterpret_cast<Bytef *>(buffer);
+        stream.avail_out = sizeof(buffer);
+        res = inflate(&stream, Z_SYNC_FLUSH);
+        output.append(buffer, sizeof(buffer) - stream.avail_out);
+    } while (res == Z_OK && stream.avail_in != 0);
+    inflateEnd(&stream);
+    if (res != Z_OK && res != Z_STREAM_END && res != Z_BUF_ERROR) {
+        throw std::runtime_error("inflate failed");
+    }
+    return output;
+}
+
+static bool testIncompressible() {
+    std::mt19937 engine { 42 };
+    std::string random(64 * 1024, '\0');
+    for (auto& c : random) {
+        c = static_cast<char>(engine());
+    }
+    bool ok = true;
+    for (std::string_view input : { std::string_view { random }, std::string_view { "a" }, std::string_view {} }) {
+        ok = ok && uncompress_gzip(compress_gzip(input), input.size()) == input;
+        ok = ok && uncompress_deflate(compress_deflate(input), input.size()) == input;
+    }
+    if (ok) {
+        std::cout << "[CompressTest] test incompressible and tiny data success" << std::endl;
+    }
+    return ok;
+}
+
+static bool testStream(CompressFormat format) {
+    bool isGzip = format == CompressFormat::Gzip;
+    std::string input;
+    std::string output;
+    bool ok = true;
+    {
+        StreamCompressor compressor { format };
+        for (size_t i = 0; i != 64; ++i) {
+            auto chunk = std::string(i * 37 % 500, static_cast<char>('a' + i % 26)).append(std::to_string(i));
+            input.append(chunk);
+            output.append(compressor.compress(chunk));
+            // Every flushed prefix is decoded entirely.
+            ok = ok && inflatePrefix(output, isGzip) == input;
+        }
+        ok = ok && compressor.compress({}).empty();
+        output.append(compressor.finish());
+    }
+    ok = ok && (isGzip ? uncompress_gzip(output, input.size()) : uncompress_deflate(output, input.size())) == input;
+
+    // The state is reset and reused by the next stream, the output is the same.
+    std::string again;
+    {
+        StreamCompressor compressor { format };
+        again.append(compressor.compress(input));
+        again.append(compressor.finish());
+    }
+    std::string fresh;
+    {
+        StreamCompressor first { format };
+        StreamCompressor second { format };
+        fresh.append(second.compress(input));
+        fresh.append(second.finish());
+    }
+    ok = ok && again == fresh && inflatePrefix(again, isGzip) == input;
+    if (ok) {
+        std::cout << "[CompressTest] test " << (isGzip ? "gzip" : "deflate") << " stream success" << std::endl;
+    }
+    return ok;
+}
+
 int main() {
     std::string input {
         "hello hello hello hello hello"\
@@ -35,4 +120,9 @@ int main() {
     if (input.size() == output.size()) {
         std::cout << "[CompressTest] test deflate success" << std::endl;
     }
+
+    bool ok = testIncompressible();
+    ok = testStream(CompressFormat::Gzip) && ok;
+    ok = testStream(CompressFormat::Deflate) && ok;
+    return ok ? 0 : 1;
 }
@@ -0,0 +1,110 @@
+#include "base/Log.h"
+#include "net/EventLoop.h"
+#include "tcp/TcpServer.h"
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <thread>
+#include <vector>
+
+extern "C" {
+#include <unistd.h>
+#include <arpa/inet.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+}
+
+static constexpr std::string_view TAG = "ConnShardTest";
+
+using namespace simpletcp;
+using namespace simpletcp::net;
+using namespace simpletcp::tcp;
+using namespace std::chrono_literals;
+
+// Check the connection limit of TcpServer and the broadcast through connection shards.
+// Usage: ConnShardTest [max connection nums]
+
+static constexpr uint16_t SERVER_PORT = 8851;
+static constexpr int EXTRA_CONNECTIONS = 50;
+static constexpr std::string_view BROADCAST_MESSAGE = "broadcast";
+
+static bool waitFor(const TcpServer& server, size_t expectNums) {
+    for (int i = 0; i != 500; ++i) {
+        if (server.getConnectionNums() == expectNums) {
+            return true;
+        }
+        std::this_thread::sleep_for(10ms);
+    }
+    return false;
+}
+
+int main(int argc, char** argv) {
+    size_t maxConnNums = 1000;
+    if (argc > 1) {
+        maxConnNums = static_cast<size_t>(std::atol(argv[1]));
+    }
+    EventLoop loop;
+    TcpServer server({ &loop, { "127.0.0.1", IP_PROTOCOL::IPv4, SERVER_PORT }, 1024, 2, maxConnNums });
+    server.start();
+
+    int result = 0;
+    std::thread clients([&] {
+        sockaddr_in addr {};
+        addr.sin_family = AF_INET;
+        addr.sin_port = htons(SERVER_PORT);
+        ::inet_pton(AF_INET, "127.0.0.1", &addr.sin_addr);
+        std::vector<int> clientFds;
+        for (size_t i = 0; i != maxConnNums + EXTRA_CONNECTIONS; ++i) {
+            int fd = ::socket(AF_INET, SOCK_STREAM, 0);
+            if (::connect(fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) < 0) {
+                std::cerr << "[ConnShardTest] connect failed." << std::endl;
+                std::exit(1);
+            }
+            timeval timeout { .tv_sec = 2, .tv_usec = 0 };
+            ::setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+            clientFds.push_back(fd);
+        }
+        if (!waitFor(server, maxConnNums)) {
+            std::cerr << "[ConnShardTest] connection limit is not enforced, nums: "
+                << server.getConnectionNums() << std::endl;
+            result = 1;
+        }
+
+        server.broadcast(BROADCAST_MESSAGE);
+        size_t received = 0;
+        size_t refused = 0;
+        for (auto fd : clientFds) {
+            char buf[64];
+            auto len = ::recv(fd, buf, sizeof(buf), 0);
+            if (len == static_cast<ssize_t>(BROADCAST_MESSAGE.size())
+                    && std::string_view(buf, BROADCAST_MESSAGE.size()) == BROADCAST_MESSAGE) {
+                ++received;
+            } else if (len == 0) {
+                ++refused;
+            }
+        }
+        std::cout << "[ConnShardTest] received: " << received << ", refused: " << refused << std::endl;
+        if (received != maxConnNums || refused != EXTRA_CONNECTIONS) {
+            std::cerr << "[ConnShardTest] broadcast failed!" << std::endl;
+            result = 1;
+        }
+
+        for (auto fd : clientFds) {
+            ::close(fd);
+        }
+        if (!waitFor(server, 0)) {
+            std::cerr << "[ConnShardTest] connections are not released, nums: "
+                << server.getConnectionNums() << std::endl;
+            result = 1;
+        }
+        loop.queueInLoop([&loop] {
+            loop.quitLoop();
+        });
+    });
+    loop.startLoop();
+    clients.join();
+    if (result == 0) {
+        std::cout << "[ConnShardTest] success" << std::endl;
+    }
+    return result;
+}
@@ -0,0 +1,178 @@
+#include "base/Log.h"
+#include "net/EventLoop.h"
+#include "tcp/SharedBuffer.h"
+#include "tcp/TcpServer.h"
+#include "TestUtils.h"
+#include <cerrno>
+#include <chrono>
+#include <cstring>
+#include <future>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+extern "C" {
+#include <unistd.h>
+#include <arpa/inet.h>
+#include <sys/epoll.h>
+#include <sys/socket.h>
+#include <sys/wait.h>
+#include <netinet/in.h>
+}
+
+static constexpr std::string_view TAG = "FanoutBench";
+
+using namespace simpletcp;
+using namespace simpletcp::net;
+using namespace simpletcp::tcp;
+using namespace simpletcp::test;
+using namespace std::chrono;
+
+// Fan-out of the same message to 10k subscribers.
+//  copy: every subscriber gets its own copy of message.
+//  shared: all subscribers refer to one SharedBuffer, the data is written by writev from the shared block.
+// The subscribers run in a child process, so the fds of both sides don't exceed the limit of one process.
+
+static constexpr uint16_t SERVER_PORT = 8883;
+static constexpr int SUBSCRIBER_NUMS = 10'000;
+static constexpr int ROUNDS = 4;
+static constexpr size_t MESSAGE_SIZE = 8192;
+static constexpr size_t PHASE_BYTES = static_cast<size_t>(SUBSCRIBER_NUMS) * ROUNDS * MESSAGE_SIZE;
+
+enum class SendMode {
+    Copy,
+    Shared,
+};
+
+// Retry until server is listening.
+static int connectFanoutServer() {
+    while (true) {
+        int fd = connectServer({ "127.0.0.1", IP_PROTOCOL::IPv4, SERVER_PORT });
+        if (fd >= 0 || errno != ECONNREFUSED) {
+            return fd;
+        }
+        std::this_thread::sleep_for(milliseconds(10));
+    }
+}
+
+// Child process: connect all subscribers and drain them, notify parent after each phase.
+static int runSubscribers(int notifyFd) {
+    std::vector<int> fds;
+    fds.reserve(SUBSCRIBER_NUMS);
+    int epollFd = ::epoll_create1(0);
+    for (int i = 0; i != SUBSCRIBER_NUMS; ++i) {
+        int fd = connectFanoutServer();
+        if (fd < 0) {
+            std::cerr << "[FanoutBench] connect failed: " << strerror(errno) << std::endl;
+            return 1;
+        }
+        epoll_event event {};
+        event.events = EPOLLIN;
+        event.data.fd = fd;
+        ::epoll_ctl(epollFd, EPOLL_CTL_ADD, fd, &event);
+        fds.push_back(fd);
+    }
+    std::vector<epoll_event> events(1024);
+    std::vector<char> buf(65536);
+    for (int phase = 0; phase != 2; ++phase) {
+        size_t received = 0;
+        while (received < PHASE_BYTES) {
+            int nums = ::epoll_wait(epollFd, events.data(), static_cast<int>(events.size()), -1);
+            for (int i = 0; i < nums; ++i) {
+                auto len = ::read(events[static_cast<size_t>(i)].data.fd, buf.data(), buf.size());
+                if (len <= 0) {
+                    std::cerr << "[FanoutBench] read failed." << std::endl;
+                    return 1;
+                }
+                received += static_cast<size_t>(len);
+            }
+        }
+        char done = 'd';
+        if (::write(notifyFd, &done, 1) != 1) {
+            return 1;
+        }
+    }
+    for (auto fd : fds) {
+        ::close(fd);
+    }
+    ::close(epollFd);
+    return 0;
+}
+
+int main() {
+    int notifyFds[2];
+    if (::pipe(notifyFds) < 0) {
+        std::cerr << "[FanoutBench] pipe failed." << std::endl;
+        return 1;
+    }
+    // Fork before any thread is created.
+    auto pid = ::fork();
+    if (pid == 0) {
+        ::close(notifyFds[0]);
+        ::_exit(runSubscribers(notifyFds[1]));
+    }
+    ::close(notifyFds[1]);
+
+    std::vector<TcpConnectionPtr> subscribers;
+    std::promise<EventLoop*> loopPromise;
+    std::thread serverThread([&] {
+        EventLoop loop;
+        TcpServer server({ &loop, { "127.0.0.1", IP_PROTOCOL::IPv4, SERVER_PORT }, 4096 });
+        server.setConnectionCallback([&] (const TcpConnectionPtr& conn) {
+            if (conn->isConnected()) {
+                subscribers.push_back(conn);
+            }
+        });
+        server.start();
+        loopPromise.set_value(&loop);
+        loop.startLoop();
+    });
+    auto loop = loopPromise.get_future().get();
+
+    size_t connected = 0;
+    while (connected != SUBSCRIBER_NUMS) {
+        std::this_thread::sleep_for(milliseconds(50));
+        loop->runInLoop([&] { connected = subscribers.size(); });
+    }
+    std::cout << "[FanoutBench] subscribers: " << SUBSCRIBER_NUMS << " rounds: " << ROUNDS
+        << " message size: " << MESSAGE_SIZE << std::endl;
+
+    std::string message(MESSAGE_SIZE, 'x');
+    for (auto mode : { SendMode::Copy, SendMode::Shared }) {
+        auto start = steady_clock::now();
+        microseconds sendCost {};
+        loop->runInLoop([&] {
+            for (int round = 0; round != ROUNDS; ++round) {
+                if (mode == SendMode::Copy) {
+                    for (const auto& conn : subscribers) {
+                        conn->send(TcpConnection::buffer_type { message.begin(), message.end() });
+                    }
+                } else {
+                    auto shared = SharedBuffer::copyFrom(message);
+                    for (const auto& conn : subscribers) {
+                        conn->send(shared);
+                    }
+                }
+            }
+            sendCost = duration_cast<microseconds>(steady_clock::now() - start);
+        });
+        char done;
+        if (::read(notifyFds[0], &done, 1) != 1) {
+            std::cerr << "[FanoutBench] subscribers failed." << std::endl;
+            return 1;
+        }
+        auto cost = duration_cast<microseconds>(steady_clock::now() - start);
+        std::cout << "[FanoutBench] " << (mode == SendMode::Shared ? "shared" : "copy  ")
+            << " send cost: " << sendCost.count() << "us total cost: " << cost.count() << "us" << std::endl;
+    }
+
+    int status = 0;
+    ::waitpid(pid, &status, 0);
+    loop->runInLoop([&] { subscribers.clear(); });
+    loop->queueInLoop([loop] {
+        loop->quitLoop();
+    });
+    serverThread.join();
+    return WIFEXITED(status) && WEXITSTATUS(status) == 0 ? 0 : 1;
+}
@@ -0,0 +1,121 @@
+#include "base/Log.h"
+#include "net/EventLoop.h"
+#include "tcp/TcpServer.h"
+#include <chrono>
+#include <fstream>
+#include <future>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <thread>
+
+extern "C" {
+#include <unistd.h>
+#include <arpa/inet.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+}
+
+static constexpr std::string_view TAG = "FastOpenBench";
+
+using namespace simpletcp;
+using namespace simpletcp::net;
+using namespace simpletcp::tcp;
+using namespace std::chrono;
+
+// Latency of short connections on loopback: connect + 64 bytes request + 64 bytes response + close.
+// Server side TFO needs bit 0x2 of net.ipv4.tcp_fastopen, otherwise kernel falls back to normal
+// handshake and both cases should be similar.
+
+static constexpr uint16_t SERVER_PORT = 8880;
+static constexpr int FAST_OPEN_QUEUE_LEN = 1024;
+static constexpr int CONNECT_TIMES = 2000;
+static constexpr size_t REQUEST_SIZE = 64;
+
+struct BenchResult {
+    double  mLatency;       // Average latency in microseconds.
+    int     mSynDataNums;   // Number of connections whose data is acked with SYN.
+};
+
+static BenchResult benchShortConnection(bool fastOpen) {
+    sockaddr_in addr {};
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(SERVER_PORT);
+    ::inet_pton(AF_INET, "127.0.0.1", &addr.sin_addr);
+
+    char buf[REQUEST_SIZE] {};
+    int synDataNums = 0;
+    auto start = steady_clock::now();
+    for (int i = 0; i != CONNECT_TIMES; ++i) {
+        int fd = ::socket(AF_INET, SOCK_STREAM, 0);
+        int flag = 1;
+        ::setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &flag, sizeof(flag));
+        if (fastOpen) {
+            // connect returns at once if cookie is cached, and the first write is sent with SYN.
+            ::setsockopt(fd, IPPROTO_TCP, TCP_FASTOPEN_CONNECT, &flag, sizeof(flag));
+        }
+        if (::connect(fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) < 0) {
+            std::cerr << "[FastOpenBench] connect failed." << std::endl;
+            std::exit(1);
+        }
+        if (::write(fd, buf, sizeof(buf)) != static_cast<ssize_t>(sizeof(buf))) {
+            std::cerr << "[FastOpenBench] write failed." << std::endl;
+            std::exit(1);
+        }
+        size_t readSize = 0;
+        while (readSize < sizeof(buf)) {
+            auto len = ::read(fd, buf + readSize, sizeof(buf) - readSize);
+            if (len <= 0) {
+                std::cerr << "[FastOpenBench] read failed." << std::endl;
+                std::exit(1);
+            }
+            readSize += static_cast<size_t>(len);
+        }
+        tcp_info info {};
+        socklen_t len = sizeof(info);
+        if (::getsockopt(fd, IPPROTO_TCP, TCP_INFO, &info, &len) == 0 && (info.tcpi_options & TCPI_OPT_SYN_DATA)) {
+            ++synDataNums;
+        }
+        ::close(fd);
+    }
+    auto cost = duration_cast<nanoseconds>(steady_clock::now() - start).count();
+    return { static_cast<double>(cost) / CONNECT_TIMES / 1000, synDataNums };
+}
+
+int main() {
+    std::string sysctl;
+    std::ifstream("/proc/sys/net/ipv4/tcp_fastopen") >> sysctl;
+    std::cout << "[FastOpenBench] net.ipv4.tcp_fastopen = " << sysctl << std::endl;
+
+    std::promise<EventLoop*> loopPromise;
+    std::thread serverThread([&] {
+        EventLoop loop;
+        SocketOptions options {};
+        options.mNoDelay = true;
+        options.mFastOpen = FAST_OPEN_QUEUE_LEN;
+        TcpServer server({ &loop, { "127.0.0.1", IP_PROTOCOL::IPv4, SERVER_PORT }, 1024, 0
+                , TCP_DEFAULT_MAX_CONNECTION_NUM, options });
+        server.setMessageCallback([] (const TcpConnectionPtr& conn) {
+            conn->send(conn->extractAll());
+        });
+        server.start();
+        loopPromise.set_value(&loop);
+        loop.startLoop();
+    });
+    auto loop = loopPromise.get_future().get();
+
+    for (bool fastOpen : { false, true }) {
+        auto result = benchShortConnection(fastOpen);
+        std::cout << "[FastOpenBench] " << (fastOpen ? "TFO    " : "no TFO ")
+            << std::fixed << std::setprecision(2)
+            << " connections: " << CONNECT_TIMES
+            << " latency: " << result.mLatency << " us"
+            << " SYN data acked: " << result.mSynDataNums << std::endl;
+    }
+
+    loop->queueInLoop([loop] {
+        loop->quitLoop();
+    });
+    serverThread.join();
+}
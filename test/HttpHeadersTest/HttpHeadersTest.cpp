@@ -0,0 +1,146 @@
+#include "http/HttpHeaders.h"
+#include "TestUtils.h"
+#include <cctype>
+#include <chrono>
+#include <cstddef>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+static constexpr std::string_view TAG = "HttpHeadersTest";
+
+using namespace simpletcp::http;
+using namespace simpletcp::test;
+using namespace std::chrono;
+
+static bool testHeaderId() {
+    bool ok = true;
+    for (size_t id = 1; id != HEADER_NAMES.size(); ++id) {
+        std::string upper { HEADER_NAMES[id] };
+        std::string lower { HEADER_NAMES[id] };
+        for (auto& c : upper) {
+            c = static_cast<char>(std::toupper(c));
+        }
+        for (auto& c : lower) {
+            c = static_cast<char>(std::tolower(c));
+        }
+        ok = expect(TAG, toHeaderId(HEADER_NAMES[id]) == static_cast<HeaderId>(id), HEADER_NAMES[id]) && ok;
+        ok = expect(TAG, toHeaderId(upper) == static_cast<HeaderId>(id), upper) && ok;
+        ok = expect(TAG, toHeaderId(lower) == static_cast<HeaderId>(id), lower) && ok;
+    }
+    for (std::string_view name : { "", "X", "Hosts", "Connections", "Content-Lengt", "X-Custom-Header" }) {
+        ok = expect(TAG, toHeaderId(name) == HeaderId::Unknown, name) && ok;
+    }
+    static_assert(toHeaderId("content-length") == HeaderId::ContentLength);
+    return ok;
+}
+
+static bool testContainer() {
+    bool ok = true;
+    HttpHeaders headers;
+    headers.add("Host", "localhost");
+    headers.add("X-Trace-Id", "1");
+    headers.add("accept", "*/*");
+    ok = expect(TAG, headers.get(HeaderId::Host) == "localhost", "get by id") && ok;
+    ok = expect(TAG, headers.get("HOST") == "localhost", "get by name") && ok;
+    ok = expect(TAG, headers.get("x-trace-id") == "1", "get unknown by name") && ok;
+    ok = expect(TAG, headers.find(HeaderId::Connection) == nullptr, "find missing") && ok;
+    ok = expect(TAG, !headers.contains("Connections"), "misspelled name") && ok;
+
+    // Values are copied, the source may be destroyed.
+    {
+        std::string value { "keep-alive" };
+        headers.setCopy(HeaderId::Connection, value);
+        std::string name { "X-Trace-Id" };
+        headers.setCopy(name, "2");
+    }
+    ok = expect(TAG, headers.get("connection") == "keep-alive", "setCopy") && ok;
+    ok = expect(TAG, headers.get("X-TRACE-ID") == "2" && headers.size() == 4, "setCopy replaces") && ok;
+
+    // Views of arena are stable when it grows.
+    std::string large(4096, 'x');
+    std::vector<std::string> values;
+    for (size_t i = 0; i != 200; ++i) {
+        values.push_back("value-" + std::to_string(i));
+        headers.setCopy("X-Header-" + std::to_string(i), values.back());
+    }
+    headers.setCopy("X-Large", large);
+    bool stable = true;
+    for (size_t i = 0; i != 200; ++i) {
+        stable = headers.get("x-header-" + std::to_string(i)) == values[i] && stable;
+    }
+    ok = expect(TAG, stable && headers.get("X-Large") == large, "arena") && ok;
+
+    // Order of adding is kept.
+    std::vector<std::string_view> names;
+    for (auto& field : headers) {
+        names.push_back(field.mName);
+    }
+    ok = expect(TAG, names[0] == "Host" && names[1] == "X-Trace-Id" && names[3] == "Connection", "order") && ok;
+
+    // The copy owns its values.
+    HttpHeaders copy;
+    {
+        HttpHeaders temp;
+        temp.setCopy("X-Temp", "temp");
+        copy = temp;
+    }
+    ok = expect(TAG, copy.get("x-temp") == "temp", "copy") && ok;
+
+    headers.remove(HeaderId::Host);
+    headers.remove("x-large");
+    ok = expect(TAG, !headers.contains(HeaderId::Host) && !headers.contains("X-Large"), "remove") && ok;
+    headers.clear();
+    ok = expect(TAG, headers.empty(), "clear") && ok;
+    return ok;
+}
+
+// Lookup the headers of a browser request in flat headers and in the map used before.
+static void benchLookup() {
+    constexpr std::string_view names[] = { "Host", "Connection", "User-Agent", "Accept", "Accept-Encoding"
+        , "Accept-Language", "Cookie", "Referer", "Sec-Fetch-Site", "Sec-Fetch-Mode", "Sec-Fetch-Dest" };
+    constexpr std::string_view lookups[] = { "connection", "Content-Length", "Transfer-Encoding", "Host"
+        , "Range", "Accept-Encoding" };
+    constexpr size_t ITERATIONS = 200000;
+    std::string_view value = "value";
+    size_t found = 0;
+
+    auto start = steady_clock::now();
+    for (size_t i = 0; i != ITERATIONS; ++i) {
+        HttpHeaders headers;
+        for (auto name : names) {
+            headers.add(name, value);
+        }
+        for (auto name : lookups) {
+            found += headers.contains(name) ? 1 : 0;
+        }
+    }
+    auto flat = duration_cast<nanoseconds>(steady_clock::now() - start).count();
+
+    start = steady_clock::now();
+    for (size_t i = 0; i != ITERATIONS; ++i) {
+        std::unordered_map<std::string, std::string> headers;
+        for (auto name : names) {
+            headers.insert({ std::string { name }, std::string { value } });
+        }
+        for (auto name : lookups) {
+            found += headers.count(std::string { name });
+        }
+    }
+    auto map = duration_cast<nanoseconds>(steady_clock::now() - start).count();
+
+    std::cout << "[" << TAG << "] build and lookup a request: flat " << std::fixed << std::setprecision(0)
+        << static_cast<double>(flat) / ITERATIONS << " ns, unordered_map " << static_cast<double>(map) / ITERATIONS
+        << " ns (" << found << " found)" << std::endl;
+}
+
+int main() {
+    bool ok = testHeaderId();
+    ok = testContainer() && ok;
+    benchLookup();
+    std::cout << "[" << TAG << "] " << (ok ? "success" : "FAIL") << std::endl;
+    return ok ? 0 : 1;
+}
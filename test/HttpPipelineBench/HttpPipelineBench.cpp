@@ -0,0 +1,185 @@
+#include "http/HttpCommon.h"
+#include "http/HttpRequest.h"
+#include "http/HttpResponse.h"
+#include "http/HttpServer.h"
+#include "net/Socket.h"
+#include "TestUtils.h"
+#include <charconv>
+#include <chrono>
+#include <cstddef>
+#include <future>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+extern "C" {
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/socket.h>
+#include <unistd.h>
+}
+
+static constexpr std::string_view TAG = "HttpPipelineBench";
+
+using namespace simpletcp;
+using namespace simpletcp::http;
+using namespace simpletcp::net;
+using namespace simpletcp::test;
+using namespace std::chrono;
+
+// Clients send requests on keep-alive connections for a while, every round sends depth requests by
+// one write, and then reads depth responses. Server echoes the url in body, so the order of responses
+// is verified by client.
+//  depth 1: a round trip for every request.
+//  depth 16: pipelined requests are handled in one message callback, and responses are flushed together.
+
+static constexpr uint16_t SERVER_PORT = 8891;
+static constexpr size_t CONNECTIONS = 4;
+static constexpr auto RUN_DURATION = 1s;
+
+static void handleRequest(const HttpRequest& request, HttpResponse& response) {
+    response.setVersion(Version::HTTP1_1);
+    response.setStatus(StatusCode::OK);
+    response.setKeepAlive(true);
+    response.setContentType(ContentType::PLAIN);
+    response.setBody(request.mUrl);
+    response.setContentLength(static_cast<int64_t>(request.mUrl.size()));
+}
+
+class Client {
+public:
+    Client()
+        : mFd(connectServer({ "127.0.0.1", IP_PROTOCOL::IPv4, SERVER_PORT }))
+        , mIsConnected(mFd >= 0) {
+        int on = 1;
+        ::setsockopt(mFd, IPPROTO_TCP, TCP_NODELAY, &on, sizeof(on));
+    }
+
+    ~Client() { ::close(mFd); }
+
+    // Send depth requests by one write.
+    bool sendRequests(size_t depth) {
+        mRequests.clear();
+        mExpected.clear();
+        for (size_t i = 0; i != depth; ++i) {
+            std::string url { "r" };
+            url.append(std::to_string(mNextId++));
+            mRequests.append("GET /").append(url).append(" HTTP/1.1\r\nHost: 127.0.0.1\r\nUser-Agent: bench\r\n\r\n");
+            mExpected.push_back(std::move(url));
+        }
+        return mIsConnected && ::send(mFd, mRequests.data(), mRequests.size(), 0)
+            == static_cast<ssize_t>(mRequests.size());
+    }
+
+    // Read responses of last requests, return false if they're wrong or out of order.
+    bool recvResponses() {
+        for (auto& expected : mExpected) {
+            std::string_view body;
+            while (!parseResponse(body)) {
+                char buffer[16 * 1024];
+                auto len = ::recv(mFd, buffer, sizeof(buffer), 0);
+                if (len <= 0) {
+                    return false;
+                }
+                mBuffer.append(buffer, static_cast<size_t>(len));
+            }
+            auto ok = body == expected;
+            mBuffer.erase(0, mResponseSize);
+            if (!ok) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+private:
+    int                         mFd;
+    bool                        mIsConnected;
+    size_t                      mNextId = 0;
+    std::string                 mRequests;
+    std::vector<std::string>    mExpected;
+    std::string                 mBuffer;
+    size_t                      mResponseSize = 0;
+
+    bool parseResponse(std::string_view& body) {
+        std::string_view data { mBuffer };
+        auto headerEnd = data.find("\r\n\r\n");
+        if (headerEnd == std::string_view::npos) {
+            return false;
+        }
+        constexpr std::string_view lengthHeader = "Content-Length: ";
+        auto pos = data.find(lengthHeader);
+        size_t length = 0;
+        if (pos == std::string_view::npos || pos > headerEnd) {
+            return false;
+        }
+        std::from_chars(data.data() + pos + lengthHeader.size(), data.data() + headerEnd, length);
+        if (data.size() < headerEnd + 4 + length) {
+            return false;
+        }
+        body = data.substr(headerEnd + 4, length);
+        mResponseSize = headerEnd + 4 + length;
+        return true;
+    }
+};
+
+// Return requests per second, or 0 if any response is wrong.
+static double runDepth(size_t depth) {
+    std::vector<std::unique_ptr<Client>> clients;
+    for (size_t i = 0; i != CONNECTIONS; ++i) {
+        clients.push_back(std::make_unique<Client>());
+    }
+    size_t requests = 0;
+    auto start = steady_clock::now();
+    while (steady_clock::now() - start < RUN_DURATION) {
+        for (auto& client : clients) {
+            if (!client->sendRequests(depth)) {
+                return 0;
+            }
+        }
+        for (auto& client : clients) {
+            if (!client->recvResponses()) {
+                return 0;
+            }
+        }
+        requests += depth * clients.size();
+    }
+    auto seconds = duration_cast<duration<double>>(steady_clock::now() - start).count();
+    return static_cast<double>(requests) / seconds;
+}
+
+int main() {
+    std::promise<HttpServer*> serverPromise;
+    std::thread serverThread([&serverPromise] {
+        HttpServer server({ .serverAddr = { "127.0.0.1", IP_PROTOCOL::IPv4, SERVER_PORT }
+                , .maxListenQueue = 128, .maxThreadNum = 0 });
+        server.setRequestHandle(handleRequest);
+        // The loop is started by start(), stop() queues the quit to it.
+        serverPromise.set_value(&server);
+        server.start();
+    });
+    auto server = serverPromise.get_future().get();
+    // Wait for listening.
+    std::this_thread::sleep_for(100ms);
+
+    bool ok = true;
+    double baseline = 0;
+    for (size_t depth : { static_cast<size_t>(1), static_cast<size_t>(16) }) {
+        auto rps = runDepth(depth);
+        ok = rps > 0 && ok;
+        baseline = depth == 1 ? rps : baseline;
+        std::cout << "[" << TAG << "] depth " << std::setw(2) << depth << ": " << std::fixed << std::setprecision(0)
+            << std::setw(8) << rps << " requests/s";
+        if (depth != 1 && baseline > 0) {
+            std::cout << ", x" << std::setprecision(1) << rps / baseline;
+        }
+        std::cout << (rps > 0 ? " success" : " FAIL") << std::endl;
+    }
+    server->stop();
+    serverThread.join();
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,219 @@
+#include "http/HttpCommon.h"
+#include "http/HttpRequest.h"
+#include "http/HttpResponse.h"
+#include "http/HttpServer.h"
+#include "TestUtils.h"
+#include <chrono>
+#include <cstddef>
+#include <filesystem>
+#include <fstream>
+#include <future>
+#include <iostream>
+#include <string>
+#include <string_view>
+#include <thread>
+
+extern "C" {
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <unistd.h>
+}
+
+static constexpr std::string_view TAG = "HttpRangeTest";
+
+using namespace simpletcp;
+using namespace simpletcp::http;
+using namespace simpletcp::net;
+using namespace simpletcp::test;
+using namespace std::chrono;
+
+// Request ranges of a file which is sent by sendfile, and check the status, headers and body of response.
+
+static const std::filesystem::path TEST_DIR = std::filesystem::temp_directory_path() / "HttpRangeTest";
+static constexpr uint16_t PORT = 8894;
+static constexpr size_t FILE_SIZE = 10000;
+
+static std::string makeContent() {
+    std::string content;
+    content.reserve(FILE_SIZE);
+    for (size_t i = 0; i != FILE_SIZE; ++i) {
+        content.push_back(static_cast<char>('a' + i % 26));
+    }
+    return content;
+}
+
+static void handleRequest(const HttpRequest& request, HttpResponse& response) {
+    response.setVersion(Version::HTTP1_1);
+    response.setStatus(StatusCode::OK);
+    response.setKeepAlive(false);
+    response.setContentByFilePath(TEST_DIR / request.mUrl);
+    if (request.mUrl == "truncated.txt") {
+        // The file is truncated after its size is sent, the connection is kept alive.
+        response.setKeepAlive(true);
+        std::filesystem::resize_file(TEST_DIR / request.mUrl, FILE_SIZE / 2);
+    }
+}
+
+struct Response {
+    std::string mStatusLine;
+    std::string mHeaders;
+    std::string mBody;
+    // False if the connection is not closed by server in time.
+    bool mIsClosed = false;
+
+    std::string_view header(std::string_view name) const {
+        std::string key = "\r\n";
+        key.append(name).append(": ");
+        auto pos = mHeaders.find(key);
+        if (pos == std::string::npos) {
+            return {};
+        }
+        auto begin = pos + key.size();
+        return std::string_view { mHeaders }.substr(begin, mHeaders.find("\r\n", begin) - begin);
+    }
+};
+
+// Send one request with the extra headers, and read the response until server closes the connection.
+static Response request(std::string_view headers, std::string_view url = "/file.txt") {
+    Response response;
+    auto fd = connectServer({ "127.0.0.1", IP_PROTOCOL::IPv4, PORT });
+    if (fd < 0) {
+        return response;
+    }
+    timeval timeout { .tv_sec = 2, .tv_usec = 0 };
+    ::setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+    std::string data = "GET ";
+    data.append(url).append(" HTTP/1.1\r\nHost: 127.0.0.1\r\n");
+    data.append(headers).append("\r\n");
+    (void)::send(fd, data.data(), data.size(), 0);
+    data.clear();
+    char buffer[16 * 1024];
+    ssize_t len = 0;
+    while ((len = ::recv(fd, buffer, sizeof(buffer), 0)) > 0) {
+        data.append(buffer, static_cast<size_t>(len));
+    }
+    response.mIsClosed = len == 0;
+    ::close(fd);
+    auto lineEnd = data.find("\r\n");
+    auto headerEnd = data.find("\r\n\r\n");
+    if (lineEnd == std::string::npos || headerEnd == std::string::npos) {
+        return response;
+    }
+    response.mStatusLine = data.substr(0, lineEnd);
+    // Keep the CRLF before the first header, so every header is found by "\r\nName: ".
+    response.mHeaders = data.substr(lineEnd, headerEnd + 2 - lineEnd);
+    response.mBody = data.substr(headerEnd + 4);
+    return response;
+}
+
+static bool testRanges(const std::string& content) {
+    bool ok = true;
+    auto full = request("");
+    ok = expect(TAG, full.mStatusLine == "HTTP/1.1 200 OK" && full.mBody == content, "whole file") && ok;
+    ok = expect(TAG, full.header("Accept-Ranges") == "bytes", "accept ranges") && ok;
+
+    auto single = request("Range: bytes=100-199\r\n");
+    ok = expect(TAG, single.mStatusLine == "HTTP/1.1 206 Partial Content", "status of single range") && ok;
+    ok = expect(TAG, single.header("Content-Range") == "bytes 100-199/10000", "content range") && ok;
+    ok = expect(TAG, single.header("Content-Length") == "100" && single.mBody == content.substr(100, 100)
+            , "body of single range") && ok;
+
+    auto suffix = request("Range: bytes=-500\r\n");
+    ok = expect(TAG, suffix.header("Content-Range") == "bytes 9500-9999/10000"
+            && suffix.mBody == content.substr(9500), "suffix range") && ok;
+
+    auto open = request("Range: bytes=9990-\r\n");
+    ok = expect(TAG, open.header("Content-Range") == "bytes 9990-9999/10000" && open.mBody == content.substr(9990)
+            , "open range") && ok;
+
+    auto clamped = request("Range: bytes=9000-20000\r\n");
+    ok = expect(TAG, clamped.header("Content-Range") == "bytes 9000-9999/10000"
+            && clamped.mBody == content.substr(9000), "clamped range") && ok;
+
+    auto unsatisfiable = request("Range: bytes=20000-\r\n");
+    ok = expect(TAG, unsatisfiable.mStatusLine == "HTTP/1.1 416 Range Not Satisfiable"
+            && unsatisfiable.header("Content-Range") == "bytes */10000" && unsatisfiable.mBody.empty()
+            , "unsatisfiable range") && ok;
+
+    // Invalid header and mismatched If-Range are ignored, the whole file is sent.
+    auto invalid = request("Range: bytes=200-100\r\n");
+    ok = expect(TAG, invalid.mStatusLine == "HTTP/1.1 200 OK" && invalid.mBody == content, "invalid range") && ok;
+    auto stale = request("Range: bytes=0-9\r\nIf-Range: \"stale\"\r\n");
+    ok = expect(TAG, stale.mStatusLine == "HTTP/1.1 200 OK" && stale.mBody == content, "stale if-range") && ok;
+    std::string ifRange = "Range: bytes=0-9\r\nIf-Range: ";
+    ifRange.append(full.header("ETag")).append("\r\n");
+    auto fresh = request(ifRange);
+    ok = expect(TAG, fresh.mStatusLine == "HTTP/1.1 206 Partial Content" && fresh.mBody == content.substr(0, 10)
+            , "fresh if-range") && ok;
+    return ok;
+}
+
+static bool testMultipart(const std::string& content) {
+    bool ok = true;
+    // The unsatisfiable range is skipped.
+    auto multi = request("Range: bytes=0-9, 20000-, 5000-5004, -3\r\n");
+    ok = expect(TAG, multi.mStatusLine == "HTTP/1.1 206 Partial Content", "status of multiple ranges") && ok;
+    constexpr std::string_view type = "multipart/byteranges; boundary=";
+    auto contentType = multi.header("Content-Type");
+    if (!expect(TAG, contentType.starts_with(type), "multipart type")) {
+        return false;
+    }
+    std::string boundary { contentType.substr(type.size()) };
+    ok = expect(TAG, multi.header("Content-Length") == std::to_string(multi.mBody.size()), "multipart length") && ok;
+
+    std::string expected;
+    auto appendPart = [&] (size_t first, size_t last) {
+        expected.append("\r\n--").append(boundary).append("\r\nContent-Type: text/plain\r\nContent-Range: bytes ");
+        expected.append(std::to_string(first)).append("-").append(std::to_string(last)).append("/10000\r\n\r\n");
+        expected.append(content.substr(first, last - first + 1));
+    };
+    appendPart(0, 9);
+    appendPart(5000, 5004);
+    appendPart(9997, 9999);
+    expected.append("\r\n--").append(boundary).append("--\r\n");
+    ok = expect(TAG, multi.mBody == expected, "multipart body") && ok;
+    return ok;
+}
+
+static bool testTruncated(const std::string& content) {
+    {
+        std::ofstream file { TEST_DIR / "truncated.txt", std::ios::out | std::ios::binary | std::ios::trunc };
+        file.write(content.data(), static_cast<std::streamsize>(content.size()));
+    }
+    // The range is sent by sendfile, the server closes connection when the file ends early.
+    auto response = request("Range: bytes=0-\r\n", "/truncated.txt");
+    return expect(TAG, response.mStatusLine == "HTTP/1.1 206 Partial Content"
+            && response.mBody.size() < content.size() && response.mIsClosed, "connection is closed if file is truncated");
+}
+
+int main() {
+    std::filesystem::create_directories(TEST_DIR);
+    auto content = makeContent();
+    {
+        std::ofstream file { TEST_DIR / "file.txt", std::ios::out | std::ios::binary | std::ios::trunc };
+        file.write(content.data(), static_cast<std::streamsize>(content.size()));
+    }
+
+    std::promise<HttpServer*> serverPromise;
+    std::thread serverThread([&serverPromise] {
+        HttpServer server({ .serverAddr = { "127.0.0.1", IP_PROTOCOL::IPv4, PORT }
+                , .maxListenQueue = 128, .maxThreadNum = 0 });
+        server.setRequestHandle(handleRequest);
+        serverPromise.set_value(&server);
+        server.start();
+    });
+    auto server = serverPromise.get_future().get();
+    // Wait for listening.
+    std::this_thread::sleep_for(100ms);
+
+    bool ok = testRanges(content);
+    ok = testMultipart(content) && ok;
+    ok = testTruncated(content) && ok;
+
+    server->stop();
+    serverThread.join();
+    std::filesystem::remove_all(TEST_DIR);
+    std::cout << "[" << TAG << "] " << (ok ? "success" : "FAIL") << std::endl;
+    return ok ? 0 : 1;
+}
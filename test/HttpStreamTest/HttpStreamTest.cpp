@@ -0,0 +1,319 @@
+#include "base/Compress.h"
+#include "http/HttpCommon.h"
+#include "http/HttpRequest.h"
+#include "http/HttpResponse.h"
+#include "http/HttpServer.h"
+#include "http/HttpStream.h"
+#include "TestUtils.h"
+#include <atomic>
+#include <charconv>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <future>
+#include <iostream>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <thread>
+
+extern "C" {
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <unistd.h>
+}
+
+static constexpr std::string_view TAG = "HttpStreamTest";
+
+using namespace simpletcp;
+using namespace simpletcp::http;
+using namespace simpletcp::net;
+using namespace simpletcp::test;
+using namespace std::chrono;
+
+// A producer thread streams a large body while the client doesn't read, so the writer is paused by the
+// high water mark and resumed when the queue is drained. The requests pipelined after the stream are
+// answered after its last chunk.
+
+static constexpr uint16_t PORT = 8895;
+static constexpr size_t CHUNK_SIZE = 16 * 1024;
+static constexpr size_t CHUNK_NUM = 1024;
+
+static std::string makeChunk(size_t id) {
+    return std::string(CHUNK_SIZE, static_cast<char>('a' + id % 26));
+}
+
+// Write chunks in other thread, and wait for writable callback when it's told to pause.
+class Producer {
+public:
+    explicit Producer(HttpStreamPtr stream) : mpStream(std::move(stream)) {
+        mpStream->setWritableCallback([this] (const HttpStreamPtr&) {
+            std::lock_guard lock { mMutex };
+            mIsWritable = true;
+            mCondition.notify_one();
+        });
+        mThread = std::thread([this] { run(); });
+    }
+
+    ~Producer() { mThread.join(); }
+
+    size_t getPauses() const noexcept { return mPauses; }
+
+private:
+    HttpStreamPtr               mpStream;
+    std::thread                 mThread;
+    std::mutex                  mMutex;
+    std::condition_variable     mCondition;
+    bool                        mIsWritable = true;
+    std::atomic<size_t>         mPauses = 0;
+
+    void run() {
+        for (size_t i = 0; i != CHUNK_NUM && !mpStream->isClosed(); ++i) {
+            // Reset the flag before writing, the callback may be invoked before waiting.
+            {
+                std::lock_guard lock { mMutex };
+                mIsWritable = false;
+            }
+            if (!mpStream->writeChunk(makeChunk(i))) {
+                ++mPauses;
+                std::unique_lock lock { mMutex };
+                mCondition.wait_for(lock, 5s, [this] { return mIsWritable; });
+            }
+        }
+        mpStream->end();
+    }
+};
+
+static std::unique_ptr<Producer> gProducer;
+
+static void handleRequest(const HttpRequest& request, HttpResponse& response) {
+    response.setVersion(request.mVersion);
+    response.setStatus(StatusCode::OK);
+    response.setKeepAlive(request.mIsKeepAlive);
+    response.setContentType(ContentType::PLAIN);
+    if (request.mUrl == "stream") {
+        auto stream = response.beginStream();
+        // The chunk written in handle is sent after headers.
+        stream->writeChunk(std::string_view { "head" });
+        gProducer = std::make_unique<Producer>(stream);
+    } else if (request.mUrl == "short") {
+        auto stream = response.beginStream();
+        stream->writeChunk(std::string_view { "hello " });
+        stream->writeChunk(std::string { "world" });
+        stream->end();
+    } else if (request.mUrl == "gzip") {
+        auto stream = response.beginStream(true);
+        for (size_t i = 0; i != 8; ++i) {
+            stream->writeChunk(makeChunk(i));
+        }
+        stream->end();
+    } else {
+        // Echo the body of request.
+        std::string body = "echo:";
+        body.append(request.mBody);
+        response.setContentLength(static_cast<int64_t>(body.size()));
+        response.setBody(std::move(body));
+    }
+}
+
+class Client {
+public:
+    Client()
+        : mFd(connectServer({ "127.0.0.1", IP_PROTOCOL::IPv4, PORT }))
+        , mIsConnected(mFd >= 0) {
+    }
+
+    ~Client() { ::close(mFd); }
+
+    bool send(std::string_view data) {
+        return mIsConnected && ::send(mFd, data.data(), data.size(), 0) == static_cast<ssize_t>(data.size());
+    }
+
+    // Read until the buffer holds size bytes, return false if connection is closed before.
+    bool fill(size_t size) {
+        while (mBuffer.size() < size) {
+            char buffer[64 * 1024];
+            auto len = ::recv(mFd, buffer, sizeof(buffer), 0);
+            if (len <= 0) {
+                return false;
+            }
+            mBuffer.append(buffer, static_cast<size_t>(len));
+        }
+        return true;
+    }
+
+    // Read headers of response, they're removed from buffer.
+    std::string readHeaders() {
+        size_t pos = std::string::npos;
+        while ((pos = mBuffer.find("\r\n\r\n")) == std::string::npos) {
+            if (!fill(mBuffer.size() + 1)) {
+                return {};
+            }
+        }
+        auto headers = mBuffer.substr(0, pos + 4);
+        mBuffer.erase(0, pos + 4);
+        return headers;
+    }
+
+    // Decode chunked body, return false if it's malformed.
+    bool readChunked(std::string& body) {
+        while (true) {
+            size_t lineEnd = std::string::npos;
+            while ((lineEnd = mBuffer.find("\r\n")) == std::string::npos) {
+                if (!fill(mBuffer.size() + 1)) {
+                    return false;
+                }
+            }
+            size_t size = 0;
+            auto res = std::from_chars(mBuffer.data(), mBuffer.data() + lineEnd, size, 16);
+            if (res.ptr != mBuffer.data() + lineEnd || !fill(lineEnd + 2 + size + 2)) {
+                return false;
+            }
+            body.append(mBuffer, lineEnd + 2, size);
+            if (mBuffer.compare(lineEnd + 2 + size, 2, "\r\n") != 0) {
+                return false;
+            }
+            mBuffer.erase(0, lineEnd + 2 + size + 2);
+            if (size == 0) {
+                return true;
+            }
+        }
+    }
+
+    std::string readBody(size_t size) {
+        if (!fill(size)) {
+            return {};
+        }
+        auto body = mBuffer.substr(0, size);
+        mBuffer.erase(0, size);
+        return body;
+    }
+
+    // Read until connection is closed.
+    std::string readAll() {
+        while (fill(mBuffer.size() + 1)) {
+        }
+        return std::move(mBuffer);
+    }
+
+private:
+    int                         mFd;
+    bool                        mIsConnected;
+    std::string                 mBuffer;
+};
+
+static bool testBackpressure() {
+    bool ok = true;
+    Client client;
+    // The echo request is pipelined after the stream.
+    ok = expect(TAG, client.send("GET /stream HTTP/1.1\r\nHost: 127.0.0.1\r\n\r\n"
+                "POST /echo HTTP/1.1\r\nHost: 127.0.0.1\r\nContent-Length: 4\r\n\r\nnext"), "send requests") && ok;
+    // Don't read, so the queue of connection grows over the high water mark.
+    std::this_thread::sleep_for(300ms);
+    auto headers = client.readHeaders();
+    ok = expect(TAG, headers.starts_with("HTTP/1.1 200 OK\r\n") && headers.find("Transfer-Encoding: chunked\r\n")
+            != std::string::npos && headers.find("Content-Length") == std::string::npos, "stream headers") && ok;
+    std::string body;
+    ok = expect(TAG, client.readChunked(body), "decode chunks") && ok;
+    std::string expected = "head";
+    for (size_t i = 0; i != CHUNK_NUM; ++i) {
+        expected.append(makeChunk(i));
+    }
+    ok = expect(TAG, body == expected, "stream body") && ok;
+    auto echoHeaders = client.readHeaders();
+    ok = expect(TAG, echoHeaders.starts_with("HTTP/1.1 200 OK\r\n") && client.readBody(9) == "echo:next"
+            , "pipelined request after stream") && ok;
+    auto pauses = gProducer->getPauses();
+    gProducer.reset();
+    ok = expect(TAG, pauses != 0, "writer is paused by high water mark") && ok;
+    std::cout << "[" << TAG << "] " << body.size() << " bytes streamed, writer paused " << pauses << " times"
+        << std::endl;
+    return ok;
+}
+
+static bool testShortStreams() {
+    bool ok = true;
+    {
+        // HTTP/1.0 doesn't support chunked, the body is ended by closing connection.
+        Client client;
+        ok = expect(TAG, client.send("GET /short HTTP/1.0\r\n\r\n"), "send http/1.0 request") && ok;
+        auto response = client.readAll();
+        ok = expect(TAG, response.starts_with("HTTP/1.0 200 OK\r\n") && response.find("Connection: close\r\n")
+                != std::string::npos && response.find("chunked") == std::string::npos
+                && response.ends_with("\r\n\r\nhello world"), "http/1.0 stream") && ok;
+    }
+    {
+        Client client;
+        ok = expect(TAG, client.send("HEAD /short HTTP/1.1\r\nHost: 127.0.0.1\r\n\r\n"
+                    "GET /short HTTP/1.1\r\nHost: 127.0.0.1\r\n\r\n"), "send head request") && ok;
+        auto headers = client.readHeaders();
+        ok = expect(TAG, headers.find("Transfer-Encoding: chunked\r\n") != std::string::npos, "head stream") && ok;
+        // The body of HEAD is not sent, the next response follows the headers.
+        headers = client.readHeaders();
+        std::string body;
+        ok = expect(TAG, headers.starts_with("HTTP/1.1 200 OK\r\n") && client.readChunked(body)
+                && body == "hello world", "stream after head") && ok;
+    }
+    return ok;
+}
+
+static bool testChunkedRequest() {
+    Client client;
+    bool ok = expect(TAG, client.send("POST /echo HTTP/1.1\r\nHost: 127.0.0.1\r\nTransfer-Encoding: chunked\r\n\r\n"
+                "5\r\nhello\r\n"), "send first chunk");
+    std::this_thread::sleep_for(50ms);
+    ok = expect(TAG, client.send("6\r\n world\r\n0\r\n\r\n"), "send last chunk") && ok;
+    auto headers = client.readHeaders();
+    ok = expect(TAG, headers.find("Content-Length: 16\r\n") != std::string::npos
+            && client.readBody(16) == "echo:hello world", "chunked request") && ok;
+    return ok;
+}
+
+static bool testCompressedStream() {
+    std::string expected;
+    for (size_t i = 0; i != 8; ++i) {
+        expected.append(makeChunk(i));
+    }
+    bool ok = true;
+    Client client;
+    ok = expect(TAG, client.send("GET /gzip HTTP/1.1\r\nHost: 127.0.0.1\r\nAccept-Encoding: gzip\r\n\r\n"
+                "GET /gzip HTTP/1.1\r\nHost: 127.0.0.1\r\n\r\n"), "send gzip requests") && ok;
+    auto headers = client.readHeaders();
+    std::string body;
+    ok = expect(TAG, headers.find("Content-Encoding: gzip\r\n") != std::string::npos
+            && headers.find("Vary: Accept-Encoding\r\n") != std::string::npos
+            && client.readChunked(body), "gzip stream headers") && ok;
+    ok = expect(TAG, body.size() < expected.size() && utils::uncompress_gzip(body, expected.size()) == expected
+            , "gzip stream body") && ok;
+    // The body is not compressed if client doesn't accept it.
+    headers = client.readHeaders();
+    std::string plain;
+    ok = expect(TAG, headers.find("Content-Encoding") == std::string::npos && client.readChunked(plain)
+            && plain == expected, "identity stream") && ok;
+    return ok;
+}
+
+int main() {
+    std::promise<HttpServer*> serverPromise;
+    std::thread serverThread([&serverPromise] {
+        HttpServer server({ .serverAddr = { "127.0.0.1", IP_PROTOCOL::IPv4, PORT }
+                , .maxListenQueue = 128, .maxThreadNum = 0 });
+        server.setRequestHandle(handleRequest);
+        serverPromise.set_value(&server);
+        server.start();
+    });
+    auto server = serverPromise.get_future().get();
+    // Wait for listening.
+    std::this_thread::sleep_for(100ms);
+
+    bool ok = testBackpressure();
+    ok = testShortStreams() && ok;
+    ok = testChunkedRequest() && ok;
+    ok = testCompressedStream() && ok;
+
+    server->stop();
+    serverThread.join();
+    std::cout << "[" << TAG << "] " << (ok ? "success" : "FAIL") << std::endl;
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,106 @@
+#include "base/Log.h"
+#include "net/EventLoop.h"
+#include "tcp/TcpServer.h"
+#include "tcp/TcpBuffer.h"
+#include <future>
+#include <iostream>
+#include <thread>
+#include <vector>
+#include <cstdlib>
+
+extern "C" {
+#include <malloc.h>
+#include <unistd.h>
+#include <arpa/inet.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+}
+
+static constexpr std::string_view TAG = "ConnFootprint";
+
+using namespace simpletcp;
+using namespace simpletcp::net;
+using namespace simpletcp::tcp;
+
+// Measure the heap bytes held by idle connections on server side, before and after every connection
+// has echoed one message.
+// Usage: ConnFootprint [connection nums]
+
+static constexpr uint16_t SERVER_PORT = 8850;
+
+static size_t heapInUse() {
+    return mallinfo2().uordblks;
+}
+
+int main(int argc, char** argv) {
+    int connNums = 200;
+    if (argc > 1) {
+        connNums = std::atoi(argv[1]);
+    }
+    std::cout << "[ConnFootprint] sizeof(TcpConnection): " << sizeof(TcpConnection) << std::endl;
+    std::cout << "[ConnFootprint] sizeof(Socket): " << sizeof(Socket) << std::endl;
+    std::cout << "[ConnFootprint] sizeof(Channel): " << sizeof(Channel) << std::endl;
+    std::cout << "[ConnFootprint] sizeof(TcpBuffer): " << sizeof(TcpBuffer) << std::endl;
+
+    EventLoop loop;
+    TcpServer server({ &loop, { "127.0.0.1", IP_PROTOCOL::IPv4, SERVER_PORT }, 1024 });
+    int connected = 0;
+    size_t heapBefore = 0;
+    std::promise<void> idlePromise;
+    server.setConnectionCallback([&] (const TcpConnectionPtr& conn) {
+        if (!conn->isConnected()) {
+            return;
+        }
+        if (++connected == connNums) {
+            auto delta = heapInUse() - heapBefore;
+            std::cout << "[ConnFootprint] idle connections: " << connNums << std::endl;
+            std::cout << "[ConnFootprint] heap delta: " << delta << " bytes" << std::endl;
+            std::cout << "[ConnFootprint] bytes per connection: " << delta / static_cast<size_t>(connNums) << std::endl;
+            idlePromise.set_value();
+        }
+    });
+    int echoed = 0;
+    server.setMessageCallback([&] (const TcpConnectionPtr& conn) {
+        conn->send(conn->readAll());
+        conn->extractShared(conn->getBufferSize());
+        if (++echoed == connNums) {
+            // Includes the scratch buffer of loop, which is allocated once.
+            auto delta = heapInUse() - heapBefore;
+            std::cout << "[ConnFootprint] heap delta after echo: " << delta << " bytes" << std::endl;
+            std::cout << "[ConnFootprint] bytes per connection after echo: "
+                << delta / static_cast<size_t>(connNums) << std::endl;
+            loop.quitLoop();
+        }
+    });
+    server.start();
+    heapBefore = heapInUse();
+
+    std::vector<int> clientFds;
+    std::thread clients([&] {
+        sockaddr_in addr {};
+        addr.sin_family = AF_INET;
+        addr.sin_port = htons(SERVER_PORT);
+        ::inet_pton(AF_INET, "127.0.0.1", &addr.sin_addr);
+        for (int i = 0; i != connNums; ++i) {
+            int fd = ::socket(AF_INET, SOCK_STREAM, 0);
+            if (::connect(fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) < 0) {
+                std::cerr << "[ConnFootprint] connect failed." << std::endl;
+                std::exit(1);
+            }
+            clientFds.push_back(fd);
+        }
+        idlePromise.get_future().wait();
+        char message[] = "ping";
+        for (auto fd : clientFds) {
+            if (::write(fd, message, sizeof(message)) != sizeof(message)) {
+                std::cerr << "[ConnFootprint] write failed." << std::endl;
+                std::exit(1);
+            }
+        }
+    });
+    loop.startLoop();
+    clients.join();
+    for (auto fd : clientFds) {
+        ::close(fd);
+    }
+}
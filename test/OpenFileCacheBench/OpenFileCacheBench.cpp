@@ -0,0 +1,239 @@
+#include "http/HttpCommon.h"
+#include "http/HttpError.h"
+#include "http/HttpRequest.h"
+#include "http/HttpResponse.h"
+#include "http/HttpServer.h"
+#include "http/OpenFileCache.h"
+#include "net/Socket.h"
+#include "TestUtils.h"
+#include <charconv>
+#include <chrono>
+#include <cstddef>
+#include <filesystem>
+#include <fstream>
+#include <future>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+extern "C" {
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/socket.h>
+#include <unistd.h>
+}
+
+static constexpr std::string_view TAG = "OpenFileCacheBench";
+
+using namespace simpletcp;
+using namespace simpletcp::http;
+using namespace simpletcp::net;
+using namespace simpletcp::test;
+using namespace std::chrono;
+
+// Clients request small static files on keep-alive connections, depth requests are pipelined in every
+// round. The content cache of server is disabled, so files are sent by sendfile, and the server either
+// opens, fstats and closes every file, or gets the descriptor from OpenFileCache.
+
+static const std::filesystem::path TEST_DIR = std::filesystem::temp_directory_path() / "OpenFileCacheBench";
+static constexpr size_t FILE_NUM = 64;
+static constexpr size_t FILE_SIZE = 1024;
+static constexpr size_t CONNECTIONS = 4;
+static constexpr size_t DEPTH = 16;
+static constexpr auto RUN_DURATION = 1s;
+
+static std::string makeContent(size_t id) {
+    std::string content(FILE_SIZE, static_cast<char>('a' + id % 26));
+    content.replace(0, std::to_string(id).size(), std::to_string(id));
+    return content;
+}
+
+static bool testCache() {
+    bool ok = true;
+    auto path = TEST_DIR / "cache.txt";
+    writeFile(path, "first");
+    OpenFileCache cache { { .mMaxFiles = 2, .mTtl = 60s, .mStatInterval = 0ms } };
+
+    auto first = cache.getFile(path);
+    ok = expect(TAG, first == cache.getFile(path), "hit returns the same file") && ok;
+    ok = expect(TAG, first->getSize() == 5 && first->getContentType() == ContentType::PLAIN, "metadata") && ok;
+
+    // The file replaced by rename is noticed, the old descriptor still reads the old content.
+    auto temp = TEST_DIR / "cache.tmp";
+    writeFile(temp, "second!");
+    std::filesystem::rename(temp, path);
+    auto second = cache.getFile(path);
+    ok = expect(TAG, second != first && second->getSize() == 7 && second->getETag() != first->getETag(), "rename") && ok;
+    char buffer[8] {};
+    ok = expect(TAG, ::pread(first->getFile()->getFd(), buffer, sizeof(buffer), 0) == 5
+            && std::string_view { buffer, 5 } == "first", "old descriptor is kept by holder") && ok;
+
+    // Bounded by max files, the least recently used one is evicted.
+    auto other1 = TEST_DIR / "other1.txt";
+    auto other2 = TEST_DIR / "other2.txt";
+    writeFile(other1, "1");
+    writeFile(other2, "2");
+    (void)cache.getFile(other1);
+    std::this_thread::sleep_for(1ms);
+    (void)cache.getFile(other2);
+    auto stats = cache.getStats();
+    ok = expect(TAG, stats.mFiles == 2 && stats.mEvictions == 1, "max files") && ok;
+
+    // Expired file is reopened.
+    OpenFileCache expiring { { .mMaxFiles = 2, .mTtl = 0ms } };
+    auto opened = expiring.getFile(other1);
+    ok = expect(TAG, expiring.getFile(other1) != opened && expiring.getStats().mReloads == 1, "ttl") && ok;
+
+    try {
+        (void)cache.getFile(TEST_DIR / "missing.txt");
+        ok = expect(TAG, false, "missing file") && ok;
+    } catch (const ResponseError& e) {
+        ok = expect(TAG, e.getErrorType() == ResponseErrorType::FileNotFound, "error of missing file") && ok;
+    }
+    ok = expect(TAG, !std::filesystem::exists(TEST_DIR / "missing.txt"), "missing file is not created") && ok;
+    return ok;
+}
+
+static void handleRequest(const HttpRequest& request, HttpResponse& response) {
+    response.setVersion(Version::HTTP1_1);
+    response.setStatus(StatusCode::OK);
+    response.setKeepAlive(true);
+    response.setContentByFilePath(TEST_DIR / request.mUrl);
+}
+
+class Client {
+public:
+    explicit Client(uint16_t port)
+        : mFd(connectServer({ "127.0.0.1", IP_PROTOCOL::IPv4, port }))
+        , mIsConnected(mFd >= 0) {
+        int on = 1;
+        ::setsockopt(mFd, IPPROTO_TCP, TCP_NODELAY, &on, sizeof(on));
+    }
+
+    ~Client() { ::close(mFd); }
+
+    bool sendRequests(size_t depth) {
+        mRequests.clear();
+        mExpected.clear();
+        for (size_t i = 0; i != depth; ++i) {
+            auto id = mNextId++ % FILE_NUM;
+            mRequests.append("GET /file").append(std::to_string(id)).append(".txt HTTP/1.1\r\nHost: 127.0.0.1\r\n\r\n");
+            mExpected.push_back(id);
+        }
+        return mIsConnected && ::send(mFd, mRequests.data(), mRequests.size(), 0)
+            == static_cast<ssize_t>(mRequests.size());
+    }
+
+    bool recvResponses() {
+        for (auto id : mExpected) {
+            std::string_view body;
+            while (!parseResponse(body)) {
+                char buffer[64 * 1024];
+                auto len = ::recv(mFd, buffer, sizeof(buffer), 0);
+                if (len <= 0) {
+                    return false;
+                }
+                mBuffer.append(buffer, static_cast<size_t>(len));
+            }
+            auto ok = body == makeContent(id);
+            mBuffer.erase(0, mResponseSize);
+            if (!ok) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+private:
+    int                         mFd;
+    bool                        mIsConnected;
+    size_t                      mNextId = 0;
+    std::string                 mRequests;
+    std::vector<size_t>         mExpected;
+    std::string                 mBuffer;
+    size_t                      mResponseSize = 0;
+
+    bool parseResponse(std::string_view& body) {
+        std::string_view data { mBuffer };
+        auto headerEnd = data.find("\r\n\r\n");
+        if (headerEnd == std::string_view::npos) {
+            return false;
+        }
+        constexpr std::string_view lengthHeader = "Content-Length: ";
+        auto pos = data.find(lengthHeader);
+        size_t length = 0;
+        if (pos == std::string_view::npos || pos > headerEnd) {
+            return false;
+        }
+        std::from_chars(data.data() + pos + lengthHeader.size(), data.data() + headerEnd, length);
+        if (data.size() < headerEnd + 4 + length) {
+            return false;
+        }
+        body = data.substr(headerEnd + 4, length);
+        mResponseSize = headerEnd + 4 + length;
+        return true;
+    }
+};
+
+// Return requests per second, or 0 if any response is wrong.
+static double runServer(uint16_t port, size_t maxFiles) {
+    std::promise<HttpServer*> serverPromise;
+    std::thread serverThread([&serverPromise, port, maxFiles] {
+        HttpServer server({ .serverAddr = { "127.0.0.1", IP_PROTOCOL::IPv4, port }
+                , .maxListenQueue = 128, .maxThreadNum = 0
+                , .fileCacheOptions = { .mCapacity = 0 }
+                , .openFileCacheOptions = { .mMaxFiles = maxFiles } });
+        server.setRequestHandle(handleRequest);
+        serverPromise.set_value(&server);
+        server.start();
+    });
+    auto server = serverPromise.get_future().get();
+    // Wait for listening.
+    std::this_thread::sleep_for(100ms);
+
+    std::vector<std::unique_ptr<Client>> clients;
+    for (size_t i = 0; i != CONNECTIONS; ++i) {
+        clients.push_back(std::make_unique<Client>(port));
+    }
+    size_t requests = 0;
+    bool ok = true;
+    auto start = steady_clock::now();
+    while (ok && steady_clock::now() - start < RUN_DURATION) {
+        for (auto& client : clients) {
+            ok = client->sendRequests(DEPTH) && ok;
+        }
+        for (auto& client : clients) {
+            ok = ok && client->recvResponses();
+        }
+        requests += DEPTH * clients.size();
+    }
+    auto seconds = duration_cast<duration<double>>(steady_clock::now() - start).count();
+    clients.clear();
+    server->stop();
+    serverThread.join();
+    return ok ? static_cast<double>(requests) / seconds : 0;
+}
+
+int main() {
+    std::filesystem::create_directories(TEST_DIR);
+    bool ok = testCache();
+    for (size_t i = 0; i != FILE_NUM; ++i) {
+        writeFile(TEST_DIR / ("file" + std::to_string(i) + ".txt"), makeContent(i));
+    }
+    auto uncached = runServer(8892, 0);
+    auto cached = runServer(8893, FILE_NUM);
+    ok = expect(TAG, uncached > 0 && cached > 0, "serve files") && ok;
+    std::cout << "[" << TAG << "] " << FILE_SIZE << " bytes files: open per request " << std::fixed
+        << std::setprecision(0) << uncached << " requests/s, cached descriptor " << cached << " requests/s";
+    if (uncached > 0) {
+        std::cout << ", x" << std::setprecision(2) << cached / uncached;
+    }
+    std::cout << std::endl;
+    std::filesystem::remove_all(TEST_DIR);
+    std::cout << "[" << TAG << "] " << (ok ? "success" : "FAIL") << std::endl;
+    return ok ? 0 : 1;
+}
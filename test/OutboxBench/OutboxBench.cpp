@@ -0,0 +1,119 @@
+#include "base/Log.h"
+#include "net/EventLoop.h"
+#include "tcp/TcpServer.h"
+#include <chrono>
+#include <future>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+extern "C" {
+#include <unistd.h>
+#include <arpa/inet.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+}
+
+static constexpr std::string_view TAG = "OutboxBench";
+
+using namespace simpletcp;
+using namespace simpletcp::net;
+using namespace simpletcp::tcp;
+using namespace std::chrono;
+
+// Messages per second sent to one connection from 8 producer threads.
+//  queueInLoop: the old way, every message is copied and posted by its own queueInLoop task.
+//  outbox: TcpConnection::send, messages are pushed to the outbox and drained by one flush task.
+
+static constexpr uint16_t SERVER_PORT = 8882;
+static constexpr int PRODUCER_NUMS = 8;
+static constexpr int MESSAGES_PER_PRODUCER = 100'000;
+static constexpr size_t MESSAGE_SIZE = 64;
+
+enum class SendMode {
+    QueueInLoop,
+    Outbox,
+};
+
+static void produce(const TcpConnectionPtr& conn, SendMode mode) {
+    std::vector<uint8_t> message(MESSAGE_SIZE, 'x');
+    TcpConnection::span_type data { message.data(), message.size() };
+    for (int i = 0; i != MESSAGES_PER_PRODUCER; ++i) {
+        if (mode == SendMode::Outbox) {
+            conn->send(data);
+        } else {
+            std::vector<uint8_t> copy { data.begin(), data.end() };
+            conn->getLoop()->queueInLoop([conn, copy = std::move(copy)] {
+                conn->send(TcpConnection::span_type { copy.data(), copy.size() });
+            });
+        }
+    }
+}
+
+int main() {
+    std::promise<EventLoop*> loopPromise;
+    std::promise<TcpConnectionPtr> connPromise;
+    std::thread serverThread([&] {
+        EventLoop loop;
+        TcpServer server({ &loop, { "127.0.0.1", IP_PROTOCOL::IPv4, SERVER_PORT }, 16 });
+        server.setConnectionCallback([&] (const TcpConnectionPtr& conn) {
+            if (conn->isConnected()) {
+                connPromise.set_value(conn);
+            }
+        });
+        server.start();
+        loopPromise.set_value(&loop);
+        loop.startLoop();
+    });
+    auto loop = loopPromise.get_future().get();
+
+    for (auto mode : { SendMode::QueueInLoop, SendMode::Outbox }) {
+        connPromise = std::promise<TcpConnectionPtr> {};
+        sockaddr_in addr {};
+        addr.sin_family = AF_INET;
+        addr.sin_port = htons(SERVER_PORT);
+        ::inet_pton(AF_INET, "127.0.0.1", &addr.sin_addr);
+        int fd = ::socket(AF_INET, SOCK_STREAM, 0);
+        if (::connect(fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) < 0) {
+            std::cerr << "[OutboxBench] connect failed." << std::endl;
+            return 1;
+        }
+        auto conn = connPromise.get_future().get();
+
+        auto start = steady_clock::now();
+        std::vector<std::thread> producers;
+        for (int i = 0; i != PRODUCER_NUMS; ++i) {
+            producers.emplace_back(produce, conn, mode);
+        }
+        constexpr size_t total = PRODUCER_NUMS * MESSAGES_PER_PRODUCER * MESSAGE_SIZE;
+        std::vector<char> buf(65536);
+        size_t received = 0;
+        while (received < total) {
+            auto len = ::read(fd, buf.data(), buf.size());
+            if (len <= 0) {
+                std::cerr << "[OutboxBench] read failed." << std::endl;
+                return 1;
+            }
+            received += static_cast<size_t>(len);
+        }
+        auto cost = duration_cast<microseconds>(steady_clock::now() - start).count();
+        for (auto& producer : producers) {
+            producer.join();
+        }
+        double messagesPerSecond = static_cast<double>(PRODUCER_NUMS * MESSAGES_PER_PRODUCER)
+            / static_cast<double>(cost) * 1'000'000;
+        std::cout << "[OutboxBench] " << (mode == SendMode::Outbox ? "outbox     " : "queueInLoop")
+            << " producers: " << PRODUCER_NUMS << " messages: " << PRODUCER_NUMS * MESSAGES_PER_PRODUCER
+            << " cost: " << cost << "us speed: " << std::fixed << std::setprecision(0)
+            << messagesPerSecond << "/sec" << std::endl;
+        conn.reset();
+        ::close(fd);
+    }
+
+    loop->queueInLoop([loop] {
+        loop->quitLoop();
+    });
+    serverThread.join();
+}
@@ -0,0 +1,139 @@
+#include "base/Log.h"
+#include "net/EventLoop.h"
+#include "tcp/TcpServer.h"
+#include "TestUtils.h"
+#include <chrono>
+#include <future>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+extern "C" {
+#include <unistd.h>
+#include <arpa/inet.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+}
+
+static constexpr std::string_view TAG = "RateLimitTest";
+
+using namespace simpletcp;
+using namespace simpletcp::net;
+using namespace simpletcp::tcp;
+using namespace simpletcp::test;
+using namespace std::chrono;
+
+// Server sends data to clients with rate limits, clients measure the receiving rate.
+//  connection: token bucket of connection.
+//  kernel: SO_MAX_PACING_RATE, only reported because pacing of loopback depends on kernel.
+//  server: token bucket shared by all connections of server.
+//  shutdown: token bucket of connection, which is shutdown after the data is queued.
+
+static constexpr uint16_t SERVER_PORT = 8886;
+static constexpr uint64_t RATE = 8 * 1024 * 1024;
+static constexpr size_t DATA_SIZE = 4 * 1024 * 1024;
+static constexpr int SERVER_CLIENT_NUMS = 4;
+
+enum class LimitMode {
+    Connection,
+    Kernel,
+    Server,
+    Shutdown,
+};
+
+static bool receiveAll(int fd, size_t size) {
+    std::vector<char> buf(65536);
+    size_t received = 0;
+    while (received < size) {
+        auto len = ::read(fd, buf.data(), buf.size());
+        if (len <= 0) {
+            return false;
+        }
+        received += static_cast<size_t>(len);
+    }
+    return true;
+}
+
+static bool runCase(LimitMode mode) {
+    auto clientNums = mode == LimitMode::Server ? SERVER_CLIENT_NUMS : 1;
+    std::promise<EventLoop*> loopPromise;
+    TcpServer* pServer = nullptr;
+    TcpThrottleStats connStats {};
+    std::thread serverThread([&] {
+        EventLoop loop;
+        TcpServer server({ &loop, { "127.0.0.1", IP_PROTOCOL::IPv4, SERVER_PORT }, 16, 0
+                , TCP_DEFAULT_MAX_CONNECTION_NUM, {}, TcpBufferMode::Linear
+                , mode == LimitMode::Server ? RATE : 0 });
+        pServer = &server;
+        server.setConnectionCallback([mode] (const TcpConnectionPtr& conn) {
+            if (!conn->isConnected()) {
+                return;
+            }
+            if (mode != LimitMode::Server) {
+                conn->setSendRateLimit(RATE, 0, mode == LimitMode::Kernel);
+            }
+            auto data = SharedBuffer::copyFrom(std::string(DATA_SIZE, 'x'));
+            // Send in pieces, as a bulk-transfer service does.
+            for (size_t offset = 0; offset < DATA_SIZE; offset += 65536) {
+                conn->send(data.slice(offset, 65536));
+            }
+            if (mode == LimitMode::Shutdown) {
+                // The queued data is still limited by rate.
+                conn->shutdownConnection();
+            }
+        });
+        server.setWriteCompleteCallback([&] (const TcpConnectionPtr& conn) {
+            connStats = conn->getThrottleStats();
+        });
+        server.start();
+        loopPromise.set_value(&loop);
+        loop.startLoop();
+    });
+    auto loop = loopPromise.get_future().get();
+
+    auto start = steady_clock::now();
+    std::vector<std::future<bool>> clients;
+    for (int i = 0; i != clientNums; ++i) {
+        clients.push_back(std::async(std::launch::async, [] {
+            int fd = connectServer({ "127.0.0.1", IP_PROTOCOL::IPv4, SERVER_PORT });
+            auto ok = fd >= 0 && receiveAll(fd, DATA_SIZE);
+            ::close(fd);
+            return ok;
+        }));
+    }
+    bool ok = true;
+    for (auto& client : clients) {
+        ok = client.get() && ok;
+    }
+    auto cost = duration<double>(steady_clock::now() - start).count();
+    auto rate = static_cast<double>(DATA_SIZE) * clientNums / cost / 1024 / 1024;
+    TcpThrottleStats stats {};
+    loop->runInLoop([&] {
+        stats = mode == LimitMode::Server ? pServer->getThrottleStats() : connStats;
+    });
+    loop->queueInLoop([loop] {
+        loop->quitLoop();
+    });
+    serverThread.join();
+
+    std::string_view name = mode == LimitMode::Connection ? "connection" : mode == LimitMode::Kernel ? "kernel    "
+        : mode == LimitMode::Server ? "server    " : "shutdown  ";
+    // The first burst is sent without waiting, so the rate is a little higher than limit.
+    auto expect = static_cast<double>(RATE) / 1024 / 1024;
+    auto inRange = rate > expect * 0.7 && rate < expect * 1.3;
+    std::cout << std::fixed << std::setprecision(2) << "[RateLimitTest] " << name << " clients: " << clientNums
+        << " limit: " << expect << "MB/s speed: " << rate << "MB/s"
+        << " throttled: " << stats.mThrottledCount << " times " << stats.mThrottledTime.count() << "us "
+        << (ok && (mode == LimitMode::Kernel || inRange) ? "success" : "FAIL") << std::endl;
+    return ok && (mode == LimitMode::Kernel || inRange);
+}
+
+int main() {
+    bool ok = true;
+    for (auto mode : { LimitMode::Connection, LimitMode::Kernel, LimitMode::Server, LimitMode::Shutdown }) {
+        ok = runCase(mode) && ok;
+    }
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,121 @@
+#include "base/Log.h"
+#include "net/EventLoop.h"
+#include "tcp/SharedBuffer.h"
+#include "tcp/TcpServer.h"
+#include <future>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+extern "C" {
+#include <unistd.h>
+#include <arpa/inet.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+}
+
+static constexpr std::string_view TAG = "RecvSliceTest";
+
+using namespace simpletcp;
+using namespace simpletcp::net;
+using namespace simpletcp::tcp;
+
+// Server echoes received bytes by sending the slices of receive storage, and keeps all slices.
+// Client sends a stream whose byte i equals to (i % 251) and validates the echo.
+// At last the kept slices are validated in another thread, they must be unchanged after buffer advances.
+
+static constexpr uint16_t SERVER_PORT = 8884;
+static constexpr size_t TOTAL_SIZE = 8 * 1024 * 1024;
+static constexpr size_t CHUNK_SIZES[] = { 1, 100, 1500, 4096, 30000, 200000 };
+
+static bool validate(std::span<const uint8_t> data, size_t& offset) {
+    for (auto c : data) {
+        if (c != static_cast<uint8_t>(offset++ % 251)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+int main() {
+    std::vector<SharedBuffer> slices;
+    std::promise<EventLoop*> loopPromise;
+    std::thread serverThread([&] {
+        EventLoop loop;
+        TcpServer server({ &loop, { "127.0.0.1", IP_PROTOCOL::IPv4, SERVER_PORT }, 16 });
+        server.setMessageCallback([&] (const TcpConnectionPtr& conn) {
+            auto slice = conn->extractSharedAll();
+            conn->send(slice);
+            slices.push_back(std::move(slice));
+        });
+        server.start();
+        loopPromise.set_value(&loop);
+        loop.startLoop();
+    });
+    auto loop = loopPromise.get_future().get();
+
+    sockaddr_in addr {};
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(SERVER_PORT);
+    ::inet_pton(AF_INET, "127.0.0.1", &addr.sin_addr);
+    int fd = ::socket(AF_INET, SOCK_STREAM, 0);
+    if (::connect(fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) < 0) {
+        std::cerr << "[RecvSliceTest] connect failed." << std::endl;
+        return 1;
+    }
+
+    std::thread writer([fd] {
+        std::vector<uint8_t> stream(TOTAL_SIZE);
+        for (size_t i = 0; i != TOTAL_SIZE; ++i) {
+            stream[i] = static_cast<uint8_t>(i % 251);
+        }
+        size_t offset = 0;
+        for (size_t i = 0; offset != TOTAL_SIZE; ++i) {
+            auto len = std::min(CHUNK_SIZES[i % std::size(CHUNK_SIZES)], TOTAL_SIZE - offset);
+            auto res = ::write(fd, stream.data() + offset, len);
+            if (res <= 0) {
+                std::cerr << "[RecvSliceTest] write failed." << std::endl;
+                return;
+            }
+            offset += static_cast<size_t>(res);
+        }
+    });
+
+    std::vector<uint8_t> buf(65536);
+    size_t received = 0;
+    size_t offset = 0;
+    bool echoOk = true;
+    while (received < TOTAL_SIZE) {
+        auto len = ::read(fd, buf.data(), buf.size());
+        if (len <= 0) {
+            std::cerr << "[RecvSliceTest] read failed." << std::endl;
+            return 1;
+        }
+        received += static_cast<size_t>(len);
+        echoOk = validate({ buf.data(), static_cast<size_t>(len) }, offset) && echoOk;
+    }
+    writer.join();
+    ::close(fd);
+
+    // Hand the slices to another thread, the receive buffer has advanced and may be released.
+    std::vector<SharedBuffer> kept;
+    loop->runInLoop([&] { kept.swap(slices); });
+    auto slicesOk = std::async(std::launch::async, [kept = std::move(kept)] {
+        size_t sliceOffset = 0;
+        bool ok = true;
+        for (const auto& slice : kept) {
+            ok = validate(slice.view(), sliceOffset) && ok;
+        }
+        return ok && sliceOffset == TOTAL_SIZE;
+    }).get();
+
+    std::cout << "[RecvSliceTest] echo " << (echoOk ? "pass" : "FAIL")
+        << ", slices " << (slicesOk ? "pass" : "FAIL") << std::endl;
+
+    loop->queueInLoop([loop] {
+        loop->quitLoop();
+    });
+    serverThread.join();
+    return echoOk && slicesOk ? 0 : 1;
+}
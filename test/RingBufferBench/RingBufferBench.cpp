@@ -0,0 +1,116 @@
+#include "base/Log.h"
+#include "net/EventLoop.h"
+#include "tcp/TcpServer.h"
+#include <chrono>
+#include <cstring>
+#include <future>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+extern "C" {
+#include <unistd.h>
+#include <arpa/inet.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+}
+
+static constexpr std::string_view TAG = "RingBufferBench";
+
+using namespace simpletcp;
+using namespace simpletcp::net;
+using namespace simpletcp::tcp;
+using namespace std::chrono;
+
+// Server parses a stream of length-prefixed frames, so partial frames are often left in receive buffer.
+// Compare the Linear receive buffer with the Mirrored ring buffer.
+
+static constexpr uint16_t SERVER_PORT = 8885;
+static constexpr size_t TOTAL_FRAMES = 20'000;
+static constexpr uint32_t FRAME_SIZES[] = { 100, 1500, 9000, 30000, 60000 };
+static constexpr size_t HEADER_SIZE = sizeof(uint32_t);
+
+// Frame i is a header of payload size, and payload whose bytes equal to (i % 251).
+static std::vector<uint8_t> makeStream() {
+    std::vector<uint8_t> stream;
+    for (size_t i = 0; i != TOTAL_FRAMES; ++i) {
+        uint32_t size = FRAME_SIZES[i % std::size(FRAME_SIZES)];
+        auto offset = stream.size();
+        stream.resize(offset + HEADER_SIZE + size, static_cast<uint8_t>(i % 251));
+        std::memcpy(stream.data() + offset, &size, HEADER_SIZE);
+    }
+    return stream;
+}
+
+int main() {
+    auto stream = makeStream();
+    std::cout << "[RingBufferBench] frames: " << TOTAL_FRAMES << " bytes: " << stream.size() << std::endl;
+    for (auto mode : { TcpBufferMode::Linear, TcpBufferMode::Mirrored }) {
+        std::promise<bool> donePromise;
+        std::promise<EventLoop*> loopPromise;
+        std::thread serverThread([&] {
+            EventLoop loop;
+            TcpServer server({ &loop, { "127.0.0.1", IP_PROTOCOL::IPv4, SERVER_PORT }, 16, 0
+                    , TCP_DEFAULT_MAX_CONNECTION_NUM, {}, mode });
+            size_t frames = 0;
+            bool ok = true;
+            server.setMessageCallback([&] (const TcpConnectionPtr& conn) {
+                while (conn->getBufferSize() >= HEADER_SIZE) {
+                    uint32_t size = 0;
+                    std::memcpy(&size, conn->read(HEADER_SIZE).data(), HEADER_SIZE);
+                    if (conn->getBufferSize() < HEADER_SIZE + size) {
+                        // Partial frame, wait for more data.
+                        return;
+                    }
+                    auto frame = conn->read(HEADER_SIZE + size);
+                    auto expect = static_cast<uint8_t>(frames % 251);
+                    ok = ok && size == FRAME_SIZES[frames % std::size(FRAME_SIZES)]
+                        && frame[HEADER_SIZE] == expect && frame.back() == expect;
+                    conn->extractShared(HEADER_SIZE + size);
+                    if (++frames == TOTAL_FRAMES) {
+                        donePromise.set_value(ok);
+                    }
+                }
+            });
+            server.start();
+            loopPromise.set_value(&loop);
+            loop.startLoop();
+        });
+        auto loop = loopPromise.get_future().get();
+
+        sockaddr_in addr {};
+        addr.sin_family = AF_INET;
+        addr.sin_port = htons(SERVER_PORT);
+        ::inet_pton(AF_INET, "127.0.0.1", &addr.sin_addr);
+        int fd = ::socket(AF_INET, SOCK_STREAM, 0);
+        if (::connect(fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) < 0) {
+            std::cerr << "[RingBufferBench] connect failed." << std::endl;
+            return 1;
+        }
+        auto start = steady_clock::now();
+        size_t offset = 0;
+        while (offset != stream.size()) {
+            auto res = ::write(fd, stream.data() + offset, std::min<size_t>(65536, stream.size() - offset));
+            if (res <= 0) {
+                std::cerr << "[RingBufferBench] write failed." << std::endl;
+                return 1;
+            }
+            offset += static_cast<size_t>(res);
+        }
+        auto ok = donePromise.get_future().get();
+        auto cost = duration_cast<microseconds>(steady_clock::now() - start).count();
+        std::cout << "[RingBufferBench] " << (mode == TcpBufferMode::Mirrored ? "mirrored" : "linear  ")
+            << " cost: " << cost << "us speed: "
+            << static_cast<double>(stream.size()) / static_cast<double>(cost) << "MB/s "
+            << (ok ? "success" : "FAIL") << std::endl;
+        ::close(fd);
+        loop->queueInLoop([loop] {
+            loop->quitLoop();
+        });
+        serverThread.join();
+        if (!ok) {
+            return 1;
+        }
+    }
+}
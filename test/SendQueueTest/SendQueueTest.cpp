@@ -0,0 +1,213 @@
+#include "base/Log.h"
+#include "net/EventLoop.h"
+#include "net/FileDesc.h"
+#include "tcp/TcpSendQueue.h"
+#include "tcp/TcpServer.h"
+#include <chrono>
+#include <cstdio>
+#include <future>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+extern "C" {
+#include <fcntl.h>
+#include <netinet/tcp.h>
+#include <unistd.h>
+#include <arpa/inet.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+}
+
+static constexpr std::string_view TAG = "SendQueueTest";
+
+using namespace simpletcp;
+using namespace simpletcp::net;
+using namespace simpletcp::tcp;
+using namespace std::chrono;
+
+// Check the byte stream sent by send/sendString/sendv/batch, in loop thread and in other thread.
+// Server generates a stream whose byte i equals to (i % 251), client validates it.
+
+static constexpr uint16_t SERVER_PORT = 8881;
+static constexpr uint16_t CORK_PORT = 8896;
+static constexpr int ROUNDS = 2000;
+static constexpr size_t PART_SIZES[] = { 1, 17, 200, 4096, 70000 };
+
+class PatternWriter {
+public:
+    std::string next(size_t size) {
+        std::string result(size, '\0');
+        for (auto& c : result) {
+            c = static_cast<char>(mOffset++ % 251);
+        }
+        return result;
+    }
+    size_t offset() const noexcept { return mOffset; }
+private:
+    size_t mOffset = 0;
+};
+
+using span_type = TcpConnection::span_type;
+
+static span_type toSpan(const std::string& s) {
+    return { reinterpret_cast<const uint8_t *>(s.data()), s.size() };
+}
+
+// Send the stream by every kind of send API, return the bytes sent.
+static size_t sendPattern(const TcpConnectionPtr& conn) {
+    PatternWriter writer;
+    for (int i = 0; i != ROUNDS; ++i) {
+        auto small = PART_SIZES[static_cast<size_t>(i) % 3];
+        auto big = PART_SIZES[static_cast<size_t>(i) % std::size(PART_SIZES)];
+        switch (i % 5) {
+            case 0: conn->sendString(writer.next(small)); break;
+            case 1: {
+                auto s = writer.next(big);
+                conn->sendString(std::string_view { s });
+                break;
+            }
+            case 2: {
+                auto header = writer.next(small);
+                auto body = writer.next(big);
+                span_type parts[] = { toSpan(header), toSpan(body) };
+                conn->sendv(parts);
+                break;
+            }
+            case 3: {
+                auto header = writer.next(small);
+                auto batch = conn->batch();
+                batch.append(std::string_view { header }).append(writer.next(big)).append(writer.next(small));
+                break;
+            }
+            case 4: {
+                auto s = writer.next(big);
+                conn->send(std::vector<uint8_t> { s.begin(), s.end() });
+                break;
+            }
+        }
+    }
+    return writer.offset();
+}
+
+static bool readPattern(int fd, size_t total) {
+    std::vector<char> buf(65536);
+    size_t offset = 0;
+    while (offset < total) {
+        auto len = ::read(fd, buf.data(), std::min(buf.size(), total - offset));
+        if (len <= 0) {
+            std::cerr << "[SendQueueTest] read failed at " << offset << std::endl;
+            return false;
+        }
+        for (ssize_t i = 0; i != len; ++i, ++offset) {
+            if (buf[static_cast<size_t>(i)] != static_cast<char>(offset % 251)) {
+                std::cerr << "[SendQueueTest] bad byte at " << offset << std::endl;
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+static int getCork(const SocketPtr& socket) {
+    int flag = -1;
+    socklen_t len = sizeof(flag);
+    ::getsockopt(socket->getFd(), IPPROTO_TCP, TCP_CORK, &flag, &len);
+    return flag;
+}
+
+// The socket is corked while headers and file are written, and uncorked after that unless it's corked by
+// socket options.
+static bool testCork() {
+    char path[] = "/tmp/SendQueueTestXXXXXX";
+    auto tempFd = ::mkstemp(path);
+    if (tempFd < 0 || ::write(tempFd, "file", 4) != 4) {
+        return false;
+    }
+    ::close(tempFd);
+    std::shared_ptr<const FileDesc> file = FileDesc::createFileDesc(path, O_RDONLY | O_CLOEXEC, 0);
+    ::unlink(path);
+
+    auto listenSocket = Socket::createTcpListenSocket({ "127.0.0.1", IP_PROTOCOL::IPv4, CORK_PORT }, 16);
+    listenSocket->listen();
+    bool ok = true;
+    for (bool isCorked : { false, true }) {
+        SocketOptions options;
+        options.mCork = isCorked;
+        auto socket = Socket::createTcpClientSocket({ "127.0.0.1", IP_PROTOCOL::IPv4, CORK_PORT }, options);
+        // Wait for connecting.
+        std::this_thread::sleep_for(50ms);
+        std::string header = "header";
+        TcpSendSegment segments[] = {
+            TcpSendSegment { toSpan(header) },
+            TcpSendSegment { TcpFileRange { .mpFile = file, .mOffset = 0, .mSize = 4 } },
+        };
+        auto written = TcpSendQueue::writeSegments(socket, segments, TcpSendQueue::npos);
+        ok = ok && written == header.size() + 4 && getCork(socket) == (isCorked ? 1 : 0);
+    }
+    std::cout << "[SendQueueTest] cork of socket options is kept: " << (ok ? "success" : "FAIL") << std::endl;
+    return ok;
+}
+
+int main() {
+    std::promise<EventLoop*> loopPromise;
+    std::promise<size_t> totalPromise;
+    std::thread serverThread([&] {
+        EventLoop loop;
+        TcpServer server({ &loop, { "127.0.0.1", IP_PROTOCOL::IPv4, SERVER_PORT }, 16 });
+        server.setMessageCallback([&] (const TcpConnectionPtr& conn) {
+            auto command = conn->extractStringAll();
+            if (command == "loop") {
+                totalPromise.set_value(sendPattern(conn));
+            } else if (command == "thread") {
+                // Send from another thread, every send is a cross-thread hop.
+                std::thread([&totalPromise, conn] {
+                    totalPromise.set_value(sendPattern(conn));
+                }).detach();
+            }
+        });
+        server.start();
+        loopPromise.set_value(&loop);
+        loop.startLoop();
+    });
+    auto loop = loopPromise.get_future().get();
+
+    int result = 0;
+    for (std::string_view command : { "loop", "thread" }) {
+        totalPromise = std::promise<size_t> {};
+        auto totalFuture = totalPromise.get_future();
+        sockaddr_in addr {};
+        addr.sin_family = AF_INET;
+        addr.sin_port = htons(SERVER_PORT);
+        ::inet_pton(AF_INET, "127.0.0.1", &addr.sin_addr);
+        int fd = ::socket(AF_INET, SOCK_STREAM, 0);
+        if (::connect(fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) < 0) {
+            std::cerr << "[SendQueueTest] connect failed." << std::endl;
+            return 1;
+        }
+        auto start = steady_clock::now();
+        if (::write(fd, command.data(), command.size()) != static_cast<ssize_t>(command.size())) {
+            std::cerr << "[SendQueueTest] write failed." << std::endl;
+            return 1;
+        }
+        auto total = totalFuture.get();
+        bool success = readPattern(fd, total);
+        auto cost = duration_cast<microseconds>(steady_clock::now() - start).count();
+        std::cout << "[SendQueueTest] send in " << command << ": " << total << " bytes, "
+            << cost << "us, " << (success ? "success" : "failed") << std::endl;
+        if (!success) {
+            result = 1;
+        }
+        ::close(fd);
+    }
+
+    loop->queueInLoop([loop] {
+        loop->quitLoop();
+    });
+    serverThread.join();
+    if (!testCork()) {
+        result = 1;
+    }
+    return result;
+}
@@ -0,0 +1,170 @@
+#include "base/Log.h"
+#include "net/EventLoop.h"
+#include "tcp/TcpServer.h"
+#include "TestUtils.h"
+#include <chrono>
+#include <functional>
+#include <future>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+extern "C" {
+#include <unistd.h>
+#include <arpa/inet.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+}
+
+static constexpr std::string_view TAG = "SocketOptionBench";
+
+using namespace simpletcp;
+using namespace simpletcp::net;
+using namespace simpletcp::tcp;
+using namespace simpletcp::test;
+using namespace std::chrono;
+
+// Benchmark matrix of socket options on loopback. Every option is applied to an echo server
+// alone, the client is a plain blocking socket with default options.
+//  latency: round trip time of 64 bytes ping-pong.
+//  throughput: echo 64MB by 64KB writes, while another thread reads the echoed data.
+
+static constexpr uint16_t BASE_PORT = 8860;
+static constexpr size_t PING_SIZE = 64;
+static constexpr int MAX_PING_TIMES = 10000;
+static constexpr auto MAX_PING_DURATION = 1s;
+static constexpr size_t STREAM_CHUNK_SIZE = 64 * 1024;
+static constexpr size_t STREAM_TOTAL_SIZE = 64 * 1024 * 1024;
+
+struct BenchCase {
+    std::string_view    mName;
+    SocketOptions       mOptions;
+};
+
+static SocketOptions makeOptions(const std::function<void (SocketOptions&)>& setter) {
+    SocketOptions options {};
+    setter(options);
+    return options;
+}
+
+static int connectOrExit(uint16_t port) {
+    int fd = connectServer({ "127.0.0.1", IP_PROTOCOL::IPv4, port });
+    if (fd < 0) {
+        std::cerr << "[SocketOptionBench] connect failed." << std::endl;
+        std::exit(1);
+    }
+    return fd;
+}
+
+static void readFully(int fd, char* buf, size_t size) {
+    size_t readSize = 0;
+    while (readSize < size) {
+        auto len = ::read(fd, buf + readSize, size - readSize);
+        if (len <= 0) {
+            std::cerr << "[SocketOptionBench] read failed." << std::endl;
+            std::exit(1);
+        }
+        readSize += static_cast<size_t>(len);
+    }
+}
+
+static void writeFully(int fd, const char* buf, size_t size) {
+    size_t writeSize = 0;
+    while (writeSize < size) {
+        auto len = ::write(fd, buf + writeSize, size - writeSize);
+        if (len <= 0) {
+            std::cerr << "[SocketOptionBench] write failed." << std::endl;
+            std::exit(1);
+        }
+        writeSize += static_cast<size_t>(len);
+    }
+}
+
+// Return the average round trip time in microseconds.
+static double benchLatency(uint16_t port) {
+    int fd = connectOrExit(port);
+    int flag = 1;
+    ::setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &flag, sizeof(flag));
+    char buf[PING_SIZE] {};
+    int times = 0;
+    auto start = steady_clock::now();
+    while (times != MAX_PING_TIMES && steady_clock::now() - start < MAX_PING_DURATION) {
+        writeFully(fd, buf, sizeof(buf));
+        readFully(fd, buf, sizeof(buf));
+        ++times;
+    }
+    auto cost = duration_cast<nanoseconds>(steady_clock::now() - start).count();
+    ::close(fd);
+    return static_cast<double>(cost) / times / 1000;
+}
+
+// Return the throughput in MB/s.
+static double benchThroughput(uint16_t port) {
+    int fd = connectOrExit(port);
+    auto start = steady_clock::now();
+    std::thread writer([fd] {
+        std::vector<char> chunk(STREAM_CHUNK_SIZE, 'x');
+        for (size_t sent = 0; sent < STREAM_TOTAL_SIZE; sent += STREAM_CHUNK_SIZE) {
+            writeFully(fd, chunk.data(), chunk.size());
+        }
+    });
+    std::vector<char> buf(STREAM_CHUNK_SIZE);
+    for (size_t received = 0; received < STREAM_TOTAL_SIZE; received += STREAM_CHUNK_SIZE) {
+        readFully(fd, buf.data(), buf.size());
+    }
+    auto cost = duration_cast<microseconds>(steady_clock::now() - start).count();
+    writer.join();
+    ::close(fd);
+    return static_cast<double>(STREAM_TOTAL_SIZE) / static_cast<double>(cost);
+}
+
+static void runCase(const BenchCase& benchCase, uint16_t port) {
+    std::promise<EventLoop*> loopPromise;
+    std::thread serverThread([&] {
+        EventLoop loop;
+        TcpServer server({ &loop, { "127.0.0.1", IP_PROTOCOL::IPv4, port }, 128, 0
+                , TCP_DEFAULT_MAX_CONNECTION_NUM, benchCase.mOptions });
+        server.setMessageCallback([] (const TcpConnectionPtr& conn) {
+            conn->send(conn->extractAll());
+        });
+        server.start();
+        loopPromise.set_value(&loop);
+        loop.startLoop();
+    });
+    auto loop = loopPromise.get_future().get();
+
+    auto latency = benchLatency(port);
+    auto throughput = benchThroughput(port);
+    std::cout << "[SocketOptionBench] " << std::left << std::setw(24) << benchCase.mName
+        << std::right << std::fixed << std::setprecision(2)
+        << " latency: " << std::setw(10) << latency << " us"
+        << " throughput: " << std::setw(10) << throughput << " MB/s" << std::endl;
+
+    loop->queueInLoop([loop] {
+        loop->quitLoop();
+    });
+    serverThread.join();
+}
+
+int main() {
+    const std::vector<BenchCase> cases {
+        { "default",                makeOptions([] (SocketOptions&) {}) },
+        { "TCP_NODELAY",            makeOptions([] (SocketOptions& o) { o.mNoDelay = true; }) },
+        { "SO_SNDBUF/RCVBUF 4MB",   makeOptions([] (SocketOptions& o) { o.mSendBufSize = o.mRecvBufSize = 4 << 20; }) },
+        { "SO_SNDBUF/RCVBUF 16KB",  makeOptions([] (SocketOptions& o) { o.mSendBufSize = o.mRecvBufSize = 16 << 10; }) },
+        { "TCP_CORK",               makeOptions([] (SocketOptions& o) { o.mCork = true; }) },
+        { "TCP_QUICKACK",           makeOptions([] (SocketOptions& o) { o.mQuickAck = true; }) },
+        { "TCP_DEFER_ACCEPT 1s",    makeOptions([] (SocketOptions& o) { o.mDeferAccept = 1; }) },
+        { "TCP_NOTSENT_LOWAT 16KB", makeOptions([] (SocketOptions& o) { o.mNotSentLowat = 16 << 10; }) },
+        { "TCP_USER_TIMEOUT 5s",    makeOptions([] (SocketOptions& o) { o.mUserTimeout = 5000; }) },
+        { "SO_BUSY_POLL 50us",      makeOptions([] (SocketOptions& o) { o.mBusyPoll = 50; }) },
+    };
+    std::cout << "[SocketOptionBench] ping-pong " << PING_SIZE << " bytes, echo "
+        << (STREAM_TOTAL_SIZE >> 20) << "MB by " << (STREAM_CHUNK_SIZE >> 10) << "KB writes." << std::endl;
+    uint16_t port = BASE_PORT;
+    for (const auto& benchCase : cases) {
+        runCase(benchCase, port++);
+    }
+}
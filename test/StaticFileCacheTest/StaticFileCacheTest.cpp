@@ -0,0 +1,199 @@
+#include "base/Compress.h"
+#include "http/HttpError.h"
+#include "http/StaticFileCache.h"
+#include "TestUtils.h"
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <filesystem>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+static constexpr std::string_view TAG = "StaticFileCacheTest";
+
+using namespace simpletcp;
+using namespace simpletcp::http;
+using namespace simpletcp::test;
+using namespace std::chrono;
+
+static const std::filesystem::path TEST_DIR = std::filesystem::temp_directory_path() / "StaticFileCacheTest";
+
+static std::string makeHtml(size_t lines) {
+    std::string html = "<html><body>\n";
+    for (size_t i = 0; i != lines; ++i) {
+        html.append("<p>The quick brown fox jumps over the lazy dog, line ");
+        html.append(std::to_string(i));
+        html.append("</p>\n");
+    }
+    html.append("</body></html>\n");
+    return html;
+}
+
+static bool testHitAndReload() {
+    bool ok = true;
+    auto path = TEST_DIR / "index.html";
+    writeFile(path, makeHtml(10));
+    StaticFileCache cache { { .mStatInterval = milliseconds { 0 } } };
+
+    auto first = cache.getFile(path);
+    auto second = cache.getFile(path);
+    ok = expect(TAG, first != nullptr && first == second, "hit returns the same file") && ok;
+    ok = expect(TAG, first->getContentType() == ContentType::HTML, "content type") && ok;
+    ok = expect(TAG, first->getContent().stringView() == makeHtml(10), "content") && ok;
+    auto stats = cache.getStats();
+    ok = expect(TAG, stats.mMisses == 1 && stats.mHits == 1 && stats.mFiles == 1, "stats of hit") && ok;
+
+    // The rewritten file is noticed by stat, and the old one is still valid for its holders.
+    writeFile(path, makeHtml(20));
+    auto reloaded = cache.getFile(path);
+    ok = expect(TAG, reloaded != first && reloaded->getContent().stringView() == makeHtml(20), "reload") && ok;
+    ok = expect(TAG, reloaded->getETag() != first->getETag(), "etag changes") && ok;
+    ok = expect(TAG, first->getContent().stringView() == makeHtml(10), "old file is kept by holder") && ok;
+    ok = expect(TAG, cache.getStats().mReloads == 1, "stats of reload") && ok;
+
+    // The change is not noticed in the stat interval.
+    StaticFileCache throttled { { .mStatInterval = seconds { 60 } } };
+    auto cached = throttled.getFile(path);
+    writeFile(path, makeHtml(30));
+    ok = expect(TAG, throttled.getFile(path) == cached, "stat is throttled") && ok;
+
+    std::filesystem::remove(path);
+    try {
+        (void)cache.getFile(path);
+        ok = expect(TAG, false, "removed file") && ok;
+    } catch (const ResponseError& e) {
+        ok = expect(TAG, e.getErrorType() == ResponseErrorType::FileNotFound, "error of removed file") && ok;
+    }
+    ok = expect(TAG, cache.getStats().mFiles == 0, "removed file is erased") && ok;
+    return ok;
+}
+
+static bool testVariants() {
+    bool ok = true;
+    auto html = makeHtml(100);
+    auto htmlPath = TEST_DIR / "page.html";
+    auto tinyPath = TEST_DIR / "tiny.txt";
+    auto largePath = TEST_DIR / "large.html";
+    writeFile(htmlPath, html);
+    writeFile(tinyPath, "a");
+    writeFile(largePath, std::string(65536, 'x'));
+    StaticFileCache cache { { .mMaxFileSize = 32768 } };
+
+    auto file = cache.getFile(htmlPath);
+    auto gzip = file->getContent(EncodingType::GZIP);
+    auto deflate = file->getContent(EncodingType::DEFLATE);
+    ok = expect(TAG, file->isCompressible() && !gzip.empty() && gzip.size() < html.size(), "gzip variant") && ok;
+    ok = expect(TAG, utils::uncompress_gzip(gzip.stringView(), html.size()) == html, "gzip round trip") && ok;
+    ok = expect(TAG, utils::uncompress_deflate(deflate.stringView(), html.size()) == html, "deflate round trip") && ok;
+    ok = expect(TAG, file->getContent(EncodingType::GZIP).data() == gzip.data(), "variant is built once") && ok;
+    ok = expect(TAG, file->getCachedBytes() == html.size() + gzip.size() + deflate.size(), "cached bytes") && ok;
+    // Every encoding is a different representation, its validator differs.
+    auto etag = file->getETag();
+    ok = expect(TAG, etag.ends_with('"') && file->getETag(EncodingType::GZIP) != etag
+            && file->getETag(EncodingType::GZIP) != file->getETag(EncodingType::DEFLATE)
+            && file->getETag(EncodingType::GZIP).ends_with("-gzip\""), "etag of variants") && ok;
+
+    auto tiny = cache.getFile(tinyPath);
+    ok = expect(TAG, tiny->getContent(EncodingType::GZIP).empty(), "tiny file is not compressed") && ok;
+    ok = expect(TAG, cache.getFile(largePath) == nullptr, "large file is not cached") && ok;
+    return ok;
+}
+
+static bool testEviction() {
+    bool ok = true;
+    std::vector<std::filesystem::path> paths;
+    for (size_t i = 0; i != 4; ++i) {
+        paths.push_back(TEST_DIR / ("file" + std::to_string(i) + ".txt"));
+        writeFile(paths.back(), std::string(1000, static_cast<char>('a' + i)));
+    }
+    StaticFileCache cache { { .mCapacity = 3000 } };
+    for (size_t i = 0; i != 3; ++i) {
+        (void)cache.getFile(paths[i]);
+        std::this_thread::sleep_for(milliseconds { 1 });
+    }
+    // file0 is used recently, file1 is the least recently used one.
+    auto file0 = cache.getFile(paths[0]);
+    std::this_thread::sleep_for(milliseconds { 1 });
+    (void)cache.getFile(paths[3]);
+    auto stats = cache.getStats();
+    ok = expect(TAG, stats.mEvictions == 1 && stats.mFiles == 3 && stats.mBytes == 3000, "evict one file") && ok;
+    ok = expect(TAG, cache.getFile(paths[0]) == file0, "recently used file is kept") && ok;
+    auto misses = cache.getStats().mMisses;
+    (void)cache.getFile(paths[1]);
+    ok = expect(TAG, cache.getStats().mMisses == misses + 1, "lru file is evicted") && ok;
+    return ok;
+}
+
+static bool testConcurrentReaders() {
+    auto html = makeHtml(100);
+    auto path = TEST_DIR / "shared.html";
+    writeFile(path, html);
+    StaticFileCache cache { { .mStatInterval = milliseconds { 0 } } };
+    constexpr size_t THREAD_NUM = 4;
+    constexpr size_t ITERATIONS = 2000;
+    std::atomic<size_t> errors = 0;
+    std::vector<std::thread> threads;
+    for (size_t i = 0; i != THREAD_NUM; ++i) {
+        threads.emplace_back([&] {
+            for (size_t j = 0; j != ITERATIONS; ++j) {
+                auto file = cache.getFile(path);
+                auto gzip = file->getContent(EncodingType::GZIP);
+                if (file->getSize() != html.size() || gzip.empty()) {
+                    errors.fetch_add(1);
+                }
+            }
+        });
+    }
+    for (auto& thread : threads) {
+        thread.join();
+    }
+    auto stats = cache.getStats();
+    return expect(TAG, errors == 0 && stats.mHits + stats.mMisses + stats.mReloads == THREAD_NUM * ITERATIONS
+            , "concurrent readers");
+}
+
+// Serve a small compressible file from cache, and by reading and compressing it for every request.
+static void benchServe() {
+    auto html = makeHtml(100);
+    auto path = TEST_DIR / "bench.html";
+    writeFile(path, html);
+    constexpr size_t ITERATIONS = 20000;
+    size_t bytes = 0;
+
+    StaticFileCache cache;
+    auto start = steady_clock::now();
+    for (size_t i = 0; i != ITERATIONS; ++i) {
+        bytes += cache.getFile(path)->getContent(EncodingType::GZIP).size();
+    }
+    auto cached = duration_cast<nanoseconds>(steady_clock::now() - start).count();
+
+    start = steady_clock::now();
+    for (size_t i = 0; i != ITERATIONS / 20; ++i) {
+        std::ifstream file { path, std::ios::in | std::ios::binary };
+        std::string content(std::filesystem::file_size(path), '\0');
+        file.read(content.data(), static_cast<std::streamsize>(content.size()));
+        bytes += utils::compress_gzip(content).size();
+    }
+    auto uncached = duration_cast<nanoseconds>(steady_clock::now() - start).count() * 20;
+
+    std::cout << "[" << TAG << "] serve " << html.size() << " bytes gzip: cached " << std::fixed
+        << std::setprecision(0) << static_cast<double>(cached) / ITERATIONS << " ns, read and compress "
+        << static_cast<double>(uncached) / ITERATIONS << " ns (" << bytes << " bytes)" << std::endl;
+}
+
+int main() {
+    std::filesystem::create_directories(TEST_DIR);
+    bool ok = testHitAndReload();
+    ok = testVariants() && ok;
+    ok = testEviction() && ok;
+    ok = testConcurrentReaders() && ok;
+    benchServe();
+    std::filesystem::remove_all(TEST_DIR);
+    std::cout << "[" << TAG << "] " << (ok ? "success" : "FAIL") << std::endl;
+    return ok ? 0 : 1;
+}
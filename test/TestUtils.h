@@ -0,0 +1,51 @@
+#pragma once
+
+#include "net/Socket.h"
+#include <cerrno>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <string_view>
+
+extern "C" {
+#include <unistd.h>
+#include <sys/socket.h>
+}
+
+// Helpers shared by tests and benches.
+namespace simpletcp::test {
+
+// Print the failed check with tag of test, return condition so checks are chained by &&.
+inline bool expect(std::string_view tag, bool condition, std::string_view message) {
+    if (!condition) {
+        std::cerr << "[" << tag << "] " << message << " failed!" << std::endl;
+    }
+    return condition;
+}
+
+inline void writeFile(const std::filesystem::path& path, std::string_view content) {
+    std::ofstream file { path, std::ios::out | std::ios::binary | std::ios::trunc };
+    file.write(content.data(), static_cast<std::streamsize>(content.size()));
+}
+
+// Connect to server by blocking socket, return -1 with errno set if it fails.
+inline int connectServer(const net::SocketAddr& serverAddr) {
+    auto addr = net::RawSockAddr::fromSocketAddr(serverAddr);
+    if (!addr) {
+        errno = EINVAL;
+        return -1;
+    }
+    int fd = ::socket(addr->getFamily(), SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (fd < 0) {
+        return -1;
+    }
+    if (::connect(fd, addr->get(), addr->getLength()) < 0) {
+        auto error = errno;
+        ::close(fd);
+        errno = error;
+        return -1;
+    }
+    return fd;
+}
+
+} // namespace simpletcp::test
@@ -0,0 +1,209 @@
+#include "base/Log.h"
+#include "net/EventLoop.h"
+#include "net/FileDesc.h"
+#include "tcp/TcpClient.h"
+#include "tcp/TcpServer.h"
+#include "tcp/Tls.h"
+#include <chrono>
+#include <cstdio>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <vector>
+
+extern "C" {
+#include <fcntl.h>
+#include <unistd.h>
+#include <openssl/evp.h>
+#include <openssl/pem.h>
+#include <openssl/x509.h>
+}
+
+static constexpr std::string_view TAG = "TlsBench";
+
+using namespace simpletcp;
+using namespace simpletcp::net;
+using namespace simpletcp::tcp;
+using namespace std::chrono;
+
+// Server sends a stream to client on loopback, client verifies every byte.
+//  plain: no TLS.
+//  tls: records are encrypted by OpenSSL in user-space.
+//  ktls: records are encrypted by kernel after handshake, it falls back to user-space if kernel has no
+//        tls module.
+// The stream is sent from memory(SharedBuffer slices) or from file(sendFile).
+
+static constexpr uint16_t SERVER_PORT = 8887;
+static constexpr size_t DATA_SIZE = 128 * 1024 * 1024;
+static constexpr size_t SLICE_SIZE = 65536;
+
+enum class TlsMode {
+    Plain,
+    UserSpace,
+    Kernel,
+};
+
+// Byte i of stream equals to (i % 251).
+static uint8_t patternAt(size_t offset) {
+    return static_cast<uint8_t>(offset % 251);
+}
+
+// Generate a self-signed certificate of P-256 key for localhost.
+static bool generateCertificate(const std::string& certFile, const std::string& keyFile) {
+    auto key = ::EVP_EC_gen("P-256");
+    auto cert = ::X509_new();
+    bool ok = key != nullptr && cert != nullptr;
+    if (ok) {
+        ::ASN1_INTEGER_set(::X509_get_serialNumber(cert), 1);
+        ::X509_gmtime_adj(::X509_getm_notBefore(cert), 0);
+        ::X509_gmtime_adj(::X509_getm_notAfter(cert), 3600);
+        ::X509_set_pubkey(cert, key);
+        auto name = ::X509_get_subject_name(cert);
+        ::X509_NAME_add_entry_by_txt(name, "CN", MBSTRING_ASC, reinterpret_cast<const unsigned char *>("localhost")
+                , -1, -1, 0);
+        ::X509_set_issuer_name(cert, name);
+        ok = ::X509_sign(cert, key, ::EVP_sha256()) > 0;
+    }
+    if (ok) {
+        auto certFp = std::fopen(certFile.c_str(), "w");
+        auto keyFp = std::fopen(keyFile.c_str(), "w");
+        ok = certFp != nullptr && keyFp != nullptr
+            && ::PEM_write_X509(certFp, cert) == 1
+            && ::PEM_write_PrivateKey(keyFp, key, nullptr, nullptr, 0, nullptr, nullptr) == 1;
+        if (certFp != nullptr) {
+            std::fclose(certFp);
+        }
+        if (keyFp != nullptr) {
+            std::fclose(keyFp);
+        }
+    }
+    ::X509_free(cert);
+    ::EVP_PKEY_free(key);
+    return ok;
+}
+
+static bool generateFile(const std::string& path) {
+    std::vector<uint8_t> data(DATA_SIZE);
+    for (size_t i = 0; i != DATA_SIZE; ++i) {
+        data[i] = patternAt(i);
+    }
+    auto fp = std::fopen(path.c_str(), "w");
+    if (fp == nullptr) {
+        return false;
+    }
+    auto ok = std::fwrite(data.data(), 1, data.size(), fp) == data.size();
+    std::fclose(fp);
+    return ok;
+}
+
+struct CaseResult {
+    bool    mOk = false;
+    bool    mKtlsSend = false;
+    double  mSpeed = 0;
+};
+
+static CaseResult runCase(TlsMode mode, bool fromFile, const TlsContextArgs& certArgs, const std::string& filePath) {
+    CaseResult result;
+    TlsContextPtr serverContext;
+    TlsContextPtr clientContext;
+    if (mode != TlsMode::Plain) {
+        auto args = certArgs;
+        args.enableKtls = mode == TlsMode::Kernel;
+        serverContext = TlsContext::createServerContext(args);
+        TlsContextArgs clientArgs;
+        clientArgs.caFile = args.certFile;
+        clientArgs.verifyPeer = true;
+        clientArgs.enableKtls = args.enableKtls;
+        clientContext = TlsContext::createClientContext(clientArgs);
+    }
+    std::vector<uint8_t> stream(DATA_SIZE);
+    for (size_t i = 0; i != DATA_SIZE; ++i) {
+        stream[i] = patternAt(i);
+    }
+    auto data = SharedBuffer::fromVector(std::move(stream));
+    std::shared_ptr<const FileDesc> file = FileDesc::createFileDesc(filePath, O_RDONLY, 0);
+
+    EventLoop loop;
+    steady_clock::time_point start;
+    TcpServer server({ &loop, { "127.0.0.1", IP_PROTOCOL::IPv4, SERVER_PORT }, 16, 0
+            , TCP_DEFAULT_MAX_CONNECTION_NUM, {}, TcpBufferMode::Linear, 0, 0, serverContext });
+    server.setConnectionCallback([&] (const TcpConnectionPtr& conn) {
+        if (!conn->isConnected()) {
+            return;
+        }
+        // The connection callback is invoked after handshake, so only transfer is measured.
+        result.mKtlsSend = conn->getTlsSession() != nullptr && conn->getTlsSession()->isKtlsSend();
+        start = steady_clock::now();
+        if (fromFile) {
+            conn->sendFile(file, 0, DATA_SIZE);
+            return;
+        }
+        for (size_t offset = 0; offset < DATA_SIZE; offset += SLICE_SIZE) {
+            conn->send(data.slice(offset, SLICE_SIZE));
+        }
+    });
+    server.start();
+
+    TcpClient client(&loop, { "127.0.0.1", IP_PROTOCOL::IPv4, SERVER_PORT });
+    if (clientContext) {
+        client.setTlsContext(clientContext, "localhost");
+    }
+    size_t received = 0;
+    bool valid = true;
+    client.setMessageCallback([&] (const TcpConnectionPtr& conn) {
+        auto bytes = conn->readAll();
+        for (size_t i = 0; i != bytes.size(); ++i) {
+            valid = valid && bytes[i] == patternAt(received + i);
+        }
+        received += bytes.size();
+        conn->extractShared(bytes.size());
+        if (received >= DATA_SIZE || !valid) {
+            auto cost = duration<double>(steady_clock::now() - start).count();
+            result.mSpeed = static_cast<double>(received) / cost / 1024 / 1024;
+            result.mOk = valid && received == DATA_SIZE;
+            loop.quitLoop();
+        }
+    });
+    client.setConnectionCallback([&] (const TcpConnectionPtr& conn) {
+        if (!conn->isConnected() && received != DATA_SIZE) {
+            // Handshake failed or connection is reset.
+            loop.quitLoop();
+        }
+    });
+    client.connect();
+    loop.startLoop();
+    return result;
+}
+
+int main() {
+    std::string certFile = "/tmp/TlsBench_cert.pem";
+    std::string keyFile = "/tmp/TlsBench_key.pem";
+    std::string dataFile = "/tmp/TlsBench_data.bin";
+    if (!generateCertificate(certFile, keyFile) || !generateFile(dataFile)) {
+        std::cout << "[TlsBench] failed to generate certificate or data file" << std::endl;
+        return 1;
+    }
+    TlsContextArgs certArgs;
+    certArgs.certFile = certFile;
+    certArgs.keyFile = keyFile;
+    std::cout << "[TlsBench] bytes: " << DATA_SIZE << std::endl;
+    bool ok = true;
+    for (auto fromFile : { false, true }) {
+        for (auto mode : { TlsMode::Plain, TlsMode::UserSpace, TlsMode::Kernel }) {
+            auto result = runCase(mode, fromFile, certArgs, dataFile);
+            std::string_view name = mode == TlsMode::Plain ? "plain" : mode == TlsMode::UserSpace ? "tls  " : "ktls ";
+            std::cout << std::fixed << std::setprecision(2) << "[TlsBench] " << name
+                << (fromFile ? " sendFile" : " memory  ") << " speed: " << result.mSpeed << "MB/s";
+            if (mode == TlsMode::Kernel) {
+                std::cout << (result.mKtlsSend ? " (kTLS send)" : " (kTLS unavailable, user-space fallback)");
+            }
+            std::cout << (result.mOk ? " success" : " FAIL") << std::endl;
+            ok = result.mOk && ok;
+        }
+    }
+    ::unlink(certFile.c_str());
+    ::unlink(keyFile.c_str());
+    ::unlink(dataFile.c_str());
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,255 @@
+#include "base/Log.h"
+#include "net/EventLoop.h"
+#include "net/Socket.h"
+#include "net/UdpServer.h"
+#include "net/UdpSocket.h"
+#include <atomic>
+#include <chrono>
+#include <future>
+#include <iomanip>
+#include <iostream>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+extern "C" {
+#include <poll.h>
+}
+
+static constexpr std::string_view TAG = "UdpBench";
+
+using namespace simpletcp;
+using namespace simpletcp::net;
+using namespace std::chrono;
+
+// Sender thread blasts datagrams to UdpServer on loopback for a while, server counts them.
+//  batch: count of datagrams moved by one recvmmsg/sendmmsg on both sides, 1 acts as recvfrom/sendto.
+//  gso/gro: sender writes super packets, and server receives super packets and splits them.
+//  shards: server sockets bound by SO_REUSEPORT in sub loops, sender uses several flows.
+// The pps is counted by server, datagrams dropped by kernel because of full receive buffer are
+// reported as loss.
+
+static constexpr uint16_t SERVER_PORT = 8890;
+static constexpr auto SEND_DURATION = 1s;
+
+struct BenchCase {
+    std::string_view    mName;
+    size_t              mBatchSize;
+    size_t              mPacketSize;
+    bool                mOffload;
+    int                 mThreadNum;
+    size_t              mFlows;
+};
+
+struct ServerCounter {
+    std::atomic<uint64_t>   mPackets { 0 };
+    std::atomic<uint64_t>   mBadPackets { 0 };
+    std::atomic<int64_t>    mFirstNs { 0 };
+    std::atomic<int64_t>    mLastNs { 0 };
+    std::mutex              mMutex;
+    std::unordered_map<std::thread::id, uint64_t>
+                            mShards;
+};
+
+static int64_t nowNs() {
+    return duration_cast<nanoseconds>(steady_clock::now().time_since_epoch()).count();
+}
+
+static UdpSocketOptions makeOptions(const BenchCase& bench) {
+    UdpSocketOptions options;
+    options.mBatchSize = bench.mBatchSize;
+    options.mMaxPacketSize = bench.mPacketSize;
+    options.mEnableGro = bench.mOffload;
+    options.mEnableGso = bench.mOffload;
+    options.mSocketOptions.mRecvBufSize = 4 * 1024 * 1024;
+    options.mSocketOptions.mSendBufSize = 4 * 1024 * 1024;
+    return options;
+}
+
+// Run server in a thread, return when the thread quits.
+class ServerThread {
+public:
+    ServerThread(const BenchCase& bench, ServerCounter& counter) {
+        std::promise<EventLoop*> loopPromise;
+        mThread = std::thread([&] {
+            EventLoop loop;
+            UdpServer server({ &loop, { "127.0.0.1", IP_PROTOCOL::IPv4, SERVER_PORT }, bench.mThreadNum
+                    , makeOptions(bench) });
+            server.setMessageCallback([&counter, size = bench.mPacketSize] (UdpSocket& socket
+                    , std::span<const UdpPacket> packets) {
+                static_cast<void>(socket);
+                uint64_t bad = 0;
+                for (auto& packet : packets) {
+                    bad += packet.mData.size() == size ? 0 : 1;
+                }
+                auto now = nowNs();
+                int64_t expected = 0;
+                counter.mFirstNs.compare_exchange_strong(expected, now, std::memory_order_relaxed);
+                counter.mLastNs.store(now, std::memory_order_relaxed);
+                counter.mPackets.fetch_add(packets.size(), std::memory_order_relaxed);
+                counter.mBadPackets.fetch_add(bad, std::memory_order_relaxed);
+                std::lock_guard lock { counter.mMutex };
+                counter.mShards[std::this_thread::get_id()] += packets.size();
+            });
+            server.start();
+            mSockets = server.getSocketNums();
+            mpLoop = &loop;
+            loopPromise.set_value(&loop);
+            loop.startLoop();
+            mStats = server.getStats();
+        });
+        loopPromise.get_future().wait();
+    }
+
+    // Quit server and return its statistics.
+    UdpStats stop() {
+        mpLoop->queueInLoop([loop = mpLoop] {
+            loop->quitLoop();
+        });
+        mThread.join();
+        return mStats;
+    }
+
+    [[nodiscard]]
+    size_t getSocketNums() const noexcept { return mSockets; }
+
+private:
+    std::thread mThread;
+    EventLoop*  mpLoop = nullptr;
+    size_t      mSockets = 0;
+    UdpStats    mStats;
+};
+
+// Send datagrams for SEND_DURATION, return the count of datagrams sent.
+static uint64_t blast(const BenchCase& bench) {
+    EventLoop loop;
+    std::vector<UdpSocketPtr> flows;
+    for (size_t i = 0; i != bench.mFlows; ++i) {
+        flows.push_back(UdpSocket::createUdpSocket(&loop
+                , Socket::createUdpClientSocket({ "127.0.0.1", IP_PROTOCOL::IPv4, SERVER_PORT }), makeOptions(bench)));
+    }
+    std::vector<uint8_t> data(bench.mPacketSize, 'x');
+    uint64_t sent = 0;
+    auto deadline = steady_clock::now() + SEND_DURATION;
+    while (steady_clock::now() < deadline) {
+        for (auto& flow : flows) {
+            for (size_t i = 0; i != bench.mBatchSize; ++i) {
+                while (!flow->send(data)) {
+                    // Send buffer is full, wait for it.
+                    pollfd fd { flow->getFd(), POLLOUT, 0 };
+                    ::poll(&fd, 1, 100);
+                    flow->flush();
+                }
+            }
+            flow->flush();
+        }
+        sent += bench.mBatchSize * flows.size();
+    }
+    for (auto& flow : flows) {
+        while (flow->getPendingPackets() != 0) {
+            pollfd fd { flow->getFd(), POLLOUT, 0 };
+            ::poll(&fd, 1, 100);
+            flow->flush();
+        }
+    }
+    return sent;
+}
+
+static bool runCase(const BenchCase& bench) {
+    ServerCounter counter;
+    ServerThread server { bench, counter };
+    auto sent = std::async(std::launch::async, blast, bench).get();
+    // Wait for server to drain its receive buffer.
+    for (auto received = counter.mPackets.load(); ; ) {
+        std::this_thread::sleep_for(100ms);
+        auto now = counter.mPackets.load();
+        if (now == received) {
+            break;
+        }
+        received = now;
+    }
+    auto stats = server.stop();
+    auto received = counter.mPackets.load();
+    auto seconds = static_cast<double>(counter.mLastNs - counter.mFirstNs) / 1e9;
+    auto pps = seconds > 0 ? static_cast<double>(received) / seconds : 0;
+    auto perBatch = stats.mRecvBatches != 0
+        ? static_cast<double>(stats.mRecvPackets) / static_cast<double>(stats.mRecvBatches) : 0;
+    // Every socket should receive some flows, sub loops are limited by the count of CPUs.
+    auto ok = received > 0 && counter.mBadPackets == 0 && counter.mShards.size() == server.getSocketNums();
+    std::cout << "[UdpBench] " << std::left << std::setw(16) << bench.mName << std::right << std::fixed
+        << std::setprecision(0) << " recv: " << std::setw(9) << pps << " pps, " << std::setw(8)
+        << pps * static_cast<double>(bench.mPacketSize) / 1024 / 1024 << " MB/s, " << std::setprecision(1)
+        << std::setw(5) << perBatch << " packets/recvmmsg, loss " << std::setw(5)
+        << (sent != 0 ? 100.0 * static_cast<double>(sent - std::min(sent, received)) / static_cast<double>(sent) : 0)
+        << "%, shards " << counter.mShards.size() << "/" << server.getSocketNums() << (ok ? " success" : " FAIL") << std::endl;
+    return ok;
+}
+
+// Server echoes datagrams to their sources, client verifies the reply.
+static bool runEcho() {
+    std::promise<EventLoop*> loopPromise;
+    std::thread serverThread([&] {
+        EventLoop loop;
+        UdpServer server({ &loop, { "127.0.0.1", IP_PROTOCOL::IPv4, SERVER_PORT } });
+        server.setMessageCallback([] (UdpSocket& socket, std::span<const UdpPacket> packets) {
+            for (auto& packet : packets) {
+                socket.send(packet.mData, *packet.mpPeerAddr);
+            }
+        });
+        server.start();
+        loopPromise.set_value(&loop);
+        loop.startLoop();
+    });
+    auto serverLoop = loopPromise.get_future().get();
+
+    EventLoop loop;
+    auto client = UdpSocket::createUdpSocket(&loop
+            , Socket::createUdpClientSocket({ "127.0.0.1", IP_PROTOCOL::IPv4, SERVER_PORT }));
+    std::string reply;
+    client->setMessageCallback([&] (UdpSocket&, std::span<const UdpPacket> packets) {
+        for (auto& packet : packets) {
+            reply.append(packet.mData.begin(), packet.mData.end());
+        }
+        if (reply.size() >= 8) {
+            loop.quitLoop();
+        }
+    });
+    client->start();
+    std::string_view message = "ping";
+    for (int i = 0; i != 2; ++i) {
+        client->send({ reinterpret_cast<const uint8_t *>(message.data()), message.size() });
+    }
+    client->flush();
+    loop.runAfter([&loop] {
+        loop.quitLoop();
+    }, 2s);
+    loop.startLoop();
+    client = nullptr;
+
+    serverLoop->queueInLoop([serverLoop] {
+        serverLoop->quitLoop();
+    });
+    serverThread.join();
+    auto ok = reply == "pingping";
+    std::cout << "[UdpBench] echo " << (ok ? "success" : "FAIL") << std::endl;
+    return ok;
+}
+
+int main() {
+    bool ok = runEcho();
+    std::vector<BenchCase> cases {
+        { "batch 1", 1, 64, false, 0, 1 },
+        { "batch 64", 64, 64, false, 0, 1 },
+        { "batch 1 1200B", 1, 1200, false, 0, 1 },
+        { "batch 64 1200B", 64, 1200, false, 0, 1 },
+        { "gso/gro 1200B", 64, 1200, true, 0, 1 },
+        { "shards 2", 64, 64, false, 2, 8 },
+    };
+    for (auto& bench : cases) {
+        ok = runCase(bench) && ok;
+    }
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,212 @@
+#include "base/Log.h"
+#include "net/EventLoop.h"
+#include "tcp/TcpClient.h"
+#include "tcp/TcpServer.h"
+#include "TestUtils.h"
+#include <chrono>
+#include <filesystem>
+#include <future>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+extern "C" {
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+}
+
+static constexpr std::string_view TAG = "UnixSocketBench";
+
+using namespace simpletcp;
+using namespace simpletcp::net;
+using namespace simpletcp::tcp;
+using namespace simpletcp::test;
+using namespace std::chrono;
+
+// Echo server on loopback TCP, Unix domain socket file and Unix domain abstract name.
+//  latency: round trip time of 64 bytes ping-pong by a blocking client.
+//  throughput: echo 256MB by 64KB writes, while another thread reads the echoed data.
+//  client: TcpClient connects to server and receives one echo, to check the client side.
+
+static constexpr size_t PING_SIZE = 64;
+static constexpr int PING_TIMES = 20000;
+static constexpr size_t STREAM_CHUNK_SIZE = 64 * 1024;
+static constexpr size_t STREAM_TOTAL_SIZE = 256 * 1024 * 1024;
+
+static int connectOrExit(const SocketAddr& serverAddr) {
+    int fd = connectServer(serverAddr);
+    if (fd < 0) {
+        std::cerr << "[UnixSocketBench] connect failed." << std::endl;
+        std::exit(1);
+    }
+    return fd;
+}
+
+static void readFully(int fd, char* buf, size_t size) {
+    size_t readSize = 0;
+    while (readSize < size) {
+        auto len = ::read(fd, buf + readSize, size - readSize);
+        if (len <= 0) {
+            std::cerr << "[UnixSocketBench] read failed." << std::endl;
+            std::exit(1);
+        }
+        readSize += static_cast<size_t>(len);
+    }
+}
+
+static void writeFully(int fd, const char* buf, size_t size) {
+    size_t writeSize = 0;
+    while (writeSize < size) {
+        auto len = ::write(fd, buf + writeSize, size - writeSize);
+        if (len <= 0) {
+            std::cerr << "[UnixSocketBench] write failed." << std::endl;
+            std::exit(1);
+        }
+        writeSize += static_cast<size_t>(len);
+    }
+}
+
+// Return the average round trip time in microseconds.
+static double benchLatency(const SocketAddr& serverAddr) {
+    int fd = connectOrExit(serverAddr);
+    if (serverAddr.mIpProtocol != IP_PROTOCOL::Unix) {
+        int flag = 1;
+        ::setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &flag, sizeof(flag));
+    }
+    char buf[PING_SIZE] {};
+    auto start = steady_clock::now();
+    for (int i = 0; i != PING_TIMES; ++i) {
+        writeFully(fd, buf, sizeof(buf));
+        readFully(fd, buf, sizeof(buf));
+    }
+    auto cost = duration_cast<nanoseconds>(steady_clock::now() - start).count();
+    ::close(fd);
+    return static_cast<double>(cost) / PING_TIMES / 1000;
+}
+
+// Return the throughput in MB/s.
+static double benchThroughput(const SocketAddr& serverAddr) {
+    int fd = connectOrExit(serverAddr);
+    auto start = steady_clock::now();
+    std::thread writer([fd] {
+        std::vector<char> chunk(STREAM_CHUNK_SIZE, 'x');
+        for (size_t sent = 0; sent < STREAM_TOTAL_SIZE; sent += STREAM_CHUNK_SIZE) {
+            writeFully(fd, chunk.data(), chunk.size());
+        }
+    });
+    std::vector<char> buf(STREAM_CHUNK_SIZE);
+    for (size_t received = 0; received < STREAM_TOTAL_SIZE; received += STREAM_CHUNK_SIZE) {
+        readFully(fd, buf.data(), buf.size());
+    }
+    auto cost = duration_cast<microseconds>(steady_clock::now() - start).count();
+    writer.join();
+    ::close(fd);
+    return static_cast<double>(STREAM_TOTAL_SIZE) / static_cast<double>(cost);
+}
+
+static bool runCase(std::string_view name, const SocketAddr& serverAddr) {
+    std::promise<EventLoop*> loopPromise;
+    std::thread serverThread([&] {
+        EventLoop loop;
+        TcpServer server({ &loop, serverAddr, 128 });
+        server.setMessageCallback([] (const TcpConnectionPtr& conn) {
+            conn->send(conn->extractAll());
+        });
+        server.start();
+        loopPromise.set_value(&loop);
+        loop.startLoop();
+    });
+    auto loop = loopPromise.get_future().get();
+
+    auto latency = benchLatency(serverAddr);
+    auto throughput = benchThroughput(serverAddr);
+
+    // TcpClient and its connection must live in a loop thread.
+    std::promise<bool> clientPromise;
+    std::thread clientThread([&] {
+        EventLoop clientLoop;
+        TcpClient client(&clientLoop, serverAddr);
+        bool ok = false;
+        client.setConnectionCallback([] (const TcpConnectionPtr& conn) {
+            if (conn->isConnected()) {
+                conn->sendString(std::string_view { "ping" });
+            }
+        });
+        client.setMessageCallback([&] (const TcpConnectionPtr& conn) {
+            if (conn->getBufferSize() >= 4) {
+                ok = conn->extractString(4) == "ping";
+                clientLoop.quitLoop();
+            }
+        });
+        client.connect();
+        clientLoop.startLoop();
+        clientPromise.set_value(ok);
+    });
+    auto clientFuture = clientPromise.get_future();
+    auto clientOk = clientFuture.wait_for(10s) == std::future_status::ready && clientFuture.get();
+    clientThread.join();
+
+    std::cout << "[UnixSocketBench] " << std::left << std::setw(10) << name
+        << std::right << std::fixed << std::setprecision(2)
+        << " latency: " << std::setw(8) << latency << " us"
+        << " throughput: " << std::setw(10) << throughput << " MB/s"
+        << " client: " << (clientOk ? "success" : "FAIL") << std::endl;
+
+    loop->queueInLoop([loop] {
+        loop->quitLoop();
+    });
+    serverThread.join();
+    return clientOk;
+}
+
+// The socket file left by a crashed server is replaced by listen, but a regular file at the path or the
+// file of a live server is never removed.
+static bool testSocketFile() {
+    const std::string path = "/tmp/SimpleTcp_UnixSocketBench_file.sock";
+    auto isSocketFile = [&path] {
+        struct stat st {};
+        return ::lstat(path.c_str(), &st) == 0 && S_ISSOCK(st.st_mode);
+    };
+    std::filesystem::remove(path);
+    bool ok = true;
+    {
+        writeFile(path, "data");
+        auto socket = Socket::createTcpListenSocket({ path, IP_PROTOCOL::Unix, 0 }, 16);
+    }
+    ok = expect(TAG, std::filesystem::is_regular_file(path), "regular file is kept") && ok;
+    std::filesystem::remove(path);
+    {
+        // Bind without listen, so the file is stale after close.
+        auto addr = RawSockAddr::fromSocketAddr({ path, IP_PROTOCOL::Unix, 0 });
+        int fd = ::socket(AF_UNIX, SOCK_STREAM, 0);
+        ::bind(fd, addr->get(), addr->getLength());
+        ::close(fd);
+        auto socket = Socket::createTcpListenSocket({ path, IP_PROTOCOL::Unix, 0 }, 16);
+        socket->listen();
+        int client = connectServer({ path, IP_PROTOCOL::Unix, 0 });
+        ok = expect(TAG, client >= 0, "listen replaces stale socket file") && ok;
+        ::close(client);
+        {
+            // A listen socket of the same path which isn't listening yet, it's destroyed before its owner.
+            auto other = Socket::createTcpListenSocket({ path, IP_PROTOCOL::Unix, 0 }, 16);
+        }
+        ok = expect(TAG, isSocketFile(), "socket file of live server is kept") && ok;
+    }
+    ok = expect(TAG, !isSocketFile(), "socket file is removed by its server") && ok;
+    std::cout << "[UnixSocketBench] socket file: " << (ok ? "success" : "FAIL") << std::endl;
+    return ok;
+}
+
+int main() {
+    std::cout << "[UnixSocketBench] ping-pong " << PING_SIZE << " bytes " << PING_TIMES << " times, echo "
+        << (STREAM_TOTAL_SIZE >> 20) << "MB by " << (STREAM_CHUNK_SIZE >> 10) << "KB writes." << std::endl;
+    bool ok = true;
+    ok = runCase("tcp", { "127.0.0.1", IP_PROTOCOL::IPv4, 8889 }) && ok;
+    ok = runCase("unix path", { "/tmp/SimpleTcp_UnixSocketBench.sock", IP_PROTOCOL::Unix, 0 }) && ok;
+    ok = runCase("abstract", { "@SimpleTcp_UnixSocketBench", IP_PROTOCOL::Unix, 0 }) && ok;
+    ok = testSocketFile() && ok;
+    return ok ? 0 : 1;
+}